@@ -13,11 +13,132 @@
 | Mesh MUST be triangulated - quads not accepted                               |
 | Mesh MUST contain vertex points, normals, and texture coordinates            |
 | Faces MUST come after all other data in the .obj file                        |
+| The file is memory-mapped and parsed in a single pass into growable arrays   |
+| Numbers are read with apg_parse.h rather than sscanf                         |
 \******************************************************************************/
 #include "obj_parser.h"
+#include "apg_parse.h"
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+// wall-clock time in seconds, used to report parse throughput
+static double obj_time_s () {
+#ifdef _WIN32
+	LARGE_INTEGER freq, count;
+	QueryPerformanceFrequency (&freq);
+	QueryPerformanceCounter (&count);
+	return (double)count.QuadPart / (double)freq.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+
+/* map the whole file read-only into memory. on windows just read it into a
+   heap buffer instead. returns NULL on failure */
+static const char* map_file (const char* file_name, size_t& sz) {
+	sz = 0;
+#ifdef _WIN32
+	FILE* fp = fopen (file_name, "rb");
+	if (!fp) {
+		return NULL;
+	}
+	fseek (fp, 0, SEEK_END);
+	long len = ftell (fp);
+	rewind (fp);
+	char* buf = (char*)malloc (len > 0 ? len : 1);
+	sz = fread (buf, 1, len, fp);
+	fclose (fp);
+	return buf;
+#else
+	int fd = open (file_name, O_RDONLY);
+	if (fd < 0) {
+		return NULL;
+	}
+	struct stat st;
+	if (fstat (fd, &st) != 0) {
+		close (fd);
+		return NULL;
+	}
+	sz = (size_t)st.st_size;
+	if (0 == sz) {
+		// mmap refuses zero-length mappings
+		close (fd);
+		return (const char*)malloc (1);
+	}
+	void* ptr = mmap (NULL, sz, PROT_READ, MAP_PRIVATE, fd, 0);
+	close (fd); // mapping stays valid after close
+	if (MAP_FAILED == ptr) {
+		return NULL;
+	}
+	madvise (ptr, sz, MADV_SEQUENTIAL);
+	return (const char*)ptr;
+#endif
+}
+
+static void unmap_file (const char* ptr, size_t sz) {
+#ifdef _WIN32
+	free ((void*)ptr);
+#else
+	if (0 == sz) {
+		free ((void*)ptr);
+	} else {
+		munmap ((void*)ptr, sz);
+	}
+#endif
+}
+
+// doubles the capacity of a float array when the next n floats won't fit
+static bool grow_floats (float*& arr, int& cap, int count, int n) {
+	if (count + n <= cap) {
+		return true;
+	}
+	int new_cap = cap > 0 ? cap * 2 : 1024;
+	while (new_cap < count + n) {
+		new_cap *= 2;
+	}
+	float* tmp = (float*)realloc (arr, new_cap * sizeof (float));
+	if (!tmp) {
+		fprintf (stderr, "ERROR: out of memory growing obj arrays\n");
+		return false;
+	}
+	arr = tmp;
+	cap = new_cap;
+	return true;
+}
+
+/* reads one "vp/vt/vn" face corner. returns NULL if the corner doesn't have
+   all three indices */
+static const char* parse_face_corner (
+	const char* p, const char* end, int& vp, int& vt, int& vn
+) {
+	const char* q = apg_parse_int (p, end, &vp);
+	if (q == p || q >= end || *q != '/') {
+		return NULL;
+	}
+	p = q + 1;
+	q = apg_parse_int (p, end, &vt);
+	if (q == p || q >= end || *q != '/') {
+		return NULL;
+	}
+	p = q + 1;
+	q = apg_parse_int (p, end, &vn);
+	if (q == p) {
+		return NULL;
+	}
+	return q;
+}
 
 bool load_obj_file  (
 	const char* file_name,
@@ -26,132 +147,126 @@ bool load_obj_file  (
 	float*& normals,
 	int& point_count
 ) {
+	double start_s = obj_time_s ();
+	size_t file_sz = 0;
+	const char* file_data = map_file (file_name, file_sz);
+	if (!file_data) {
+		fprintf (stderr, "ERROR: could not find file %s\n", file_name);
+		return false;
+	}
 
+	// unsorted arrays hold floats, so counts here are in floats not vertices
 	float* unsorted_vp_array = NULL;
 	float* unsorted_vt_array = NULL;
 	float* unsorted_vn_array = NULL;
-	int current_unsorted_vp = 0;
-	int current_unsorted_vt = 0;
-	int current_unsorted_vn = 0;
-
-	FILE* fp = fopen (file_name, "r");
-	if (!fp) {
-		fprintf (stderr, "ERROR: could not find file %s\n", file_name);
-		return false;
-	}
-	
-	// first count points in file so we know how much mem to allocate
+	int unsorted_vp_floats = 0, unsorted_vp_cap = 0;
+	int unsorted_vt_floats = 0, unsorted_vt_cap = 0;
+	int unsorted_vn_floats = 0, unsorted_vn_cap = 0;
+	int points_cap = 0, tex_coords_cap = 0, normals_cap = 0;
+	points = tex_coords = normals = NULL;
 	point_count = 0;
-	int unsorted_vp_count = 0;
-	int unsorted_vt_count = 0;
-	int unsorted_vn_count = 0;
-	int face_count = 0;
-	char line[1024];
-	while (fgets (line, 1024, fp)) {
-		if (line[0] == 'v') {
-			if (line[1] == ' ') {
-				unsorted_vp_count++;
-			} else if (line[1] == 't') {
-				unsorted_vt_count++;
-			} else if (line[1] == 'n') {
-				unsorted_vn_count++;
-			}
-		} else if (line[0] == 'f') {
-			face_count++;
-		}
-	}
-	printf (
-		"found %i vp %i vt %i vn unique in obj. allocating memory...\n",
-		unsorted_vp_count, unsorted_vt_count, unsorted_vn_count
-	);
-	unsorted_vp_array = (float*)malloc (unsorted_vp_count * 3 * sizeof (float));
-	unsorted_vt_array = (float*)malloc (unsorted_vt_count * 2 * sizeof (float));
-	unsorted_vn_array = (float*)malloc (unsorted_vn_count * 3 * sizeof (float));
-	points = (float*)malloc (3 * face_count * 3 * sizeof (float));
-	tex_coords = (float*)malloc (3 * face_count * 2 * sizeof (float));
-	normals = (float*)malloc (3 * face_count * 3 * sizeof (float));
-	printf (
-		"allocated %i bytes for mesh\n",
-		(int)(3 * face_count * 8 * sizeof (float))
-	);
-	
-	rewind (fp);
-	while (fgets (line, 1024, fp)) {
+	bool ok = true;
+
+	const char* curr = file_data;
+	const char* end = file_data + file_sz;
+	while (curr < end && ok) {
+		const char* line = curr;
+		curr = apg_next_line (curr, end);
+		const char* line_end = curr;
+
 		// vertex
-		if (line[0] == 'v') {
-		
+		if (line[0] == 'v' && line_end - line > 2) {
+
 			// vertex point
 			if (line[1] == ' ') {
 				float x, y, z;
 				x = y = z = 0.0f;
-				sscanf (line, "v %f %f %f", &x, &y, &z);
-				unsorted_vp_array[current_unsorted_vp * 3] = x;
-				unsorted_vp_array[current_unsorted_vp * 3 + 1] = y;
-				unsorted_vp_array[current_unsorted_vp * 3 + 2] = z;
-				current_unsorted_vp++;
-				
+				const char* p = apg_parse_float (line + 2, line_end, &x);
+				p = apg_parse_float (p, line_end, &y);
+				apg_parse_float (p, line_end, &z);
+				ok = grow_floats (unsorted_vp_array, unsorted_vp_cap, unsorted_vp_floats, 3);
+				if (ok) {
+					unsorted_vp_array[unsorted_vp_floats++] = x;
+					unsorted_vp_array[unsorted_vp_floats++] = y;
+					unsorted_vp_array[unsorted_vp_floats++] = z;
+				}
+
 			// vertex texture coordinate
 			} else if (line[1] == 't') {
 				float s, t;
 				s = t = 0.0f;
-				sscanf (line, "vt %f %f", &s, &t);
-				unsorted_vt_array[current_unsorted_vt * 2] = s;
-				unsorted_vt_array[current_unsorted_vt * 2 + 1] = t;
-				current_unsorted_vt++;
-				
+				const char* p = apg_parse_float (line + 2, line_end, &s);
+				apg_parse_float (p, line_end, &t);
+				ok = grow_floats (unsorted_vt_array, unsorted_vt_cap, unsorted_vt_floats, 2);
+				if (ok) {
+					unsorted_vt_array[unsorted_vt_floats++] = s;
+					unsorted_vt_array[unsorted_vt_floats++] = t;
+				}
+
 			// vertex normal
 			} else if (line[1] == 'n') {
 				float x, y, z;
 				x = y = z = 0.0f;
-				sscanf (line, "vn %f %f %f", &x, &y, &z);
-				unsorted_vn_array[current_unsorted_vn * 3] = x;
-				unsorted_vn_array[current_unsorted_vn * 3 + 1] = y;
-				unsorted_vn_array[current_unsorted_vn * 3 + 2] = z;
-				current_unsorted_vn++;
+				const char* p = apg_parse_float (line + 2, line_end, &x);
+				p = apg_parse_float (p, line_end, &y);
+				apg_parse_float (p, line_end, &z);
+				ok = grow_floats (unsorted_vn_array, unsorted_vn_cap, unsorted_vn_floats, 3);
+				if (ok) {
+					unsorted_vn_array[unsorted_vn_floats++] = x;
+					unsorted_vn_array[unsorted_vn_floats++] = y;
+					unsorted_vn_array[unsorted_vn_floats++] = z;
+				}
 			}
-			
+
 		// faces
-		} else if (line[0] == 'f') {
-			// work out if using quads instead of triangles and print a warning
-			int slashCount = 0;
-			int len = strlen (line);
-			for (int i = 0; i < len; i++) {
-				if (line[i] == '/') {
-					slashCount++;
+		} else if (line[0] == 'f' && line_end - line > 1 && line[1] == ' ') {
+			/* exactly three vp/vt/vn corners then the end of the line - anything else
+			   is quads or a different layout */
+			int vp[3], vt[3], vn[3];
+			const char* p = line + 1;
+			for (int i = 0; i < 3 && p; i++) {
+				p = parse_face_corner (p, line_end, vp[i], vt[i], vn[i]);
+			}
+			if (p) {
+				p = apg_skip_spaces (p, line_end);
+				if (p < line_end && *p == '\r') {
+					p++;
 				}
 			}
-			if (slashCount != 6) {
+			if (!p || (p < line_end && *p != '\n')) {
 				fprintf (
 					stderr,
 					"ERROR: file contains quads or does not match v vp/vt/vn layout - \
 					make sure exported mesh is triangulated and contains vertex points, \
 					texture coordinates, and normals\n"
 				);
-				return false;
+				ok = false;
+				break;
+			}
+			ok = grow_floats (points, points_cap, point_count * 3, 9) &&
+				grow_floats (tex_coords, tex_coords_cap, point_count * 2, 6) &&
+				grow_floats (normals, normals_cap, point_count * 3, 9);
+			if (!ok) {
+				break;
 			}
-
-			int vp[3], vt[3], vn[3];
-			sscanf (
-				line,
-				"f %i/%i/%i %i/%i/%i %i/%i/%i",
-				&vp[0], &vt[0], &vn[0], &vp[1], &vt[1], &vn[1], &vp[2], &vt[2], &vn[2]
-			);
-
 			/* start reading points into a buffer. order is -1 because obj starts from
-			   1, not 0 */
-			// NB: assuming all indices are valid
+			   1, not 0. indices are range-checked before any arithmetic, as the
+			   parser clamps huge ones to INT_MIN/INT_MAX */
 			for (int i = 0; i < 3; i++) {
-				if ((vp[i] - 1 < 0) || (vp[i] - 1 >= unsorted_vp_count)) {
+				if (vp[i] < 1 || vp[i] > unsorted_vp_floats / 3) {
 					fprintf (stderr, "ERROR: invalid vertex position index in face\n");
-					return false;
+					ok = false;
+					break;
 				}
-				if ((vt[i] - 1 < 0) || (vt[i] - 1 >= unsorted_vt_count)) {
+				if (vt[i] < 1 || vt[i] > unsorted_vt_floats / 2) {
 					fprintf (stderr, "ERROR: invalid texture coord index %i in face.\n", vt[i]);
-					return false;
+					ok = false;
+					break;
 				}
-				if ((vn[i] - 1 < 0) || (vn[i] - 1 >= unsorted_vn_count)) {
+				if (vn[i] < 1 || vn[i] > unsorted_vn_floats / 3) {
 					printf ("ERROR: invalid vertex normal index in face\n");
-					return false;
+					ok = false;
+					break;
 				}
 				points[point_count * 3] = unsorted_vp_array[(vp[i] - 1) * 3];
 				points[point_count * 3 + 1] = unsorted_vp_array[(vp[i] - 1) * 3 + 1];
@@ -165,13 +280,27 @@ bool load_obj_file  (
 			}
 		}
 	}
-	fclose (fp);
+	unmap_file (file_data, file_sz);
 	free (unsorted_vp_array);
 	free (unsorted_vn_array);
 	free (unsorted_vt_array);
+	if (!ok) {
+		free (points);
+		free (tex_coords);
+		free (normals);
+		points = tex_coords = normals = NULL;
+		point_count = 0;
+		return false;
+	}
+	double elapsed_s = obj_time_s () - start_s;
+	double mb = (double)file_sz / (1024.0 * 1024.0);
 	printf (
-		"allocated %i points\n",
-		point_count
+		"allocated %i points (%i bytes) from %.2fMB in %.3fs (%.1fMB/s)\n",
+		point_count,
+		(int)(point_count * 8 * sizeof (float)),
+		mb,
+		elapsed_s,
+		elapsed_s > 0.0 ? mb / elapsed_s : 0.0
 	);
 	return true;
 }
@@ -6,6 +6,7 @@
 //
 
 #include <stdio.h>
+#include <string.h>
 #include "apg_gl.h"
 
 APG_GL_Context g_gl;
@@ -77,3 +78,38 @@ void stop_gl () {
 	glfwTerminate ();
 }
 
+
+bool create_interleaved_mesh (const void* vertices, int vertex_count,
+	const Obj_Vertex_Layout* layout, const void* indices, int index_count,
+	int index_size, APG_Mesh* mesh) {
+	memset (mesh, 0, sizeof (APG_Mesh));
+	mesh->pc = (GLuint)vertex_count;
+	glGenVertexArrays (1, &mesh->vao);
+	glBindVertexArray (mesh->vao);
+	glGenBuffers (1, &mesh->vbo_vps);
+	glBindBuffer (GL_ARRAY_BUFFER, mesh->vbo_vps);
+	glBufferData (GL_ARRAY_BUFFER, (GLsizeiptr)vertex_count * layout->stride,
+		vertices, GL_STATIC_DRAW);
+	GLenum vp_type = OBJ_POSITION_HALF == layout->position_format ?
+		GL_HALF_FLOAT : GL_FLOAT;
+	glEnableVertexAttribArray (0);
+	glVertexAttribPointer (0, 3, vp_type, GL_FALSE, layout->stride,
+		(GLvoid*)(size_t)layout->position_offset);
+	glEnableVertexAttribArray (1);
+	glVertexAttribPointer (1, 2, GL_UNSIGNED_SHORT, GL_TRUE, layout->stride,
+		(GLvoid*)(size_t)layout->tex_coord_offset);
+	glEnableVertexAttribArray (2);
+	glVertexAttribPointer (2, 2, GL_SHORT, GL_TRUE, layout->stride,
+		(GLvoid*)(size_t)layout->normal_offset);
+	if (indices && index_count > 0) {
+		mesh->index_count = (GLuint)index_count;
+		mesh->index_type = 2 == index_size ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+		// element buffer binding is stored in the VAO
+		glGenBuffers (1, &mesh->ibo);
+		glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, mesh->ibo);
+		glBufferData (GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)index_count * index_size,
+			indices, GL_STATIC_DRAW);
+	}
+	glBindVertexArray (0);
+	return true;
+}
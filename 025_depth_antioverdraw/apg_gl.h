@@ -6,6 +6,7 @@
 //
 
 #pragma once
+#include "obj_parser.h"
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <stdbool.h>
@@ -18,10 +19,22 @@ typedef struct APG_GL_Context APG_GL_Context;
 
 struct APG_Mesh {
 	GLuint vao, vbo_vps, vbo_vts, vbo_vns, pc;
+	// element buffer, drawn with glDrawElements if index_count > 0
+	GLuint ibo, index_count;
+	GLenum index_type; // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
 };
 typedef struct APG_Mesh APG_Mesh;
 
 bool start_gl ();
 void stop_gl ();
 
+/* uploads an interleaved buffer from pack_obj_vertices() into a new VAO. the
+   one VBO goes in vbo_vps. indices are optional (NULL for glDrawArrays).
+   attribute 0 - vec3 position, float or half
+   attribute 1 - vec2 tex coord, unorm16 normalised to 0-1
+   attribute 2 - vec2 octahedral normal, snorm16 */
+bool create_interleaved_mesh (const void* vertices, int vertex_count,
+	const Obj_Vertex_Layout* layout, const void* indices, int index_count,
+	int index_size, APG_Mesh* mesh);
+
 extern APG_GL_Context g_gl;
@@ -8,19 +8,25 @@
 // notes - i get a speed-up only with a lower number of meshes e.g. 99 draws
 // with higher numbers e.g. 999 or 9999 the cpu side stuff seems to nail
 // the frame rate
+// distant monkeys draw simplified LODs sharing the one vertex buffer
 //
 
 #include "apg_maths.h"
 #include "obj_parser.h"
+#include "mesh_opt.h"
+#include "mesh_simplify.h"
 #include "apg_gl.h"
 #include <stdio.h>
 #include <assert.h>
 #include <stdlib.h>
 #define MESH_FILE "../common/mesh/suzanne.obj"
 #define NUM_MONKEYS 99
+#define FOVY_DEG 67.0f
+#define MAX_LOD_PIXEL_ERROR 1.0f
 float monkey_zs[NUM_MONKEYS];
 bool do_pre_pass = true;
 APG_Mesh mesh;
+Mesh_Lod_Chain lods;
 GLuint shader_programme, dshader_programme;
 GLint sp_PVM_loc = -1, dsp_PVM_loc = -1;
 mat4 P, V, PV;
@@ -29,39 +35,29 @@ static void init () {
 	assert (start_gl ());
 	// create FBs
 	// create textures
-	{ // load meshes
-		float *vps = NULL, *vts = NULL, *vns = NULL;
-		int pc = 0;
-		assert (load_obj_file (MESH_FILE, &vps, &vts, &vns, &pc));
-		mesh.pc = (GLuint)pc;
-		glGenVertexArrays (1, &mesh.vao);
-		glBindVertexArray (mesh.vao);
-		glGenBuffers (1, &mesh.vbo_vps);
-		glBindBuffer (GL_ARRAY_BUFFER, mesh.vbo_vps);
-		glBufferData (GL_ARRAY_BUFFER, mesh.pc * 3 * sizeof (float), vps,
-			GL_STATIC_DRAW);
-		glEnableVertexAttribArray (0);
-		glVertexAttribPointer (0, 3, GL_FLOAT, GL_FALSE, 0, NULL);
-		glGenBuffers (1, &mesh.vbo_vts);
-		glBindBuffer (GL_ARRAY_BUFFER, mesh.vbo_vts);
-		glBufferData (GL_ARRAY_BUFFER, mesh.pc * 3 * sizeof (float), vts,
-			GL_STATIC_DRAW);
-		glEnableVertexAttribArray (1);
-		glVertexAttribPointer (1, 2, GL_FLOAT, GL_FALSE, 0, NULL);
-		glGenBuffers (1, &mesh.vbo_vns);
-		glBindBuffer (GL_ARRAY_BUFFER, mesh.vbo_vns);
-		glBufferData (GL_ARRAY_BUFFER, mesh.pc * 3 * sizeof (float), vns,
-			GL_STATIC_DRAW);
-		glEnableVertexAttribArray (2);
-		glVertexAttribPointer (2, 3, GL_FLOAT, GL_FALSE, 0, NULL);
-		free (vps);
-		free (vts);
-		free (vns);
+	{ // load meshes - indexed so repeated vertices hit the post-transform cache
+		// and interleaved/quantised to 20 bytes a vertex instead of 32. the
+		// shaders only read the position - attribute 0 in create_interleaved_mesh
+		Obj_Indexed_Mesh obj;
+		Obj_Vertex_Layout layout;
+		void* vertices = NULL;
+		set_obj_parser_threads (0); // all cores. small files still parse serially
+		assert (load_obj_file_indexed (MESH_FILE, &obj));
+		assert (optimise_obj_mesh (&obj, MESH_OPT_DEFAULT_CACHE));
+		// every LOD indexes the same vertices, so all levels go in one index buffer
+		float lod_ratios[] = { 0.5f, 0.25f, 0.125f };
+		assert (build_lod_chain (&obj, lod_ratios, 3, &lods));
+		assert (pack_obj_vertices (obj.points, obj.tex_coords, obj.normals,
+			obj.vertex_count, OBJ_POSITION_FLOAT, &vertices, &layout));
+		assert (create_interleaved_mesh (vertices, obj.vertex_count, &layout,
+			lods.indices, lods.index_count, lods.index_size, &mesh));
+		free (vertices);
+		free_obj_indexed_mesh (&obj);
 	}
 	{ // load shaders
 		const char* dvertex_shader =
 			"#version 430\n"
-			"in vec3 vp;"
+			"layout (location = 0) in vec3 vp;"
 			"uniform mat4 PVM;"
 			"void main () {"
 			"  gl_Position = PVM * vec4 (vp, 1.0);"
@@ -82,7 +78,7 @@ static void init () {
 		dsp_PVM_loc = glGetUniformLocation (dshader_programme, "PVM");
 		const char* vertex_shader =
 			"#version 430\n"
-			"in vec3 vp;"
+			"layout (location = 0) in vec3 vp;"
 			"uniform mat4 PVM;"
 			"void main () {"
 			"  gl_Position = PVM * vec4 (vp, 1.0);"
@@ -115,7 +111,7 @@ static void init () {
 	}
 	{ // camera
 		float a = (float)g_gl.fb_width / (float)g_gl.fb_height;
-		P = perspective (67.0f, a, 0.1f, 1000.0f);
+		P = perspective (FOVY_DEG, a, 0.1f, 1000.0f);
 		V = look_at (vec3_from_3f (0.0f, 0.0f, 1.0f),
 			vec3_from_3f (0.0f, 0.0f, 0.0f),
 			vec3_from_3f (0.0f, 1.0f, 0.0f));
@@ -128,9 +124,19 @@ static void init () {
 }
 
 static void stop () {
+	free_lod_chain (&lods);
 	stop_gl ();
 }
 
+// camera is at z = 1 looking down -z
+static void draw_monkey (int i) {
+	const Mesh_Lod* lod = &lods.levels[select_lod (&lods, 1.0f - monkey_zs[i],
+		FOVY_DEG, g_gl.fb_height, MAX_LOD_PIXEL_ERROR)];
+	glBindVertexArray (mesh.vao);
+	glDrawElements (GL_TRIANGLES, lod->index_count, mesh.index_type,
+		(const GLvoid*)((size_t)lod->first_index * lods.index_size));
+}
+
 static void draw_frame (double elapsed) {
 	glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	if (do_pre_pass) { // depth-writing pre-pass
@@ -139,8 +145,7 @@ static void draw_frame (double elapsed) {
 			mat4 M = translate_mat4 (vec3_from_3f (0.0f, 0.0f, monkey_zs[i]));
 			mat4 PVM = mult_mat4_mat4 (PV, M);
 			glUniformMatrix4fv (dsp_PVM_loc, 1, GL_FALSE, PVM.m);
-			glBindVertexArray (mesh.vao);
-			glDrawArrays (GL_TRIANGLES, 0, mesh.pc);
+			draw_monkey (i);
 		}
 		glDepthFunc (GL_LEQUAL); // because self is gonna be equal duh!
 		glDepthMask (GL_FALSE); // disable depth writing - already done
@@ -151,8 +156,7 @@ static void draw_frame (double elapsed) {
 			mat4 M = translate_mat4 (vec3_from_3f (0.0f, 0.0f, monkey_zs[i]));
 			mat4 PVM = mult_mat4_mat4 (PV, M);
 			glUniformMatrix4fv (sp_PVM_loc, 1, GL_FALSE, PVM.m);
-			glBindVertexArray (mesh.vao);
-			glDrawArrays (GL_TRIANGLES, 0, mesh.pc);
+			draw_monkey (i);
 		}
 		glDepthFunc (GL_LESS);
 		glDepthMask (GL_TRUE); // disable depth writing - already done
@@ -0,0 +1,355 @@
+//
+// triangle and vertex order optimisation for indexed meshes, C99
+// anton gerdelan <gerdela@scss.tcd.ie>
+// trinity college dublin
+//
+#include "mesh_opt.h"
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t get_index (const Obj_Indexed_Mesh* mesh, int i) {
+	if (2 == mesh->index_size) {
+		return ((const uint16_t*)mesh->indices)[i];
+	}
+	return ((const uint32_t*)mesh->indices)[i];
+}
+
+// only after make_obj_indexed_mesh_writable() - the indices are then on the heap
+static void set_index (Obj_Indexed_Mesh* mesh, int i, uint32_t v) {
+	if (2 == mesh->index_size) {
+		((uint16_t*)mesh->indices)[i] = (uint16_t)v;
+	} else {
+		((uint32_t*)mesh->indices)[i] = v;
+	}
+}
+
+/* fifo cache simulation. a vertex stamped with the miss count when it went in
+   is still cached until cache_size more vertices have gone in after it */
+static int count_cache_misses (const Obj_Indexed_Mesh* mesh, int cache_size) {
+	int i, misses = 0;
+	int* stamp = (int*)malloc ((mesh->vertex_count + 1) * sizeof (int));
+	if (!stamp) {
+		return -1;
+	}
+	for (i = 0; i < mesh->vertex_count; i++) {
+		stamp[i] = INT_MIN / 2;
+	}
+	for (i = 0; i < mesh->index_count; i++) {
+		uint32_t v = get_index (mesh, i);
+		if (misses - stamp[v] > cache_size) {
+			stamp[v] = misses++;
+		}
+	}
+	free (stamp);
+	return misses;
+}
+
+float mesh_acmr (const Obj_Indexed_Mesh* mesh, int cache_size) {
+	int tri_count = mesh->index_count / 3;
+	if (tri_count < 1) {
+		return 0.0f;
+	}
+	return (float)count_cache_misses (mesh, cache_size) / (float)tri_count;
+}
+
+float mesh_atvr (const Obj_Indexed_Mesh* mesh, int cache_size) {
+	if (mesh->vertex_count < 1) {
+		return 0.0f;
+	}
+	return (float)count_cache_misses (mesh, cache_size) /
+		(float)mesh->vertex_count;
+}
+
+// pops dead-end vertices, then falls back to scanning for any live vertex
+static int skip_dead_end (const int* live, const int* dead_end, int* dead_top,
+	int* cursor, int vertex_count) {
+	while (*dead_top > 0) {
+		int d = dead_end[--(*dead_top)];
+		if (live[d] > 0) {
+			return d;
+		}
+	}
+	while (*cursor < vertex_count) {
+		if (live[*cursor] > 0) {
+			return *cursor;
+		}
+		(*cursor)++;
+	}
+	return -1;
+}
+
+/* pass 1 - tipsify. fans around a vertex, emitting all its remaining triangles,
+   then picks the next fanning vertex from the ones just emitted, preferring
+   those that will still be in the cache after their own fan */
+static bool tipsify (const Obj_Indexed_Mesh* mesh, int cache_size,
+	uint32_t* out) {
+	int vc = mesh->vertex_count, tri_count = mesh->index_count / 3;
+	int i, j;
+	int* adj_start = (int*)calloc (vc + 1, sizeof (int));
+	int* adj = (int*)malloc ((tri_count * 3 + 1) * sizeof (int));
+	int* live = (int*)calloc (vc + 1, sizeof (int));
+	int* stamp = (int*)calloc (vc + 1, sizeof (int));
+	int* dead_end = (int*)malloc ((tri_count * 3 + 1) * sizeof (int));
+	int* candidates = (int*)malloc ((tri_count * 3 + 1) * sizeof (int));
+	bool* emitted = (bool*)calloc (tri_count + 1, sizeof (bool));
+	bool ok = adj_start && adj && live && stamp && dead_end && candidates &&
+		emitted;
+	if (ok) {
+		// triangle lists per vertex, packed
+		for (i = 0; i < tri_count * 3; i++) {
+			live[get_index (mesh, i)]++;
+		}
+		for (i = 0; i < vc; i++) {
+			adj_start[i + 1] = adj_start[i] + live[i];
+		}
+		int* fill = stamp; // borrow, reset below
+		for (i = 0; i < tri_count * 3; i++) {
+			uint32_t v = get_index (mesh, i);
+			adj[adj_start[v] + fill[v]++] = i / 3;
+		}
+		memset (stamp, 0, vc * sizeof (int));
+
+		int fan = 0, time = cache_size + 1, cursor = 0, dead_top = 0, out_count = 0;
+		fan = skip_dead_end (live, dead_end, &dead_top, &cursor, vc);
+		while (fan >= 0) {
+			int n_candidates = 0;
+			for (i = adj_start[fan]; i < adj_start[fan + 1]; i++) {
+				int t = adj[i];
+				if (emitted[t]) {
+					continue;
+				}
+				for (j = 0; j < 3; j++) {
+					uint32_t v = get_index (mesh, t * 3 + j);
+					out[out_count++] = v;
+					dead_end[dead_top++] = (int)v;
+					candidates[n_candidates++] = (int)v;
+					live[v]--;
+					if (time - stamp[v] > cache_size) {
+						stamp[v] = time++;
+					}
+				}
+				emitted[t] = true;
+			}
+			// best candidate is the one fanned soonest that will still be cached
+			int best = -1, best_priority = -1;
+			for (i = 0; i < n_candidates; i++) {
+				int v = candidates[i];
+				if (live[v] <= 0) {
+					continue;
+				}
+				int priority = 0;
+				if (time - stamp[v] + 2 * live[v] <= cache_size) {
+					priority = time - stamp[v];
+				}
+				if (priority > best_priority) {
+					best_priority = priority;
+					best = v;
+				}
+			}
+			if (best < 0) {
+				best = skip_dead_end (live, dead_end, &dead_top, &cursor, vc);
+			}
+			fan = best;
+		}
+		ok = out_count == tri_count * 3;
+	}
+	free (adj_start);
+	free (adj);
+	free (live);
+	free (stamp);
+	free (dead_end);
+	free (candidates);
+	free (emitted);
+	return ok;
+}
+
+struct Cluster {
+	float metric;
+	int first_tri, tri_count;
+};
+typedef struct Cluster Cluster;
+
+static int compare_clusters (const void* a, const void* b) {
+	const Cluster* ca = (const Cluster*)a;
+	const Cluster* cb = (const Cluster*)b;
+	if (ca->metric != cb->metric) {
+		return ca->metric > cb->metric ? -1 : 1; // biggest metric first
+	}
+	return ca->first_tri - cb->first_tri;
+}
+
+/* pass 2 - overdraw. a triangle that misses the cache on all three vertices
+   starts a new cluster, so moving whole clusters around barely changes the
+   cache hit rate. clusters are then sorted by how far out from the mesh centre
+   they sit along their own facing direction - those tend to occlude the rest */
+static bool sort_clusters_for_overdraw (const Obj_Indexed_Mesh* mesh,
+	int cache_size, uint32_t* tris) {
+	int vc = mesh->vertex_count, tri_count = mesh->index_count / 3;
+	int i, j, k, misses = 0, n_clusters = 0;
+	int* stamp = (int*)malloc ((vc + 1) * sizeof (int));
+	Cluster* clusters = (Cluster*)malloc ((tri_count + 1) * sizeof (Cluster));
+	uint32_t* sorted = (uint32_t*)malloc ((tri_count * 3 + 1) * sizeof (uint32_t));
+	if (!stamp || !clusters || !sorted) {
+		free (stamp);
+		free (clusters);
+		free (sorted);
+		return false;
+	}
+	for (i = 0; i < vc; i++) {
+		stamp[i] = INT_MIN / 2;
+	}
+	for (i = 0; i < tri_count; i++) {
+		int tri_misses = 0;
+		for (j = 0; j < 3; j++) {
+			uint32_t v = tris[i * 3 + j];
+			if (misses - stamp[v] > cache_size) {
+				stamp[v] = misses++;
+				tri_misses++;
+			}
+		}
+		if (0 == i || 3 == tri_misses) {
+			clusters[n_clusters].first_tri = i;
+			clusters[n_clusters].tri_count = 0;
+			n_clusters++;
+		}
+		clusters[n_clusters - 1].tri_count++;
+	}
+
+	float mesh_centre[3] = { 0.0f, 0.0f, 0.0f };
+	for (i = 0; i < vc; i++) {
+		for (k = 0; k < 3; k++) {
+			mesh_centre[k] += mesh->points[i * 3 + k] / (float)vc;
+		}
+	}
+	for (i = 0; i < n_clusters; i++) {
+		// area-weighted centroid and normal of the cluster
+		float centre[3] = { 0.0f, 0.0f, 0.0f }, normal[3] = { 0.0f, 0.0f, 0.0f };
+		float area_sum = 0.0f;
+		for (j = clusters[i].first_tri;
+			j < clusters[i].first_tri + clusters[i].tri_count; j++) {
+			const float* a = &mesh->points[tris[j * 3] * 3];
+			const float* b = &mesh->points[tris[j * 3 + 1] * 3];
+			const float* c = &mesh->points[tris[j * 3 + 2] * 3];
+			float e0[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+			float e1[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+			float n[3] = { e0[1] * e1[2] - e0[2] * e1[1],
+				e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0] };
+			float area = sqrtf (n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			for (k = 0; k < 3; k++) {
+				centre[k] += (a[k] + b[k] + c[k]) / 3.0f * area;
+				normal[k] += n[k];
+			}
+			area_sum += area;
+		}
+		float len = sqrtf (normal[0] * normal[0] + normal[1] * normal[1] +
+			normal[2] * normal[2]);
+		float metric = 0.0f;
+		if (area_sum > 0.0f && len > 0.0f) {
+			for (k = 0; k < 3; k++) {
+				metric += (centre[k] / area_sum - mesh_centre[k]) * normal[k] / len;
+			}
+		}
+		clusters[i].metric = metric;
+	}
+	qsort (clusters, n_clusters, sizeof (Cluster), compare_clusters);
+	int out = 0;
+	for (i = 0; i < n_clusters; i++) {
+		memcpy (&sorted[out], &tris[clusters[i].first_tri * 3],
+			clusters[i].tri_count * 3 * sizeof (uint32_t));
+		out += clusters[i].tri_count * 3;
+	}
+	memcpy (tris, sorted, tri_count * 3 * sizeof (uint32_t));
+	printf ("overdraw sort: %i clusters\n", n_clusters);
+	free (stamp);
+	free (clusters);
+	free (sorted);
+	return true;
+}
+
+// copies n_components floats per vertex from src[old] to dst[new]
+static void remap_floats (float* dst, const float* src, const int* new_to_old,
+	int vertex_count, int n_components) {
+	int i;
+	for (i = 0; i < vertex_count; i++) {
+		memcpy (&dst[i * n_components], &src[new_to_old[i] * n_components],
+			n_components * sizeof (float));
+	}
+}
+
+/* pass 3 - vertex fetch. renumbers vertices in the order the index buffer first
+   uses them. vertices no triangle uses are dropped */
+static bool reorder_vertex_fetch (Obj_Indexed_Mesh* mesh, uint32_t* tris) {
+	int vc = mesh->vertex_count, i, next = 0;
+	int* old_to_new = (int*)malloc ((vc + 1) * sizeof (int));
+	int* new_to_old = (int*)malloc ((vc + 1) * sizeof (int));
+	float* points = (float*)malloc ((vc * 3 + 1) * sizeof (float));
+	float* tex_coords = (float*)malloc ((vc * 2 + 1) * sizeof (float));
+	float* normals = (float*)malloc ((vc * 3 + 1) * sizeof (float));
+	if (!old_to_new || !new_to_old || !points || !tex_coords || !normals) {
+		free (old_to_new);
+		free (new_to_old);
+		free (points);
+		free (tex_coords);
+		free (normals);
+		return false;
+	}
+	memset (old_to_new, 0xFF, vc * sizeof (int)); // -1 == not used yet
+	for (i = 0; i < mesh->index_count; i++) {
+		uint32_t v = tris[i];
+		if (old_to_new[v] < 0) {
+			new_to_old[next] = (int)v;
+			old_to_new[v] = next++;
+		}
+		tris[i] = (uint32_t)old_to_new[v];
+	}
+	remap_floats (points, mesh->points, new_to_old, next, 3);
+	remap_floats (tex_coords, mesh->tex_coords, new_to_old, next, 2);
+	remap_floats (normals, mesh->normals, new_to_old, next, 3);
+	free ((void*)mesh->points);
+	free ((void*)mesh->tex_coords);
+	free ((void*)mesh->normals);
+	mesh->points = points;
+	mesh->tex_coords = tex_coords;
+	mesh->normals = normals;
+	mesh->vertex_count = next;
+	free (old_to_new);
+	free (new_to_old);
+	return true;
+}
+
+bool optimise_obj_mesh (Obj_Indexed_Mesh* mesh, int cache_size) {
+	int i;
+	if (mesh->index_count < 3) {
+		return true;
+	}
+	if (!make_obj_indexed_mesh_writable (mesh)) {
+		return false;
+	}
+	float acmr_before = mesh_acmr (mesh, cache_size);
+	float atvr_before = mesh_atvr (mesh, cache_size);
+	uint32_t* tris = (uint32_t*)malloc (mesh->index_count * sizeof (uint32_t));
+	if (!tris) {
+		fprintf (stderr, "ERROR: out of memory optimising mesh\n");
+		return false;
+	}
+	bool ok = tipsify (mesh, cache_size, tris) &&
+		sort_clusters_for_overdraw (mesh, cache_size, tris) &&
+		reorder_vertex_fetch (mesh, tris);
+	if (ok) {
+		for (i = 0; i < mesh->index_count; i++) {
+			set_index (mesh, i, tris[i]);
+		}
+		printf ("mesh optimised for %i-entry cache: ACMR %.3f -> %.3f, "
+			"ATVR %.3f -> %.3f\n", cache_size, acmr_before,
+			mesh_acmr (mesh, cache_size), atvr_before,
+			mesh_atvr (mesh, cache_size));
+	} else {
+		fprintf (stderr, "ERROR: mesh optimisation failed\n");
+	}
+	free (tris);
+	return ok;
+}
@@ -0,0 +1,30 @@
+//
+// triangle and vertex order optimisation for indexed meshes, C99
+// anton gerdelan <gerdela@scss.tcd.ie>
+// trinity college dublin
+//
+// three passes over an Obj_Indexed_Mesh:
+// 1. tipsify - reorder triangles for the post-transform vertex cache
+//    (Sander, Nehab, Barczak 2007 "Fast Triangle Reordering for Vertex Locality
+//    and Reduced Overdraw")
+// 2. cut the result into clusters where the cache runs cold and sort clusters
+//    so outward-facing, outer geometry draws first (less overdraw)
+// 3. renumber vertices in first-use order so vertex fetch walks memory forwards
+//
+#pragma once
+#include "obj_parser.h"
+
+// fifo cache size the reordering assumes. 16-32 for most GPUs
+#define MESH_OPT_DEFAULT_CACHE 16
+
+/* average cache miss ratio - transformed vertices per triangle. 0.5 is about
+   the best possible on big regular meshes, 3.0 the worst */
+float mesh_acmr (const Obj_Indexed_Mesh* mesh, int cache_size);
+
+/* average transform to vertex ratio - transformed vertices per unique vertex.
+   1.0 is perfect */
+float mesh_atvr (const Obj_Indexed_Mesh* mesh, int cache_size);
+
+/* runs all three passes in-place and prints ACMR/ATVR before and after. a mesh
+   mapped from the .bin cache is copied to the heap first */
+bool optimise_obj_mesh (Obj_Indexed_Mesh* mesh, int cache_size);
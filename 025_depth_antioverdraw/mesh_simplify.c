@@ -0,0 +1,622 @@
+//
+// quadric error metric mesh simplification and LOD selection, C99
+// anton gerdelan <gerdela@scss.tcd.ie>
+// trinity college dublin
+//
+// the indexed loader splits a vertex wherever its vt or vn differs, so one
+// position can have several "wedges" - vertex indices with different
+// attributes. topology and error are tracked per position; a collapse moves
+// every wedge of one position onto the wedge of the neighbour position it
+// shares an edge with. if any wedge has no such partner (or more than one) the
+// collapse would drag a seam across the surface, so it isn't allowed. that
+// leaves seams free to shorten along themselves but never to cross
+//
+#include "mesh_simplify.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIMPLIFY_REMOVED UINT32_MAX
+
+// symmetric 4x4 error matrix, upper triangle. sum of squared plane distances
+struct Quadric {
+	double aa, ab, ac, ad, bb, bc, bd, cc, cd, dd;
+};
+typedef struct Quadric Quadric;
+
+// merge position "from" onto position "to". both are representative indices
+struct Collapse {
+	uint32_t from, to;
+	double cost;
+};
+typedef struct Collapse Collapse;
+
+struct Simplifier {
+	const float* points;
+	int vertex_count;
+	uint32_t* tris; // 3 indices per triangle. removed triangles start with SIMPLIFY_REMOVED
+	int tri_count, live_count;
+	uint32_t* pos_id; // lowest vertex index with the same position
+	uint32_t* wedge_next; // circular list through each position's wedges
+	Quadric* quadrics; // indexed by pos_id
+	double max_cost;
+	// per-pass scratch
+	int* adj_start, *adj, *fill;
+	bool* locked; // indexed by pos_id
+	Collapse* collapses;
+	uint32_t* ring, *ring_b;
+	int* ring_count;
+	int ring_cap;
+};
+typedef struct Simplifier Simplifier;
+
+// vertex with its position, sorted to find coincident vertices
+struct Pos_Key {
+	float x, y, z;
+	uint32_t v;
+};
+typedef struct Pos_Key Pos_Key;
+
+static uint32_t get_index (const void* indices, int index_size, int i) {
+	if (2 == index_size) {
+		return ((const uint16_t*)indices)[i];
+	}
+	return ((const uint32_t*)indices)[i];
+}
+
+static void set_index (void* indices, int index_size, int i, uint32_t v) {
+	if (2 == index_size) {
+		((uint16_t*)indices)[i] = (uint16_t)v;
+	} else {
+		((uint32_t*)indices)[i] = v;
+	}
+}
+
+static void quadric_add_plane (Quadric* q, double a, double b, double c,
+	double d) {
+	q->aa += a * a; q->ab += a * b; q->ac += a * c; q->ad += a * d;
+	q->bb += b * b; q->bc += b * c; q->bd += b * d;
+	q->cc += c * c; q->cd += c * d;
+	q->dd += d * d;
+}
+
+static void quadric_add (Quadric* q, const Quadric* r) {
+	q->aa += r->aa; q->ab += r->ab; q->ac += r->ac; q->ad += r->ad;
+	q->bb += r->bb; q->bc += r->bc; q->bd += r->bd;
+	q->cc += r->cc; q->cd += r->cd;
+	q->dd += r->dd;
+}
+
+// v^T Q v for v = (p, 1). clamped - rounding can push a zero error negative
+static double quadric_eval (const Quadric* q, const float* p) {
+	double x = p[0], y = p[1], z = p[2];
+	double e = q->aa * x * x + 2.0 * q->ab * x * y + 2.0 * q->ac * x * z +
+		2.0 * q->ad * x + q->bb * y * y + 2.0 * q->bc * y * z + 2.0 * q->bd * y +
+		q->cc * z * z + 2.0 * q->cd * z + q->dd;
+	return e > 0.0 ? e : 0.0;
+}
+
+static void tri_normal (const float* a, const float* b, const float* c,
+	double* n) {
+	double e0[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+	double e1[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+	n[0] = e0[1] * e1[2] - e0[2] * e1[1];
+	n[1] = e0[2] * e1[0] - e0[0] * e1[2];
+	n[2] = e0[0] * e1[1] - e0[1] * e1[0];
+}
+
+static int compare_pos_keys (const void* a, const void* b) {
+	const Pos_Key* ka = (const Pos_Key*)a;
+	const Pos_Key* kb = (const Pos_Key*)b;
+	if (ka->x != kb->x) {
+		return ka->x < kb->x ? -1 : 1;
+	}
+	if (ka->y != kb->y) {
+		return ka->y < kb->y ? -1 : 1;
+	}
+	if (ka->z != kb->z) {
+		return ka->z < kb->z ? -1 : 1;
+	}
+	return ka->v < kb->v ? -1 : (ka->v > kb->v ? 1 : 0);
+}
+
+// groups wedges by exact position. they come from the same vp so compare equal
+static bool find_wedges (Simplifier* s) {
+	int i, j, k;
+	Pos_Key* keys = (Pos_Key*)malloc ((s->vertex_count + 1) * sizeof (Pos_Key));
+	if (!keys) {
+		return false;
+	}
+	for (i = 0; i < s->vertex_count; i++) {
+		keys[i].x = s->points[i * 3];
+		keys[i].y = s->points[i * 3 + 1];
+		keys[i].z = s->points[i * 3 + 2];
+		keys[i].v = (uint32_t)i;
+	}
+	qsort (keys, s->vertex_count, sizeof (Pos_Key), compare_pos_keys);
+	for (i = 0; i < s->vertex_count; i = j) {
+		for (j = i + 1; j < s->vertex_count && keys[j].x == keys[i].x &&
+			keys[j].y == keys[i].y && keys[j].z == keys[i].z; j++);
+		// sorted by index within a run, so keys[i] holds the lowest
+		for (k = i; k < j; k++) {
+			s->pos_id[keys[k].v] = keys[i].v;
+			s->wedge_next[keys[k].v] = keys[k + 1 < j ? k + 1 : i].v;
+		}
+	}
+	free (keys);
+	return true;
+}
+
+/* each position starts with the planes of all its triangles. degenerate
+   triangles have no plane and add nothing */
+static void init_quadrics (Simplifier* s) {
+	int t, i;
+	memset (s->quadrics, 0, s->vertex_count * sizeof (Quadric));
+	for (t = 0; t < s->tri_count; t++) {
+		const uint32_t* tri = &s->tris[t * 3];
+		const float* p0 = &s->points[tri[0] * 3];
+		double n[3];
+		tri_normal (p0, &s->points[tri[1] * 3], &s->points[tri[2] * 3], n);
+		double len = sqrt (n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		if (len <= 0.0) {
+			continue;
+		}
+		n[0] /= len; n[1] /= len; n[2] /= len;
+		double d = -(n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2]);
+		for (i = 0; i < 3; i++) {
+			quadric_add_plane (&s->quadrics[s->pos_id[tri[i]]], n[0], n[1], n[2], d);
+		}
+	}
+}
+
+// packed lists of live triangles around each vertex
+static bool build_adjacency (Simplifier* s) {
+	int t, i, max_valence = 0;
+	memset (s->adj_start, 0, (s->vertex_count + 1) * sizeof (int));
+	memset (s->fill, 0, s->vertex_count * sizeof (int));
+	for (t = 0; t < s->tri_count; t++) {
+		if (SIMPLIFY_REMOVED == s->tris[t * 3]) {
+			continue;
+		}
+		for (i = 0; i < 3; i++) {
+			s->fill[s->tris[t * 3 + i]]++;
+		}
+	}
+	for (i = 0; i < s->vertex_count; i++) {
+		s->adj_start[i + 1] = s->adj_start[i] + s->fill[i];
+		// every wedge of a position can show up in the same ring
+		s->fill[s->pos_id[i]] += i != (int)s->pos_id[i] ? s->fill[i] : 0;
+	}
+	for (i = 0; i < s->vertex_count; i++) {
+		if (s->fill[i] > max_valence) {
+			max_valence = s->fill[i];
+		}
+	}
+	memset (s->fill, 0, s->vertex_count * sizeof (int));
+	for (t = 0; t < s->tri_count; t++) {
+		if (SIMPLIFY_REMOVED == s->tris[t * 3]) {
+			continue;
+		}
+		for (i = 0; i < 3; i++) {
+			uint32_t v = s->tris[t * 3 + i];
+			s->adj[s->adj_start[v] + s->fill[v]++] = t;
+		}
+	}
+	// a ring has at most two neighbours per triangle
+	if (max_valence * 2 > s->ring_cap) {
+		int cap = max_valence * 2;
+		uint32_t* ring = (uint32_t*)realloc (s->ring, cap * sizeof (uint32_t));
+		if (ring) {
+			s->ring = ring;
+		}
+		uint32_t* ring_b = (uint32_t*)realloc (s->ring_b, cap * sizeof (uint32_t));
+		if (ring_b) {
+			s->ring_b = ring_b;
+		}
+		int* ring_count = (int*)realloc (s->ring_count, cap * sizeof (int));
+		if (ring_count) {
+			s->ring_count = ring_count;
+		}
+		if (!ring || !ring_b || !ring_count) {
+			return false;
+		}
+		s->ring_cap = cap;
+	}
+	return true;
+}
+
+/* unique neighbour positions around position p, over all its wedges, and how
+   many triangles share each edge. an edge used once is an open border, more
+   than twice is non-manifold. returns 0 for a position with no triangles */
+static int gather_ring (const Simplifier* s, uint32_t p, uint32_t* ring,
+	int* ring_count) {
+	int i, j, k, n = 0;
+	uint32_t w = p;
+	do {
+		for (i = s->adj_start[w]; i < s->adj_start[w + 1]; i++) {
+			const uint32_t* tri = &s->tris[s->adj[i] * 3];
+			for (j = 0; j < 3; j++) {
+				uint32_t q = s->pos_id[tri[j]];
+				if (q == p) {
+					continue;
+				}
+				for (k = 0; k < n; k++) {
+					if (ring[k] == q) {
+						break;
+					}
+				}
+				if (k == n) {
+					ring[n] = q;
+					if (ring_count) {
+						ring_count[n] = 0;
+					}
+					n++;
+				}
+				if (ring_count) {
+					ring_count[k]++;
+				}
+			}
+		}
+		w = s->wedge_next[w];
+	} while (w != p);
+	return n;
+}
+
+/* the wedge of position q that wedge w shares its edges with. SIMPLIFY_REMOVED
+   if there is none or w touches q through two different wedges */
+static uint32_t wedge_partner (const Simplifier* s, uint32_t w, uint32_t q) {
+	int i, j;
+	uint32_t partner = SIMPLIFY_REMOVED;
+	for (i = s->adj_start[w]; i < s->adj_start[w + 1]; i++) {
+		const uint32_t* tri = &s->tris[s->adj[i] * 3];
+		for (j = 0; j < 3; j++) {
+			if (s->pos_id[tri[j]] != q) {
+				continue;
+			}
+			if (SIMPLIFY_REMOVED != partner && tri[j] != partner) {
+				return SIMPLIFY_REMOVED;
+			}
+			partner = tri[j];
+		}
+	}
+	return partner;
+}
+
+// every wedge of "from" that still has triangles needs a partner in "to"
+static bool wedges_match (const Simplifier* s, uint32_t from, uint32_t to) {
+	uint32_t w = from;
+	do {
+		if (s->adj_start[w] != s->adj_start[w + 1] &&
+			SIMPLIFY_REMOVED == wedge_partner (s, w, to)) {
+			return false;
+		}
+		w = s->wedge_next[w];
+	} while (w != from);
+	return true;
+}
+
+// cheapest neighbour position to merge p onto. false if p must stay
+static bool best_collapse (Simplifier* s, uint32_t p, Collapse* c) {
+	int i;
+	int n = gather_ring (s, p, s->ring, s->ring_count);
+	if (0 == n) {
+		return false;
+	}
+	// borders stay put. there are no planes across them to hold them in place
+	for (i = 0; i < n; i++) {
+		if (s->ring_count[i] != 2) {
+			return false;
+		}
+	}
+	c->from = p;
+	c->cost = -1.0;
+	for (i = 0; i < n; i++) {
+		uint32_t q = s->ring[i];
+		Quadric quad = s->quadrics[p];
+		quadric_add (&quad, &s->quadrics[q]);
+		double cost = quadric_eval (&quad, &s->points[q * 3]);
+		if ((c->cost < 0.0 || cost < c->cost) && wedges_match (s, p, q)) {
+			c->cost = cost;
+			c->to = q;
+		}
+	}
+	return c->cost >= 0.0;
+}
+
+/* link condition - an interior edge's end points may only share the two
+   positions opposite it, otherwise the collapse pinches the surface */
+static bool collapse_keeps_manifold (Simplifier* s, const Collapse* c) {
+	int i, j, shared = 0;
+	int na = gather_ring (s, c->from, s->ring, NULL);
+	int nb = gather_ring (s, c->to, s->ring_b, NULL);
+	for (i = 0; i < na; i++) {
+		for (j = 0; j < nb; j++) {
+			if (s->ring[i] == s->ring_b[j]) {
+				shared++;
+			}
+		}
+	}
+	return 2 == shared;
+}
+
+// no triangle that survives the collapse may turn over or go degenerate
+static bool collapse_keeps_winding (const Simplifier* s, const Collapse* c) {
+	int i, j;
+	const float* to_p = &s->points[c->to * 3];
+	uint32_t w = c->from;
+	do {
+		for (i = s->adj_start[w]; i < s->adj_start[w + 1]; i++) {
+			const uint32_t* tri = &s->tris[s->adj[i] * 3];
+			const float* p[3];
+			bool dies = false;
+			for (j = 0; j < 3; j++) {
+				dies = dies || s->pos_id[tri[j]] == c->to;
+				p[j] = &s->points[tri[j] * 3];
+			}
+			if (dies) {
+				continue;
+			}
+			double before[3], after[3];
+			tri_normal (p[0], p[1], p[2], before);
+			for (j = 0; j < 3; j++) {
+				if (tri[j] == w) {
+					p[j] = to_p;
+				}
+			}
+			tri_normal (p[0], p[1], p[2], after);
+			double d = before[0] * after[0] + before[1] * after[1] +
+				before[2] * after[2];
+			if (d <= 0.0) {
+				return false;
+			}
+		}
+		w = s->wedge_next[w];
+	} while (w != c->from);
+	return true;
+}
+
+static void apply_collapse (Simplifier* s, const Collapse* c) {
+	int i, j;
+	uint32_t w = c->from;
+	do {
+		// look the partner up before any of w's triangles are touched
+		uint32_t partner = wedge_partner (s, w, c->to);
+		for (i = s->adj_start[w]; i < s->adj_start[w + 1]; i++) {
+			uint32_t* tri = &s->tris[s->adj[i] * 3];
+			if (s->pos_id[tri[0]] == c->to || s->pos_id[tri[1]] == c->to ||
+				s->pos_id[tri[2]] == c->to) {
+				tri[0] = SIMPLIFY_REMOVED;
+				s->live_count--;
+				continue;
+			}
+			for (j = 0; j < 3; j++) {
+				if (tri[j] == w) {
+					tri[j] = partner;
+				}
+			}
+		}
+		w = s->wedge_next[w];
+	} while (w != c->from);
+	quadric_add (&s->quadrics[c->to], &s->quadrics[c->from]);
+	if (c->cost > s->max_cost) {
+		s->max_cost = c->cost;
+	}
+}
+
+static int compare_collapses (const void* a, const void* b) {
+	double ca = ((const Collapse*)a)->cost, cb = ((const Collapse*)b)->cost;
+	return ca < cb ? -1 : (ca > cb ? 1 : 0);
+}
+
+/* each pass finds every position's cheapest collapse and applies them cheapest
+   first. collapsing a position locks its whole ring for the rest of the pass so
+   no decision is made on stale adjacency. passes repeat until the target is
+   met or nothing more can go */
+static bool simplify_to (Simplifier* s, int target_tris) {
+	int i, j;
+	while (s->live_count > target_tris) {
+		if (!build_adjacency (s)) {
+			return false;
+		}
+		int n_collapses = 0;
+		for (i = 0; i < s->vertex_count; i++) {
+			if ((uint32_t)i == s->pos_id[i] &&
+				best_collapse (s, (uint32_t)i, &s->collapses[n_collapses])) {
+				n_collapses++;
+			}
+		}
+		qsort (s->collapses, n_collapses, sizeof (Collapse), compare_collapses);
+		memset (s->locked, 0, s->vertex_count * sizeof (bool));
+		/* each collapse removes 2 triangles. don't go much past the cost of the
+		   one that would meet the target if none were skipped, or expensive
+		   collapses get in before cheaper ones they uncover in the next pass. a
+		   little slack covers candidates that fail the checks below every pass,
+		   and the limit is ignored until at least one collapse has gone */
+		int goal = (s->live_count - target_tris + 1) / 2 + 1 + n_collapses / 64;
+		double cost_limit = n_collapses > 0 ?
+			s->collapses[(goal < n_collapses ? goal : n_collapses) - 1].cost : 0.0;
+		int applied = 0;
+		for (i = 0; i < n_collapses && s->live_count > target_tris; i++) {
+			const Collapse* c = &s->collapses[i];
+			if (c->cost > cost_limit && applied > 0) {
+				break;
+			}
+			if (s->locked[c->from] || s->locked[c->to]) {
+				continue;
+			}
+			if (!collapse_keeps_manifold (s, c) || !collapse_keeps_winding (s, c)) {
+				continue;
+			}
+			int n = gather_ring (s, c->from, s->ring, NULL);
+			apply_collapse (s, c);
+			s->locked[c->from] = true;
+			for (j = 0; j < n; j++) {
+				s->locked[s->ring[j]] = true;
+			}
+			applied++;
+		}
+		if (0 == applied) {
+			break;
+		}
+	}
+	// squeeze out removed triangles so the next level starts compact
+	int live = 0;
+	for (i = 0; i < s->tri_count; i++) {
+		if (SIMPLIFY_REMOVED != s->tris[i * 3]) {
+			memmove (&s->tris[live * 3], &s->tris[i * 3], 3 * sizeof (uint32_t));
+			live++;
+		}
+	}
+	s->tri_count = s->live_count = live;
+	return true;
+}
+
+static float bounding_radius (const Obj_Indexed_Mesh* mesh) {
+	int i;
+	double c[3] = { 0.0, 0.0, 0.0 };
+	for (i = 0; i < mesh->vertex_count; i++) {
+		c[0] += mesh->points[i * 3];
+		c[1] += mesh->points[i * 3 + 1];
+		c[2] += mesh->points[i * 3 + 2];
+	}
+	if (mesh->vertex_count > 0) {
+		c[0] /= mesh->vertex_count;
+		c[1] /= mesh->vertex_count;
+		c[2] /= mesh->vertex_count;
+	}
+	double r2 = 0.0;
+	for (i = 0; i < mesh->vertex_count; i++) {
+		double dx = mesh->points[i * 3] - c[0];
+		double dy = mesh->points[i * 3 + 1] - c[1];
+		double dz = mesh->points[i * 3 + 2] - c[2];
+		double d2 = dx * dx + dy * dy + dz * dz;
+		if (d2 > r2) {
+			r2 = d2;
+		}
+	}
+	return (float)sqrt (r2);
+}
+
+static void free_simplifier (Simplifier* s) {
+	free (s->tris);
+	free (s->pos_id);
+	free (s->wedge_next);
+	free (s->quadrics);
+	free (s->adj_start);
+	free (s->adj);
+	free (s->fill);
+	free (s->locked);
+	free (s->collapses);
+	free (s->ring);
+	free (s->ring_b);
+	free (s->ring_count);
+}
+
+bool build_lod_chain (const Obj_Indexed_Mesh* mesh, const float* ratios,
+	int n_ratios, Mesh_Lod_Chain* chain) {
+	int i, l;
+	memset (chain, 0, sizeof (Mesh_Lod_Chain));
+	if (mesh->index_count < 3 || n_ratios < 0) {
+		fprintf (stderr, "ERROR: can't build LODs for an empty mesh\n");
+		return false;
+	}
+	if (n_ratios > MESH_LOD_MAX - 1) {
+		n_ratios = MESH_LOD_MAX - 1;
+	}
+	Simplifier s;
+	memset (&s, 0, sizeof (Simplifier));
+	s.points = mesh->points;
+	s.vertex_count = mesh->vertex_count;
+	s.tri_count = s.live_count = mesh->index_count / 3;
+	int vc = s.vertex_count, tc = s.tri_count;
+	s.tris = (uint32_t*)malloc (tc * 3 * sizeof (uint32_t));
+	s.pos_id = (uint32_t*)malloc ((vc + 1) * sizeof (uint32_t));
+	s.wedge_next = (uint32_t*)malloc ((vc + 1) * sizeof (uint32_t));
+	s.quadrics = (Quadric*)malloc ((vc + 1) * sizeof (Quadric));
+	s.adj_start = (int*)malloc ((vc + 1) * sizeof (int));
+	s.adj = (int*)malloc (tc * 3 * sizeof (int));
+	s.fill = (int*)malloc ((vc + 1) * sizeof (int));
+	s.locked = (bool*)malloc ((vc + 1) * sizeof (bool));
+	s.collapses = (Collapse*)malloc ((vc + 1) * sizeof (Collapse));
+	// worst case every level keeps all triangles
+	chain->indices = malloc ((size_t)tc * 3 * (n_ratios + 1) * mesh->index_size);
+	bool ok = s.tris && s.pos_id && s.wedge_next && s.quadrics && s.adj_start &&
+		s.adj && s.fill && s.locked && s.collapses && chain->indices;
+	if (ok) {
+		for (i = 0; i < tc * 3; i++) {
+			s.tris[i] = get_index (mesh->indices, mesh->index_size, i);
+		}
+		ok = find_wedges (&s);
+	}
+	if (ok) {
+		init_quadrics (&s);
+	}
+	chain->index_size = mesh->index_size;
+	chain->radius = bounding_radius (mesh);
+	for (l = 0; ok && l <= n_ratios; l++) {
+		if (l > 0) {
+			int target = (int)(ratios[l - 1] * (float)(mesh->index_count / 3));
+			int prev_count = s.tri_count;
+			ok = simplify_to (&s, target);
+			if (!ok) {
+				break;
+			}
+			// a copy of the previous level would only waste index buffer
+			if (s.tri_count == prev_count) {
+				fprintf (stderr, "WARNING: lod chain ends at %i levels - nothing left "
+					"to collapse below %i triangles, target was %i\n", l, s.tri_count,
+					target);
+				break;
+			}
+			if (s.tri_count > target) {
+				fprintf (stderr, "WARNING: lod %i stopped at %i triangles, target was "
+					"%i\n", l, s.tri_count, target);
+			}
+		}
+		Mesh_Lod* lod = &chain->levels[l];
+		lod->first_index = chain->index_count;
+		lod->index_count = s.tri_count * 3;
+		lod->error = (float)sqrt (s.max_cost);
+		for (i = 0; i < lod->index_count; i++) {
+			set_index (chain->indices, chain->index_size, chain->index_count + i,
+				s.tris[i]);
+		}
+		chain->index_count += lod->index_count;
+		chain->n_levels++;
+		printf ("lod %i: %i triangles, error %g\n", l, s.tri_count,
+			(double)lod->error);
+	}
+	free_simplifier (&s);
+	if (!ok) {
+		fprintf (stderr, "ERROR: out of memory building mesh LODs\n");
+		free_lod_chain (chain);
+		return false;
+	}
+	return true;
+}
+
+void free_lod_chain (Mesh_Lod_Chain* chain) {
+	free (chain->indices);
+	memset (chain, 0, sizeof (Mesh_Lod_Chain));
+}
+
+int select_lod (const Mesh_Lod_Chain* chain, float distance, float fovy_deg,
+	int viewport_height, float max_pixel_error) {
+	int l, best = 0;
+	if (distance <= 0.0f) {
+		return 0;
+	}
+	// pixels covered by one world unit at distance 1
+	float half_fovy_rad = fovy_deg * 0.5f * 3.14159265358979f / 180.0f;
+	float pixels_per_unit = (float)viewport_height / (2.0f * tanf (half_fovy_rad));
+	// levels only get coarser, so stop at the first one that shows
+	for (l = 1; l < chain->n_levels; l++) {
+		if (chain->levels[l].error * pixels_per_unit > max_pixel_error * distance) {
+			break;
+		}
+		best = l;
+	}
+	return best;
+}
@@ -0,0 +1,46 @@
+//
+// quadric error metric mesh simplification and LOD selection, C99
+// anton gerdelan <gerdela@scss.tcd.ie>
+// trinity college dublin
+//
+// Garland & Heckbert 1997 quadrics with half-edge collapses: a vertex is only
+// ever merged onto one of its neighbours, never moved. every level therefore
+// indexes the same vertex buffer as the original mesh, so one VBO serves the
+// whole chain and UVs/normals are never interpolated. vertices on open borders
+// are locked. UV or normal seams (same position, different attributes) may
+// shorten along themselves but are never dragged across the surface
+//
+#pragma once
+#include "obj_parser.h"
+
+#define MESH_LOD_MAX 8
+
+struct Mesh_Lod {
+	int first_index, index_count; // range within Mesh_Lod_Chain.indices
+	float error; // object-space distance error relative to the original mesh
+};
+typedef struct Mesh_Lod Mesh_Lod;
+
+struct Mesh_Lod_Chain {
+	Mesh_Lod levels[MESH_LOD_MAX]; // levels[0] is the original mesh
+	void* indices; // all levels back-to-back. same index_size as the source
+	int n_levels, index_count, index_size;
+	float radius; // of a bounding sphere around the vertex centroid
+};
+typedef struct Mesh_Lod_Chain Mesh_Lod_Chain;
+
+/* builds levels[0] from the mesh's own indices then one simplified level per
+   ratio, each ratio being a fraction of the original triangle count, e.g.
+   { 0.5f, 0.25f, 0.125f }. each level is simplified from the one before. a
+   level that can't reach its ratio stops where it can, with a warning. if it
+   can't remove any triangles at all the chain ends there, so n_levels may be
+   less than n_ratios + 1 */
+bool build_lod_chain (const Obj_Indexed_Mesh* mesh, const float* ratios,
+	int n_ratios, Mesh_Lod_Chain* chain);
+
+void free_lod_chain (Mesh_Lod_Chain* chain);
+
+/* picks the coarsest level whose error projects to no more than
+   max_pixel_error pixels on screen at this distance from the camera */
+int select_lod (const Mesh_Lod_Chain* chain, float distance, float fovy_deg,
+	int viewport_height, float max_pixel_error);
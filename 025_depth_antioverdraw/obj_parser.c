@@ -3,102 +3,228 @@
 // Anton Gerdelan 22 Dec 2014
 // antongerdelan.net
 //
+// the file is memory-mapped and parsed in a single pass. arrays grow by
+// doubling so we don't need a counting pass and a rewind first. numbers are
+// read with apg_parse.h rather than sscanf. big files can be split into
+// chunks at line breaks and parsed on several threads - see
+// set_obj_parser_threads(). indexed meshes can be cached in a binary sidecar
+// file next to the .obj (mesh.obj.bin), which is memory-mapped on later runs
+// and rebuilt whenever the .obj changes - see set_obj_parser_cache()
+//
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L // clock_gettime, posix_madvise, st_mtim
+#endif
 #include "obj_parser.h"
+#include "apg_parse.h"
+#include <math.h>
+#include <stdint.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#endif
 
-bool load_obj_file  (const char* file_name, float** points, float** tex_coords,
-	float** normals, int* point_count) {
-	int current_unsorted_vp = 0;
-	int current_unsorted_vt = 0;
-	int current_unsorted_vn = 0;
-	int unsorted_vp_count = 0;
-	int unsorted_vt_count = 0;
-	int unsorted_vn_count = 0;
-	int face_count = 0;
-	int i;
-	char line[1024];
-	FILE* fp = fopen (file_name, "r");
+// wall-clock time in seconds, used to report parse throughput
+static double obj_time_s () {
+#ifdef _WIN32
+	LARGE_INTEGER freq, count;
+	QueryPerformanceFrequency (&freq);
+	QueryPerformanceCounter (&count);
+	return (double)count.QuadPart / (double)freq.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+
+// map the whole file read-only. on windows just read it into a heap buffer
+static const char* map_file (const char* file_name, size_t* sz) {
+	*sz = 0;
+#ifdef _WIN32
+	FILE* fp = fopen (file_name, "rb");
 	if (!fp) {
-		fprintf (stderr, "ERROR: could not find file %s\n", file_name);
-		return false;
+		return NULL;
 	}
-	
-	// first count points in file so we know how much mem to allocate
-	*point_count = 0;
-	while (fgets (line, 1024, fp)) {
-		if (line[0] == 'v') {
-			if (line[1] == ' ') {
-				unsorted_vp_count++;
-			} else if (line[1] == 't') {
-				unsorted_vt_count++;
-			} else if (line[1] == 'n') {
-				unsorted_vn_count++;
-			}
-		} else if (line[0] == 'f') {
-			face_count++;
-		}
-	}
-	printf ("found %i vp %i vt %i vn unique in obj. allocating memory...\n",
-		unsorted_vp_count, unsorted_vt_count, unsorted_vn_count);
-	float* unsorted_vp_array = (float*)malloc (unsorted_vp_count * 3 * sizeof (float));
-	float* unsorted_vt_array = (float*)malloc (unsorted_vt_count * 2 * sizeof (float));
-	float* unsorted_vn_array = (float*)malloc (unsorted_vn_count * 3 * sizeof (float));
-	*points = (float*)malloc (3 * face_count * 3 * sizeof (float));
-	*tex_coords = (float*)malloc (3 * face_count * 2 * sizeof (float));
-	*normals = (float*)malloc (3 * face_count * 3 * sizeof (float));
-	printf ("allocated %i bytes for mesh\n", (int)(3 * face_count * 8 *
-		sizeof (float)));
-	
+	fseek (fp, 0, SEEK_END);
+	long len = ftell (fp);
 	rewind (fp);
-	while (fgets (line, 1024, fp)) {
+	char* buf = (char*)malloc (len > 0 ? len : 1);
+	*sz = fread (buf, 1, len, fp);
+	fclose (fp);
+	return buf;
+#else
+	int fd = open (file_name, O_RDONLY);
+	if (fd < 0) {
+		return NULL;
+	}
+	struct stat st;
+	if (fstat (fd, &st) != 0) {
+		close (fd);
+		return NULL;
+	}
+	*sz = (size_t)st.st_size;
+	if (0 == *sz) {
+		// mmap refuses zero-length mappings
+		close (fd);
+		return (const char*)malloc (1);
+	}
+	void* ptr = mmap (NULL, *sz, PROT_READ, MAP_PRIVATE, fd, 0);
+	close (fd); // mapping stays valid after close
+	if (MAP_FAILED == ptr) {
+		return NULL;
+	}
+	posix_madvise (ptr, *sz, POSIX_MADV_SEQUENTIAL);
+	return (const char*)ptr;
+#endif
+}
+
+static void unmap_file (const char* ptr, size_t sz) {
+#ifdef _WIN32
+	free ((void*)ptr);
+#else
+	if (0 == sz) {
+		free ((void*)ptr);
+	} else {
+		munmap ((void*)ptr, sz);
+	}
+#endif
+}
+
+// doubles the capacity of an array when the next n elements won't fit
+static bool grow_array (void** arr, int* cap, int count, int n,
+	size_t elem_size) {
+	if (count + n <= *cap) {
+		return true;
+	}
+	int new_cap = *cap > 0 ? *cap * 2 : 1024;
+	while (new_cap < count + n) {
+		new_cap *= 2;
+	}
+	void* tmp = realloc (*arr, (size_t)new_cap * elem_size);
+	if (!tmp) {
+		fprintf (stderr, "ERROR: out of memory growing obj arrays\n");
+		return false;
+	}
+	*arr = tmp;
+	*cap = new_cap;
+	return true;
+}
+
+// reads one "vp/vt/vn" face corner. returns NULL if any index is missing
+static const char* parse_face_corner (const char* p, const char* end, int* vp,
+	int* vt, int* vn) {
+	const char* q = apg_parse_int (p, end, vp);
+	if (q == p || q >= end || *q != '/') {
+		return NULL;
+	}
+	p = q + 1;
+	q = apg_parse_int (p, end, vt);
+	if (q == p || q >= end || *q != '/') {
+		return NULL;
+	}
+	p = q + 1;
+	q = apg_parse_int (p, end, vn);
+	if (q == p) {
+		return NULL;
+	}
+	return q;
+}
+
+// everything read from the text before face indices are resolved
+struct Obj_Parsed {
+	float *vp, *vt, *vn; // unsorted attribute arrays
+	int* corners; // raw 1-based vp,vt,vn triples, 3 corners per face
+	int vp_count, vt_count, vn_count, corner_count; // in vertices/corners
+	int vp_cap, vt_cap, vn_cap, corners_cap; // in floats/ints
+};
+typedef struct Obj_Parsed Obj_Parsed;
+
+static void free_obj_parsed (Obj_Parsed* parsed) {
+	free (parsed->vp);
+	free (parsed->vt);
+	free (parsed->vn);
+	free (parsed->corners);
+	memset (parsed, 0, sizeof (Obj_Parsed));
+}
+
+// parses the v, vt, vn, and f lines in [curr, end) into parsed
+static bool parse_obj_text (const char* curr, const char* end,
+	Obj_Parsed* parsed) {
+	int i;
+	while (curr < end) {
+		const char* line = curr;
+		curr = apg_next_line (curr, end);
+		const char* line_end = curr;
+
 		// vertex
-		if (line[0] == 'v') {
-		
+		if (line[0] == 'v' && line_end - line > 2) {
+			float f[3] = { 0.0f, 0.0f, 0.0f };
+			const char* p = line + 2;
 			// vertex point
 			if (line[1] == ' ') {
-				float x, y, z;
-				x = y = z = 0.0f;
-				sscanf (line, "v %f %f %f", &x, &y, &z);
-				unsorted_vp_array[current_unsorted_vp * 3] = x;
-				unsorted_vp_array[current_unsorted_vp * 3 + 1] = y;
-				unsorted_vp_array[current_unsorted_vp * 3 + 2] = z;
-				current_unsorted_vp++;
-				
+				p = apg_parse_float (p, line_end, &f[0]);
+				p = apg_parse_float (p, line_end, &f[1]);
+				apg_parse_float (p, line_end, &f[2]);
+				if (!grow_array ((void**)&parsed->vp, &parsed->vp_cap,
+					parsed->vp_count * 3, 3, sizeof (float))) {
+					return false;
+				}
+				memcpy (&parsed->vp[parsed->vp_count * 3], f, 3 * sizeof (float));
+				parsed->vp_count++;
+
 			// vertex texture coordinate
 			} else if (line[1] == 't') {
-				float s, t;
-				s = t = 0.0f;
-				sscanf (line, "vt %f %f", &s, &t);
-				unsorted_vt_array[current_unsorted_vt * 2] = s;
-				unsorted_vt_array[current_unsorted_vt * 2 + 1] = t;
-				current_unsorted_vt++;
-				
+				p = apg_parse_float (p, line_end, &f[0]);
+				apg_parse_float (p, line_end, &f[1]);
+				if (!grow_array ((void**)&parsed->vt, &parsed->vt_cap,
+					parsed->vt_count * 2, 2, sizeof (float))) {
+					return false;
+				}
+				memcpy (&parsed->vt[parsed->vt_count * 2], f, 2 * sizeof (float));
+				parsed->vt_count++;
+
 			// vertex normal
 			} else if (line[1] == 'n') {
-				float x, y, z;
-				x = y = z = 0.0f;
-				sscanf (line, "vn %f %f %f", &x, &y, &z);
-				unsorted_vn_array[current_unsorted_vn * 3] = x;
-				unsorted_vn_array[current_unsorted_vn * 3 + 1] = y;
-				unsorted_vn_array[current_unsorted_vn * 3 + 2] = z;
-				current_unsorted_vn++;
+				p = apg_parse_float (p, line_end, &f[0]);
+				p = apg_parse_float (p, line_end, &f[1]);
+				apg_parse_float (p, line_end, &f[2]);
+				if (!grow_array ((void**)&parsed->vn, &parsed->vn_cap,
+					parsed->vn_count * 3, 3, sizeof (float))) {
+					return false;
+				}
+				memcpy (&parsed->vn[parsed->vn_count * 3], f, 3 * sizeof (float));
+				parsed->vn_count++;
 			}
-			
+
 		// faces
-		} else if (line[0] == 'f') {
-			int vp[3], vt[3], vn[3], len;
-			int slashCount = 0;
-			// work out if using quads instead of triangles and print a warning
-			
-			len = strlen (line);
-			for (i = 0; i < len; i++) {
-				if (line[i] == '/') {
-					slashCount++;
+		} else if (line[0] == 'f' && line_end - line > 1 && line[1] == ' ') {
+			if (!grow_array ((void**)&parsed->corners, &parsed->corners_cap,
+				parsed->corner_count * 3, 9, sizeof (int))) {
+				return false;
+			}
+			int* c = &parsed->corners[parsed->corner_count * 3];
+			// exactly three vp/vt/vn corners then end of line, or it's quads etc.
+			const char* p = line + 1;
+			for (i = 0; i < 3 && p; i++) {
+				p = parse_face_corner (p, line_end, &c[i * 3], &c[i * 3 + 1],
+					&c[i * 3 + 2]);
+			}
+			if (p) {
+				p = apg_skip_spaces (p, line_end);
+				if (p < line_end && *p == '\r') {
+					p++;
 				}
 			}
-			if (slashCount != 6) {
+			if (!p || (p < line_end && *p != '\n')) {
 				fprintf (
 					stderr,
 					"ERROR: file contains quads or does not match v vp/vt/vn layout - \
@@ -107,45 +233,762 @@ bool load_obj_file  (const char* file_name, float** points, float** tex_coords,
 				);
 				return false;
 			}
+			parsed->corner_count += 3;
+		}
+	}
+	return true;
+}
 
-			sscanf (line, "f %i/%i/%i %i/%i/%i %i/%i/%i",
-			 &vp[0], &vt[0], &vn[0], &vp[1], &vt[1], &vn[1], &vp[2], &vt[2], &vn[2]);
-			/* start reading points into a buffer. order is -1 because obj starts
-			   from 1, not 0 */
-			// NB: assuming all indices are valid
-			for (i = 0; i < 3; i++) {
-				int pc = *point_count;
-				if ((vp[i] - 1 < 0) || (vp[i] - 1 >= unsorted_vp_count)) {
-					fprintf (stderr, "ERROR: invalid vertex position index in face\n");
-					return false;
-				}
-				if ((vt[i] - 1 < 0) || (vt[i] - 1 >= unsorted_vt_count)) {
-					fprintf (stderr, "ERROR: invalid texture coord index %i in face.\n",
-						vt[i]);
-					return false;
-				}
-				if ((vn[i] - 1 < 0) || (vn[i] - 1 >= unsorted_vn_count)) {
-					printf ("ERROR: invalid vertex normal index in face\n");
-					return false;
-				}
-				// note - parentheses needed for C array dereferencing w/ptr
-				(*points)[pc * 3] = unsorted_vp_array[(vp[i] - 1) * 3];
-				(*points)[pc * 3 + 1] = unsorted_vp_array[(vp[i] - 1) * 3 + 1];
-				(*points)[pc * 3 + 2] = unsorted_vp_array[(vp[i] - 1) * 3 + 2];
-				(*tex_coords)[pc * 2] = unsorted_vt_array[(vt[i] - 1) * 2];
-				(*tex_coords)[pc * 2 + 1] = unsorted_vt_array[(vt[i] - 1) * 2 + 1];
-				(*normals)[pc * 3] = unsorted_vn_array[(vn[i] - 1) * 3];
-				(*normals)[pc * 3 + 1] = unsorted_vn_array[(vn[i] - 1) * 3 + 1];
-				(*normals)[pc * 3 + 2] = unsorted_vn_array[(vn[i] - 1) * 3 + 2];
-				// ++ doesnt work here for deref, need brackets or it increments ptr
-				(*point_count)++;
+/* checks 1-based face corner indices against the attribute counts, then
+   converts them to 0-based. the check comes first as apg_parse_int clamps
+   huge indices to INT_MIN/INT_MAX, which can't be decremented */
+static bool validate_corners (Obj_Parsed* parsed) {
+	int i;
+	for (i = 0; i < parsed->corner_count; i++) {
+		int* c = &parsed->corners[i * 3];
+		if (c[0] < 1 || c[0] > parsed->vp_count) {
+			fprintf (stderr, "ERROR: invalid vertex position index in face\n");
+			return false;
+		}
+		if (c[1] < 1 || c[1] > parsed->vt_count) {
+			fprintf (stderr, "ERROR: invalid texture coord index %i in face.\n",
+				c[1]);
+			return false;
+		}
+		if (c[2] < 1 || c[2] > parsed->vn_count) {
+			printf ("ERROR: invalid vertex normal index in face\n");
+			return false;
+		}
+		c[0]--;
+		c[1]--;
+		c[2]--;
+	}
+	return true;
+}
+
+// 1 = parse on the calling thread, 0 = one thread per core
+static int g_obj_threads = 1;
+// don't bother splitting files into chunks smaller than this
+#define OBJ_MIN_CHUNK_BYTES (1024 * 1024)
+#define OBJ_MAX_THREADS 64
+
+void set_obj_parser_threads (int n_threads) {
+	g_obj_threads = n_threads < 0 ? 1 : n_threads;
+}
+
+static int obj_core_count () {
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo (&info);
+	return (int)info.dwNumberOfProcessors;
+#else
+	long n = sysconf (_SC_NPROCESSORS_ONLN);
+	return n > 0 ? (int)n : 1;
+#endif
+}
+
+// one thread's share of the file
+struct Obj_Chunk {
+	const char *start, *end;
+	Obj_Parsed parsed;
+	bool ok;
+};
+typedef struct Obj_Chunk Obj_Chunk;
+
+#ifdef _WIN32
+static DWORD WINAPI parse_chunk_thread (LPVOID arg) {
+#else
+static void* parse_chunk_thread (void* arg) {
+#endif
+	Obj_Chunk* chunk = (Obj_Chunk*)arg;
+	chunk->ok = parse_obj_text (chunk->start, chunk->end, &chunk->parsed);
+	return 0;
+}
+
+// appends n elements of src onto dst, growing it
+static bool append_array (void** dst, int* dst_cap, int dst_count,
+	const void* src, int n, size_t elem_size) {
+	if (n <= 0) {
+		return true;
+	}
+	if (!grow_array (dst, dst_cap, dst_count, n, elem_size)) {
+		return false;
+	}
+	memcpy ((char*)*dst + (size_t)dst_count * elem_size, src,
+		(size_t)n * elem_size);
+	return true;
+}
+
+/* splits the text at line breaks and parses the chunks in parallel. face
+   indices in .obj are absolute, so the merge is just concatenating chunks in
+   file order, and validate_corners() resolves everything afterwards exactly
+   as in the serial case */
+static bool parse_obj_text_threaded (const char* text, size_t sz,
+	int n_threads, Obj_Parsed* parsed) {
+	Obj_Chunk chunks[OBJ_MAX_THREADS];
+	int i, n_chunks = 0;
+	const char* end = text + sz;
+	const char* start = text;
+	for (i = 0; i < n_threads && start < end; i++) {
+		const char* chunk_end = text + (size_t)((double)sz * (i + 1) / n_threads);
+		if (i == n_threads - 1 || chunk_end >= end) {
+			chunk_end = end;
+		} else {
+			chunk_end = apg_next_line (chunk_end, end);
+		}
+		if (chunk_end <= start) {
+			continue;
+		}
+		memset (&chunks[n_chunks], 0, sizeof (Obj_Chunk));
+		chunks[n_chunks].start = start;
+		chunks[n_chunks].end = chunk_end;
+		n_chunks++;
+		start = chunk_end;
+	}
+
+	// chunk 0 runs on this thread
+#ifdef _WIN32
+	HANDLE threads[OBJ_MAX_THREADS];
+	for (i = 1; i < n_chunks; i++) {
+		threads[i] = CreateThread (NULL, 0, parse_chunk_thread, &chunks[i], 0,
+			NULL);
+		if (!threads[i]) {
+			parse_chunk_thread (&chunks[i]);
+		}
+	}
+	if (n_chunks > 0) {
+		parse_chunk_thread (&chunks[0]);
+	}
+	for (i = 1; i < n_chunks; i++) {
+		if (threads[i]) {
+			WaitForSingleObject (threads[i], INFINITE);
+			CloseHandle (threads[i]);
+		}
+	}
+#else
+	pthread_t threads[OBJ_MAX_THREADS];
+	bool started[OBJ_MAX_THREADS];
+	for (i = 1; i < n_chunks; i++) {
+		started[i] = 0 == pthread_create (&threads[i], NULL, parse_chunk_thread,
+			&chunks[i]);
+		if (!started[i]) {
+			parse_chunk_thread (&chunks[i]);
+		}
+	}
+	if (n_chunks > 0) {
+		parse_chunk_thread (&chunks[0]);
+	}
+	for (i = 1; i < n_chunks; i++) {
+		if (started[i]) {
+			pthread_join (threads[i], NULL);
+		}
+	}
+#endif
+
+	// merge in file order. chunk 0's arrays are reused as the output
+	bool ok = n_chunks == 0 || chunks[0].ok;
+	if (n_chunks > 0) {
+		*parsed = chunks[0].parsed;
+	}
+	for (i = 1; i < n_chunks; i++) {
+		Obj_Parsed* p = &chunks[i].parsed;
+		ok = ok && chunks[i].ok &&
+			append_array ((void**)&parsed->vp, &parsed->vp_cap, parsed->vp_count * 3,
+				p->vp, p->vp_count * 3, sizeof (float)) &&
+			append_array ((void**)&parsed->vt, &parsed->vt_cap, parsed->vt_count * 2,
+				p->vt, p->vt_count * 2, sizeof (float)) &&
+			append_array ((void**)&parsed->vn, &parsed->vn_cap, parsed->vn_count * 3,
+				p->vn, p->vn_count * 3, sizeof (float)) &&
+			append_array ((void**)&parsed->corners, &parsed->corners_cap,
+				parsed->corner_count * 3, p->corners, p->corner_count * 3,
+				sizeof (int));
+		if (ok) {
+			parsed->vp_count += p->vp_count;
+			parsed->vt_count += p->vt_count;
+			parsed->vn_count += p->vn_count;
+			parsed->corner_count += p->corner_count;
+		}
+		free_obj_parsed (p);
+	}
+	return ok;
+}
+
+// maps and parses a whole file then validates the face indices
+static bool parse_obj_file (const char* file_name, Obj_Parsed* parsed,
+	size_t* file_sz) {
+	memset (parsed, 0, sizeof (Obj_Parsed));
+	const char* file_data = map_file (file_name, file_sz);
+	if (!file_data) {
+		fprintf (stderr, "ERROR: could not find file %s\n", file_name);
+		return false;
+	}
+	int n_threads = g_obj_threads > 0 ? g_obj_threads : obj_core_count ();
+	int max_chunks = (int)(*file_sz / OBJ_MIN_CHUNK_BYTES) + 1;
+	if (n_threads > max_chunks) {
+		n_threads = max_chunks;
+	}
+	if (n_threads > OBJ_MAX_THREADS) {
+		n_threads = OBJ_MAX_THREADS;
+	}
+	bool ok = false;
+	if (n_threads > 1) {
+		ok = parse_obj_text_threaded (file_data, *file_sz, n_threads, parsed);
+	} else {
+		ok = parse_obj_text (file_data, file_data + *file_sz, parsed);
+	}
+	unmap_file (file_data, *file_sz);
+	if (!ok || !validate_corners (parsed)) {
+		free_obj_parsed (parsed);
+		return false;
+	}
+	return true;
+}
+
+static void print_throughput (size_t file_sz, double start_s) {
+	double elapsed_s = obj_time_s () - start_s;
+	double mb = (double)file_sz / (1024.0 * 1024.0);
+	printf ("parsed %.2fMB in %.3fs (%.1fMB/s)\n", mb, elapsed_s,
+		elapsed_s > 0.0 ? mb / elapsed_s : 0.0);
+}
+
+// unrolls each face corner into its own vertex
+static bool unroll_corners (const Obj_Parsed* parsed, float** points,
+	float** tex_coords, float** normals, int* point_count) {
+	int i, pc = parsed->corner_count;
+	*points = (float*)malloc (pc * 3 * sizeof (float));
+	*tex_coords = (float*)malloc (pc * 2 * sizeof (float));
+	*normals = (float*)malloc (pc * 3 * sizeof (float));
+	if (pc > 0 && (!*points || !*tex_coords || !*normals)) {
+		fprintf (stderr, "ERROR: out of memory allocating obj mesh\n");
+		free (*points);
+		free (*tex_coords);
+		free (*normals);
+		*points = *tex_coords = *normals = NULL;
+		return false;
+	}
+	for (i = 0; i < pc; i++) {
+		const int* c = &parsed->corners[i * 3];
+		// note - parentheses needed for C array dereferencing w/ptr
+		memcpy (&(*points)[i * 3], &parsed->vp[c[0] * 3], 3 * sizeof (float));
+		memcpy (&(*tex_coords)[i * 2], &parsed->vt[c[1] * 2], 2 * sizeof (float));
+		memcpy (&(*normals)[i * 3], &parsed->vn[c[2] * 3], 3 * sizeof (float));
+	}
+	*point_count = pc;
+	return true;
+}
+
+// same output as unroll_corners() but from an already-indexed mesh
+static bool unroll_indexed (const Obj_Indexed_Mesh* mesh, float** points,
+	float** tex_coords, float** normals, int* point_count) {
+	int i, pc = mesh->index_count;
+	*points = (float*)malloc (pc * 3 * sizeof (float));
+	*tex_coords = (float*)malloc (pc * 2 * sizeof (float));
+	*normals = (float*)malloc (pc * 3 * sizeof (float));
+	if (pc > 0 && (!*points || !*tex_coords || !*normals)) {
+		fprintf (stderr, "ERROR: out of memory allocating obj mesh\n");
+		free (*points);
+		free (*tex_coords);
+		free (*normals);
+		*points = *tex_coords = *normals = NULL;
+		return false;
+	}
+	for (i = 0; i < pc; i++) {
+		uint32_t v = 2 == mesh->index_size ? ((const uint16_t*)mesh->indices)[i] :
+			((const uint32_t*)mesh->indices)[i];
+		memcpy (&(*points)[i * 3], &mesh->points[v * 3], 3 * sizeof (float));
+		memcpy (&(*tex_coords)[i * 2], &mesh->tex_coords[v * 2], 2 * sizeof (float));
+		memcpy (&(*normals)[i * 3], &mesh->normals[v * 3], 3 * sizeof (float));
+	}
+	*point_count = pc;
+	return true;
+}
+
+// mixes a vp/vt/vn triple into a hash table slot
+static uint32_t hash_corner (const int* c) {
+	uint32_t h = (uint32_t)c[0] * 0x9E3779B1u;
+	h ^= (uint32_t)c[1] * 0x85EBCA77u;
+	h ^= (uint32_t)c[2] * 0xC2B2AE3Du;
+	h ^= h >> 15;
+	h *= 0x2C1B3C6Du;
+	h ^= h >> 12;
+	return h;
+}
+
+// de-duplicates the parsed face corners into unique vertices and indices
+static bool build_indexed_mesh (const Obj_Parsed* parsed,
+	Obj_Indexed_Mesh* mesh) {
+	int i, n = parsed->corner_count;
+	memset (mesh, 0, sizeof (Obj_Indexed_Mesh));
+	// open-addressed table of vertex indices, kept under half full
+	uint32_t table_sz = 64;
+	while (table_sz < (uint32_t)n * 2) {
+		table_sz *= 2;
+	}
+	int* table = (int*)malloc (table_sz * sizeof (int));
+	int* unique_corners = (int*)malloc ((n > 0 ? n : 1) * sizeof (int));
+	uint32_t* indices = (uint32_t*)malloc ((n > 0 ? n : 1) * sizeof (uint32_t));
+	if (!table || !unique_corners || !indices) {
+		fprintf (stderr, "ERROR: out of memory allocating obj mesh\n");
+		free (table);
+		free (unique_corners);
+		free (indices);
+		return false;
+	}
+	memset (table, 0xFF, table_sz * sizeof (int)); // -1 == empty
+	int vertex_count = 0;
+	for (i = 0; i < n; i++) {
+		const int* c = &parsed->corners[i * 3];
+		uint32_t slot = hash_corner (c) & (table_sz - 1);
+		for (;;) {
+			int v = table[slot];
+			if (v < 0) {
+				table[slot] = vertex_count;
+				unique_corners[vertex_count] = i;
+				indices[i] = (uint32_t)vertex_count++;
+				break;
 			}
+			const int* other = &parsed->corners[unique_corners[v] * 3];
+			if (other[0] == c[0] && other[1] == c[1] && other[2] == c[2]) {
+				indices[i] = (uint32_t)v;
+				break;
+			}
+			slot = (slot + 1) & (table_sz - 1);
 		}
 	}
-	fclose (fp);
-	free (unsorted_vp_array);
-	free (unsorted_vn_array);
-	free (unsorted_vt_array);
-	printf ("allocated %i points\n", *point_count);
+	free (table);
+
+	float* points = (float*)malloc (vertex_count * 3 * sizeof (float));
+	float* tex_coords = (float*)malloc (vertex_count * 2 * sizeof (float));
+	float* normals = (float*)malloc (vertex_count * 3 * sizeof (float));
+	bool ok = vertex_count == 0 || (points && tex_coords && normals);
+	for (i = 0; ok && i < vertex_count; i++) {
+		const int* c = &parsed->corners[unique_corners[i] * 3];
+		memcpy (&points[i * 3], &parsed->vp[c[0] * 3], 3 * sizeof (float));
+		memcpy (&tex_coords[i * 2], &parsed->vt[c[1] * 2], 2 * sizeof (float));
+		memcpy (&normals[i * 3], &parsed->vn[c[2] * 3], 3 * sizeof (float));
+	}
+	free (unique_corners);
+	mesh->points = points;
+	mesh->tex_coords = tex_coords;
+	mesh->normals = normals;
+	mesh->vertex_count = vertex_count;
+	mesh->index_count = n;
+	mesh->index_size = 4;
+	mesh->indices = indices;
+	// squash to 16-bit indices in-place if every vertex is addressable
+	if (ok && vertex_count <= 65536) {
+		uint16_t* indices16 = (uint16_t*)indices;
+		for (i = 0; i < n; i++) {
+			indices16[i] = (uint16_t)indices[i];
+		}
+		mesh->index_size = 2;
+	}
+	if (!ok) {
+		fprintf (stderr, "ERROR: out of memory allocating obj mesh\n");
+		free_obj_indexed_mesh (mesh);
+		return false;
+	}
+	printf ("indexed %i corners into %i unique vertices (%i-bit indices)\n", n,
+		vertex_count, mesh->index_size * 8);
+	return true;
+}
+
+/* binary sidecar layout: this header, then the points, tex_coords, normals, and
+   indices blobs, each starting on an OBJ_CACHE_ALIGN boundary. bump
+   OBJ_CACHE_VERSION whenever the layout changes */
+#define OBJ_CACHE_MAGIC "APGMESH"
+#define OBJ_CACHE_VERSION 1
+#define OBJ_CACHE_ALIGN 64
+struct Obj_Cache_Header {
+	char magic[8];
+	uint32_t version, index_size;
+	int64_t src_mtime; // source .obj mtime in ns and size, to detect staleness
+	uint64_t src_size;
+	uint32_t vertex_count, index_count;
+	uint64_t points_offset, tex_coords_offset, normals_offset, indices_offset;
+	uint64_t total_size;
+};
+typedef struct Obj_Cache_Header Obj_Cache_Header;
+
+static bool g_obj_cache = false;
+
+void set_obj_parser_cache (bool enabled) {
+	g_obj_cache = enabled;
+}
+
+static bool source_stat (const char* file_name, int64_t* mtime,
+	uint64_t* size) {
+	struct stat st;
+	if (stat (file_name, &st) != 0) {
+		return false;
+	}
+	// nanoseconds where we can get them so quick re-exports are noticed
+#if defined(__APPLE__)
+	*mtime = (int64_t)st.st_mtimespec.tv_sec * 1000000000 +
+		st.st_mtimespec.tv_nsec;
+#elif defined(_WIN32)
+	*mtime = (int64_t)st.st_mtime * 1000000000;
+#else
+	*mtime = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+	*size = (uint64_t)st.st_size;
+	return true;
+}
+
+static void cache_file_name (const char* file_name, char* out, size_t max) {
+	snprintf (out, max, "%s.bin", file_name);
+}
+
+static uint64_t align_cache_offset (uint64_t offset) {
+	return (offset + OBJ_CACHE_ALIGN - 1) & ~(uint64_t)(OBJ_CACHE_ALIGN - 1);
+}
+
+/* fills in the blob offsets and total size for a mesh. returns the header
+   ready to write */
+static Obj_Cache_Header make_cache_header (const Obj_Indexed_Mesh* mesh,
+	int64_t src_mtime, uint64_t src_size) {
+	Obj_Cache_Header h;
+	memset (&h, 0, sizeof (h));
+	memcpy (h.magic, OBJ_CACHE_MAGIC, sizeof (OBJ_CACHE_MAGIC));
+	h.version = OBJ_CACHE_VERSION;
+	h.index_size = (uint32_t)mesh->index_size;
+	h.src_mtime = src_mtime;
+	h.src_size = src_size;
+	h.vertex_count = (uint32_t)mesh->vertex_count;
+	h.index_count = (uint32_t)mesh->index_count;
+	uint64_t vc = h.vertex_count;
+	h.points_offset = align_cache_offset (sizeof (Obj_Cache_Header));
+	h.tex_coords_offset = align_cache_offset (h.points_offset +
+		vc * 3 * sizeof (float));
+	h.normals_offset = align_cache_offset (h.tex_coords_offset +
+		vc * 2 * sizeof (float));
+	h.indices_offset = align_cache_offset (h.normals_offset +
+		vc * 3 * sizeof (float));
+	h.total_size = h.indices_offset + (uint64_t)h.index_count * h.index_size;
+	return h;
+}
+
+// maps a sidecar and points mesh straight into it, if it is still valid
+static bool read_obj_cache (const char* file_name, Obj_Indexed_Mesh* mesh) {
+	char cache_name[2048];
+	int64_t src_mtime;
+	uint64_t src_size;
+	if (!source_stat (file_name, &src_mtime, &src_size)) {
+		return false;
+	}
+	cache_file_name (file_name, cache_name, sizeof (cache_name));
+	size_t sz = 0;
+	const char* data = map_file (cache_name, &sz);
+	if (!data) {
+		return false; // no sidecar yet
+	}
+	Obj_Cache_Header h;
+	bool ok = sz >= sizeof (h);
+	if (ok) {
+		memcpy (&h, data, sizeof (h));
+		Obj_Indexed_Mesh dims;
+		dims.vertex_count = (int)h.vertex_count;
+		dims.index_count = (int)h.index_count;
+		dims.index_size = (int)h.index_size;
+		Obj_Cache_Header expected = make_cache_header (&dims, src_mtime, src_size);
+		ok = 0 == memcmp (h.magic, OBJ_CACHE_MAGIC, sizeof (OBJ_CACHE_MAGIC)) &&
+			OBJ_CACHE_VERSION == h.version && (2 == h.index_size ||
+			4 == h.index_size) && h.vertex_count <= 0x7FFFFFFF &&
+			h.index_count <= 0x7FFFFFFF && 0 == memcmp (&h, &expected, sizeof (h)) &&
+			h.total_size <= sz;
+	}
+	if (!ok) {
+		printf ("cache %s is stale or invalid - rebuilding\n", cache_name);
+		unmap_file (data, sz);
+		return false;
+	}
+	memset (mesh, 0, sizeof (Obj_Indexed_Mesh));
+	mesh->points = (const float*)(data + h.points_offset);
+	mesh->tex_coords = (const float*)(data + h.tex_coords_offset);
+	mesh->normals = (const float*)(data + h.normals_offset);
+	mesh->indices = data + h.indices_offset;
+	mesh->vertex_count = (int)h.vertex_count;
+	mesh->index_count = (int)h.index_count;
+	mesh->index_size = (int)h.index_size;
+	mesh->mapped_data = data;
+	mesh->mapped_size = sz;
+	return true;
+}
+
+// writes a sidecar via a temporary file so a crash never leaves half a cache
+static void write_obj_cache (const char* file_name,
+	const Obj_Indexed_Mesh* mesh) {
+	char cache_name[2048], tmp_name[2048 + 8];
+	int64_t src_mtime;
+	uint64_t src_size;
+	if (!source_stat (file_name, &src_mtime, &src_size)) {
+		return;
+	}
+	cache_file_name (file_name, cache_name, sizeof (cache_name));
+	snprintf (tmp_name, sizeof (tmp_name), "%s.tmp", cache_name);
+	FILE* fp = fopen (tmp_name, "wb");
+	if (!fp) {
+		fprintf (stderr, "WARNING: could not write mesh cache %s\n", cache_name);
+		return;
+	}
+	Obj_Cache_Header h = make_cache_header (mesh, src_mtime, src_size);
+	const void* blobs[4] = { mesh->points, mesh->tex_coords, mesh->normals,
+		mesh->indices };
+	uint64_t offsets[4] = { h.points_offset, h.tex_coords_offset,
+		h.normals_offset, h.indices_offset };
+	uint64_t sizes[4] = { (uint64_t)h.vertex_count * 3 * sizeof (float),
+		(uint64_t)h.vertex_count * 2 * sizeof (float),
+		(uint64_t)h.vertex_count * 3 * sizeof (float),
+		(uint64_t)h.index_count * h.index_size };
+	static const char zeros[OBJ_CACHE_ALIGN] = { 0 };
+	uint64_t written = 0;
+	bool ok = 1 == fwrite (&h, sizeof (h), 1, fp);
+	written = sizeof (h);
+	int i;
+	for (i = 0; ok && i < 4; i++) {
+		ok = fwrite (zeros, 1, (size_t)(offsets[i] - written), fp) ==
+			offsets[i] - written;
+		ok = ok && fwrite (blobs[i], 1, (size_t)sizes[i], fp) == sizes[i];
+		written = offsets[i] + sizes[i];
+	}
+	ok = (0 == fclose (fp)) && ok;
+#ifdef _WIN32
+	remove (cache_name); // rename won't replace an existing file on windows
+#endif
+	if (!ok || 0 != rename (tmp_name, cache_name)) {
+		fprintf (stderr, "WARNING: could not write mesh cache %s\n", cache_name);
+		remove (tmp_name);
+		return;
+	}
+	printf ("wrote mesh cache %s\n", cache_name);
+}
+
+// loads the indexed mesh from its sidecar, or parses it and writes the sidecar
+static bool load_indexed_via_cache (const char* file_name,
+	Obj_Indexed_Mesh* mesh, size_t* parsed_sz) {
+	*parsed_sz = 0;
+	if (read_obj_cache (file_name, mesh)) {
+		printf ("loaded %s.bin (%i vertices %i indices)\n", file_name,
+			mesh->vertex_count, mesh->index_count);
+		return true;
+	}
+	Obj_Parsed parsed;
+	if (!parse_obj_file (file_name, &parsed, parsed_sz)) {
+		return false;
+	}
+	bool ok = build_indexed_mesh (&parsed, mesh);
+	free_obj_parsed (&parsed);
+	if (ok && g_obj_cache) {
+		write_obj_cache (file_name, mesh);
+	}
+	return ok;
+}
+
+bool load_obj_file  (const char* file_name, float** points, float** tex_coords,
+	float** normals, int* point_count) {
+	double start_s = obj_time_s ();
+	size_t file_sz = 0;
+	bool ok = false;
+	*points = *tex_coords = *normals = NULL;
+	*point_count = 0;
+	if (g_obj_cache) {
+		Obj_Indexed_Mesh mesh;
+		if (!load_indexed_via_cache (file_name, &mesh, &file_sz)) {
+			return false;
+		}
+		ok = unroll_indexed (&mesh, points, tex_coords, normals, point_count);
+		free_obj_indexed_mesh (&mesh);
+	} else {
+		Obj_Parsed parsed;
+		if (!parse_obj_file (file_name, &parsed, &file_sz)) {
+			return false;
+		}
+		ok = unroll_corners (&parsed, points, tex_coords, normals, point_count);
+		free_obj_parsed (&parsed);
+	}
+	if (!ok) {
+		return false;
+	}
+	printf ("allocated %i points (%i bytes)\n", *point_count,
+		(int)(*point_count * 8 * sizeof (float)));
+	if (file_sz > 0) {
+		print_throughput (file_sz, start_s);
+	}
+	return true;
+}
+
+bool load_obj_file_indexed (const char* file_name, Obj_Indexed_Mesh* mesh) {
+	double start_s = obj_time_s ();
+	size_t file_sz = 0;
+	memset (mesh, 0, sizeof (Obj_Indexed_Mesh));
+	if (g_obj_cache) {
+		if (!load_indexed_via_cache (file_name, mesh, &file_sz)) {
+			return false;
+		}
+	} else {
+		Obj_Parsed parsed;
+		if (!parse_obj_file (file_name, &parsed, &file_sz)) {
+			return false;
+		}
+		bool ok = build_indexed_mesh (&parsed, mesh);
+		free_obj_parsed (&parsed);
+		if (!ok) {
+			return false;
+		}
+	}
+	if (file_sz > 0) {
+		print_throughput (file_sz, start_s);
+	}
+	return true;
+}
+
+void free_obj_indexed_mesh (Obj_Indexed_Mesh* mesh) {
+	if (mesh->mapped_data) {
+		unmap_file ((const char*)mesh->mapped_data, mesh->mapped_size);
+	} else {
+		// heap arrays when not mapped, so casting away const is safe here
+		free ((void*)mesh->points);
+		free ((void*)mesh->tex_coords);
+		free ((void*)mesh->normals);
+		free ((void*)mesh->indices);
+	}
+	memset (mesh, 0, sizeof (Obj_Indexed_Mesh));
+}
+
+bool make_obj_indexed_mesh_writable (Obj_Indexed_Mesh* mesh) {
+	if (!mesh->mapped_data) {
+		return true;
+	}
+	size_t vc = (size_t)mesh->vertex_count;
+	size_t isz = (size_t)mesh->index_count * mesh->index_size;
+	float* points = (float*)malloc (vc * 3 * sizeof (float) + 1);
+	float* tex_coords = (float*)malloc (vc * 2 * sizeof (float) + 1);
+	float* normals = (float*)malloc (vc * 3 * sizeof (float) + 1);
+	void* indices = malloc (isz + 1);
+	if (!points || !tex_coords || !normals || !indices) {
+		fprintf (stderr, "ERROR: out of memory copying mapped mesh\n");
+		free (points);
+		free (tex_coords);
+		free (normals);
+		free (indices);
+		return false;
+	}
+	memcpy (points, mesh->points, vc * 3 * sizeof (float));
+	memcpy (tex_coords, mesh->tex_coords, vc * 2 * sizeof (float));
+	memcpy (normals, mesh->normals, vc * 3 * sizeof (float));
+	memcpy (indices, mesh->indices, isz);
+	unmap_file ((const char*)mesh->mapped_data, mesh->mapped_size);
+	mesh->mapped_data = NULL;
+	mesh->mapped_size = 0;
+	mesh->points = points;
+	mesh->tex_coords = tex_coords;
+	mesh->normals = normals;
+	mesh->indices = indices;
+	return true;
+}
+
+uint16_t obj_float_to_half (float f) {
+	uint32_t x;
+	memcpy (&x, &f, sizeof (x));
+	uint16_t sign = (uint16_t)((x >> 16) & 0x8000);
+	uint32_t abs_x = x & 0x7FFFFFFF;
+	if (abs_x >= 0x7F800000) { // inf or nan
+		return sign | 0x7C00 | (abs_x > 0x7F800000 ? 0x200 : 0);
+	}
+	if (abs_x >= 0x477FF000) { // rounds above the largest half, 65504
+		return sign | 0x7C00;
+	}
+	if (abs_x < 0x38800000) { // half denormal or zero
+		if (abs_x < 0x33000000) {
+			return sign;
+		}
+		uint32_t mant = (abs_x & 0x007FFFFF) | 0x00800000;
+		int shift = 126 - (int)(abs_x >> 23);
+		uint32_t half = mant >> shift;
+		uint32_t rem = mant & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if (rem > halfway || (rem == halfway && (half & 1))) {
+			half++;
+		}
+		return sign | (uint16_t)half;
+	}
+	// re-bias exponent from 127 to 15 then round off 13 mantissa bits
+	uint32_t half = (abs_x - 0x38000000) >> 13;
+	uint32_t rem = abs_x & 0x1FFF;
+	if (rem > 0x1000 || (rem == 0x1000 && (half & 1))) {
+		half++;
+	}
+	return sign | (uint16_t)half;
+}
+
+static int16_t snorm16 (float v) {
+	v = v < -1.0f ? -1.0f : (v > 1.0f ? 1.0f : v);
+	return (int16_t)lrintf (v * 32767.0f);
+}
+
+static uint16_t unorm16 (float v) {
+	v = v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+	return (uint16_t)lrintf (v * 65535.0f);
+}
+
+/* octahedral normal encoding - project onto the |x|+|y|+|z|=1 octahedron and
+   fold the lower half over the upper. decode in GLSL with:
+   vec3 n = vec3 (e, 1.0 - abs (e.x) - abs (e.y));
+   float t = max (-n.z, 0.0);
+   n.xy += vec2 (n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+   n = normalize (n); */
+static void oct_encode (const float* n, int16_t* out) {
+	float l1 = fabsf (n[0]) + fabsf (n[1]) + fabsf (n[2]);
+	float x = 0.0f, y = 0.0f;
+	if (l1 > 0.0f) {
+		x = n[0] / l1;
+		y = n[1] / l1;
+		if (n[2] < 0.0f) {
+			float fx = (1.0f - fabsf (y)) * (x >= 0.0f ? 1.0f : -1.0f);
+			float fy = (1.0f - fabsf (x)) * (y >= 0.0f ? 1.0f : -1.0f);
+			x = fx;
+			y = fy;
+		}
+	}
+	out[0] = snorm16 (x);
+	out[1] = snorm16 (y);
+}
+
+bool pack_obj_vertices (const float* points, const float* tex_coords,
+	const float* normals, int vertex_count, Obj_Position_Format format,
+	void** vertices, Obj_Vertex_Layout* layout) {
+	int i;
+	memset (layout, 0, sizeof (Obj_Vertex_Layout));
+	layout->position_format = format;
+	layout->position_offset = 0;
+	// half positions get a pad element so every attribute stays 4-byte aligned
+	layout->tex_coord_offset = OBJ_POSITION_HALF == format ? 8 : 12;
+	layout->normal_offset = layout->tex_coord_offset + 4;
+	layout->stride = layout->normal_offset + 4;
+	*vertices = malloc ((size_t)(vertex_count > 0 ? vertex_count : 1) *
+		layout->stride);
+	if (!*vertices) {
+		fprintf (stderr, "ERROR: out of memory packing vertices\n");
+		return false;
+	}
+	for (i = 0; i < vertex_count; i++) {
+		unsigned char* v = (unsigned char*)*vertices + (size_t)i * layout->stride;
+		if (OBJ_POSITION_HALF == format) {
+			uint16_t h[4] = { obj_float_to_half (points[i * 3]),
+				obj_float_to_half (points[i * 3 + 1]),
+				obj_float_to_half (points[i * 3 + 2]), 0 };
+			memcpy (v, h, sizeof (h));
+		} else {
+			memcpy (v, &points[i * 3], 3 * sizeof (float));
+		}
+		uint16_t st[2] = { unorm16 (tex_coords[i * 2]),
+			unorm16 (tex_coords[i * 2 + 1]) };
+		memcpy (v + layout->tex_coord_offset, st, sizeof (st));
+		int16_t oct[2];
+		oct_encode (&normals[i * 3], oct);
+		memcpy (v + layout->normal_offset, oct, sizeof (oct));
+	}
+	printf ("packed %i vertices at %i bytes each (was %i)\n", vertex_count,
+		layout->stride, (int)(8 * sizeof (float)));
 	return true;
 }
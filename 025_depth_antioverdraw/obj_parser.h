@@ -5,7 +5,69 @@
 //
 #pragma once
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
+/* mesh with each unique vp/vt/vn combination stored once, for glDrawElements.
+   the arrays are const because they may point into a read-only mapping of
+   the .bin cache - call make_obj_indexed_mesh_writable() before changing them */
+struct Obj_Indexed_Mesh {
+	const float* points; // 3 floats per vertex
+	const float* tex_coords; // 2 floats per vertex
+	const float* normals; // 3 floats per vertex
+	const void* indices; // uint16_t if index_size is 2, uint32_t if 4
+	int vertex_count, index_count, index_size;
+	// if loaded from a .bin cache the arrays point into this mapping
+	const void* mapped_data;
+	size_t mapped_size;
+};
+typedef struct Obj_Indexed_Mesh Obj_Indexed_Mesh;
+
+// unrolled triangles - one vertex per face corner, for glDrawArrays
 bool load_obj_file (const char* file_name, float** points, float** tex_coords,
 	float** normals, int* point_count);
 
+/* de-duplicates face corners with identical vp/vt/vn indices and builds an
+   index buffer. indices are 16-bit whenever vertex_count <= 65536 */
+bool load_obj_file_indexed (const char* file_name, Obj_Indexed_Mesh* mesh);
+
+void free_obj_indexed_mesh (Obj_Indexed_Mesh* mesh);
+
+/* copies a mesh that was mapped from the .bin cache into heap arrays, which
+   the caller may then cast away const on and modify in-place. does nothing to
+   a mesh that already owns its arrays */
+bool make_obj_indexed_mesh_writable (Obj_Indexed_Mesh* mesh);
+
+/* number of threads the loaders split big files across. 1 (the default)
+   parses on the calling thread, 0 uses one thread per core. output is
+   identical either way */
+void set_obj_parser_threads (int n_threads);
+
+/* when enabled, both loaders keep a binary copy of the indexed mesh next to
+   the .obj (e.g. suzanne.obj.bin) and load that instead while its recorded
+   .obj size and modification time still match. this writes into the asset's
+   directory, so it is off by default */
+void set_obj_parser_cache (bool enabled);
+
+// interleaved vertex output. see pack_obj_vertices()
+enum Obj_Position_Format { OBJ_POSITION_FLOAT, OBJ_POSITION_HALF };
+typedef enum Obj_Position_Format Obj_Position_Format;
+
+// byte offsets of each attribute inside one interleaved vertex
+struct Obj_Vertex_Layout {
+	Obj_Position_Format position_format;
+	int stride, position_offset, tex_coord_offset, normal_offset;
+};
+typedef struct Obj_Vertex_Layout Obj_Vertex_Layout;
+
+/* packs separate point/tex_coord/normal arrays into one interleaved buffer:
+   position - 3 floats (20 byte vertex) or 3 halfs + pad (16 byte vertex)
+   tex_coord - 2 unorm16. values outside 0-1 are clamped, so no tiled UVs
+   normal - octahedral-encoded as 2 snorm16. decode in the vertex shader
+   works on indexed or unrolled arrays. free the result with free() */
+bool pack_obj_vertices (const float* points, const float* tex_coords,
+	const float* normals, int vertex_count, Obj_Position_Format format,
+	void** vertices, Obj_Vertex_Layout* layout);
+
+// float to IEEE half, round-to-nearest-even. used by pack_obj_vertices()
+uint16_t obj_float_to_half (float f);
@@ -1,4 +1,4 @@
-// gcc -o test main.c -std=c99 -lX11 -lm
+// make -f Makefile.linux64
 
 // problems:
 // * load system fonts?
@@ -7,15 +7,31 @@
 
 // notes:
 // * fixed font char width 6px height 9px
+// * everything is drawn into our own framebuffer then sent to the window in
+//   one XShmPutImage (or XPutImage) per frame - see x11_fb.h. -noshm on the
+//   command line forces the XPutImage path to compare
+// * triangles are clipped, back faces culled, and filled with depth testing
+//   by raster.h, on one thread per core (-threads N to change). any other
+//   argument is an .obj to draw next to the cube (default is 028's suzanne)
+// * meshes go through the vertex stage in raster_vertex.h as indexed
+//   triangles. suzanne needs ~0.7 vertex transforms per triangle that way
+// * -bench renders a grid of the .obj at 1080p on 1-32 threads and prints the
+//   frame times, without opening a window. the threaded binning and
+//   rasterising has only been timed on a 1-core machine, where more threads
+//   can only add overhead, so how well it scales with cores is unverified
 
 #include "apg_maths.h"
+#include "obj_parser.h"
+#include "mesh_opt.h"
+#include "raster.h"
+#include "raster_vertex.h"
+#include "x11_fb.h"
 #include <X11/Xlib.h>
 #include <stdio.h>
-#define __USE_XOPEN_EXTENDED // what the heck
+#include <stdlib.h>
 #include <unistd.h> // sleep
 #include <stdbool.h>
 #include <string.h>
-#define __USE_POSIX199309 // sigh
 #include <time.h>
 #include <assert.h>
 
@@ -69,6 +85,8 @@ float geom[] = {
 Display* display;
 GC graphics_context;
 Window window;
+X11_Framebuffer fb;
+Raster_Target raster_target; // draws into fb's pixels
 XColor green_col, text_col, ruler_col, charcoal_col, lcharcoal_col, lineno_col;
 
 typedef struct timespec timespec;
@@ -78,103 +96,174 @@ double frame_accum;
 long frame_count;
 char fps_txt[32];
 
-vec4 persp_div (vec4 v) {
-	vec4 r;
-	r.v[0] = v.v[0] / v.v[3]; // TODO WHYYYYY did i need 1.0 - ?
-	r.v[1] = v.v[1] / v.v[3];
-	r.v[2] = v.v[2] / v.v[3];
-	r.v[3] = v.v[3];
-	return r;
+// geom as indexed vertices, each a corner with its face's colour
+#define CUBE_POINTS 36
+float cube_positions[CUBE_POINTS * 3], cube_colours[CUBE_POINTS * 3];
+uint16_t cube_indices[CUBE_POINTS];
+int cube_vertex_count;
+
+// the obj mesh, reordered for the vertex stage's cache. colours are lit per
+// vertex each draw
+Obj_Indexed_Mesh mesh;
+float* mesh_colours;
+Raster_Draw_Stats draw_stats;
+
+// merges corners that share a position and colour. one colour per triangle:
+// 2 red, 2 green, 2 blue, then magenta
+void index_geom () {
+	static const float colours[12 * 3] = {
+		1, 0, 0, 1, 0, 0, 0, 1, 0, 0, 1, 0, 0, 0, 1, 0, 0, 1,
+		1, 0, 1, 1, 0, 1, 1, 0, 1, 1, 0, 1, 1, 0, 1, 1, 0, 1
+	};
+	cube_vertex_count = 0;
+	for (int i = 0; i < CUBE_POINTS; i++) {
+		const float* p = &geom[i * 3];
+		const float* c = &colours[(i / 3) * 3];
+		int v = 0;
+		while (v < cube_vertex_count &&
+			(0 != memcmp (&cube_positions[v * 3], p, 3 * sizeof (float)) ||
+			0 != memcmp (&cube_colours[v * 3], c, 3 * sizeof (float)))) {
+			v++;
+		}
+		if (v == cube_vertex_count) {
+			memcpy (&cube_positions[v * 3], p, 3 * sizeof (float));
+			memcpy (&cube_colours[v * 3], c, 3 * sizeof (float));
+			cube_vertex_count++;
+		}
+		cube_indices[i] = (uint16_t)v;
+	}
+}
+
+mat4 view_proj () {
+	mat4 V = look_at (vec3_from_3f (0.0f, 0.0f, 10.0f),
+		vec3_from_3f (0.0f, 0.0f, 0.0f), vec3_from_3f (0.0f, 1.0f, 0.0f));
+	float aspect = (float)raster_target.width / (float)raster_target.height;
+	mat4 P = perspective (45.0f, aspect, 0.01f, 100.0f);
+	return mult_mat4_mat4 (P, V);
 }
 
 void draw_cube () {
 	// HACK fake timer
-	// draw triangle geom
-	for (int i = 0; i < 12; i++) {
-		float ax = geom[i * 9];
-		float ay = geom[i * 9 + 1];
-		float az = geom[i * 9 + 2];
-		float bx = geom[i * 9 + 3];
-		float by = geom[i * 9 + 4];
-		float bz = geom[i * 9 + 5];
-		float cx = geom[i * 9 + 6];
-		float cy = geom[i * 9 + 7];
-		float cz = geom[i * 9 + 8];
-		
-		vec4 va = vec4_from_4f (ax, ay, az, 1.0);
-		vec4 vb = vec4_from_4f (bx, by, bz, 1.0);
-		vec4 vc = vec4_from_4f (cx, cy, cz, 1.0);
-		//mat4 S = scale_mat4 (vec3_from_3f (0.5, 0.5, 0.5));
-		mat4 Rx = rot_x_deg_mat4 (45.0);
-		static double ra = 45.0;
-		ra += delta_s * 10.0;
-		mat4 Ry = rot_y_deg_mat4 (ra);
-		// TODO - think my maths lib has args backwards
-		// correction: nope, seems right
-		mat4 R = mult_mat4_mat4 (Ry, Rx);
-		mat4 T = translate_mat4 (vec3_from_3f (-4,2,-1));
-		//mat4 M = mult_mat4_mat4 (R, S);
-		mat4 M = mult_mat4_mat4 (T, R);
-		
-		mat4 V = look_at (vec3_from_3f (0.0f, 0.0f, 10.0f),
-			vec3_from_3f (0.0f, 0.0f, 0.0f), vec3_from_3f (0.0f, 1.0f, 0.0f));
-		mat4 P = perspective (45.0f, (float)WIDTH / (float)HEIGHT, 0.01f, 100.0f);
-		mat4 PV = mult_mat4_mat4 (P, V);
-		mat4 PVM = mult_mat4_mat4 (PV, M);
-		
-		va = mult_mat4_vec4 (PVM, va);
-		vb = mult_mat4_vec4 (PVM, vb);
-		vc = mult_mat4_vec4 (PVM, vc);
-		va = persp_div (va);
-		vb = persp_div (vb);
-		vc = persp_div (vc);
-		
-		// 0 to RES
-		// TODO vectors/mats should just be float arrays
-		va.v[0] = (va.v[0] + 1.0) * 0.5 * WIDTH;
-		va.v[1] = HEIGHT - (va.v[1] + 1.0) * 0.5 * HEIGHT;
-		vb.v[0] = (vb.v[0] + 1.0) * 0.5 * WIDTH;
-		vb.v[1] = HEIGHT - (vb.v[1] + 1.0) * 0.5 * HEIGHT;
-		vc.v[0] = (vc.v[0] + 1.0) * 0.5 * WIDTH;
-		vc.v[1] = HEIGHT - (vc.v[1] + 1.0) * 0.5 * HEIGHT;
-		
-		int r = 0;
-		int g = 0;
-		int b = 0;
-		if (i >= 6) {
-			r = 255;
-			b = 255;
-		} else if (i >= 4) {
-			b = 255;
-		} else if (i >= 2) {
-			g = 255;
-		} else {
-			r = 255;
+	//mat4 S = scale_mat4 (vec3_from_3f (0.5, 0.5, 0.5));
+	mat4 Rx = rot_x_deg_mat4 (45.0);
+	static double ra = 45.0;
+	ra += delta_s * 120.0; // same speed as when this went up once per triangle
+	mat4 Ry = rot_y_deg_mat4 (ra);
+	// TODO - think my maths lib has args backwards
+	// correction: nope, seems right
+	mat4 R = mult_mat4_mat4 (Ry, Rx);
+	mat4 T = translate_mat4 (vec3_from_3f (-4,2,-1));
+	//mat4 M = mult_mat4_mat4 (R, S);
+	mat4 M = mult_mat4_mat4 (T, R);
+	mat4 PVM = mult_mat4_mat4 (view_proj (), M);
+	raster_draw_indexed (&raster_target, PVM.m, cube_positions, cube_colours,
+		cube_indices, 2, CUBE_POINTS, &draw_stats);
+}
+
+// lit on the cpu each frame - a directional light from the upper right
+void draw_mesh_instance (mat4 PV, vec3 pos, float scale, float y_deg) {
+	mat4 R = rot_y_deg_mat4 (y_deg);
+	mat4 M = mult_mat4_mat4 (translate_mat4 (pos),
+		mult_mat4_mat4 (R, scale_mat4 (vec3_from_3f (scale, scale, scale))));
+	mat4 PVM = mult_mat4_mat4 (PV, M);
+	
+	vec3 light = normalise_vec3 (vec3_from_3f (1.0f, 1.0f, 1.0f));
+	for (int i = 0; i < mesh.vertex_count; i++) {
+		vec4 n = mult_mat4_vec4 (R, vec4_from_4f (mesh.normals[i * 3],
+			mesh.normals[i * 3 + 1], mesh.normals[i * 3 + 2], 0.0f));
+		float d = dot_vec3 (vec3_from_vec4 (n), light);
+		float lit = 0.15f + 0.85f * (d > 0.0f ? d : 0.0f);
+		mesh_colours[i * 3] = 0.9f * lit;
+		mesh_colours[i * 3 + 1] = 0.7f * lit;
+		mesh_colours[i * 3 + 2] = 0.3f * lit;
+	}
+	raster_draw_indexed (&raster_target, PVM.m, mesh.points, mesh_colours,
+		mesh.indices, mesh.index_size, mesh.index_count, &draw_stats);
+}
+
+void draw_mesh () {
+	if (!mesh_colours) {
+		return;
+	}
+	static double ma = 0.0;
+	ma += delta_s * 30.0;
+	draw_mesh_instance (view_proj (), vec3_from_3f (1.5f, -1.0f, 0.0f), 1.5f,
+		(float)ma);
+}
+
+// renders a grid of the mesh off-screen at 1080p with 1 to 32 threads and
+// prints the frame times. doesn't need an X server
+void bench (int grid) {
+	if (!mesh_colours) {
+		return;
+	}
+	uint32_t* pixels = (uint32_t*)malloc (1920 * 1080 * sizeof (uint32_t));
+	if (!pixels || !create_raster_target (&raster_target, pixels, 1920, 1920,
+		1080)) {
+		fprintf (stderr, "ERROR: out of memory for bench\n");
+		return;
+	}
+	printf ("bench: %i triangles at 1920x1080, %s\n",
+		grid * grid * mesh.index_count / 3, raster_simd_name ());
+	mat4 PV = view_proj ();
+	int frames = 20;
+	double first_ms = 0.0;
+	for (int n_threads = 1; n_threads <= 32; n_threads *= 2) {
+		set_raster_threads (n_threads);
+		double frame_ms[2] = { 0.0, 0.0 }; // everything, then just the flush
+		for (int f = 0; f < frames; f++) {
+			timespec t0, t1, t2;
+			clock_gettime (CLOCK_MONOTONIC, &t0);
+			clear_raster_target (&raster_target, 0);
+			memset (&draw_stats, 0, sizeof (draw_stats));
+			for (int y = 0; y < grid; y++) {
+				for (int x = 0; x < grid; x++) {
+					vec3 pos = vec3_from_3f (-6.5f + 13.0f * x / (grid - 1 + 1e-6f),
+						-3.6f + 7.2f * y / (grid - 1 + 1e-6f), 0.0f);
+					draw_mesh_instance (PV, pos, 5.0f / grid, (float)(f * 10 + x * 7));
+				}
+			}
+			clock_gettime (CLOCK_MONOTONIC, &t1);
+			flush_raster_target (&raster_target);
+			clock_gettime (CLOCK_MONOTONIC, &t2);
+			frame_ms[0] += (t2.tv_sec - t0.tv_sec) * 1e3 +
+				(t2.tv_nsec - t0.tv_nsec) / 1e6;
+			frame_ms[1] += (t2.tv_sec - t1.tv_sec) * 1e3 +
+				(t2.tv_nsec - t1.tv_nsec) / 1e6;
 		}
-		
-		// TODO triangle filling algorithm
-		/*tri (Number ((va[0]).toFixed (0)), Number ((va[1]).toFixed (0)),
-			Number ((vb[0]).toFixed (0)), Number ((vb[1]).toFixed (0)),
-			Number ((vc[0]).toFixed (0)), Number ((vc[1]).toFixed (0)),
-			r, g, b);*/
-			
-		/*XDrawLine (display, window, graphics_context, va.v[0], va.v[1],
-			vb.v[0], vb.v[1]);
-		XDrawLine (display, window, graphics_context, vb.v[0], vb.v[1],
-			vc.v[0], vc.v[1]);
-		XDrawLine (display, window, graphics_context, vc.v[0], vc.v[1],
-			va.v[0], va.v[1]);*/
-			
-		XPoint pts[3];
-		pts[0].x = va.v[0];
-		pts[0].y = va.v[1];
-		pts[1].x = vb.v[0];
-		pts[1].y = vb.v[1];
-		pts[2].x = vc.v[0];
-		pts[2].y = vc.v[1];
-			
-		XFillPolygon (display, window, graphics_context,pts, 3,  Convex, CoordModeOrigin); 
+		frame_ms[0] /= frames;
+		frame_ms[1] /= frames;
+		first_ms = 1 == n_threads ? frame_ms[1] : first_ms;
+		printf ("%2i threads: %7.2f ms/frame (%7.2f ms flush, %.2fx)\n",
+			raster_threads (), frame_ms[0], frame_ms[1], first_ms / frame_ms[1]);
 	}
+	printf ("vertex stage: %i vertices transformed per frame, %.2f per "
+		"triangle. %i triangles rejected\n", draw_stats.vertices_transformed,
+		(float)draw_stats.vertices_transformed / (float)draw_stats.triangles,
+		draw_stats.triangles_rejected);
+	destroy_raster_target (&raster_target);
+	free (pixels);
+}
+
+// indexed, then reordered so neighbouring triangles share transformed
+// vertices in the vertex stage's cache
+bool load_mesh (const char* file_name) {
+	if (!load_obj_file_indexed (file_name, &mesh)) {
+		fprintf (stderr, "ERROR: could not load mesh %s\n", file_name);
+		return false;
+	}
+	if (!optimise_obj_mesh (&mesh, RASTER_VERTEX_CACHE_SIZE)) {
+		fprintf (stderr, "ERROR: could not reorder mesh %s\n", file_name);
+	}
+	mesh_colours = (float*)malloc (mesh.vertex_count * 3 * sizeof (float));
+	if (!mesh_colours) {
+		fprintf (stderr, "ERROR: out of memory for mesh %s\n", file_name);
+		free_obj_indexed_mesh (&mesh);
+		return false;
+	}
+	printf ("loaded %s: %i triangles, %i vertices\n", file_name,
+		mesh.index_count / 3, mesh.vertex_count);
+	return true;
 }
 
 void draw_frame (Display* display, Window window, GC graphics_context) {
@@ -182,17 +271,16 @@ void draw_frame (Display* display, Window window, GC graphics_context) {
 		fprintf (stderr, "ERROR: lost display\n");
 		return;
 	}
-	int black_colour = BlackPixel (display, DefaultScreen (display));
-	int white_colour = WhitePixel (display, DefaultScreen (display));
-	
-	XClearWindow (display, window);
+	clear_raster_target (&raster_target, (uint32_t)lcharcoal_col.pixel);
+	draw_cube ();
+	draw_mesh ();
+	flush_raster_target (&raster_target);
+	// the text goes in between the copy and the sync, so each frame reaches
+	// the window with its FPS already on it
+	put_x11_fb (&fb);
 	
-	XSetForeground (display, graphics_context, lcharcoal_col.pixel);
 	int x = 0, y = 0;
-	int width = WIDTH;
-	int height = HEIGHT;
-	XFillRectangle (display, window, graphics_context, x, y, width, height);
-	width = 36, height = HEIGHT;
+	int width = 36;
 	
 	/*XSetForeground (display, graphics_context, lineno_col.pixel);
 	x = 3, y = 12;
@@ -220,12 +308,11 @@ void draw_frame (Display* display, Window window, GC graphics_context) {
 	}
 	int len = strlen (fps_txt);
 	XDrawString (display, window, graphics_context, x, y, fps_txt, len);
+	sync_x11_fb (&fb);
 	//y += 12;
 	//char txtb[] = "Here is a lengthy treatise on fonts.";
 	//len = strlen (txtb);
 	//XDrawString (display, window, graphics_context, x, y, txtb, len);
-	
-	draw_cube ();
 }
 
 void event_loop (Display* display, Window window, GC graphics_context) {
@@ -236,7 +323,8 @@ void event_loop (Display* display, Window window, GC graphics_context) {
 		}
 		timespec curr_ts;
 		assert (0 == clock_gettime(CLOCK_REALTIME, &curr_ts));
-		long delta_ns = curr_ts.tv_nsec - prev_ts.tv_nsec;
+		long delta_ns = (curr_ts.tv_sec - prev_ts.tv_sec) * 1000000000L +
+			curr_ts.tv_nsec - prev_ts.tv_nsec;
 		//printf ("delta ns = %ld\n", delta_ns);
 		double delta_ms = (double)delta_ns / 1000000.0;
 		if (delta_ms < 0.0) {
@@ -250,17 +338,39 @@ void event_loop (Display* display, Window window, GC graphics_context) {
 		//	;
 		//}
 		draw_frame (display, window, graphics_context);
-		//XFlush (display); // dispatches the command queue
-		XSync (display, true); // dispatches and waits
+		// the frame went out in sync_x11_fb(). nothing uses events yet
+		while (XPending (display)) {
+			XEvent event;
+			XNextEvent (display, &event);
+		}
 		frame_count++;
 		usleep (100);
 	}
 }
 
-int main () {
+int main (int argc, char** argv) {
 	printf ("X11 demo\n");
-
-	int black_colour, white_colour;
+	bool use_shm = true, run_bench = false;
+	int n_threads = 0;
+	const char* mesh_file = "../028_more_cube/suzanne.obj";
+	for (int i = 1; i < argc; i++) {
+		if (0 == strcmp (argv[i], "-noshm")) {
+			use_shm = false;
+		} else if (0 == strcmp (argv[i], "-bench")) {
+			run_bench = true;
+		} else if (0 == strcmp (argv[i], "-threads") && i + 1 < argc) {
+			n_threads = atoi (argv[++i]);
+		} else {
+			mesh_file = argv[i];
+		}
+	}
+	set_raster_cull_back (true);
+	if (run_bench) {
+		load_mesh (mesh_file);
+		bench (11);
+		return 0;
+	}
+	set_raster_threads (n_threads);
 
 	{ // create window and display combo
 		printf ("init window...\n");
@@ -269,8 +379,6 @@ int main () {
 			fprintf (stderr, "ERROR: opening display\n");
 			return 1;
 		}
-		black_colour = BlackPixel (display, DefaultScreen (display));
-		white_colour = WhitePixel (display, DefaultScreen (display));
 		// colour map
 		Colormap colour_map;
 		char green[] = "#00FF00";
@@ -306,6 +414,16 @@ int main () {
 		XMapWindow (display, window);
 		// create graphics context
 		graphics_context = XCreateGC (display, window, 0, 0);
+		if (!create_x11_fb (&fb, display, window, graphics_context, WIDTH, HEIGHT,
+			use_shm)) {
+			return 1;
+		}
+		if (!create_raster_target (&raster_target, fb.pixels, fb.stride, fb.width,
+			fb.height)) {
+			return 1;
+		}
+		printf ("rasteriser: %s, %i threads\n", raster_simd_name (),
+			raster_threads ());
 	} // endinitwindow
 
 	{ // draw
@@ -322,6 +440,8 @@ int main () {
 		}
 		XSetFont (display, graphics_context, font->fid);
 		sprintf (fps_txt, "FPS:");
+		index_geom ();
+		load_mesh (mesh_file);
 		assert (0 == clock_gettime(CLOCK_REALTIME, &prev_ts));
 //		printf ("start time is %llds and %ldns\n", (long long)prev_ts.tv_sec, (long)prev_ts.tv_nsec);
 		event_loop (display, window, graphics_context);
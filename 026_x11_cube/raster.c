@@ -0,0 +1,632 @@
+//
+// half-space triangle rasteriser with a depth buffer, C99
+// anton gerdelan <gerdela@scss.tcd.ie>
+// trinity college dublin
+//
+#include "raster.h"
+#include "raster_blocks.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define RASTER_MAX_THREADS 64
+
+// triangles touching one tile, as indices into the target's setups, in the
+// order they were submitted
+struct Raster_Bin {
+	uint32_t* tris;
+	int count, capacity;
+};
+typedef struct Raster_Bin Raster_Bin;
+
+// the tiles a thread has left are [head, tail), packed into one 64-bit word
+// so that the owner taking one off the front, or a thief taking one off the
+// back, is a single compare-and-swap
+struct Raster_Worker {
+	Raster_Tile tile;
+	uint64_t queue __attribute__ ((aligned (64)));
+	pthread_t thread;
+	int index, generation;
+};
+typedef struct Raster_Worker Raster_Worker;
+
+// worker 0 is the thread calling flush_raster_target(). the others wait for
+// the generation to go up, then all take tiles until none are left anywhere
+struct Raster_Pool {
+	pthread_mutex_t mutex;
+	pthread_cond_t start_cond, done_cond;
+	Raster_Worker* workers;
+	int n_threads;
+	int generation, n_done;
+	bool quit;
+	Raster_Target* target;
+};
+typedef struct Raster_Pool Raster_Pool;
+
+static raster_blocks_func g_blocks_func;
+static const char* g_simd_name;
+static Raster_Pool g_pool = { PTHREAD_MUTEX_INITIALIZER,
+	PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER };
+
+void set_raster_avx2 (bool enabled) {
+	g_blocks_func = raster_blocks_sse2;
+	g_simd_name = "sse2";
+	if (enabled && __builtin_cpu_supports ("avx2")) {
+		g_blocks_func = raster_blocks_avx2;
+		g_simd_name = "avx2";
+	}
+}
+
+const char* raster_simd_name () {
+	if (!g_blocks_func) {
+		set_raster_avx2 (true);
+	}
+	return g_simd_name;
+}
+
+bool create_raster_target (Raster_Target* target, uint32_t* colour,
+	int colour_stride, int width, int height) {
+	memset (target, 0, sizeof (Raster_Target));
+	target->colour = colour;
+	target->colour_stride = colour_stride;
+	target->width = width;
+	target->height = height;
+	target->tiles_x = (width + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+	target->tiles_y = (height + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+	size_t tile_pixels = RASTER_TILE_SIZE * RASTER_TILE_SIZE;
+	target->depth = (float*)malloc (target->tiles_x * target->tiles_y *
+		tile_pixels * sizeof (float));
+	target->bins = (Raster_Bin*)calloc (target->tiles_x * target->tiles_y,
+		sizeof (Raster_Bin));
+	if (!target->depth || !target->bins) {
+		fprintf (stderr, "ERROR: out of memory for %ix%i raster target\n", width,
+			height);
+		destroy_raster_target (target);
+		return false;
+	}
+	for (size_t i = 0; i < target->tiles_x * target->tiles_y * tile_pixels;
+		i++) {
+		target->depth[i] = 1.0f;
+	}
+	return true;
+}
+
+void destroy_raster_target (Raster_Target* target) {
+	if (target->bins) {
+		for (int i = 0; i < target->tiles_x * target->tiles_y; i++) {
+			free (target->bins[i].tris);
+		}
+	}
+	free (target->bins);
+	free (target->setups);
+	free (target->depth);
+	memset (target, 0, sizeof (Raster_Target));
+}
+
+void clear_raster_target (Raster_Target* target, uint32_t colour) {
+	target->clear_pending = true;
+	target->clear_colour = colour;
+	target->setup_count = 0;
+	for (int i = 0; i < target->tiles_x * target->tiles_y; i++) {
+		target->bins[i].count = 0;
+	}
+}
+
+// snaps to fixed point and works out edge functions, bounding box and
+// attribute gradients. returns false if there is nothing to draw
+static bool setup_triangle (const Raster_Vertex* v[3], int width,
+	int height, Raster_Setup* s) {
+	int32_t x[3], y[3];
+	for (int i = 0; i < 3; i++) {
+		// also false for NaNs, e.g. from a vertex at w = 0
+		if (!(fabsf (v[i]->x) <= RASTER_MAX_COORD &&
+			fabsf (v[i]->y) <= RASTER_MAX_COORD)) {
+			return false;
+		}
+		x[i] = (int32_t)lrintf (v[i]->x * RASTER_SUBPIXELS);
+		y[i] = (int32_t)lrintf (v[i]->y * RASTER_SUBPIXELS);
+	}
+	// twice the area, in subpixels squared. > 0 for the winding the edge
+	// functions below expect (clockwise on screen, with y down)
+	int64_t area = (int64_t)(x[1] - x[0]) * (y[2] - y[0]) -
+		(int64_t)(y[1] - y[0]) * (x[2] - x[0]);
+	if (0 == area) {
+		return false;
+	}
+	if (area < 0) {
+		const Raster_Vertex* tv = v[1];
+		v[1] = v[2];
+		v[2] = tv;
+		int32_t t = x[1];
+		x[1] = x[2];
+		x[2] = t;
+		t = y[1];
+		y[1] = y[2];
+		y[2] = t;
+		area = -area;
+	}
+
+	// pixels whose centres (x * 16 + 8) are inside the box
+	int32_t min_x = x[0], max_x = x[0], min_y = y[0], max_y = y[0];
+	for (int i = 1; i < 3; i++) {
+		min_x = x[i] < min_x ? x[i] : min_x;
+		max_x = x[i] > max_x ? x[i] : max_x;
+		min_y = y[i] < min_y ? y[i] : min_y;
+		max_y = y[i] > max_y ? y[i] : max_y;
+	}
+	int half = RASTER_SUBPIXELS / 2;
+	s->min_x = (min_x - half + RASTER_SUBPIXELS - 1) >> RASTER_SUBPIXEL_BITS;
+	s->min_y = (min_y - half + RASTER_SUBPIXELS - 1) >> RASTER_SUBPIXEL_BITS;
+	s->max_x = (max_x - half) >> RASTER_SUBPIXEL_BITS;
+	s->max_y = (max_y - half) >> RASTER_SUBPIXEL_BITS;
+	s->min_x = s->min_x < 0 ? 0 : s->min_x;
+	s->min_y = s->min_y < 0 ? 0 : s->min_y;
+	s->max_x = s->max_x > width - 1 ? width - 1 : s->max_x;
+	s->max_y = s->max_y > height - 1 ? height - 1 : s->max_y;
+	if (s->min_x > s->max_x || s->min_y > s->max_y) {
+		return false;
+	}
+
+	// edge from vertex i to j. a pixel centre exactly on it is only in if the
+	// edge is a top edge (horizontal, going right) or a left edge (going up),
+	// so the -1 turns >= 0 into > 0 for the others
+	for (int i = 0; i < 3; i++) {
+		int j = (i + 1) % 3;
+		s->a[i] = y[i] - y[j];
+		s->b[i] = x[j] - x[i];
+		s->c[i] = -((int64_t)s->a[i] * x[i] + (int64_t)s->b[i] * y[i]);
+		bool top_left = s->a[i] > 0 || (0 == s->a[i] && s->b[i] > 0);
+		if (!top_left) {
+			s->c[i] -= 1;
+		}
+	}
+
+	// attribute planes through the snapped positions. in double as the area
+	// can be tiny
+	double fx[3], fy[3];
+	for (int i = 0; i < 3; i++) {
+		fx[i] = (double)x[i] / RASTER_SUBPIXELS;
+		fy[i] = (double)y[i] / RASTER_SUBPIXELS;
+	}
+	double inv_area = (double)(RASTER_SUBPIXELS * RASTER_SUBPIXELS) /
+		(double)area;
+	s->x0 = (float)fx[0];
+	s->y0 = (float)fy[0];
+	for (int k = 0; k < RASTER_ATTRIBS; k++) {
+		double val[3];
+		for (int i = 0; i < 3; i++) {
+			switch (k) {
+				case RASTER_Z: val[i] = v[i]->z; break;
+				case RASTER_INV_W: val[i] = v[i]->inv_w; break;
+				case RASTER_R_W: val[i] = v[i]->r * v[i]->inv_w; break;
+				case RASTER_G_W: val[i] = v[i]->g * v[i]->inv_w; break;
+				default: val[i] = v[i]->b * v[i]->inv_w; break;
+			}
+		}
+		double d1 = val[1] - val[0], d2 = val[2] - val[0];
+		s->v0[k] = (float)val[0];
+		s->dx[k] = (float)((d1 * (fy[2] - fy[0]) - d2 * (fy[1] - fy[0])) *
+			inv_area);
+		s->dy[k] = (float)((d2 * (fx[1] - fx[0]) - d1 * (fx[2] - fx[0])) *
+			inv_area);
+	}
+	return true;
+}
+
+// false if an edge has the whole tile outside it, as for 8x8 blocks
+static bool tile_touches (const Raster_Setup* s, int tx, int ty) {
+	int64_t x0 = (int64_t)tx * RASTER_TILE_SIZE * RASTER_SUBPIXELS +
+		RASTER_SUBPIXELS / 2;
+	int64_t y0 = (int64_t)ty * RASTER_TILE_SIZE * RASTER_SUBPIXELS +
+		RASTER_SUBPIXELS / 2;
+	int64_t span = (RASTER_TILE_SIZE - 1) * RASTER_SUBPIXELS;
+	for (int i = 0; i < 3; i++) {
+		int64_t e = s->a[i] * x0 + s->b[i] * y0 + s->c[i];
+		int64_t across = s->a[i] * span, below = s->b[i] * span;
+		if (e + (across > 0 ? across : 0) + (below > 0 ? below : 0) < 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool add_to_bin (Raster_Bin* bin, uint32_t tri) {
+	if (bin->count == bin->capacity) {
+		int capacity = bin->capacity ? bin->capacity * 2 : 64;
+		uint32_t* tris = (uint32_t*)realloc (bin->tris, capacity *
+			sizeof (uint32_t));
+		if (!tris) {
+			return false;
+		}
+		bin->tris = tris;
+		bin->capacity = capacity;
+	}
+	bin->tris[bin->count++] = tri;
+	return true;
+}
+
+void raster_triangle (Raster_Target* target, const Raster_Vertex* a,
+	const Raster_Vertex* b, const Raster_Vertex* c) {
+	const Raster_Vertex* v[3] = { a, b, c };
+	Raster_Setup s;
+	if (!setup_triangle (v, target->width, target->height, &s)) {
+		return;
+	}
+	if (target->setup_count == target->setup_capacity) {
+		int capacity = target->setup_capacity ? target->setup_capacity * 2 : 1024;
+		Raster_Setup* setups = (Raster_Setup*)realloc (target->setups,
+			capacity * sizeof (Raster_Setup));
+		if (!setups) {
+			fprintf (stderr, "ERROR: out of memory binning triangles\n");
+			return;
+		}
+		target->setups = setups;
+		target->setup_capacity = capacity;
+	}
+	uint32_t tri = (uint32_t)target->setup_count++;
+	target->setups[tri] = s;
+	for (int ty = s.min_y / RASTER_TILE_SIZE; ty <= s.max_y / RASTER_TILE_SIZE;
+		ty++) {
+		for (int tx = s.min_x / RASTER_TILE_SIZE;
+			tx <= s.max_x / RASTER_TILE_SIZE; tx++) {
+			if (!tile_touches (&s, tx, ty)) {
+				continue;
+			}
+			if (!add_to_bin (&target->bins[ty * target->tiles_x + tx], tri)) {
+				fprintf (stderr, "ERROR: out of memory binning triangles\n");
+				return;
+			}
+		}
+	}
+}
+
+// the same mapping as project_points_soa() with a viewport of
+// (0, height, width, -height)
+static void clip_to_raster (const Raster_Target* target,
+	const Raster_Clip_Vertex* c, Raster_Vertex* r) {
+	float inv_w = 1.0f / c->w;
+	r->x = (c->x * inv_w + 1.0f) * 0.5f * (float)target->width;
+	r->y = (1.0f - c->y * inv_w) * 0.5f * (float)target->height;
+	r->z = c->z * inv_w * 0.5f + 0.5f;
+	r->inv_w = inv_w;
+	r->r = c->r;
+	r->g = c->g;
+	r->b = c->b;
+}
+
+// outcode bits. the view volume is -w <= x,y,z <= w. the guard band is
+// -g * w <= x,y <= g * w, with g > 1 chosen so it still maps inside
+// RASTER_MAX_COORD
+enum {
+	CLIP_LEFT = 1, CLIP_RIGHT = 2, CLIP_BOTTOM = 4, CLIP_TOP = 8, CLIP_NEAR = 16,
+	CLIP_FAR = 32, CLIP_GUARD_LEFT = 64, CLIP_GUARD_RIGHT = 128,
+	CLIP_GUARD_BOTTOM = 256, CLIP_GUARD_TOP = 512, CLIP_PLANES = 10
+};
+
+// the planes polygons are actually cut against. the view's sides are left to
+// the rasteriser's bounding box
+#define CLIP_CUT_MASK (CLIP_NEAR | CLIP_FAR | CLIP_GUARD_LEFT | \
+	CLIP_GUARD_RIGHT | CLIP_GUARD_BOTTOM | CLIP_GUARD_TOP)
+
+// each plane clipped against can add a vertex
+#define CLIP_MAX_VERTS (3 + 6)
+
+static bool g_cull_back;
+
+void set_raster_cull_back (bool enabled) {
+	g_cull_back = enabled;
+}
+
+// >= 0 on the inside of plane bit
+static float clip_distance (const Raster_Clip_Vertex* v, int bit, float gx,
+	float gy) {
+	switch (bit) {
+		case CLIP_LEFT: return v->x + v->w;
+		case CLIP_RIGHT: return v->w - v->x;
+		case CLIP_BOTTOM: return v->y + v->w;
+		case CLIP_TOP: return v->w - v->y;
+		case CLIP_NEAR: return v->z + v->w;
+		case CLIP_FAR: return v->w - v->z;
+		case CLIP_GUARD_LEFT: return v->x + gx * v->w;
+		case CLIP_GUARD_RIGHT: return gx * v->w - v->x;
+		case CLIP_GUARD_BOTTOM: return v->y + gy * v->w;
+		default: return gy * v->w - v->y;
+	}
+}
+
+// the same tests as clip_distance() < 0, without the switch
+static int outcode (const Raster_Clip_Vertex* v, float gx, float gy) {
+	float gw_x = gx * v->w, gw_y = gy * v->w;
+	return (v->x < -v->w ? CLIP_LEFT : 0) | (v->x > v->w ? CLIP_RIGHT : 0) |
+		(v->y < -v->w ? CLIP_BOTTOM : 0) | (v->y > v->w ? CLIP_TOP : 0) |
+		(v->z < -v->w ? CLIP_NEAR : 0) | (v->z > v->w ? CLIP_FAR : 0) |
+		(v->x < -gw_x ? CLIP_GUARD_LEFT : 0) |
+		(v->x > gw_x ? CLIP_GUARD_RIGHT : 0) |
+		(v->y < -gw_y ? CLIP_GUARD_BOTTOM : 0) |
+		(v->y > gw_y ? CLIP_GUARD_TOP : 0);
+}
+
+static Raster_Clip_Vertex lerp_clip_vertex (const Raster_Clip_Vertex* a,
+	const Raster_Clip_Vertex* b, float t) {
+	Raster_Clip_Vertex r;
+	r.x = a->x + (b->x - a->x) * t;
+	r.y = a->y + (b->y - a->y) * t;
+	r.z = a->z + (b->z - a->z) * t;
+	r.w = a->w + (b->w - a->w) * t;
+	r.r = a->r + (b->r - a->r) * t;
+	r.g = a->g + (b->g - a->g) * t;
+	r.b = a->b + (b->b - a->b) * t;
+	return r;
+}
+
+// sutherland-hodgman: one pass per plane over the polygon's edges, keeping
+// inside vertices and adding one where an edge crosses. returns the new count
+static int clip_polygon (Raster_Clip_Vertex* poly, int n, int bit, float gx,
+	float gy) {
+	Raster_Clip_Vertex out[CLIP_MAX_VERTS];
+	int n_out = 0;
+	for (int i = 0; i < n; i++) {
+		const Raster_Clip_Vertex* a = &poly[i];
+		const Raster_Clip_Vertex* b = &poly[(i + 1) % n];
+		float da = clip_distance (a, bit, gx, gy);
+		float db = clip_distance (b, bit, gx, gy);
+		if (da >= 0.0f) {
+			out[n_out++] = *a;
+		}
+		if ((da >= 0.0f) != (db >= 0.0f)) {
+			out[n_out++] = lerp_clip_vertex (a, b, da / (da - db));
+		}
+	}
+	memcpy (poly, out, n_out * sizeof (Raster_Clip_Vertex));
+	return n_out;
+}
+
+bool raster_clip_triangle (Raster_Target* target, const Raster_Clip_Vertex* a,
+	const Raster_Clip_Vertex* b, const Raster_Clip_Vertex* c) {
+	// pixel x = (x / w + 1) * width / 2, so |x / w| <= g keeps it within half
+	// of RASTER_MAX_COORD, which leaves room for rounding
+	float gx = RASTER_MAX_COORD / (float)target->width - 1.0f;
+	float gy = RASTER_MAX_COORD / (float)target->height - 1.0f;
+	gx = gx < 1.0f ? 1.0f : gx;
+	gy = gy < 1.0f ? 1.0f : gy;
+	int codes[3] = { outcode (a, gx, gy), outcode (b, gx, gy),
+		outcode (c, gx, gy) };
+	// all 3 outside the same side of the view
+	if (codes[0] & codes[1] & codes[2]) {
+		return false;
+	}
+	// the sign of det [x y w] is the triangle's winding as seen from the eye.
+	// unlike the area after the divide it is right even with a corner behind
+	// the camera, so back faces go before any clipping. > 0 is counter-
+	// clockwise on screen, as GL's default front face
+	if (g_cull_back) {
+		float det = a->x * (b->y * c->w - c->y * b->w) -
+			b->x * (a->y * c->w - c->y * a->w) + c->x * (a->y * b->w - b->y * a->w);
+		if (det <= 0.0f) {
+			return false;
+		}
+	}
+
+	Raster_Clip_Vertex poly[CLIP_MAX_VERTS] = { *a, *b, *c };
+	int n = 3;
+	int cut = (codes[0] | codes[1] | codes[2]) & CLIP_CUT_MASK;
+	for (int i = 0; i < CLIP_PLANES && n >= 3; i++) {
+		if (cut & (1 << i)) {
+			n = clip_polygon (poly, n, 1 << i, gx, gy);
+		}
+	}
+	if (n < 3) {
+		return false;
+	}
+	// w > 0 everywhere now, as the near plane is in front of the eye
+	Raster_Vertex verts[CLIP_MAX_VERTS];
+	for (int i = 0; i < n; i++) {
+		clip_to_raster (target, &poly[i], &verts[i]);
+	}
+	for (int i = 1; i + 1 < n; i++) {
+		raster_triangle (target, &verts[0], &verts[i], &verts[i + 1]);
+	}
+	return true;
+}
+
+// copies the tile's colour in from the target (or clears it), draws its bin,
+// and copies the colour back out
+static void raster_tile (Raster_Target* target, int index, Raster_Tile* tile) {
+	const Raster_Bin* bin = &target->bins[index];
+	tile->x0 = (index % target->tiles_x) * RASTER_TILE_SIZE;
+	tile->y0 = (index / target->tiles_x) * RASTER_TILE_SIZE;
+	tile->x1 = tile->x0 + RASTER_TILE_SIZE;
+	tile->y1 = tile->y0 + RASTER_TILE_SIZE;
+	tile->x1 = tile->x1 > target->width ? target->width : tile->x1;
+	tile->y1 = tile->y1 > target->height ? target->height : tile->y1;
+	tile->depth = target->depth + index * RASTER_TILE_SIZE * RASTER_TILE_SIZE;
+	int w = tile->x1 - tile->x0;
+	if (target->clear_pending) {
+		for (int i = 0; i < RASTER_TILE_SIZE * RASTER_TILE_SIZE; i++) {
+			tile->depth[i] = 1.0f;
+		}
+	}
+	if (0 == bin->count) {
+		for (int y = tile->y0; target->clear_pending && y < tile->y1; y++) {
+			uint32_t* colour_row = target->colour + y * target->colour_stride;
+			for (int x = tile->x0; x < tile->x1; x++) {
+				colour_row[x] = target->clear_colour;
+			}
+		}
+		return;
+	}
+
+	for (int y = tile->y0; y < tile->y1; y++) {
+		uint32_t* colour_row = tile->colour + (y - tile->y0) * RASTER_TILE_SIZE;
+		if (target->clear_pending) {
+			for (int x = 0; x < w; x++) {
+				colour_row[x] = target->clear_colour;
+			}
+		} else {
+			memcpy (colour_row, target->colour + y * target->colour_stride +
+				tile->x0, w * sizeof (uint32_t));
+		}
+	}
+	for (int i = 0; i < bin->count; i++) {
+		g_blocks_func (&target->setups[bin->tris[i]], tile);
+	}
+	for (int y = tile->y0; y < tile->y1; y++) {
+		memcpy (target->colour + y * target->colour_stride + tile->x0,
+			tile->colour + (y - tile->y0) * RASTER_TILE_SIZE, w * sizeof (uint32_t));
+	}
+}
+
+// -1 if the queue is empty
+static int take_tile (uint64_t* queue, bool from_back) {
+	uint64_t q = __atomic_load_n (queue, __ATOMIC_ACQUIRE);
+	while (true) {
+		uint32_t head = (uint32_t)q, tail = (uint32_t)(q >> 32);
+		if (head >= tail) {
+			return -1;
+		}
+		int tile = from_back ? (int)tail - 1 : (int)head;
+		uint64_t next = from_back ? (uint64_t)(tail - 1) << 32 | head :
+			(uint64_t)tail << 32 | (head + 1);
+		if (__atomic_compare_exchange_n (queue, &q, next, false, __ATOMIC_ACQ_REL,
+			__ATOMIC_ACQUIRE)) {
+			return tile;
+		}
+	}
+}
+
+// own tiles from the front first, then the back of everyone else's. no tiles
+// are added during a flush, so once every queue is empty the work is done
+static void run_tiles (Raster_Target* target, Raster_Worker* worker) {
+	int n = g_pool.n_threads;
+	while (true) {
+		int tile = take_tile (&worker->queue, false);
+		for (int i = 1; tile < 0 && i < n; i++) {
+			Raster_Worker* victim = &g_pool.workers[(worker->index + i) % n];
+			tile = take_tile (&victim->queue, true);
+		}
+		if (tile < 0) {
+			return;
+		}
+		raster_tile (target, tile, &worker->tile);
+	}
+}
+
+static void* worker_thread (void* arg) {
+	Raster_Worker* worker = (Raster_Worker*)arg;
+	pthread_mutex_lock (&g_pool.mutex);
+	while (true) {
+		while (!g_pool.quit && g_pool.generation == worker->generation) {
+			pthread_cond_wait (&g_pool.start_cond, &g_pool.mutex);
+		}
+		if (g_pool.quit) {
+			break;
+		}
+		worker->generation = g_pool.generation;
+		Raster_Target* target = g_pool.target;
+		pthread_mutex_unlock (&g_pool.mutex);
+		run_tiles (target, worker);
+		pthread_mutex_lock (&g_pool.mutex);
+		g_pool.n_done++;
+		if (g_pool.n_done == g_pool.n_threads - 1) {
+			pthread_cond_signal (&g_pool.done_cond);
+		}
+	}
+	pthread_mutex_unlock (&g_pool.mutex);
+	return NULL;
+}
+
+static void stop_pool () {
+	pthread_mutex_lock (&g_pool.mutex);
+	g_pool.quit = true;
+	pthread_cond_broadcast (&g_pool.start_cond);
+	pthread_mutex_unlock (&g_pool.mutex);
+	for (int i = 1; i < g_pool.n_threads; i++) {
+		pthread_join (g_pool.workers[i].thread, NULL);
+	}
+	free (g_pool.workers);
+	g_pool.workers = NULL;
+	g_pool.n_threads = 0;
+	g_pool.quit = false;
+}
+
+void set_raster_threads (int n_threads) {
+	if (n_threads <= 0) {
+		n_threads = (int)sysconf (_SC_NPROCESSORS_ONLN);
+	}
+	n_threads = n_threads < 1 ? 1 : n_threads;
+	n_threads = n_threads > RASTER_MAX_THREADS ? RASTER_MAX_THREADS : n_threads;
+	if (g_pool.workers) {
+		stop_pool ();
+	}
+	void* workers = NULL;
+	if (0 != posix_memalign (&workers, 64, n_threads * sizeof (Raster_Worker))) {
+		fprintf (stderr, "ERROR: out of memory for %i raster threads\n",
+			n_threads);
+		return;
+	}
+	memset (workers, 0, n_threads * sizeof (Raster_Worker));
+	g_pool.workers = (Raster_Worker*)workers;
+	g_pool.generation = 0;
+	g_pool.n_threads = 1;
+	for (int i = 0; i < n_threads; i++) {
+		g_pool.workers[i].index = i;
+		if (i > 0) {
+			if (0 != pthread_create (&g_pool.workers[i].thread, NULL, worker_thread,
+				&g_pool.workers[i])) {
+				fprintf (stderr, "ERROR: could only start %i raster threads\n", i);
+				break;
+			}
+			g_pool.n_threads++;
+		}
+	}
+}
+
+int raster_threads () {
+	return g_pool.n_threads ? g_pool.n_threads : 1;
+}
+
+void flush_raster_target (Raster_Target* target) {
+	if (!g_blocks_func) {
+		set_raster_avx2 (true);
+	}
+	if (!g_pool.workers) {
+		set_raster_threads (1);
+		if (!g_pool.workers) {
+			return;
+		}
+	}
+	// each thread starts with a run of neighbouring tiles, which tend to share
+	// triangles
+	int n_tiles = target->tiles_x * target->tiles_y;
+	int n = g_pool.n_threads;
+	for (int i = 0; i < n; i++) {
+		uint64_t head = (uint64_t)n_tiles * i / n;
+		uint64_t tail = (uint64_t)n_tiles * (i + 1) / n;
+		g_pool.workers[i].queue = tail << 32 | head;
+	}
+	if (n > 1) {
+		pthread_mutex_lock (&g_pool.mutex);
+		g_pool.target = target;
+		g_pool.n_done = 0;
+		g_pool.generation++;
+		pthread_cond_broadcast (&g_pool.start_cond);
+		pthread_mutex_unlock (&g_pool.mutex);
+	}
+	run_tiles (target, &g_pool.workers[0]);
+	if (n > 1) {
+		pthread_mutex_lock (&g_pool.mutex);
+		while (g_pool.n_done < n - 1) {
+			pthread_cond_wait (&g_pool.done_cond, &g_pool.mutex);
+		}
+		pthread_mutex_unlock (&g_pool.mutex);
+	}
+
+	target->clear_pending = false;
+	target->setup_count = 0;
+	for (int i = 0; i < n_tiles; i++) {
+		target->bins[i].count = 0;
+	}
+}
@@ -0,0 +1,104 @@
+//
+// half-space triangle rasteriser with a depth buffer, C99
+// anton gerdelan <gerdela@scss.tcd.ie>
+// trinity college dublin
+//
+// triangles come in either in clip space, e.g. from the vertex stage in
+// raster_vertex.h, or already projected to pixels (see project_points_soa() in
+// apg_maths.h). each one is snapped to 1/16th pixel fixed point and its 3
+// edge functions are walked over 8x8 pixel blocks. blocks entirely outside an
+// edge are skipped, and edges a block is entirely inside aren't tested per
+// pixel. the rest evaluate 8 pixels (one block row) at a time - with AVX2
+// when the cpu has it, otherwise as two halves with SSE2.
+// pixel centres exactly on an edge follow the D3D/GL top-left rule, so
+// triangles sharing an edge never both draw, or both miss, a pixel.
+// colour is interpolated perspective-correct and depth is a 32-bit float
+// z/w in 0..1 with a less-than test.
+// drawing is sort-middle: raster_triangle() only does the setup and bins the
+// triangle into the 64x64 tiles it touches. flush_raster_target() then has a
+// pool of threads draw whole tiles, each into its own copy of the tile's
+// colour, and idle threads steal tiles from busy ones. within a tile
+// triangles are drawn in the order they were submitted
+//
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+// vertices further off-screen than this (in pixels) can't be represented in
+// the fixed-point edge functions, so triangles with one are dropped
+#define RASTER_MAX_COORD 8192.0f
+
+// colour and depth buffers, and the triangles binned for the next flush.
+// colour can be someone else's memory, e.g. an XImage
+struct Raster_Target {
+	uint32_t* colour; // 0x00RRGGBB, top row first
+	int colour_stride; // in pixels
+	float* depth; // 64x64 floats per tile, in the same order as bins
+	int width, height;
+	struct Raster_Setup* setups;
+	int setup_count, setup_capacity;
+	struct Raster_Bin* bins; // one per tile, row by row
+	int tiles_x, tiles_y;
+	bool clear_pending;
+	uint32_t clear_colour;
+};
+typedef struct Raster_Target Raster_Target;
+
+// a vertex after project_points_soa(): x,y in pixels, z in 0..1, inv_w = 1/w.
+// r,g,b are in 0..1
+struct Raster_Vertex {
+	float x, y, z, inv_w;
+	float r, g, b;
+};
+typedef struct Raster_Vertex Raster_Vertex;
+
+// a vertex in clip space, before the divide by w
+struct Raster_Clip_Vertex {
+	float x, y, z, w;
+	float r, g, b;
+};
+typedef struct Raster_Clip_Vertex Raster_Clip_Vertex;
+
+bool create_raster_target (Raster_Target* target, uint32_t* colour,
+	int colour_stride, int width, int height);
+
+void destroy_raster_target (Raster_Target* target);
+
+// sets every pixel's colour, and depth to 1 (the far plane), as part of the
+// next flush. triangles not flushed yet are dropped
+void clear_raster_target (Raster_Target* target, uint32_t colour);
+
+// either winding is drawn, at the next flush
+void raster_triangle (Raster_Target* target, const Raster_Vertex* a,
+	const Raster_Vertex* b, const Raster_Vertex* c);
+
+// drops the triangle if it is entirely off one side of the view, or a back
+// face (see set_raster_cull_back()). otherwise clips it to the near and far
+// planes, divides by w and maps -1..1 to the whole target, y down, then goes
+// on as raster_triangle(). x and y are only clipped for triangles too big for
+// RASTER_MAX_COORD - the rest are left to the rasteriser's bounding box.
+// returns false if nothing was left to draw
+bool raster_clip_triangle (Raster_Target* target, const Raster_Clip_Vertex* a,
+	const Raster_Clip_Vertex* b, const Raster_Clip_Vertex* c);
+
+// draws everything binned since the last flush and returns when the colour
+// and depth buffers are up to date
+void flush_raster_target (Raster_Target* target);
+
+// "avx2" or "sse2" - picked from the cpu on first use
+const char* raster_simd_name ();
+
+// false forces the SSE2 kernel, e.g. to compare speed. output is identical
+void set_raster_avx2 (bool enabled);
+
+// true drops clip-space triangles that are clockwise on screen, i.e. facing
+// away with GL's default counter-clockwise front faces. off by default.
+// raster_triangle() always draws either winding
+void set_raster_cull_back (bool enabled);
+
+// number of threads that flush tiles, including the calling one. 1 (the
+// default) draws on the calling thread only, 0 uses one per core. output is
+// identical either way. not to be called during a flush
+void set_raster_threads (int n_threads);
+
+int raster_threads ();
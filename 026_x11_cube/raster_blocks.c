@@ -0,0 +1,170 @@
+//
+// per-triangle block loop of the rasteriser, C99 + GCC/Clang vector types
+// anton gerdelan <gerdela@scss.tcd.ie>
+// trinity college dublin
+//
+// the maths is written on 8-wide vector_size types, as in apg_maths_vec.h.
+// built with -mavx2 each is one ymm register; built for plain x86-64 the
+// compiler splits them into two SSE2 halves. -mfma is left off so both give
+// exactly the same pixels
+//
+#include "raster_blocks.h"
+#include <string.h>
+
+#ifdef RASTER_AVX2
+#define RASTER_BLOCKS_FUNC raster_blocks_avx2
+#else
+#define RASTER_BLOCKS_FUNC raster_blocks_sse2
+#endif
+
+typedef float raster_f8 __attribute__ ((vector_size (32)));
+typedef int32_t raster_i8 __attribute__ ((vector_size (32)));
+
+// memcpy keeps these legal for any alignment. compilers turn it into movups
+static inline raster_f8 load_f8 (const float* p) {
+	raster_f8 r;
+	memcpy (&r, p, sizeof (raster_f8));
+	return r;
+}
+
+static inline void store_f8 (float* p, raster_f8 a) {
+	memcpy (p, &a, sizeof (raster_f8));
+}
+
+static inline raster_i8 load_i8 (const uint32_t* p) {
+	raster_i8 r;
+	memcpy (&r, p, sizeof (raster_i8));
+	return r;
+}
+
+static inline void store_i8 (uint32_t* p, raster_i8 a) {
+	memcpy (p, &a, sizeof (raster_i8));
+}
+
+static inline raster_f8 splat_f8 (float f) {
+	raster_f8 r = { f, f, f, f, f, f, f, f };
+	return r;
+}
+
+// comparisons give -1 (all bits) in lanes that pass. picks a there, else b
+static inline raster_i8 select_i8 (raster_i8 mask, raster_i8 a, raster_i8 b) {
+	return (mask & a) | (~mask & b);
+}
+
+static inline raster_f8 select_f8 (raster_i8 mask, raster_f8 a, raster_f8 b) {
+	return (raster_f8)select_i8 (mask, (raster_i8)a, (raster_i8)b);
+}
+
+static inline bool any_i8 (raster_i8 mask) {
+	uint64_t q[4];
+	memcpy (q, &mask, sizeof (q));
+	return 0 != (q[0] | q[1] | q[2] | q[3]);
+}
+
+// 0..1 to 0..255, clamped
+static inline raster_i8 to_byte_i8 (raster_f8 f) {
+	raster_i8 i = __builtin_convertvector (f * 255.0f + 0.5f, raster_i8);
+	raster_i8 zero = { 0 }, max = zero + 255;
+	i = select_i8 (i < zero, zero, i);
+	return select_i8 (i > max, max, i);
+}
+
+void RASTER_BLOCKS_FUNC (const Raster_Setup* s, Raster_Tile* t) {
+	const raster_i8 lane = { 0, 1, 2, 3, 4, 5, 6, 7 };
+	const raster_f8 lane_f = { 0, 1, 2, 3, 4, 5, 6, 7 };
+	int x0 = t->x0, y0 = t->y0, x1 = t->x1, y1 = t->y1;
+	int min_x = s->min_x > x0 ? s->min_x : x0;
+	int min_y = s->min_y > y0 ? s->min_y : y0;
+	int max_x = s->max_x < x1 - 1 ? s->max_x : x1 - 1;
+	int max_y = s->max_y < y1 - 1 ? s->max_y : y1 - 1;
+	// steps from one pixel centre to the next, in edge function units
+	int32_t step_x[3], step_y[3];
+	for (int i = 0; i < 3; i++) {
+		step_x[i] = s->a[i] * RASTER_SUBPIXELS;
+		step_y[i] = s->b[i] * RASTER_SUBPIXELS;
+	}
+
+	for (int by = min_y & ~7; by <= max_y; by += 8) {
+		for (int bx = min_x & ~7; bx <= max_x; bx += 8) {
+			// each edge at the block's first pixel centre. linear, so its smallest
+			// and largest values over the block are at corners. if any edge is
+			// negative at all 4 the block is out. edges that are >= 0 at all 4 need
+			// no per-pixel test. the rest are within a few block widths of 0, so
+			// they fit in 32 bits
+			int64_t px = (int64_t)bx * RASTER_SUBPIXELS + RASTER_SUBPIXELS / 2;
+			int64_t py = (int64_t)by * RASTER_SUBPIXELS + RASTER_SUBPIXELS / 2;
+			// partial edges across the block's first row, and their change per row
+			raster_i8 edge[3], edge_down[3];
+			int n_partial = 0;
+			bool out = false;
+			for (int i = 0; i < 3 && !out; i++) {
+				int64_t e = s->a[i] * px + s->b[i] * py + s->c[i];
+				int64_t across = (int64_t)step_x[i] * 7, below = (int64_t)step_y[i] * 7;
+				int64_t lo = e + (across < 0 ? across : 0) + (below < 0 ? below : 0);
+				int64_t hi = e + (across > 0 ? across : 0) + (below > 0 ? below : 0);
+				if (hi < 0) {
+					out = true;
+				} else if (lo < 0) {
+					raster_i8 zero = { 0 };
+					edge[n_partial] = lane * step_x[i] + (int32_t)e;
+					edge_down[n_partial] = zero + step_y[i];
+					n_partial++;
+				}
+			}
+			if (out) {
+				continue;
+			}
+
+			// the far sides of a tile at the screen edge may cut through a block.
+			// the tile's rows are full width, so lanes past x1 can still be
+			// loaded and stored as long as they are masked out
+			raster_i8 in_cols = lane + bx < x1;
+			// and small triangles often only cover a few of the rows
+			int first_row = min_y > by ? min_y - by : 0;
+			int end_row = max_y - by + 1 < 8 ? max_y - by + 1 : 8;
+
+			float fx = (float)bx + 0.5f - s->x0, fy = (float)by + 0.5f - s->y0;
+			// attributes along the block's first row, and their change per row
+			raster_f8 first[RASTER_ATTRIBS], down[RASTER_ATTRIBS];
+			for (int k = 0; k < RASTER_ATTRIBS; k++) {
+				first[k] = splat_f8 (s->v0[k] + s->dx[k] * fx + s->dy[k] * fy) +
+					lane_f * s->dx[k];
+				down[k] = splat_f8 (s->dy[k]);
+			}
+
+			for (int row = first_row; row < end_row; row++) {
+				raster_i8 mask = in_cols;
+				for (int i = 0; i < n_partial; i++) {
+					mask &= edge[i] + edge_down[i] * row >= 0;
+				}
+				if (!any_i8 (mask)) {
+					continue;
+				}
+				raster_f8 attrib[RASTER_ATTRIBS];
+				for (int k = 0; k < RASTER_ATTRIBS; k++) {
+					attrib[k] = first[k] + down[k] * (float)row;
+				}
+				raster_f8 z = attrib[RASTER_Z];
+				int y = by + row;
+				int offset = (y - y0) * RASTER_TILE_SIZE + bx - x0;
+				float* depth_row = t->depth + offset;
+				raster_f8 depth = load_f8 (depth_row);
+				mask &= z < depth;
+				if (!any_i8 (mask)) {
+					continue;
+				}
+				store_f8 (depth_row, select_f8 (mask, z, depth));
+
+				// perspective-correct colour is (colour/w) / (1/w)
+				raster_f8 w = 1.0f / attrib[RASTER_INV_W];
+				raster_i8 r = to_byte_i8 (attrib[RASTER_R_W] * w);
+				raster_i8 g = to_byte_i8 (attrib[RASTER_G_W] * w);
+				raster_i8 b = to_byte_i8 (attrib[RASTER_B_W] * w);
+				raster_i8 colour = r << 16 | g << 8 | b;
+				uint32_t* colour_row = t->colour + offset;
+				raster_i8 prev = load_i8 (colour_row);
+				store_i8 (colour_row, select_i8 (mask, colour, prev));
+			}
+		}
+	}
+}
@@ -0,0 +1,51 @@
+//
+// per-triangle block loop of the rasteriser, C99
+// anton gerdelan <gerdela@scss.tcd.ie>
+// trinity college dublin
+//
+// raster_blocks.c is compiled twice, as is for the SSE2 kernel and with
+// -mavx2 -DRASTER_AVX2 for the AVX2 one. raster.c does the triangle setup and
+// binning, and picks which to call
+//
+#pragma once
+#include "raster.h"
+
+#define RASTER_TILE_SIZE 64
+#define RASTER_SUBPIXEL_BITS 4
+#define RASTER_SUBPIXELS (1 << RASTER_SUBPIXEL_BITS)
+
+// attributes interpolated across a triangle. colour is stored divided by w
+enum { RASTER_Z = 0, RASTER_INV_W, RASTER_R_W, RASTER_G_W, RASTER_B_W,
+	RASTER_ATTRIBS };
+
+struct Raster_Setup {
+	// edge i is a[i] * x + b[i] * y + c[i] >= 0 inside, with x,y in subpixels.
+	// c already has the -1 that keeps pixels exactly on a bottom or right edge
+	// out
+	int32_t a[3], b[3];
+	int64_t c[3];
+	// pixels with centres in the triangle's bounding box, inclusive
+	int min_x, min_y, max_x, max_y;
+	// attribute = v0 + dx * (x - x0) + dy * (y - y0) at pixel centre x,y
+	float x0, y0;
+	float v0[RASTER_ATTRIBS], dx[RASTER_ATTRIBS], dy[RASTER_ATTRIBS];
+};
+typedef struct Raster_Setup Raster_Setup;
+
+// a thread's private copy of the colour of the tile it is working on, and the
+// tile's part of the target's depth, which is stored tile by tile anyway.
+// rows of both are always RASTER_TILE_SIZE apart, even in tiles cut short by
+// the screen edge. x0,y0 - x1,y1 (exclusive) is where the tile is on screen
+struct Raster_Tile {
+	uint32_t colour[RASTER_TILE_SIZE * RASTER_TILE_SIZE]
+		__attribute__ ((aligned (32)));
+	float* depth;
+	int x0, y0, x1, y1;
+};
+typedef struct Raster_Tile Raster_Tile;
+
+// draws the part of the triangle inside the tile
+typedef void (*raster_blocks_func) (const Raster_Setup* s, Raster_Tile* t);
+
+void raster_blocks_sse2 (const Raster_Setup* s, Raster_Tile* t);
+void raster_blocks_avx2 (const Raster_Setup* s, Raster_Tile* t);
@@ -0,0 +1,69 @@
+//
+// vertex stage of the rasteriser, C99
+// anton gerdelan <gerdela@scss.tcd.ie>
+// trinity college dublin
+//
+#include "raster_vertex.h"
+#include <stdint.h>
+
+// fifo - a hit doesn't move an entry, and a miss replaces the oldest
+struct Raster_Vertex_Cache {
+	uint32_t tags[RASTER_VERTEX_CACHE_SIZE];
+	Raster_Clip_Vertex verts[RASTER_VERTEX_CACHE_SIZE];
+	int next;
+};
+typedef struct Raster_Vertex_Cache Raster_Vertex_Cache;
+
+static void transform_vertex (const float* m, const float* p, const float* c,
+	Raster_Clip_Vertex* r) {
+	r->x = m[0] * p[0] + m[4] * p[1] + m[8] * p[2] + m[12];
+	r->y = m[1] * p[0] + m[5] * p[1] + m[9] * p[2] + m[13];
+	r->z = m[2] * p[0] + m[6] * p[1] + m[10] * p[2] + m[14];
+	r->w = m[3] * p[0] + m[7] * p[1] + m[11] * p[2] + m[15];
+	r->r = c[0];
+	r->g = c[1];
+	r->b = c[2];
+}
+
+void raster_draw_indexed (Raster_Target* target, const float* matrix,
+	const float* positions, const float* colours, const void* indices,
+	int index_size, int index_count, Raster_Draw_Stats* stats) {
+	Raster_Vertex_Cache cache;
+	for (int i = 0; i < RASTER_VERTEX_CACHE_SIZE; i++) {
+		cache.tags[i] = UINT32_MAX;
+	}
+	cache.next = 0;
+	const uint16_t* indices16 = (const uint16_t*)indices;
+	const uint32_t* indices32 = (const uint32_t*)indices;
+	int transformed = 0, rejected = 0;
+
+	for (int i = 0; i + 2 < index_count; i += 3) {
+		// copied out, as a miss on a later corner could replace an earlier one
+		Raster_Clip_Vertex tri[3];
+		for (int k = 0; k < 3; k++) {
+			uint32_t index = 2 == index_size ? indices16[i + k] : indices32[i + k];
+			int slot = -1;
+			for (int j = 0; j < RASTER_VERTEX_CACHE_SIZE; j++) {
+				slot = cache.tags[j] == index ? j : slot;
+			}
+			if (slot < 0) {
+				slot = cache.next;
+				cache.next = (cache.next + 1) % RASTER_VERTEX_CACHE_SIZE;
+				cache.tags[slot] = index;
+				transform_vertex (matrix, positions + index * 3, colours + index * 3,
+					&cache.verts[slot]);
+				transformed++;
+			}
+			tri[k] = cache.verts[slot];
+		}
+		if (!raster_clip_triangle (target, &tri[0], &tri[1], &tri[2])) {
+			rejected++;
+		}
+	}
+
+	if (stats) {
+		stats->triangles += index_count / 3;
+		stats->vertices_transformed += transformed;
+		stats->triangles_rejected += rejected;
+	}
+}
@@ -0,0 +1,33 @@
+//
+// vertex stage of the rasteriser, C99
+// anton gerdelan <gerdela@scss.tcd.ie>
+// trinity college dublin
+//
+// walks an index buffer, transforms each vertex it refers to into clip space
+// and hands the triangles to raster_clip_triangle(). transformed vertices go
+// into a small fifo post-transform cache, like a GPU's, so a vertex shared by
+// neighbouring triangles is usually only done once. meshes reordered with
+// optimise_obj_mesh() (025's mesh_opt.h) for RASTER_VERTEX_CACHE_SIZE get
+// around 0.7 transforms per triangle, against 3 for unrolled triangles
+//
+#pragma once
+#include "raster.h"
+
+// entries in the post-transform cache. same meaning as mesh_opt.h's cache size
+#define RASTER_VERTEX_CACHE_SIZE 16
+
+// added to by each draw, so zero it first
+struct Raster_Draw_Stats {
+	int triangles;
+	int vertices_transformed;
+	int triangles_rejected; // off-screen or back-facing
+};
+typedef struct Raster_Draw_Stats Raster_Draw_Stats;
+
+/* clip = matrix * (x, y, z, 1) with a column-major matrix, e.g. a mat4's m.
+   positions and colours are 3 floats per vertex, colours 0..1. indices are
+   uint16_t if index_size is 2, uint32_t if 4 - as in Obj_Indexed_Mesh.
+   stats can be NULL */
+void raster_draw_indexed (Raster_Target* target, const float* matrix,
+	const float* positions, const float* colours, const void* indices,
+	int index_size, int index_count, Raster_Draw_Stats* stats);
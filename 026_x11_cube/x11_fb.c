@@ -0,0 +1,166 @@
+//
+// client-side 32-bit framebuffer for an X11 window, C99
+// anton gerdelan <gerdela@scss.tcd.ie>
+// trinity college dublin
+//
+#include "x11_fb.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+// XShmAttach fails with an X error, not a return value, e.g. when the server
+// is on another machine and can't see our segment
+static bool g_shm_error;
+
+static int shm_error_handler (Display* display, XErrorEvent* event) {
+	(void)display;
+	(void)event;
+	g_shm_error = true;
+	return 0;
+}
+
+static bool create_shm_image (X11_Framebuffer* fb, Visual* visual,
+	int depth) {
+	if (!XShmQueryExtension (fb->display)) {
+		fprintf (stderr, "WARNING: no MIT-SHM extension\n");
+		return false;
+	}
+	memset (&fb->shm_info, 0, sizeof (XShmSegmentInfo));
+	fb->image = XShmCreateImage (fb->display, visual, depth, ZPixmap, NULL,
+		&fb->shm_info, fb->width, fb->height);
+	if (!fb->image) {
+		fprintf (stderr, "WARNING: XShmCreateImage failed\n");
+		return false;
+	}
+	fb->shm_info.shmid = shmget (IPC_PRIVATE,
+		fb->image->bytes_per_line * fb->image->height, IPC_CREAT | 0600);
+	if (fb->shm_info.shmid < 0) {
+		fprintf (stderr, "WARNING: shmget failed\n");
+		XDestroyImage (fb->image);
+		fb->image = NULL;
+		return false;
+	}
+	fb->shm_info.shmaddr = fb->image->data =
+		(char*)shmat (fb->shm_info.shmid, NULL, 0);
+	if ((char*)-1 == fb->shm_info.shmaddr) {
+		fprintf (stderr, "WARNING: shmat failed\n");
+		shmctl (fb->shm_info.shmid, IPC_RMID, NULL);
+		fb->image->data = NULL;
+		XDestroyImage (fb->image);
+		fb->image = NULL;
+		return false;
+	}
+	fb->shm_info.readOnly = False;
+	g_shm_error = false;
+	XErrorHandler prev_handler = XSetErrorHandler (shm_error_handler);
+	XShmAttach (fb->display, &fb->shm_info);
+	XSync (fb->display, False);
+	XSetErrorHandler (prev_handler);
+	// marked for removal now, so it goes away when both sides detach, even if
+	// we crash
+	shmctl (fb->shm_info.shmid, IPC_RMID, NULL);
+	if (g_shm_error) {
+		fprintf (stderr, "WARNING: XShmAttach failed\n");
+		shmdt (fb->shm_info.shmaddr);
+		fb->image->data = NULL;
+		XDestroyImage (fb->image);
+		fb->image = NULL;
+		return false;
+	}
+	return true;
+}
+
+bool create_x11_fb (X11_Framebuffer* fb, Display* display, Window window,
+	GC gc, int width, int height, bool use_shm) {
+	memset (fb, 0, sizeof (X11_Framebuffer));
+	fb->display = display;
+	fb->window = window;
+	fb->gc = gc;
+	fb->width = width;
+	fb->height = height;
+
+	int screen = DefaultScreen (display);
+	Visual* visual = DefaultVisual (display, screen);
+	int depth = DefaultDepth (display, screen);
+	if (depth < 24 || TrueColor != visual->class ||
+		0xFF0000 != visual->red_mask || 0x00FF00 != visual->green_mask ||
+		0x0000FF != visual->blue_mask) {
+		fprintf (stderr, "ERROR: need a 24-bit 0xRRGGBB TrueColor visual\n");
+		return false;
+	}
+
+	if (use_shm && create_shm_image (fb, visual, depth)) {
+		fb->shm = true;
+	} else {
+		char* data = (char*)calloc ((size_t)width * height, 4);
+		if (!data) {
+			fprintf (stderr, "ERROR: out of memory for framebuffer\n");
+			return false;
+		}
+		fb->image = XCreateImage (display, visual, depth, ZPixmap, 0, data,
+			width, height, 32, width * 4);
+		if (!fb->image) {
+			fprintf (stderr, "ERROR: XCreateImage failed\n");
+			free (data);
+			return false;
+		}
+	}
+	if (32 != fb->image->bits_per_pixel) {
+		fprintf (stderr, "ERROR: XImage is %i bits per pixel, not 32\n",
+			fb->image->bits_per_pixel);
+		destroy_x11_fb (fb);
+		return false;
+	}
+	fb->pixels = (uint32_t*)fb->image->data;
+	fb->stride = fb->image->bytes_per_line / 4;
+	printf ("framebuffer %ix%i presenting with %s\n", width, height,
+		fb->shm ? "XShmPutImage" : "XPutImage");
+	return true;
+}
+
+void destroy_x11_fb (X11_Framebuffer* fb) {
+	if (!fb->image) {
+		return;
+	}
+	if (fb->shm) {
+		XShmDetach (fb->display, &fb->shm_info);
+		XSync (fb->display, False);
+		shmdt (fb->shm_info.shmaddr);
+		fb->image->data = NULL; // or XDestroyImage would free() it
+	}
+	XDestroyImage (fb->image); // also frees the calloc()ed pixels
+	fb->image = NULL;
+	fb->pixels = NULL;
+}
+
+void clear_x11_fb (X11_Framebuffer* fb, uint32_t colour) {
+	for (int y = 0; y < fb->height; y++) {
+		uint32_t* row = fb->pixels + y * fb->stride;
+		for (int x = 0; x < fb->width; x++) {
+			row[x] = colour;
+		}
+	}
+}
+
+void put_x11_fb (X11_Framebuffer* fb) {
+	if (fb->shm) {
+		XShmPutImage (fb->display, fb->window, fb->gc, fb->image, 0, 0, 0, 0,
+			fb->width, fb->height, False);
+	} else {
+		XPutImage (fb->display, fb->window, fb->gc, fb->image, 0, 0, 0, 0,
+			fb->width, fb->height);
+	}
+}
+
+void sync_x11_fb (X11_Framebuffer* fb) {
+	// with shared memory the server reads the pixels some time after the
+	// request, so wait for it before the next frame draws over them
+	XSync (fb->display, False);
+}
+
+void present_x11_fb (X11_Framebuffer* fb) {
+	put_x11_fb (fb);
+	sync_x11_fb (fb);
+}
@@ -0,0 +1,54 @@
+//
+// client-side 32-bit framebuffer for an X11 window, C99
+// anton gerdelan <gerdela@scss.tcd.ie>
+// trinity college dublin
+//
+// the renderer draws into pixels[] and present_x11_fb() copies the whole lot
+// to the window in one request. with the MIT-SHM extension the XImage lives in
+// shared memory, so the server reads it straight out of our address space
+// (XShmPutImage). otherwise, e.g. over ssh, it falls back to XPutImage, which
+// sends the pixels down the socket.
+// only 24/32-bit TrueColor visuals with 0x00RRGGBB pixels are supported
+//
+#pragma once
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+struct X11_Framebuffer {
+	uint32_t* pixels; // row-major, top row first
+	int width, height;
+	int stride; // pixels per row. can be more than width
+	bool shm; // true if presenting with XShmPutImage
+	Display* display;
+	Window window;
+	GC gc;
+	XImage* image;
+	XShmSegmentInfo shm_info;
+};
+typedef struct X11_Framebuffer X11_Framebuffer;
+
+// tries MIT-SHM first unless use_shm is false. returns false if neither works
+bool create_x11_fb (X11_Framebuffer* fb, Display* display, Window window,
+	GC gc, int width, int height, bool use_shm);
+
+void destroy_x11_fb (X11_Framebuffer* fb);
+
+static inline uint32_t rgb_x11_fb (int r, int g, int b) {
+	return (uint32_t)r << 16 | (uint32_t)g << 8 | (uint32_t)b;
+}
+
+void clear_x11_fb (X11_Framebuffer* fb, uint32_t colour);
+
+/* copies the framebuffer to the window and waits until the server has it, so
+   pixels[] can be drawn into again straight away */
+void present_x11_fb (X11_Framebuffer* fb);
+
+/* present_x11_fb() in two halves, for drawing with Xlib over the top: queue
+   the copy, queue e.g. XDrawString(), then sync. the server handles requests
+   in order, so the text lands on the new frame rather than flickering after
+   it. pixels[] must not be drawn into until sync_x11_fb() returns */
+void put_x11_fb (X11_Framebuffer* fb);
+void sync_x11_fb (X11_Framebuffer* fb);
@@ -19,7 +19,7 @@ TODO:
 \*****************************************************************************/
 
 #include "maths_funcs.h" // my maths functions
-#include "obj_parser.h" // my little Wavefront .obj mesh loader
+#include "mesh_loader.h" // streams .obj meshes in on a background thread
 #include "stb_image.h" // Sean Barrett's image loader - nothings.org
 #include "gl_utils.h" // common opengl functions and small utilities like logs
 #include <GL/glew.h> // include GLEW and new version of GL on Windows
@@ -29,6 +29,8 @@ TODO:
 #include <assert.h>
 #include <math.h>
 #define MESH_FILE "suzanne.obj"
+// vertex data copied into VBOs per frame while meshes stream in
+#define MESH_UPLOAD_BYTES_PER_FRAME (1024 * 1024)
 
 /* choose pure reflection or pure refraction here. */
 #define MONKEY_VERT_FILE "reflect_vs.glsl"
@@ -236,7 +238,7 @@ int main () {
 	// start GL context and O/S window using the GLFW helper library
 	assert (start_gl ());
 	
-vec3 light_pos = vec3 (0.0,0.0,0.0);
+constexpr vec3 light_pos = vec3 (0.0,0.0,0.0);
 /*---------------------------------CUBE MAP-----------------------------------*/
 	GLuint cube_vao = make_big_cube ();
 	GLuint cube_map_texture;
@@ -244,35 +246,15 @@ vec3 light_pos = vec3 (0.0,0.0,0.0);
 
 	init_fb (cube_map_texture);
 /*------------------------------CREATE GEOMETRY-------------------------------*/
-	GLfloat* vp = NULL; // array of vertex points
-	GLfloat* vn = NULL; // array of vertex normals
-	GLfloat* vt = NULL; // array of texture coordinates
-	int g_point_count = 0;
-	assert (load_obj_file (MESH_FILE, vp, vt, vn, g_point_count));
-
+	/* parsed on the loader thread and uploaded by the render loop, so the window
+	draws straight away and the monkeys pop in when they are ready */
+	Streamed_Mesh monkey_mesh;
+	assert (start_mesh_loader ());
+	assert (queue_mesh_load (MESH_FILE, &monkey_mesh));
+	// empty until the mesh is ready, so the draws below are zero-length no-ops
 	GLuint vao;
 	glGenVertexArrays (1, &vao);
-	glBindVertexArray (vao);
-
-	GLuint points_vbo, normals_vbo;
-	if (NULL != vp) {
-		glGenBuffers (1, &points_vbo);
-		glBindBuffer (GL_ARRAY_BUFFER, points_vbo);
-		glBufferData (
-			GL_ARRAY_BUFFER, 3 * g_point_count * sizeof (GLfloat), vp, GL_STATIC_DRAW
-		);
-		glVertexAttribPointer (0, 3, GL_FLOAT, GL_FALSE, 0, NULL);
-		glEnableVertexAttribArray (0);
-	}
-	if (NULL != vn) {
-		glGenBuffers (1, &normals_vbo);
-		glBindBuffer (GL_ARRAY_BUFFER, normals_vbo);
-		glBufferData (
-			GL_ARRAY_BUFFER, 3 * g_point_count * sizeof (GLfloat), vn, GL_STATIC_DRAW
-		);
-		glVertexAttribPointer (1, 3, GL_FLOAT, GL_FALSE, 0, NULL);
-		glEnableVertexAttribArray (1);
-	}
+	int g_point_count = 0;
 	
 /*-------------------------------CREATE SHADERS-------------------------------*/
 	// shaders for "Suzanne" mesh
@@ -350,6 +332,11 @@ vec3 light_pos = vec3 (0.0,0.0,0.0);
 		double elapsed_seconds = current_seconds - previous_seconds;
 		previous_seconds = current_seconds;
 		_update_fps_counter (g_window);
+		update_mesh_uploads (MESH_UPLOAD_BYTES_PER_FRAME);
+		if (monkey_mesh.ready) {
+			vao = monkey_mesh.vao;
+			g_point_count = monkey_mesh.point_count;
+		}
 
 		{ // depth pass -- only need to do this when stuff herein actually moves
 			glBindFramebuffer(GL_FRAMEBUFFER, g_light_fb);
@@ -370,30 +357,25 @@ vec3 light_pos = vec3 (0.0,0.0,0.0);
 				//
 			//}
 			
-			vec3 targ_pos[6] = {
-				light_pos + vec3 (1.0, 0.0, 0.0), // posx
-				light_pos + vec3 (-1.0, 0.0, 0.0), // negx
-				light_pos + vec3 (0.0, 1.0, 0.0), //posy
-				light_pos + vec3 (0.0, -1.0, 0.0), //negy
-				light_pos + vec3 (0.0, 0.0, 1.0), //posz
-				light_pos + vec3 (0.0, 0.0, -1.0) //negz
-			};
+			// the light doesn't move so these are all built at compile time
 			//upside-down up to store texture right- way up. hacky...
-			vec3 up[6] = {
-				vec3 (0.0,-1.0,0.0),
-				vec3 (0.0,-1.0,0.0),
-				vec3 (0.0,0.0,1.0),//posy
-				vec3 (0.0,0.0,-1.0),//negy
-				vec3 (0.0,-1.0,0.0),
-				vec3 (0.0,-1.0,0.0)
+			static constexpr mat4 light_V[6] = {
+				look_at_ct (light_pos, light_pos + vec3 (1.0, 0.0, 0.0), // posx
+					vec3 (0.0,-1.0,0.0)),
+				look_at_ct (light_pos, light_pos + vec3 (-1.0, 0.0, 0.0), // negx
+					vec3 (0.0,-1.0,0.0)),
+				look_at_ct (light_pos, light_pos + vec3 (0.0, 1.0, 0.0), //posy
+					vec3 (0.0,0.0,1.0)),
+				look_at_ct (light_pos, light_pos + vec3 (0.0, -1.0, 0.0), //negy
+					vec3 (0.0,0.0,-1.0)),
+				look_at_ct (light_pos, light_pos + vec3 (0.0, 0.0, 1.0), //posz
+					vec3 (0.0,-1.0,0.0)),
+				look_at_ct (light_pos, light_pos + vec3 (0.0, 0.0, -1.0), //negz
+					vec3 (0.0,-1.0,0.0))
 			};
-			mat4 light_V[6];
-			for (int i = 0; i < 6; i++) {
-				light_V[i] = look_at (light_pos, targ_pos[i],up[i]);
-			}
 			// NOTE: texture was upside-down!!! -- reversing y means y val is backwards, above
 			
-			mat4 light_P = perspective (90.0,1.0,0.01,100.0);
+			static constexpr mat4 light_P = perspective_ct (90.0f,1.0f,0.01f,100.0f);
 
 			//glDisable (GL_DEPTH_TEST); // enable depth-testing
 			glUseProgram (write_cube_sp);
@@ -410,22 +392,22 @@ vec3 light_pos = vec3 (0.0,0.0,0.0);
 				glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 				glUniformMatrix4fv (write_cube_V_location, 1, GL_FALSE, light_V[i].m);
-				model_mat = translate (identity_mat4 (), vec3 (5.0, 1.0 + tx, 0.0));
+				translation (vec3 (5.0, 1.0 + tx, 0.0), model_mat);
 				glUniformMatrix4fv (write_cube_M_location, 1, GL_FALSE, model_mat.m);
 				glDrawArrays (GL_TRIANGLES, 0, g_point_count);
-				model_mat = translate (identity_mat4 (), vec3 (-5.0 + tx, -1.0, 0.0));
+				translation (vec3 (-5.0 + tx, -1.0, 0.0), model_mat);
 				glUniformMatrix4fv (write_cube_M_location, 1, GL_FALSE, model_mat.m);
 				glDrawArrays (GL_TRIANGLES, 0, g_point_count);
-				model_mat = translate (identity_mat4 (), vec3 (0.0, -1.0, -5.0 + tx));
+				translation (vec3 (0.0, -1.0, -5.0 + tx), model_mat);
 				glUniformMatrix4fv (write_cube_M_location, 1, GL_FALSE, model_mat.m);
 				glDrawArrays (GL_TRIANGLES, 0, g_point_count);
-				model_mat = translate (identity_mat4 (), vec3 (0.0, 1.0, 5.0));
+				translation (vec3 (0.0, 1.0, 5.0), model_mat);
 				glUniformMatrix4fv (write_cube_M_location, 1, GL_FALSE, model_mat.m);
 				glDrawArrays (GL_TRIANGLES, 0, g_point_count);
-				model_mat = translate (identity_mat4 (), vec3 (tx, 5.0, 0.0));
+				translation (vec3 (tx, 5.0, 0.0), model_mat);
 				glUniformMatrix4fv (write_cube_M_location, 1, GL_FALSE, model_mat.m);
 				glDrawArrays (GL_TRIANGLES, 0, g_point_count);
-				model_mat = translate (identity_mat4 (), vec3 (0.0, -5.0, 0.0));
+				translation (vec3 (0.0, -5.0, 0.0), model_mat);
 				glUniformMatrix4fv (write_cube_M_location, 1, GL_FALSE, model_mat.m);
 				glDrawArrays (GL_TRIANGLES, 0, g_point_count);
 			}
@@ -455,22 +437,22 @@ vec3 light_pos = vec3 (0.0,0.0,0.0);
 			cam_pos.v[2]);
 		glBindVertexArray (vao);
 		float tx = sinf ((float)current_seconds);
-		model_mat = translate (identity_mat4 (), vec3 (5.0, 1.0 + tx, 0.0));
+		translation (vec3 (5.0, 1.0 + tx, 0.0), model_mat);
 		glUniformMatrix4fv (monkey_M_location, 1, GL_FALSE, model_mat.m);
 		glDrawArrays (GL_TRIANGLES, 0, g_point_count);
-		model_mat = translate (identity_mat4 (), vec3 (-5.0 + tx, -1.0, 0.0));
+		translation (vec3 (-5.0 + tx, -1.0, 0.0), model_mat);
 		glUniformMatrix4fv (monkey_M_location, 1, GL_FALSE, model_mat.m);
 		glDrawArrays (GL_TRIANGLES, 0, g_point_count);
-		model_mat = translate (identity_mat4 (), vec3 (0.0, -1.0, -5.0 + tx));
+		translation (vec3 (0.0, -1.0, -5.0 + tx), model_mat);
 		glUniformMatrix4fv (monkey_M_location, 1, GL_FALSE, model_mat.m);
 		glDrawArrays (GL_TRIANGLES, 0, g_point_count);
-		model_mat = translate (identity_mat4 (), vec3 (0.0, 1.0, 5.0));
+		translation (vec3 (0.0, 1.0, 5.0), model_mat);
 		glUniformMatrix4fv (monkey_M_location, 1, GL_FALSE, model_mat.m);
 		glDrawArrays (GL_TRIANGLES, 0, g_point_count);
-		model_mat = translate (identity_mat4 (), vec3 (tx, 5.0, 0.0));
+		translation (vec3 (tx, 5.0, 0.0), model_mat);
 		glUniformMatrix4fv (monkey_M_location, 1, GL_FALSE, model_mat.m);
 		glDrawArrays (GL_TRIANGLES, 0, g_point_count);
-		model_mat = translate (identity_mat4 (), vec3 (0.0, -5.0, 0.0));
+		translation (vec3 (0.0, -5.0, 0.0), model_mat);
 		glUniformMatrix4fv (monkey_M_location, 1, GL_FALSE, model_mat.m);
 		glDrawArrays (GL_TRIANGLES, 0, g_point_count);
 		// update other events like input handling 
@@ -512,7 +494,7 @@ vec3 light_pos = vec3 (0.0,0.0,0.0);
 			versor q_yaw = quat_from_axis_deg (
 				cam_yaw, up.v[0], up.v[1], up.v[2]
 			);
-			q = q_yaw * q;
+			mult (q_yaw, q, q);
 		}
 		if (glfwGetKey (g_window, GLFW_KEY_RIGHT)) {
 			cam_yaw -= cam_heading_speed * elapsed_seconds;
@@ -520,7 +502,7 @@ vec3 light_pos = vec3 (0.0,0.0,0.0);
 			versor q_yaw = quat_from_axis_deg (
 				cam_yaw, up.v[0], up.v[1], up.v[2]
 			);
-			q = q_yaw * q;
+			mult (q_yaw, q, q);
 		}
 		if (glfwGetKey (g_window, GLFW_KEY_UP)) {
 			cam_pitch += cam_heading_speed * elapsed_seconds;
@@ -528,7 +510,7 @@ vec3 light_pos = vec3 (0.0,0.0,0.0);
 			versor q_pitch = quat_from_axis_deg (
 				cam_pitch, rgt.v[0], rgt.v[1], rgt.v[2]
 			);
-			q = q_pitch * q;
+			mult (q_pitch, q, q);
 		}
 		if (glfwGetKey (g_window, GLFW_KEY_DOWN)) {
 			cam_pitch -= cam_heading_speed * elapsed_seconds;
@@ -536,7 +518,7 @@ vec3 light_pos = vec3 (0.0,0.0,0.0);
 			versor q_pitch = quat_from_axis_deg (
 				cam_pitch, rgt.v[0], rgt.v[1], rgt.v[2]
 			);
-			q = q_pitch * q;
+			mult (q_pitch, q, q);
 		}
 		if (glfwGetKey (g_window, GLFW_KEY_Z)) {
 			cam_roll -= cam_heading_speed * elapsed_seconds;
@@ -544,7 +526,7 @@ vec3 light_pos = vec3 (0.0,0.0,0.0);
 			versor q_roll = quat_from_axis_deg (
 				cam_roll, fwd.v[0], fwd.v[1], fwd.v[2]
 			);
-			q = q_roll * q;
+			mult (q_roll, q, q);
 		}
 		if (glfwGetKey (g_window, GLFW_KEY_C)) {
 			cam_roll += cam_heading_speed * elapsed_seconds;
@@ -552,25 +534,23 @@ vec3 light_pos = vec3 (0.0,0.0,0.0);
 			versor q_roll = quat_from_axis_deg (
 				cam_roll, fwd.v[0], fwd.v[1], fwd.v[2]
 			);
-			q = q_roll * q;
+			mult (q_roll, q, q);
 		}
 		// update view matrix
 		if (cam_moved) {
 			cam_heading += cam_yaw;
 		
 			// re-calculate local axes so can move fwd in dir cam is pointing
-			R = quat_to_mat4 (q);
-			fwd = R * vec4 (0.0, 0.0, -1.0, 0.0);
-			rgt = R * vec4 (1.0, 0.0, 0.0, 0.0);
-			up = R * vec4 (0.0, 1.0, 0.0, 0.0);
+			quat_to_mat4 (q, R);
+			mult (R, vec4 (0.0, 0.0, -1.0, 0.0), fwd);
+			mult (R, vec4 (1.0, 0.0, 0.0, 0.0), rgt);
+			mult (R, vec4 (0.0, 1.0, 0.0, 0.0), up);
 			
 			cam_pos = cam_pos + vec3 (fwd) * -move.v[2];
 			cam_pos = cam_pos + vec3 (up) * move.v[1];
 			cam_pos = cam_pos + vec3 (rgt) * move.v[0];
 			print (cam_pos);
-			mat4 T = translate (identity_mat4 (), vec3 (cam_pos));
-			
-			view_mat = inverse (R) * inverse (T);
+			view_from_quat_pos (q, cam_pos, view_mat);
 		
 			// cube-map view matrix has rotation, but not translation
 			glUseProgram (cube_sp);
@@ -585,6 +565,7 @@ vec3 light_pos = vec3 (0.0,0.0,0.0);
 		glfwSwapBuffers (g_window);
 	}
 	
+	stop_mesh_loader ();
 	// close GL context and any other GLFW resources
 	glfwTerminate();
 	return 0;
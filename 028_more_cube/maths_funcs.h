@@ -7,82 +7,119 @@
 | See individual libraries' separate legal notices                             |
 |******************************************************************************|
 | Commonly-used maths structures and functions                                 |
-| Simple-as-possible. No disgusting templates.                                 |
+| Simple-as-possible. Templated only on float/double, nothing cleverer.        |
 | Structs vec3, mat4, versor. just hold arrays of floats called "v","m","q",   |
 | respectively. So, for example, to get values from a mat4 do: my_mat.m        |
+| dvec3, dmat4, dversor etc. are the same with doubles.                        |
 | A versor is the proper name for a unit quaternion.                           |
 | This is C++ because it's sort-of convenient to be able to use maths operators|
+| Most of it is constexpr (C++14) so fixed cameras can be built at compile     |
+| time. Functions needing sqrt/trig call libm, and are mostly float only -     |
+| look_at and perspective also take doubles. Many have _ct versions for        |
+| compile time, e.g.                                                           |
+|   constexpr mat4 P = perspective_ct (90.0f, 1.0f, 0.01f, 100.0f);            |
+| The _ct versions use series, not libm, so are slow if called per frame.      |
+| Default constructors set everything to zero.                                 |
 \******************************************************************************/
 #ifndef _MATHS_FUNCS_H_
 #define _MATHS_FUNCS_H_
 
+#include <stdio.h>
+
 // const used to convert degrees into radians
 #define TAU 2.0 * M_PI
 #define ONE_DEG_IN_RAD (2.0 * M_PI) / 360.0 // 0.017444444
 #define ONE_RAD_IN_DEG 360.0 / (2.0 * M_PI) //57.2957795
 
-struct vec2;
-struct vec3;
-struct vec4;
-struct versor;
+template <typename T> struct tvec2;
+template <typename T> struct tvec3;
+template <typename T> struct tvec4;
+template <typename T> struct tversor;
 
-struct vec2 {
-	vec2 ();
-	vec2 (float x, float y);
-	float v[2];
+template <typename T> struct tvec2 {
+	constexpr tvec2 () : v{ 0, 0 } {}
+	constexpr tvec2 (T x, T y) : v{ x, y } {}
+	T v[2];
 };
 
-struct vec3 {
-	vec3 ();
+template <typename T> struct tvec3 {
+	constexpr tvec3 () : v{ 0, 0, 0 } {}
 	// create from 3 scalars
-	vec3 (float x, float y, float z);
+	constexpr tvec3 (T x, T y, T z) : v{ x, y, z } {}
 	// create from vec2 and a scalar
-	vec3 (const vec2& vv, float z);
+	constexpr tvec3 (const tvec2<T>& vv, T z) : v{ vv.v[0], vv.v[1], z } {}
 	// create from truncated vec4
-	vec3 (const vec4& vv);
+	constexpr tvec3 (const tvec4<T>& vv) : v{ vv.v[0], vv.v[1], vv.v[2] } {}
 	// add vector to vector
-	vec3 operator+ (const vec3& rhs);
+	constexpr tvec3 operator+ (const tvec3& rhs) const {
+		return tvec3 (v[0] + rhs.v[0], v[1] + rhs.v[1], v[2] + rhs.v[2]);
+	}
 	// add scalar to vector
-	vec3 operator+ (float rhs);
+	constexpr tvec3 operator+ (T rhs) const {
+		return tvec3 (v[0] + rhs, v[1] + rhs, v[2] + rhs);
+	}
 	// because user's expect this too
-	vec3& operator+= (const vec3& rhs);
+	constexpr tvec3& operator+= (const tvec3& rhs) {
+		v[0] += rhs.v[0];
+		v[1] += rhs.v[1];
+		v[2] += rhs.v[2];
+		return *this;
+	}
 	// subtract vector from vector
-	vec3 operator- (const vec3& rhs);
-	// add vector to vector
-	vec3 operator- (float rhs);
+	constexpr tvec3 operator- (const tvec3& rhs) const {
+		return tvec3 (v[0] - rhs.v[0], v[1] - rhs.v[1], v[2] - rhs.v[2]);
+	}
+	// subtract scalar from vector
+	constexpr tvec3 operator- (T rhs) const {
+		return tvec3 (v[0] - rhs, v[1] - rhs, v[2] - rhs);
+	}
 	// because users expect this too
-	vec3& operator-= (const vec3& rhs);
+	constexpr tvec3& operator-= (const tvec3& rhs) {
+		v[0] -= rhs.v[0];
+		v[1] -= rhs.v[1];
+		v[2] -= rhs.v[2];
+		return *this;
+	}
 	// multiply with scalar
-	vec3 operator* (float rhs);
+	constexpr tvec3 operator* (T rhs) const {
+		return tvec3 (v[0] * rhs, v[1] * rhs, v[2] * rhs);
+	}
 	// because users expect this too
-	vec3& operator*= (float rhs);
+	constexpr tvec3& operator*= (T rhs) {
+		v[0] *= rhs;
+		v[1] *= rhs;
+		v[2] *= rhs;
+		return *this;
+	}
 	// divide vector by scalar
-	vec3 operator/ (float rhs);
-	// because users expect this too
-	vec3& operator= (const vec3& rhs);
-	
+	constexpr tvec3 operator/ (T rhs) const {
+		return tvec3 (v[0] / rhs, v[1] / rhs, v[2] / rhs);
+	}
+
 	// internal data
-	float v[3];
+	T v[3];
 };
 
-struct vec4 {
-	vec4 ();
-	vec4 (float x, float y, float z, float w);
-	vec4 (const vec2& vv, float z, float w);
-	vec4 (const vec3& vv, float w);
-	float v[4];
+template <typename T> struct tvec4 {
+	constexpr tvec4 () : v{ 0, 0, 0, 0 } {}
+	constexpr tvec4 (T x, T y, T z, T w) : v{ x, y, z, w } {}
+	constexpr tvec4 (const tvec2<T>& vv, T z, T w) :
+		v{ vv.v[0], vv.v[1], z, w } {}
+	constexpr tvec4 (const tvec3<T>& vv, T w) :
+		v{ vv.v[0], vv.v[1], vv.v[2], w } {}
+	T v[4];
 };
 
 /* stored like this:
 a d g
 b e h
 c f i */
-struct mat3 {
-	mat3 ();
-	mat3 (float a, float b, float c,
-				float d, float e, float f,
-				float g, float h, float i);
-	float m[9];
+template <typename T> struct tmat3 {
+	constexpr tmat3 () : m{ 0, 0, 0, 0, 0, 0, 0, 0, 0 } {}
+	constexpr tmat3 (T a, T b, T c,
+				T d, T e, T f,
+				T g, T h, T i) : m{ a, b, c, d, e, f, g, h, i } {}
+	T m[9];
 };
 
 /* stored like this:
@@ -90,67 +127,523 @@ struct mat3 {
 1 5 9  13
 2 6 10 14
 3 7 11 15*/
-struct mat4 {
-	mat4 ();
+template <typename T> struct tmat4 {
+	constexpr tmat4 () : m{ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 } {}
 	// note! this is entering components in ROW-major order
-	mat4 (float a, float b, float c, float d,
-				float e, float f, float g, float h,
-				float i, float j, float k, float l,
-				float mm, float n, float o, float p);
-	vec4 operator* (const vec4& rhs);
-	mat4 operator* (const mat4& rhs);
-	mat4& operator= (const mat4& rhs);
-	float m[16];
+	constexpr tmat4 (T a, T b, T c, T d,
+				T e, T f, T g, T h,
+				T i, T j, T k, T l,
+				T mm, T n, T o, T p) :
+		m{ a, b, c, d, e, f, g, h, i, j, k, l, mm, n, o, p } {}
+	constexpr tvec4<T> operator* (const tvec4<T>& rhs) const;
+	constexpr tmat4 operator* (const tmat4& rhs) const;
+	T m[16];
 };
 
-struct versor {
-	versor ();
-	versor operator/ (float rhs);
-	versor operator* (float rhs);
-	versor operator* (const versor& rhs);
-	versor operator+ (const versor& rhs);
-	float q[4];
+// the quaternion product is not constexpr as it re-normalises with sqrt
+template <typename T> struct tversor {
+	constexpr tversor () : q{ 0, 0, 0, 0 } {}
+	constexpr tversor operator/ (T rhs) const {
+		tversor result;
+		for (int i = 0; i < 4; i++) {
+			result.q[i] = q[i] / rhs;
+		}
+		return result;
+	}
+	constexpr tversor operator* (T rhs) const {
+		tversor result;
+		for (int i = 0; i < 4; i++) {
+			result.q[i] = q[i] * rhs;
+		}
+		return result;
+	}
+	T q[4];
 };
 
+typedef tvec2<float> vec2;
+typedef tvec3<float> vec3;
+typedef tvec4<float> vec4;
+typedef tmat3<float> mat3;
+typedef tmat4<float> mat4;
+typedef tversor<float> versor;
+typedef tvec2<double> dvec2;
+typedef tvec3<double> dvec3;
+typedef tvec4<double> dvec4;
+typedef tmat3<double> dmat3;
+typedef tmat4<double> dmat4;
+typedef tversor<double> dversor;
+
 void print (const vec2& v);
 void print (const vec3& v);
 void print (const vec4& v);
 void print (const mat3& m);
 void print (const mat4& m);
-// vector functions
+
+/*------------------------COMPILE-TIME SQRT AND TRIG--------------------------*/
+// good to double precision. done in double whatever T is
+constexpr double ct_pi = 3.14159265358979323846;
+
+// Newton's method from above, which only ever decreases until it converges
+constexpr double ct_sqrt (double x) {
+	if (x <= 0.0) {
+		return 0.0;
+	}
+	double r = x > 1.0 ? x : 1.0;
+	for (int i = 0; i < 1100; i++) {
+		double next = 0.5 * (r + x / r);
+		if (next >= r) {
+			break;
+		}
+		r = next;
+	}
+	return r;
+}
+
+// Taylor series after reducing to -pi/2..pi/2
+constexpr double ct_sin (double x) {
+	x = x - 2.0 * ct_pi * (double)(long long)(x / (2.0 * ct_pi));
+	if (x > ct_pi) {
+		x -= 2.0 * ct_pi;
+	} else if (x < -ct_pi) {
+		x += 2.0 * ct_pi;
+	}
+	if (x > 0.5 * ct_pi) {
+		x = ct_pi - x;
+	} else if (x < -0.5 * ct_pi) {
+		x = -ct_pi - x;
+	}
+	double term = x, sum = x;
+	for (int n = 1; n < 20; n++) {
+		term *= -x * x / (double)((2 * n) * (2 * n + 1));
+		sum += term;
+	}
+	return sum;
+}
+
+constexpr double ct_cos (double x) {
+	return ct_sin (x + 0.5 * ct_pi);
+}
+
+constexpr double ct_tan (double x) {
+	return ct_sin (x) / ct_cos (x);
+}
+
+/*------------------------------VECTOR FUNCTIONS------------------------------*/
+// runtime, float only
 float length (const vec3& v);
-float length2 (const vec3& v);
 vec3 normalise (const vec3& v);
-float dot (const vec3& a, const vec3& b);
-vec3 cross (const vec3& a, const vec3& b);
-float get_squared_dist (vec3 from, vec3 to);
 float direction_to_heading (vec3 d);
 vec3 heading_to_direction (float degrees);
-// matrix functions
-mat3 zero_mat3 ();
-mat3 identity_mat3 ();
-mat4 zero_mat4 ();
-mat4 identity_mat4 ();
-float determinant (const mat4& mm);
-mat4 inverse (const mat4& mm);
-mat4 transpose (const mat4& mm);
-// affine functions
-mat4 translate (const mat4& m, const vec3& v);
+
+// squared length
+template <typename T> constexpr T length2 (const tvec3<T>& v) {
+	return v.v[0] * v.v[0] + v.v[1] * v.v[1] + v.v[2] * v.v[2];
+}
+
+template <typename T> constexpr T dot (const tvec3<T>& a, const tvec3<T>& b) {
+	return a.v[0] * b.v[0] + a.v[1] * b.v[1] + a.v[2] * b.v[2];
+}
+
+template <typename T> constexpr tvec3<T> cross (const tvec3<T>& a,
+	const tvec3<T>& b) {
+	return tvec3<T> (
+		a.v[1] * b.v[2] - a.v[2] * b.v[1],
+		a.v[2] * b.v[0] - a.v[0] * b.v[2],
+		a.v[0] * b.v[1] - a.v[1] * b.v[0]
+	);
+}
+
+template <typename T> constexpr T get_squared_dist (const tvec3<T>& from,
+	const tvec3<T>& to) {
+	return length2 (to - from);
+}
+
+template <typename T> constexpr T length_ct (const tvec3<T>& v) {
+	return (T)ct_sqrt ((double)length2 (v));
+}
+
+template <typename T> constexpr tvec3<T> normalise_ct (const tvec3<T>& v) {
+	T l = length_ct (v);
+	if (0 == l) {
+		return tvec3<T> (0, 0, 0);
+	}
+	return v / l;
+}
+
+/*-----------------------------MATRIX FUNCTIONS-------------------------------*/
+// e.g. identity_mat4 () for a mat4 or identity_mat4<double> () for a dmat4
+template <typename T = float> constexpr tmat3<T> zero_mat3 () {
+	return tmat3<T> ();
+}
+
+template <typename T = float> constexpr tmat3<T> identity_mat3 () {
+	return tmat3<T> (
+		1, 0, 0,
+		0, 1, 0,
+		0, 0, 1
+	);
+}
+
+template <typename T = float> constexpr tmat4<T> zero_mat4 () {
+	return tmat4<T> ();
+}
+
+template <typename T = float> constexpr tmat4<T> identity_mat4 () {
+	return tmat4<T> (
+		1, 0, 0, 0,
+		0, 1, 0, 0,
+		0, 0, 1, 0,
+		0, 0, 0, 1
+	);
+}
+
+// out-parameter versions for per-frame code. these write into r rather than
+// building a temporary to return, and r may be one of the inputs. the
+// operators and value functions of the same name are wrappers around them
+template <typename T> constexpr void mult (const tmat4<T>& a,
+	const tmat4<T>& b, tmat4<T>& r) {
+	if (&r == &a || &r == &b) {
+		tmat4<T> t;
+		mult (a, b, t);
+		r = t;
+		return;
+	}
+	int r_index = 0;
+	for (int col = 0; col < 4; col++) {
+		for (int row = 0; row < 4; row++) {
+			T sum = 0;
+			for (int i = 0; i < 4; i++) {
+				sum += b.m[i + col * 4] * a.m[row + i * 4];
+			}
+			r.m[r_index] = sum;
+			r_index++;
+		}
+	}
+}
+
+template <typename T> constexpr void mult (const tmat4<T>& mm,
+	const tvec4<T>& v, tvec4<T>& r) {
+	const T* m = mm.m;
+	// 0x + 4y + 8z + 12w
+	T x = m[0] * v.v[0] + m[4] * v.v[1] + m[8] * v.v[2] + m[12] * v.v[3];
+	// 1x + 5y + 9z + 13w
+	T y = m[1] * v.v[0] + m[5] * v.v[1] + m[9] * v.v[2] + m[13] * v.v[3];
+	// 2x + 6y + 10z + 14w
+	T z = m[2] * v.v[0] + m[6] * v.v[1] + m[10] * v.v[2] + m[14] * v.v[3];
+	// 3x + 7y + 11z + 15w
+	T w = m[3] * v.v[0] + m[7] * v.v[1] + m[11] * v.v[2] + m[15] * v.v[3];
+	r.v[0] = x;
+	r.v[1] = y;
+	r.v[2] = z;
+	r.v[3] = w;
+}
+
+template <typename T>
+constexpr tvec4<T> tmat4<T>::operator* (const tvec4<T>& rhs) const {
+	tvec4<T> r;
+	mult (*this, rhs, r);
+	return r;
+}
+
+template <typename T>
+constexpr tmat4<T> tmat4<T>::operator* (const tmat4<T>& rhs) const {
+	tmat4<T> r;
+	mult (*this, rhs, r);
+	return r;
+}
+
+// returns a 16-element array flipped on the main diagonal
+template <typename T> constexpr tmat4<T> transpose (const tmat4<T>& mm) {
+	return tmat4<T> (
+		mm.m[0], mm.m[4], mm.m[8], mm.m[12],
+		mm.m[1], mm.m[5], mm.m[9], mm.m[13],
+		mm.m[2], mm.m[6], mm.m[10], mm.m[14],
+		mm.m[3], mm.m[7], mm.m[11], mm.m[15]
+	);
+}
+
+// returns a scalar value with the determinant for a 4x4 matrix
+// see http://www.euclideanspace.com/maths/algebra/matrix/functions/determinant/fourD/index.htm
+template <typename T> constexpr T determinant (const tmat4<T>& mm) {
+	return
+		mm.m[12] * mm.m[9] * mm.m[6] * mm.m[3] -
+		mm.m[8] * mm.m[13] * mm.m[6] * mm.m[3] -
+		mm.m[12] * mm.m[5] * mm.m[10] * mm.m[3] +
+		mm.m[4] * mm.m[13] * mm.m[10] * mm.m[3] +
+		mm.m[8] * mm.m[5] * mm.m[14] * mm.m[3] -
+		mm.m[4] * mm.m[9] * mm.m[14] * mm.m[3] -
+		mm.m[12] * mm.m[9] * mm.m[2] * mm.m[7] +
+		mm.m[8] * mm.m[13] * mm.m[2] * mm.m[7] +
+		mm.m[12] * mm.m[1] * mm.m[10] * mm.m[7] -
+		mm.m[0] * mm.m[13] * mm.m[10] * mm.m[7] -
+		mm.m[8] * mm.m[1] * mm.m[14] * mm.m[7] +
+		mm.m[0] * mm.m[9] * mm.m[14] * mm.m[7] +
+		mm.m[12] * mm.m[5] * mm.m[2] * mm.m[11] -
+		mm.m[4] * mm.m[13] * mm.m[2] * mm.m[11] -
+		mm.m[12] * mm.m[1] * mm.m[6] * mm.m[11] +
+		mm.m[0] * mm.m[13] * mm.m[6] * mm.m[11] +
+		mm.m[4] * mm.m[1] * mm.m[14] * mm.m[11] -
+		mm.m[0] * mm.m[5] * mm.m[14] * mm.m[11] -
+		mm.m[8] * mm.m[5] * mm.m[2] * mm.m[15] +
+		mm.m[4] * mm.m[9] * mm.m[2] * mm.m[15] +
+		mm.m[8] * mm.m[1] * mm.m[6] * mm.m[15] -
+		mm.m[0] * mm.m[9] * mm.m[6] * mm.m[15] -
+		mm.m[4] * mm.m[1] * mm.m[10] * mm.m[15] +
+		mm.m[0] * mm.m[5] * mm.m[10] * mm.m[15];
+}
+
+/* returns a 16-element array that is the inverse of a 16-element array (4x4
+matrix). see http://www.euclideanspace.com/maths/algebra/matrix/functions/inverse/fourD/index.htm */
+template <typename T> constexpr tmat4<T> inverse (const tmat4<T>& mm) {
+	T det = determinant (mm);
+	/* there is no inverse if determinant is zero (not likely unless scale is
+	broken) */
+	if (0 == det) {
+		fprintf (stderr, "WARNING. matrix has no determinant. can not invert\n");
+		return mm;
+	}
+	T inv_det = 1 / det;
+
+	return tmat4<T> (
+		inv_det * (
+			mm.m[9] * mm.m[14] * mm.m[7] - mm.m[13] * mm.m[10] * mm.m[7] +
+			mm.m[13] * mm.m[6] * mm.m[11] - mm.m[5] * mm.m[14] * mm.m[11] -
+			mm.m[9] * mm.m[6] * mm.m[15] + mm.m[5] * mm.m[10] * mm.m[15]
+		),
+		inv_det * (
+			mm.m[13] * mm.m[10] * mm.m[3] - mm.m[9] * mm.m[14] * mm.m[3] -
+			mm.m[13] * mm.m[2] * mm.m[11] + mm.m[1] * mm.m[14] * mm.m[11] +
+			mm.m[9] * mm.m[2] * mm.m[15] - mm.m[1] * mm.m[10] * mm.m[15]
+		),
+		inv_det * (
+			mm.m[5] * mm.m[14] * mm.m[3] - mm.m[13] * mm.m[6] * mm.m[3] +
+			mm.m[13] * mm.m[2] * mm.m[7] - mm.m[1] * mm.m[14] * mm.m[7] -
+			mm.m[5] * mm.m[2] * mm.m[15] + mm.m[1] * mm.m[6] * mm.m[15]
+		),
+		inv_det * (
+			mm.m[9] * mm.m[6] * mm.m[3] - mm.m[5] * mm.m[10] * mm.m[3] -
+			mm.m[9] * mm.m[2] * mm.m[7] + mm.m[1] * mm.m[10] * mm.m[7] +
+			mm.m[5] * mm.m[2] * mm.m[11] - mm.m[1] * mm.m[6] * mm.m[11]
+		),
+		inv_det * (
+			mm.m[12] * mm.m[10] * mm.m[7] - mm.m[8] * mm.m[14] * mm.m[7] -
+			mm.m[12] * mm.m[6] * mm.m[11] + mm.m[4] * mm.m[14] * mm.m[11] +
+			mm.m[8] * mm.m[6] * mm.m[15] - mm.m[4] * mm.m[10] * mm.m[15]
+		),
+		inv_det * (
+			mm.m[8] * mm.m[14] * mm.m[3] - mm.m[12] * mm.m[10] * mm.m[3] +
+			mm.m[12] * mm.m[2] * mm.m[11] - mm.m[0] * mm.m[14] * mm.m[11] -
+			mm.m[8] * mm.m[2] * mm.m[15] + mm.m[0] * mm.m[10] * mm.m[15]
+		),
+		inv_det * (
+			mm.m[12] * mm.m[6] * mm.m[3] - mm.m[4] * mm.m[14] * mm.m[3] -
+			mm.m[12] * mm.m[2] * mm.m[7] + mm.m[0] * mm.m[14] * mm.m[7] +
+			mm.m[4] * mm.m[2] * mm.m[15] - mm.m[0] * mm.m[6] * mm.m[15]
+		),
+		inv_det * (
+			mm.m[4] * mm.m[10] * mm.m[3] - mm.m[8] * mm.m[6] * mm.m[3] +
+			mm.m[8] * mm.m[2] * mm.m[7] - mm.m[0] * mm.m[10] * mm.m[7] -
+			mm.m[4] * mm.m[2] * mm.m[11] + mm.m[0] * mm.m[6] * mm.m[11]
+		),
+		inv_det * (
+			mm.m[8] * mm.m[13] * mm.m[7] - mm.m[12] * mm.m[9] * mm.m[7] +
+			mm.m[12] * mm.m[5] * mm.m[11] - mm.m[4] * mm.m[13] * mm.m[11] -
+			mm.m[8] * mm.m[5] * mm.m[15] + mm.m[4] * mm.m[9] * mm.m[15]
+		),
+		inv_det * (
+			mm.m[12] * mm.m[9] * mm.m[3] - mm.m[8] * mm.m[13] * mm.m[3] -
+			mm.m[12] * mm.m[1] * mm.m[11] + mm.m[0] * mm.m[13] * mm.m[11] +
+			mm.m[8] * mm.m[1] * mm.m[15] - mm.m[0] * mm.m[9] * mm.m[15]
+		),
+		inv_det * (
+			mm.m[4] * mm.m[13] * mm.m[3] - mm.m[12] * mm.m[5] * mm.m[3] +
+			mm.m[12] * mm.m[1] * mm.m[7] - mm.m[0] * mm.m[13] * mm.m[7] -
+			mm.m[4] * mm.m[1] * mm.m[15] + mm.m[0] * mm.m[5] * mm.m[15]
+		),
+		inv_det * (
+			mm.m[8] * mm.m[5] * mm.m[3] - mm.m[4] * mm.m[9] * mm.m[3] -
+			mm.m[8] * mm.m[1] * mm.m[7] + mm.m[0] * mm.m[9] * mm.m[7] +
+			mm.m[4] * mm.m[1] * mm.m[11] - mm.m[0] * mm.m[5] * mm.m[11]
+		),
+		inv_det * (
+			mm.m[12] * mm.m[9] * mm.m[6] - mm.m[8] * mm.m[13] * mm.m[6] -
+			mm.m[12] * mm.m[5] * mm.m[10] + mm.m[4] * mm.m[13] * mm.m[10] +
+			mm.m[8] * mm.m[5] * mm.m[14] - mm.m[4] * mm.m[9] * mm.m[14]
+		),
+		inv_det * (
+			mm.m[8] * mm.m[13] * mm.m[2] - mm.m[12] * mm.m[9] * mm.m[2] +
+			mm.m[12] * mm.m[1] * mm.m[10] - mm.m[0] * mm.m[13] * mm.m[10] -
+			mm.m[8] * mm.m[1] * mm.m[14] + mm.m[0] * mm.m[9] * mm.m[14]
+		),
+		inv_det * (
+			mm.m[12] * mm.m[5] * mm.m[2] - mm.m[4] * mm.m[13] * mm.m[2] -
+			mm.m[12] * mm.m[1] * mm.m[6] + mm.m[0] * mm.m[13] * mm.m[6] +
+			mm.m[4] * mm.m[1] * mm.m[14] - mm.m[0] * mm.m[5] * mm.m[14]
+		),
+		inv_det * (
+			mm.m[4] * mm.m[9] * mm.m[2] - mm.m[8] * mm.m[5] * mm.m[2] +
+			mm.m[8] * mm.m[1] * mm.m[6] - mm.m[0] * mm.m[9] * mm.m[6] -
+			mm.m[4] * mm.m[1] * mm.m[10] + mm.m[0] * mm.m[5] * mm.m[10]
+		)
+	);
+}
+
+/*--------------------------AFFINE MATRIX FUNCTIONS---------------------------*/
+// runtime, float only
 mat4 rotate_x_deg (const mat4& m, float deg);
 mat4 rotate_y_deg (const mat4& m, float deg);
 mat4 rotate_z_deg (const mat4& m, float deg);
-mat4 scale (const mat4& m, const vec3& v);
-// camera functions
+
+// sets r to a translation matrix, for model matrices that are only that.
+// saves translate (identity_mat4 (), v)'s identity and 4x4 multiply
+template <typename T> constexpr void translation (const tvec3<T>& v,
+	tmat4<T>& r) {
+	r = identity_mat4<T> ();
+	r.m[12] = v.v[0];
+	r.m[13] = v.v[1];
+	r.m[14] = v.v[2];
+}
+
+// translate a 4d matrix with xyz array
+template <typename T> constexpr tmat4<T> translate (const tmat4<T>& m,
+	const tvec3<T>& v) {
+	tmat4<T> m_t;
+	translation (v, m_t);
+	return m_t * m;
+}
+
+// scale a matrix by [x, y, z]
+template <typename T> constexpr tmat4<T> scale (const tmat4<T>& m,
+	const tvec3<T>& v) {
+	tmat4<T> a = identity_mat4<T> ();
+	a.m[0] = v.v[0];
+	a.m[5] = v.v[1];
+	a.m[10] = v.v[2];
+	return a * m;
+}
+
+/*-----------------------VIRTUAL CAMERA MATRIX FUNCTIONS----------------------*/
+// runtime, float and double
 mat4 look_at (const vec3& cam_pos, vec3 targ_pos, const vec3& up);
+dmat4 look_at (const dvec3& cam_pos, dvec3 targ_pos, const dvec3& up);
 mat4 perspective (float fovy, float aspect, float near, float far);
-// quaternion functions
+dmat4 perspective (double fovy, double aspect, double near, double far);
+
+// look_at () for constant cameras, e.g. the faces of a cube map
+template <typename T> constexpr tmat4<T> look_at_ct (const tvec3<T>& cam_pos,
+	const tvec3<T>& targ_pos, const tvec3<T>& up) {
+	// inverse translation
+	tmat4<T> p = translate (identity_mat4<T> (), cam_pos * -1);
+	// forward, right and real up vectors
+	tvec3<T> f = normalise_ct (targ_pos - cam_pos);
+	tvec3<T> r = normalise_ct (cross (f, up));
+	tvec3<T> u = normalise_ct (cross (r, f));
+	tmat4<T> ori = identity_mat4<T> ();
+	ori.m[0] = r.v[0];
+	ori.m[4] = r.v[1];
+	ori.m[8] = r.v[2];
+	ori.m[1] = u.v[0];
+	ori.m[5] = u.v[1];
+	ori.m[9] = u.v[2];
+	ori.m[2] = -f.v[0];
+	ori.m[6] = -f.v[1];
+	ori.m[10] = -f.v[2];
+	return ori * p;
+}
+
+// perspective () for constant projections
+template <typename T> constexpr tmat4<T> perspective_ct (T fovy, T aspect,
+	T near, T far) {
+	T range = (T)ct_tan (fovy * ct_pi / 360.0) * near;
+	tmat4<T> m; // make sure bottom-right corner is zero
+	m.m[0] = (2 * near) / (range * aspect + range * aspect);
+	m.m[5] = near / range;
+	m.m[10] = -(far + near) / (far - near);
+	m.m[14] = -(2 * far * near) / (far - near);
+	m.m[11] = -1;
+	return m;
+}
+
+/*----------------------------QUATERNION FUNCTIONS----------------------------*/
+// runtime, float only
+versor operator* (const versor& lhs, const versor& rhs);
+versor operator+ (const versor& lhs, const versor& rhs);
 versor quat_from_axis_rad (float radians, float x, float y, float z);
 versor quat_from_axis_deg (float degrees, float x, float y, float z);
-mat4 quat_to_mat4 (const versor& q);
-float dot (const versor& q, const versor& r);
 versor slerp (const versor& q, const versor& r);
 // stupid overloading wouldn't let me use const
 versor normalise (versor& q);
 void print (const versor& q);
 versor slerp (versor& q, versor& r, float t);
+void mult (const versor& a, const versor& b, versor& r);
+
+template <typename T> constexpr T dot (const tversor<T>& q,
+	const tversor<T>& r) {
+	return q.q[0] * r.q[0] + q.q[1] * r.q[1] + q.q[2] * r.q[2] + q.q[3] * r.q[3];
+}
+
+// axis should be normalised
+template <typename T> constexpr tversor<T> quat_from_axis_rad_ct (T radians,
+	T x, T y, T z) {
+	T s = (T)ct_sin (radians / 2.0);
+	tversor<T> result;
+	result.q[0] = (T)ct_cos (radians / 2.0);
+	result.q[1] = s * x;
+	result.q[2] = s * y;
+	result.q[3] = s * z;
+	return result;
+}
+
+template <typename T> constexpr tversor<T> quat_from_axis_deg_ct (T degrees,
+	T x, T y, T z) {
+	return quat_from_axis_rad_ct ((T)(degrees * ct_pi / 180.0), x, y, z);
+}
+
+template <typename T> constexpr void quat_to_mat4 (const tversor<T>& q,
+	tmat4<T>& r) {
+	T w = q.q[0];
+	T x = q.q[1];
+	T y = q.q[2];
+	T z = q.q[3];
+	r.m[0] = 1 - 2 * y * y - 2 * z * z;
+	r.m[1] = 2 * x * y + 2 * w * z;
+	r.m[2] = 2 * x * z - 2 * w * y;
+	r.m[3] = 0;
+	r.m[4] = 2 * x * y - 2 * w * z;
+	r.m[5] = 1 - 2 * x * x - 2 * z * z;
+	r.m[6] = 2 * y * z + 2 * w * x;
+	r.m[7] = 0;
+	r.m[8] = 2 * x * z + 2 * w * y;
+	r.m[9] = 2 * y * z - 2 * w * x;
+	r.m[10] = 1 - 2 * x * x - 2 * y * y;
+	r.m[11] = 0;
+	r.m[12] = 0;
+	r.m[13] = 0;
+	r.m[14] = 0;
+	r.m[15] = 1;
+}
+
+template <typename T> constexpr tmat4<T> quat_to_mat4 (const tversor<T>& q) {
+	tmat4<T> r;
+	quat_to_mat4 (q, r);
+	return r;
+}
+
+// view matrix for a camera with orientation q at pos. same as
+// inverse (quat_to_mat4 (q)) * inverse (translate (identity_mat4 (), pos))
+// but the inverse rotation is just that of the conjugate quaternion, and the
+// translation is -R^T * pos
+template <typename T> constexpr void view_from_quat_pos (const tversor<T>& q,
+	const tvec3<T>& pos, tmat4<T>& r) {
+	tversor<T> conj;
+	conj.q[0] = q.q[0];
+	conj.q[1] = -q.q[1];
+	conj.q[2] = -q.q[2];
+	conj.q[3] = -q.q[3];
+	quat_to_mat4 (conj, r);
+	T x = pos.v[0], y = pos.v[1], z = pos.v[2];
+	r.m[12] = -(r.m[0] * x + r.m[4] * y + r.m[8] * z);
+	r.m[13] = -(r.m[1] * x + r.m[5] * y + r.m[9] * z);
+	r.m[14] = -(r.m[2] * x + r.m[6] * y + r.m[10] * z);
+}
 #endif
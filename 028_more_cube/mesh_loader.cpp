@@ -0,0 +1,300 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries separate legal notices                              |
+|******************************************************************************|
+| Background mesh loading - see mesh_loader.h                                  |
+| Two single-producer single-consumer rings connect the threads: requests go   |
+| GL thread -> loader, parsed meshes go loader -> GL thread. Each ring's head  |
+| is only written by its producer and its tail only by its consumer, so they   |
+| need no lock, just acquire/release ordering on those two counters. The       |
+| loader thread naps for a millisecond when it has nothing to do.              |
+\******************************************************************************/
+#include "mesh_loader.h"
+#include "obj_parser.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#endif
+
+#define MESH_LOADER_MAX_PATH 1024
+
+struct Load_Request {
+	char file_name[MESH_LOADER_MAX_PATH];
+	Streamed_Mesh* mesh;
+};
+
+struct Parsed_Mesh {
+	Streamed_Mesh* mesh;
+	float* vp, *vt, *vn;
+	int point_count;
+	bool ok;
+};
+
+// head counts pushes, tail counts pops. both only ever go up
+struct Ring {
+	unsigned int head, tail;
+};
+
+static Load_Request g_requests[MESH_LOADER_QUEUE_LEN];
+static Parsed_Mesh g_parsed[MESH_LOADER_QUEUE_LEN];
+static Ring g_request_ring, g_parsed_ring;
+static int g_stop_loader;
+static bool g_loader_running;
+#ifdef _WIN32
+static HANDLE g_loader_thread;
+#else
+static pthread_t g_loader_thread;
+#endif
+
+// the mesh currently streaming into its VBOs, GL thread only
+static Parsed_Mesh g_uploading;
+static bool g_is_uploading;
+static size_t g_uploaded_bytes;
+
+/*-----------------------------------RINGS------------------------------------*/
+// producer side. slot to fill is head % MESH_LOADER_QUEUE_LEN
+static bool ring_can_push (Ring* ring) {
+	unsigned int head = __atomic_load_n (&ring->head, __ATOMIC_RELAXED);
+	unsigned int tail = __atomic_load_n (&ring->tail, __ATOMIC_ACQUIRE);
+	return head - tail < MESH_LOADER_QUEUE_LEN;
+}
+
+// publishes the slot just filled
+static void ring_push (Ring* ring) {
+	unsigned int head = __atomic_load_n (&ring->head, __ATOMIC_RELAXED);
+	__atomic_store_n (&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+// consumer side. slot to read is tail % MESH_LOADER_QUEUE_LEN
+static bool ring_can_pop (Ring* ring) {
+	unsigned int tail = __atomic_load_n (&ring->tail, __ATOMIC_RELAXED);
+	unsigned int head = __atomic_load_n (&ring->head, __ATOMIC_ACQUIRE);
+	return head != tail;
+}
+
+// hands the slot just read back to the producer
+static void ring_pop (Ring* ring) {
+	unsigned int tail = __atomic_load_n (&ring->tail, __ATOMIC_RELAXED);
+	__atomic_store_n (&ring->tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+static void free_parsed_mesh (Parsed_Mesh* parsed) {
+	free (parsed->vp);
+	free (parsed->vt);
+	free (parsed->vn);
+	parsed->vp = parsed->vt = parsed->vn = NULL;
+}
+
+/*-------------------------------LOADER THREAD--------------------------------*/
+static void nap () {
+#ifdef _WIN32
+	Sleep (1);
+#else
+	struct timespec ts = { 0, 1000000 };
+	nanosleep (&ts, NULL);
+#endif
+}
+
+static bool should_stop () {
+	return 0 != __atomic_load_n (&g_stop_loader, __ATOMIC_ACQUIRE);
+}
+
+static void loader_main () {
+	while (!should_stop ()) {
+		if (!ring_can_pop (&g_request_ring)) {
+			nap ();
+			continue;
+		}
+		Load_Request* req =
+			&g_requests[g_request_ring.tail % MESH_LOADER_QUEUE_LEN];
+		Parsed_Mesh parsed;
+		memset (&parsed, 0, sizeof (Parsed_Mesh));
+		parsed.mesh = req->mesh;
+		parsed.ok = load_obj_file (req->file_name, parsed.vp, parsed.vt,
+			parsed.vn, parsed.point_count);
+		if (!parsed.ok) {
+			free_parsed_mesh (&parsed);
+		}
+		ring_pop (&g_request_ring);
+		// the GL thread only frees up slots as it uploads, so wait for one
+		while (!ring_can_push (&g_parsed_ring)) {
+			if (should_stop ()) {
+				free_parsed_mesh (&parsed);
+				return;
+			}
+			nap ();
+		}
+		g_parsed[g_parsed_ring.head % MESH_LOADER_QUEUE_LEN] = parsed;
+		ring_push (&g_parsed_ring);
+	}
+}
+
+#ifdef _WIN32
+static DWORD WINAPI loader_thread_func (LPVOID arg) {
+	(void)arg;
+	loader_main ();
+	return 0;
+}
+#else
+static void* loader_thread_func (void* arg) {
+	(void)arg;
+	loader_main ();
+	return NULL;
+}
+#endif
+
+bool start_mesh_loader () {
+	if (g_loader_running) {
+		return true;
+	}
+	__atomic_store_n (&g_stop_loader, 0, __ATOMIC_RELEASE);
+#ifdef _WIN32
+	g_loader_thread = CreateThread (NULL, 0, loader_thread_func, NULL, 0, NULL);
+	g_loader_running = NULL != g_loader_thread;
+#else
+	g_loader_running =
+		0 == pthread_create (&g_loader_thread, NULL, loader_thread_func, NULL);
+#endif
+	if (!g_loader_running) {
+		fprintf (stderr, "ERROR: could not start mesh loader thread\n");
+	}
+	return g_loader_running;
+}
+
+void stop_mesh_loader () {
+	if (!g_loader_running) {
+		return;
+	}
+	__atomic_store_n (&g_stop_loader, 1, __ATOMIC_RELEASE);
+#ifdef _WIN32
+	WaitForSingleObject (g_loader_thread, INFINITE);
+	CloseHandle (g_loader_thread);
+#else
+	pthread_join (g_loader_thread, NULL);
+#endif
+	g_loader_running = false;
+	// thread has gone so nothing else touches the rings now
+	while (ring_can_pop (&g_parsed_ring)) {
+		free_parsed_mesh (&g_parsed[g_parsed_ring.tail % MESH_LOADER_QUEUE_LEN]);
+		ring_pop (&g_parsed_ring);
+	}
+	while (ring_can_pop (&g_request_ring)) {
+		ring_pop (&g_request_ring);
+	}
+	if (g_is_uploading) {
+		free_parsed_mesh (&g_uploading);
+		g_is_uploading = false;
+	}
+}
+
+bool queue_mesh_load (const char* file_name, Streamed_Mesh* mesh) {
+	if (strlen (file_name) >= MESH_LOADER_MAX_PATH) {
+		fprintf (stderr, "ERROR: mesh file name too long %s\n", file_name);
+		return false;
+	}
+	if (!ring_can_push (&g_request_ring)) {
+		fprintf (stderr, "ERROR: mesh load queue full - %s not queued\n",
+			file_name);
+		return false;
+	}
+	memset (mesh, 0, sizeof (Streamed_Mesh));
+	Load_Request* req = &g_requests[g_request_ring.head % MESH_LOADER_QUEUE_LEN];
+	strcpy (req->file_name, file_name);
+	req->mesh = mesh;
+	ring_push (&g_request_ring);
+	return true;
+}
+
+/*----------------------------------UPLOADS-----------------------------------*/
+static GLuint create_attrib_vbo (GLuint loc, int comps, size_t bytes) {
+	GLuint vbo;
+	glGenBuffers (1, &vbo);
+	glBindBuffer (GL_ARRAY_BUFFER, vbo);
+	glBufferData (GL_ARRAY_BUFFER, bytes, NULL, GL_STATIC_DRAW);
+	glVertexAttribPointer (loc, comps, GL_FLOAT, GL_FALSE, 0, NULL);
+	glEnableVertexAttribArray (loc);
+	return vbo;
+}
+
+// allocates the buffers at full size. data goes in over the following frames
+static void begin_upload (Parsed_Mesh* parsed) {
+	Streamed_Mesh* mesh = parsed->mesh;
+	size_t n = (size_t)parsed->point_count;
+	glGenVertexArrays (1, &mesh->vao);
+	glBindVertexArray (mesh->vao);
+	mesh->points_vbo = create_attrib_vbo (0, 3, n * 3 * sizeof (GLfloat));
+	mesh->normals_vbo = create_attrib_vbo (1, 3, n * 3 * sizeof (GLfloat));
+	mesh->tex_coords_vbo = create_attrib_vbo (2, 2, n * 2 * sizeof (GLfloat));
+	glBindVertexArray (0);
+	mesh->point_count = parsed->point_count;
+}
+
+/* copies the next max_bytes of the mesh, walking points then normals then
+   tex coords as if they were one long array */
+static size_t continue_upload (Parsed_Mesh* parsed, size_t max_bytes,
+	bool* done) {
+	size_t n = (size_t)parsed->point_count;
+	GLuint vbos[3] = {
+		parsed->mesh->points_vbo, parsed->mesh->normals_vbo,
+		parsed->mesh->tex_coords_vbo
+	};
+	const float* arrays[3] = { parsed->vp, parsed->vn, parsed->vt };
+	size_t sizes[3] = {
+		n * 3 * sizeof (GLfloat), n * 3 * sizeof (GLfloat), n * 2 * sizeof (GLfloat)
+	};
+	size_t copied = 0, start = 0;
+	for (int i = 0; i < 3; i++) {
+		size_t end = start + sizes[i];
+		if (g_uploaded_bytes < end && copied < max_bytes) {
+			size_t offset = g_uploaded_bytes - start;
+			size_t count = end - g_uploaded_bytes;
+			if (count > max_bytes - copied) {
+				count = max_bytes - copied;
+			}
+			glBindBuffer (GL_ARRAY_BUFFER, vbos[i]);
+			glBufferSubData (GL_ARRAY_BUFFER, offset, count,
+				(const char*)arrays[i] + offset);
+			g_uploaded_bytes += count;
+			copied += count;
+		}
+		start = end;
+	}
+	*done = g_uploaded_bytes >= start;
+	return copied;
+}
+
+size_t update_mesh_uploads (size_t max_bytes) {
+	size_t copied = 0;
+	while (copied < max_bytes) {
+		if (!g_is_uploading) {
+			if (!ring_can_pop (&g_parsed_ring)) {
+				break;
+			}
+			g_uploading = g_parsed[g_parsed_ring.tail % MESH_LOADER_QUEUE_LEN];
+			ring_pop (&g_parsed_ring);
+			if (!g_uploading.ok) {
+				g_uploading.mesh->failed = true;
+				continue;
+			}
+			begin_upload (&g_uploading);
+			g_is_uploading = true;
+			g_uploaded_bytes = 0;
+		}
+		bool done = false;
+		copied += continue_upload (&g_uploading, max_bytes - copied, &done);
+		if (done) {
+			g_uploading.mesh->ready = true;
+			free_parsed_mesh (&g_uploading);
+			g_is_uploading = false;
+		}
+	}
+	return copied;
+}
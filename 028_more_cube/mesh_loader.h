@@ -0,0 +1,49 @@
+/******************************************************************************\
+| OpenGL 4 Example Code.                                                       |
+| Accompanies written series "Anton's OpenGL 4 Tutorials"                      |
+| Email: anton at antongerdelan dot net                                        |
+| Copyright Dr Anton Gerdelan, Trinity College Dublin, Ireland.                |
+| See individual libraries separate legal notices                              |
+|******************************************************************************|
+| Background mesh loading. A loader thread parses .obj files with              |
+| load_obj_file() and posts the finished CPU arrays to a lock-free queue. The  |
+| render loop calls update_mesh_uploads() once a frame, which drains that      |
+| queue into VBOs but never copies more than a given number of bytes per call, |
+| so a big mesh streams in over several frames instead of stalling one.        |
+| The first frame can be drawn straight away - just skip meshes that aren't    |
+| ready yet.                                                                   |
+\******************************************************************************/
+#ifndef _MESH_LOADER_H_
+#define _MESH_LOADER_H_
+
+#include <GL/glew.h> // include GLEW and new version of GL on Windows
+
+// max meshes waiting to be parsed, and parsed meshes waiting for upload
+#define MESH_LOADER_QUEUE_LEN 64
+
+/* a mesh being streamed in. owned by the caller and must stay put (not be
+   copied or freed) until it is ready or the loader is stopped. attributes are
+   points at location 0, normals at 1, texture coordinates at 2 */
+struct Streamed_Mesh {
+	GLuint vao, points_vbo, normals_vbo, tex_coords_vbo;
+	int point_count;
+	bool ready; // every byte uploaded - safe to draw
+	bool failed; // file didn't load - it will never be ready
+};
+
+/* starts the loader thread. queue meshes any time after this */
+bool start_mesh_loader ();
+/* waits for the thread to finish its current file, then frees anything parsed
+   but not yet uploaded. call before the GL context goes */
+void stop_mesh_loader ();
+
+/* asks the loader thread to parse a file into mesh. returns false if the
+   request queue is full */
+bool queue_mesh_load (const char* file_name, Streamed_Mesh* mesh);
+
+/* call once per frame on the GL thread. uploads up to max_bytes of parsed
+   vertex data, finishing one mesh before starting the next. returns the
+   number of bytes copied */
+size_t update_mesh_uploads (size_t max_bytes);
+
+#endif
@@ -2,20 +2,24 @@
 #include "stb/stb_image.h"
 #include "camera.h"
 #include "mesh.h"
+#include "weld.h"
 #include "text.h"
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <assert.h>
 #define VP_WIDTH 1136
 #define VP_HEIGHT 640
+// positions closer than this (model units) become one vertex
+#define WELD_EPSILON 1e-5f
 
 GLFWwindow* g_win;
 GLuint g_vao_tri;
 GLuint g_shadprog;
 GLuint g_tex_cube;
 GLint P_loc, V_loc, M_loc;
-Mesh g_mesh;
+int g_mesh_icount;
 mat4 g_globe_M;
 float g_globe_yrot;
 Font g_font;
@@ -101,16 +105,35 @@ void init_geom() {
 		-10.0f, -10.0f,  10.0f,
 		 10.0f, -10.0f,  10.0f
 	};*/
-	g_mesh = load_ascii_stl ("meshes/sphere.stl");
-	GLuint vbo = 0;
-	glGenBuffers (1, &vbo);
-	glBindBuffer (GL_ARRAY_BUFFER, vbo);
-	glBufferData (GL_ARRAY_BUFFER, g_mesh.vcount * 3 * sizeof (float), g_mesh.vps, GL_STATIC_DRAW);
+	Mesh soup;
+	Indexed_Mesh mesh;
+	assert(load_stl("meshes/sphere.stl", &soup));
+	// STL repeats every corner for every triangle. weld them for ~6x fewer
+	// vertices, which also gives us shared vertices to smooth normals over
+	assert(weld_mesh(&soup, WELD_EPSILON, &mesh));
+	free_mesh(&soup);
+	assert(compute_smooth_normals(&mesh));
+	GLuint vbos[2], ibo = 0;
+	glGenBuffers (2, vbos);
+	glBindBuffer (GL_ARRAY_BUFFER, vbos[0]);
+	glBufferData (GL_ARRAY_BUFFER, (size_t)mesh.vcount * 3 * sizeof (float), mesh.vps, GL_STATIC_DRAW);
+	glBindBuffer (GL_ARRAY_BUFFER, vbos[1]);
+	glBufferData (GL_ARRAY_BUFFER, (size_t)mesh.vcount * 3 * sizeof (float), mesh.vns, GL_STATIC_DRAW);
 	glGenVertexArrays (1, &g_vao_tri);
 	glBindVertexArray (g_vao_tri);
 	glEnableVertexAttribArray (0);
-	glBindBuffer (GL_ARRAY_BUFFER, vbo);
+	glBindBuffer (GL_ARRAY_BUFFER, vbos[0]);
 	glVertexAttribPointer (0, 3, GL_FLOAT, GL_FALSE, 0, NULL);
+	glEnableVertexAttribArray (1);
+	glBindBuffer (GL_ARRAY_BUFFER, vbos[1]);
+	glVertexAttribPointer (1, 3, GL_FLOAT, GL_FALSE, 0, NULL);
+	glGenBuffers (1, &ibo);
+	glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, ibo); // VAO remembers this
+	glBufferData (GL_ELEMENT_ARRAY_BUFFER, (size_t)mesh.icount * sizeof (unsigned int), mesh.indices, GL_STATIC_DRAW);
+	glBindVertexArray (0);
+	// GL has its own copy now - no need to hold a big scan in memory twice
+	g_mesh_icount = mesh.icount;
+	free_indexed_mesh(&mesh);
 }
 
 void compile_shader(GLuint shdr_idx){
@@ -145,20 +168,27 @@ void init_shaders() {
 	const char* vertex_shader =
 		"#version 300 es\n"
 		"in vec3 vp;"
+		"in vec3 vn;"
 		"uniform mat4 P, V, M;"
-		"out vec3 texcoords;"
+		"out vec3 texcoords, normal;"
 		"void main(){"
 		"  texcoords = vec3(vp.x, vp.y, vp.z);"
+		// M has no non-uniform scale, so it can turn normals as it is
+		"  normal = mat3(M) * vn;"
 		"  gl_Position = P * V * M * vec4(vp * 0.1, 1.0);"
 		"}";
 	const char* fragment_shader =
 		"#version 300 es\n"
 		"precision mediump float;" // need this
-		"in vec3 texcoords;"
+		"in vec3 texcoords, normal;"
 		"uniform samplerCube cube_texture;"
 		"out vec4 frag_colour;"
 		"void main(){"
-		"  frag_colour = texture(cube_texture, texcoords);"
+		// the welded, smoothed normals give a soft diffuse shade over the map
+		"  vec3 l = normalize(vec3(0.3, 1.0, 0.5));"
+		"  float lit = 0.4 + 0.6 * max(dot(normalize(normal), l), 0.0);"
+		"  vec4 texel = texture(cube_texture, texcoords);"
+		"  frag_colour = vec4(texel.rgb * lit, texel.a);"
 		"}";
 	GLuint vs = glCreateShader(GL_VERTEX_SHADER);
 	glShaderSource(vs, 1, &vertex_shader, NULL);
@@ -169,6 +199,8 @@ void init_shaders() {
 	g_shadprog = glCreateProgram();
 	glAttachShader(g_shadprog, fs);
 	glAttachShader(g_shadprog, vs);
+	glBindAttribLocation(g_shadprog, 0, "vp");
+	glBindAttribLocation(g_shadprog, 1, "vn");
 	link_program(g_shadprog);
 	P_loc = glGetUniformLocation(g_shadprog, "P");
 	assert(P_loc > -1);
@@ -186,7 +218,7 @@ void draw_scene(Camera cam){
 	glBindVertexArray (g_vao_tri);
 	glActiveTexture (GL_TEXTURE0);
 	glBindTexture (GL_TEXTURE_CUBE_MAP, g_tex_cube);
-	glDrawArrays (GL_TRIANGLES, 0, g_mesh.vcount);
+	glDrawElements (GL_TRIANGLES, g_mesh_icount, GL_UNSIGNED_INT, NULL);
 	{
 		glActiveTexture (GL_TEXTURE0);
 		glBindTexture (GL_TEXTURE_2D, g_font.texture);
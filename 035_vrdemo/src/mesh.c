@@ -1,25 +1,206 @@
+// binary STL is an 80 byte header, a uint32 triangle count, then 50 byte
+// records: normal, 3 vertices (12 floats, little-endian) and a 2 byte
+// attribute. the file is mapped rather than read so a big scan only costs the
+// one copy out of the unaligned 50 byte records into a tight GL-ready array
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
 #include "mesh.h"
+#include "apg_parse.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <assert.h>
+#include <stdint.h>
 #include <string.h>
+#include <limits.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
-Mesh load_ascii_stl(const char* fn){
-	assert(fn);
-	Mesh mesh;
-	printf("loading STL mesh %s\n", fn);
-	FILE* fp = fopen(fn, "r");
-	assert(fp);
-	char line[1024];
-	while(fgets(line, 1024, fp)){
-		if (strncmp(line, "vertex", 6) == 0){
-			assert ((mesh.vcount * 3 + 3) < MAX_MESH_COMPS);
-			sscanf(line, "vertex %f %f %f",
-				&mesh.vps[mesh.vcount * 3],
-				&mesh.vps[mesh.vcount * 3 + 1],
-				&mesh.vps[mesh.vcount * 3 + 2]);
-			mesh.vcount ++;
-		}
+#define STL_HEADER_BYTES 84
+#define STL_RECORD_BYTES 50
+
+typedef struct Mapped_File{
+	const char* data;
+	size_t size;
+} Mapped_File;
+
+static bool map_file(const char* fn, Mapped_File* mf){
+	memset(mf, 0, sizeof(Mapped_File));
+#ifdef _WIN32
+	// no mmap here so just read the whole thing in
+	FILE* fp = fopen(fn, "rb");
+	if (!fp){
+		return false;
+	}
+	fseek(fp, 0, SEEK_END);
+	long sz = ftell(fp);
+	rewind(fp);
+	char* buf = sz > 0 ? (char*)malloc((size_t)sz) : NULL;
+	if (!buf || fread(buf, 1, (size_t)sz, fp) != (size_t)sz){
+		free(buf);
+		fclose(fp);
+		return false;
 	}
 	fclose(fp);
-	return mesh;
+	mf->data = buf;
+	mf->size = (size_t)sz;
+#else
+	int fd = open(fn, O_RDONLY);
+	if (fd < 0){
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size <= 0){
+		close(fd);
+		return false;
+	}
+	void* ptr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); // mapping stays valid
+	if (ptr == MAP_FAILED){
+		return false;
+	}
+	posix_madvise(ptr, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+	mf->data = (const char*)ptr;
+	mf->size = (size_t)st.st_size;
+#endif
+	return true;
+}
+
+static void unmap_file(Mapped_File* mf){
+#ifdef _WIN32
+	free((void*)mf->data);
+#else
+	munmap((void*)mf->data, mf->size);
+#endif
+	mf->data = NULL;
+	mf->size = 0;
+}
+
+static uint32_t read_u32_le(const char* p){
+	const unsigned char* u = (const unsigned char*)p;
+	return (uint32_t)u[0] | ((uint32_t)u[1] << 8) | ((uint32_t)u[2] << 16) |
+		((uint32_t)u[3] << 24);
+}
+
+// triangle count if the file is exactly the size a binary STL says it is.
+// ASCII is the fallback because some binary exporters also start with "solid"
+static bool is_binary_stl(const Mapped_File* mf, uint32_t* ntris){
+	if (mf->size < STL_HEADER_BYTES){
+		return false;
+	}
+	*ntris = read_u32_le(mf->data + 80);
+	uint64_t expected =
+		STL_HEADER_BYTES + (uint64_t)*ntris * STL_RECORD_BYTES;
+	return expected == (uint64_t)mf->size;
+}
+
+static bool load_binary_stl(const Mapped_File* mf, uint32_t ntris, Mesh* mesh){
+	if (ntris > (uint32_t)(INT_MAX / 3)){
+		fprintf(stderr, "ERROR: too many triangles in STL (%u)\n", ntris);
+		return false;
+	}
+	mesh->vcount = (int)ntris * 3;
+	mesh->vps = (float*)malloc((size_t)ntris * 9 * sizeof(float));
+	if (!mesh->vps && ntris > 0){
+		fprintf(stderr, "ERROR: out of memory for %u STL triangles\n", ntris);
+		return false;
+	}
+	// assumes a little-endian host, which is everything we build for
+	const char* rec = mf->data + STL_HEADER_BYTES;
+	float* dst = mesh->vps;
+	for (uint32_t i = 0; i < ntris; i++){
+		memcpy(dst, rec + 12, 9 * sizeof(float)); // skip the facet normal
+		dst += 9;
+		rec += STL_RECORD_BYTES;
+	}
+	return true;
+}
+
+static bool load_ascii_stl(const Mapped_File* mf, Mesh* mesh){
+	const char* str = mf->data;
+	const char* end = mf->data + mf->size;
+	// about 3 vertex lines per 250 bytes of a typical export; grow if not
+	size_t cap = mf->size / 80 + 9;
+	size_t nfloats = 0;
+	mesh->vps = (float*)malloc(cap * sizeof(float));
+	if (!mesh->vps){
+		fprintf(stderr, "ERROR: out of memory loading ASCII STL\n");
+		return false;
+	}
+	while (str < end){
+		const char* p = apg_skip_spaces(str, end);
+		str = apg_next_line(p, end);
+		if (end - p < 6 || strncmp(p, "vertex", 6) != 0){
+			continue;
+		}
+		if (nfloats + 3 > cap){
+			if (cap > (size_t)INT_MAX){
+				fprintf(stderr, "ERROR: too many vertices in STL\n");
+				return false;
+			}
+			cap *= 2;
+			float* grown = (float*)realloc(mesh->vps, cap * sizeof(float));
+			if (!grown){
+				fprintf(stderr, "ERROR: out of memory loading ASCII STL\n");
+				return false;
+			}
+			mesh->vps = grown;
+		}
+		p += 6;
+		for (int i = 0; i < 3; i++){
+			const char* next = apg_parse_float(p, str, &mesh->vps[nfloats + i]);
+			if (next == p){
+				fprintf(stderr, "ERROR: STL vertex %i has fewer than 3 coordinates\n",
+					(int)(nfloats / 3));
+				return false;
+			}
+			p = next;
+		}
+		nfloats += 3;
+	}
+	// a truncated binary STL whose header starts "solid" ends up here too
+	if (0 == nfloats){
+		fprintf(stderr,
+			"ERROR: no triangles in ASCII STL. truncated binary file?\n");
+		return false;
+	}
+	mesh->vcount = (int)(nfloats / 3);
+	return true;
+}
+
+bool load_stl(const char* fn, Mesh* mesh){
+	assert(fn && mesh);
+	memset(mesh, 0, sizeof(Mesh));
+	printf("loading STL mesh %s\n", fn);
+	Mapped_File mf;
+	if (!map_file(fn, &mf)){
+		fprintf(stderr, "ERROR: could not open STL file %s\n", fn);
+		return false;
+	}
+	uint32_t ntris = 0;
+	bool ok = false;
+	if (is_binary_stl(&mf, &ntris)){
+		ok = load_binary_stl(&mf, ntris, mesh);
+	} else if (mf.size >= 5 && strncmp(mf.data, "solid", 5) == 0){
+		ok = load_ascii_stl(&mf, mesh);
+	} else {
+		fprintf(stderr, "ERROR: %s is not a binary or ASCII STL file\n", fn);
+	}
+	unmap_file(&mf);
+	if (!ok){
+		free_mesh(mesh);
+		return false;
+	}
+	printf("  %i vertices\n", mesh->vcount);
+	return true;
+}
+
+void free_mesh(Mesh* mesh){
+	free(mesh->vps);
+	mesh->vps = NULL;
+	mesh->vcount = 0;
 }
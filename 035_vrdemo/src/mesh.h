@@ -1,11 +1,12 @@
 #pragma once
-
 #include <stdbool.h>
-#define MAX_MESH_COMPS 10000
 
+// triangle soup - every 3 vertices is a triangle. vps is heap-owned
 typedef struct Mesh{
-	float vps[MAX_MESH_COMPS];
+	float* vps;
 	int vcount;
 } Mesh;
 
-Mesh load_ascii_stl(const char* fn);
+// loads binary STL, or ASCII STL if the file isn't a valid binary one
+bool load_stl(const char* fn, Mesh* mesh);
+void free_mesh(Mesh* mesh);
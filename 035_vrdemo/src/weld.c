@@ -0,0 +1,324 @@
+// welding: positions are bucketed into a hash of grid cells. a vertex can only
+// be within epsilon of a vertex in a neighbouring cell, so each lookup walks a
+// handful of short bucket chains instead of comparing against everything.
+// normals: face normals are computed per triangle, then each vertex sums its
+// faces through a vertex->triangle table. each thread owns a range of vertices
+// so there are no write races and the result is the same on any core count
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+#include "weld.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#define WELD_MAX_THREADS 32
+// below this many items a thread costs more than it saves
+#define WELD_MIN_ITEMS_PER_THREAD 16384
+
+/*--------------------------------- WELDING ----------------------------------*/
+static uint32_t hash_cell(int64_t x, int64_t y, int64_t z){
+	uint64_t h = (uint64_t)x * 0x9E3779B97F4A7C15ULL;
+	h ^= (uint64_t)y * 0xC2B2AE3D27D4EB4FULL;
+	h ^= (uint64_t)z * 0x165667B19E3779F9ULL;
+	return (uint32_t)(h ^ (h >> 29));
+}
+
+// exact mode hashes the bit patterns, with -0 folded into 0
+static int64_t float_key(float f){
+	uint32_t u;
+	if (f == 0.0f){
+		f = 0.0f;
+	}
+	memcpy(&u, &f, sizeof(u));
+	return (int64_t)u;
+}
+
+bool weld_mesh(const Mesh* soup, float epsilon, Indexed_Mesh* mesh){
+	assert(soup && mesh && epsilon >= 0.0f);
+	memset(mesh, 0, sizeof(Indexed_Mesh));
+	int n = soup->vcount;
+	size_t nbuckets = 1;
+	// soups usually weld about 6:1, so this is still ~3 buckets per vertex
+	while (nbuckets < (size_t)n / 2){
+		nbuckets <<= 1;
+	}
+	uint32_t mask = (uint32_t)(nbuckets - 1);
+	int* buckets = (int*)malloc(nbuckets * sizeof(int));
+	int* next = (int*)malloc(((size_t)n + 1) * sizeof(int));
+	int* remap = (int*)malloc(((size_t)n + 1) * sizeof(int));
+	mesh->vps = (float*)malloc(((size_t)n + 1) * 3 * sizeof(float));
+	mesh->indices = (unsigned int*)malloc(((size_t)n + 1) * sizeof(unsigned int));
+	if (!buckets || !next || !remap || !mesh->vps || !mesh->indices){
+		fprintf(stderr, "ERROR: out of memory welding %i vertices\n", n);
+		free(buckets);
+		free(next);
+		free(remap);
+		free_indexed_mesh(mesh);
+		return false;
+	}
+	memset(buckets, 0xFF, nbuckets * sizeof(int)); // all -1
+	bool exact = epsilon == 0.0f;
+	// cells are 2 epsilon wide, so a match can only be in this cell or the
+	// neighbour on the near side of each axis - 8 cells to look in, not 27
+	float inv_cell = exact ? 0.0f : 0.5f / epsilon;
+	float eps_sq = epsilon * epsilon;
+	int nunique = 0;
+	for (int i = 0; i < n; i++){
+		const float* p = &soup->vps[i * 3];
+		int64_t cell[3], near[3];
+		for (int c = 0; c < 3; c++){
+			if (exact){
+				cell[c] = near[c] = float_key(p[c]);
+			} else {
+				float f = floorf(p[c] * inv_cell);
+				cell[c] = (int64_t)f;
+				near[c] = p[c] * inv_cell - f < 0.5f ? cell[c] - 1 : cell[c] + 1;
+			}
+		}
+		int found = -1;
+		for (int k = 0; k < 8 && found < 0; k++){
+			int64_t x = k & 1 ? near[0] : cell[0];
+			int64_t y = k & 2 ? near[1] : cell[1];
+			int64_t z = k & 4 ? near[2] : cell[2];
+			if (exact && k > 0){
+				break;
+			}
+			uint32_t b = hash_cell(x, y, z) & mask;
+			// other cells can share the bucket, the distance test sorts that out
+			for (int u = buckets[b]; u >= 0; u = next[u]){
+				const float* q = &mesh->vps[u * 3];
+				float dx = p[0] - q[0], dy = p[1] - q[1], dz = p[2] - q[2];
+				if (dx * dx + dy * dy + dz * dz <= eps_sq){
+					found = u;
+					break;
+				}
+			}
+		}
+		if (found < 0){
+			found = nunique++;
+			memcpy(&mesh->vps[found * 3], p, 3 * sizeof(float));
+			uint32_t b = hash_cell(cell[0], cell[1], cell[2]) & mask;
+			next[found] = buckets[b];
+			buckets[b] = found;
+		}
+		remap[i] = found;
+	}
+	// drop triangles that welded down to a line or a point
+	for (int t = 0; t + 2 < n; t += 3){
+		int a = remap[t], b = remap[t + 1], c = remap[t + 2];
+		if (a == b || b == c || c == a){
+			continue;
+		}
+		mesh->indices[mesh->icount++] = (unsigned int)a;
+		mesh->indices[mesh->icount++] = (unsigned int)b;
+		mesh->indices[mesh->icount++] = (unsigned int)c;
+	}
+	mesh->vcount = nunique;
+	free(buckets);
+	free(next);
+	free(remap);
+	// give back the slack - on big soups the unique set is a fraction of it
+	float* vps = (float*)realloc(mesh->vps, ((size_t)nunique + 1) * 3 * sizeof(float));
+	unsigned int* indices = (unsigned int*)realloc(mesh->indices,
+		((size_t)mesh->icount + 1) * sizeof(unsigned int));
+	if (vps){
+		mesh->vps = vps;
+	}
+	if (indices){
+		mesh->indices = indices;
+	}
+	printf("  welded %i vertices to %i, %i triangles\n", n, nunique, mesh->icount / 3);
+	return true;
+}
+
+/*--------------------------------- THREADS ----------------------------------*/
+typedef void (*Range_Func)(void* ctx, int first, int last);
+
+typedef struct Range_Job{
+	Range_Func func;
+	void* ctx;
+	int first, last;
+} Range_Job;
+
+static int count_cpus(){
+#ifdef _WIN32
+	SYSTEM_INFO si;
+	GetSystemInfo(&si);
+	return (int)si.dwNumberOfProcessors;
+#else
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0 ? (int)n : 1;
+#endif
+}
+
+#ifdef _WIN32
+static DWORD WINAPI range_thread_func(LPVOID arg){
+	Range_Job* job = (Range_Job*)arg;
+	job->func(job->ctx, job->first, job->last);
+	return 0;
+}
+#else
+static void* range_thread_func(void* arg){
+	Range_Job* job = (Range_Job*)arg;
+	job->func(job->ctx, job->first, job->last);
+	return NULL;
+}
+#endif
+
+// splits [0, count) into one range per core. the calling thread takes the
+// first range, and any thread that fails to start has its range run here too
+static void parallel_for(int count, Range_Func func, void* ctx){
+	int nthreads = count_cpus();
+	if (nthreads > WELD_MAX_THREADS){
+		nthreads = WELD_MAX_THREADS;
+	}
+	if (nthreads > count / WELD_MIN_ITEMS_PER_THREAD){
+		nthreads = count / WELD_MIN_ITEMS_PER_THREAD;
+	}
+	if (nthreads < 2){
+		func(ctx, 0, count);
+		return;
+	}
+	Range_Job jobs[WELD_MAX_THREADS];
+	bool started[WELD_MAX_THREADS] = { false };
+#ifdef _WIN32
+	HANDLE threads[WELD_MAX_THREADS];
+#else
+	pthread_t threads[WELD_MAX_THREADS];
+#endif
+	for (int i = 0; i < nthreads; i++){
+		jobs[i].func = func;
+		jobs[i].ctx = ctx;
+		jobs[i].first = (int)((int64_t)count * i / nthreads);
+		jobs[i].last = (int)((int64_t)count * (i + 1) / nthreads);
+	}
+	for (int i = 1; i < nthreads; i++){
+#ifdef _WIN32
+		threads[i] = CreateThread(NULL, 0, range_thread_func, &jobs[i], 0, NULL);
+		started[i] = NULL != threads[i];
+#else
+		started[i] = 0 == pthread_create(&threads[i], NULL, range_thread_func, &jobs[i]);
+#endif
+	}
+	func(ctx, jobs[0].first, jobs[0].last);
+	for (int i = 1; i < nthreads; i++){
+		if (!started[i]){
+			func(ctx, jobs[i].first, jobs[i].last);
+			continue;
+		}
+#ifdef _WIN32
+		WaitForSingleObject(threads[i], INFINITE);
+		CloseHandle(threads[i]);
+#else
+		pthread_join(threads[i], NULL);
+#endif
+	}
+}
+
+/*--------------------------------- NORMALS ----------------------------------*/
+typedef struct Normals_Ctx{
+	Indexed_Mesh* mesh;
+	float* face_ns; // un-normalised, so bigger faces count for more
+	int* vert_first; // vcount + 1 offsets into vert_tris
+	int* vert_tris;
+} Normals_Ctx;
+
+static void face_normals_range(void* arg, int first, int last){
+	Normals_Ctx* ctx = (Normals_Ctx*)arg;
+	const float* vps = ctx->mesh->vps;
+	const unsigned int* idx = ctx->mesh->indices;
+	for (int t = first; t < last; t++){
+		const float* a = &vps[idx[t * 3] * 3];
+		const float* b = &vps[idx[t * 3 + 1] * 3];
+		const float* c = &vps[idx[t * 3 + 2] * 3];
+		float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+		float e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+		float* n = &ctx->face_ns[t * 3];
+		n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+		n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+		n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+	}
+}
+
+static void vertex_normals_range(void* arg, int first, int last){
+	Normals_Ctx* ctx = (Normals_Ctx*)arg;
+	for (int v = first; v < last; v++){
+		float sum[3] = { 0.0f, 0.0f, 0.0f };
+		for (int i = ctx->vert_first[v]; i < ctx->vert_first[v + 1]; i++){
+			const float* n = &ctx->face_ns[ctx->vert_tris[i] * 3];
+			sum[0] += n[0];
+			sum[1] += n[1];
+			sum[2] += n[2];
+		}
+		float len = sqrtf(sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2]);
+		float* out = &ctx->mesh->vns[v * 3];
+		if (len > 0.0f){
+			out[0] = sum[0] / len;
+			out[1] = sum[1] / len;
+			out[2] = sum[2] / len;
+		} else { // unused vertex or faces cancelled out
+			out[0] = 0.0f;
+			out[1] = 1.0f;
+			out[2] = 0.0f;
+		}
+	}
+}
+
+bool compute_smooth_normals(Indexed_Mesh* mesh){
+	assert(mesh);
+	int ntris = mesh->icount / 3;
+	Normals_Ctx ctx;
+	ctx.mesh = mesh;
+	ctx.face_ns = (float*)malloc(((size_t)ntris + 1) * 3 * sizeof(float));
+	ctx.vert_first = (int*)calloc((size_t)mesh->vcount + 1, sizeof(int));
+	ctx.vert_tris = (int*)malloc(((size_t)mesh->icount + 1) * sizeof(int));
+	free(mesh->vns);
+	mesh->vns = (float*)malloc(((size_t)mesh->vcount + 1) * 3 * sizeof(float));
+	if (!ctx.face_ns || !ctx.vert_first || !ctx.vert_tris || !mesh->vns){
+		fprintf(stderr, "ERROR: out of memory computing normals\n");
+		free(ctx.face_ns);
+		free(ctx.vert_first);
+		free(ctx.vert_tris);
+		free(mesh->vns);
+		mesh->vns = NULL;
+		return false;
+	}
+	// vertex->triangle table, counting sort style. cheap next to the maths
+	for (int i = 0; i < mesh->icount; i++){
+		ctx.vert_first[mesh->indices[i] + 1]++;
+	}
+	for (int v = 0; v < mesh->vcount; v++){
+		ctx.vert_first[v + 1] += ctx.vert_first[v];
+	}
+	for (int i = 0; i < mesh->icount; i++){
+		// vert_first[v] walks forward as it fills, then gets shifted back below
+		ctx.vert_tris[ctx.vert_first[mesh->indices[i]]++] = i / 3;
+	}
+	for (int v = mesh->vcount; v > 0; v--){
+		ctx.vert_first[v] = ctx.vert_first[v - 1];
+	}
+	ctx.vert_first[0] = 0;
+	parallel_for(ntris, face_normals_range, &ctx);
+	parallel_for(mesh->vcount, vertex_normals_range, &ctx);
+	free(ctx.face_ns);
+	free(ctx.vert_first);
+	free(ctx.vert_tris);
+	return true;
+}
+
+void free_indexed_mesh(Indexed_Mesh* mesh){
+	free(mesh->vps);
+	free(mesh->vns);
+	free(mesh->indices);
+	memset(mesh, 0, sizeof(Indexed_Mesh));
+}
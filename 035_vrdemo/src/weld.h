@@ -0,0 +1,18 @@
+#pragma once
+#include "mesh.h"
+#include <stdbool.h>
+
+// welded mesh - shared vertices with smooth normals, drawn with glDrawElements
+typedef struct Indexed_Mesh{
+	float* vps; // vcount * 3
+	float* vns; // vcount * 3, NULL until compute_smooth_normals()
+	unsigned int* indices; // icount, 3 per triangle
+	int vcount, icount;
+} Indexed_Mesh;
+
+// merges soup vertices closer than epsilon into shared vertices using a spatial
+// hash. epsilon 0 only merges exact matches. triangles that collapse are dropped
+bool weld_mesh(const Mesh* soup, float epsilon, Indexed_Mesh* mesh);
+// area-weighted vertex normals, spread over all cores
+bool compute_smooth_normals(Indexed_Mesh* mesh);
+void free_indexed_mesh(Indexed_Mesh* mesh);
@@ -178,28 +178,43 @@ static inline mat4 identity_mat4() {
   return r;
 }
 
-static inline mat4 mult_mat4_mat4( mat4 a, mat4 b ) {
-  mat4 r = { { 0 } };
+// the _p functions read inputs through const pointers and write to r, so no
+// 64-byte matrices are copied on and off the stack. r may point at an input.
+// the value versions are wrappers
+static inline void mult_mat4_mat4_p( const mat4 *a, const mat4 *b, mat4 *r ) {
+  mat4 t;
   int r_index = 0;
   for ( int col = 0; col < 4; col++ ) {
     for ( int row = 0; row < 4; row++ ) {
       float sum = 0.0f;
       for ( int i = 0; i < 4; i++ ) {
-        sum += b.m[i + col * 4] * a.m[row + i * 4];
+        sum += b->m[i + col * 4] * a->m[row + i * 4];
       }
-      r.m[r_index] = sum;
+      t.m[r_index] = sum;
       r_index++;
     }
   }
+  *r = t;
+}
+
+static inline mat4 mult_mat4_mat4( mat4 a, mat4 b ) {
+  mat4 r;
+  mult_mat4_mat4_p( &a, &b, &r );
   return r;
 }
 
+static inline void mult_mat4_vec4_p( const mat4 *m, const vec4 *v, vec4 *r ) {
+  float x = m->m[0] * v->x + m->m[4] * v->y + m->m[8] * v->z + m->m[12] * v->w;
+  float y = m->m[1] * v->x + m->m[5] * v->y + m->m[9] * v->z + m->m[13] * v->w;
+  float z = m->m[2] * v->x + m->m[6] * v->y + m->m[10] * v->z + m->m[14] * v->w;
+  float w = m->m[3] * v->x + m->m[7] * v->y + m->m[11] * v->z + m->m[15] * v->w;
+  *r = ( vec4 ){.x = x, .y = y, .z = z, .w = w };
+}
+
 static inline vec4 mult_mat4_vec4( mat4 m, vec4 v ) {
-  float x = m.m[0] * v.x + m.m[4] * v.y + m.m[8] * v.z + m.m[12] * v.w;
-  float y = m.m[1] * v.x + m.m[5] * v.y + m.m[9] * v.z + m.m[13] * v.w;
-  float z = m.m[2] * v.x + m.m[6] * v.y + m.m[10] * v.z + m.m[14] * v.w;
-  float w = m.m[3] * v.x + m.m[7] * v.y + m.m[11] * v.z + m.m[15] * v.w;
-  return ( vec4 ){.x = x, .y = y, .z = z, .w = w };
+  vec4 r;
+  mult_mat4_vec4_p( &m, &v, &r );
+  return r;
 }
 
 static inline float det_mat4( mat4 mm ) {
@@ -304,6 +319,64 @@ static inline mat4 inverse_mat4( mat4 mm ) {
   return r;
 }
 
+// rotation + translation only, so the inverse rotation is the transpose and
+// the translation t becomes -R^T * t
+static inline mat4 inverse_rigid_mat4( mat4 mm ) {
+  mat4 r;
+  r.m[0] = mm.m[0];
+  r.m[1] = mm.m[4];
+  r.m[2] = mm.m[8];
+  r.m[4] = mm.m[1];
+  r.m[5] = mm.m[5];
+  r.m[6] = mm.m[9];
+  r.m[8] = mm.m[2];
+  r.m[9] = mm.m[6];
+  r.m[10] = mm.m[10];
+  r.m[3] = r.m[7] = r.m[11] = 0.0f;
+  r.m[12] = -( mm.m[0] * mm.m[12] + mm.m[1] * mm.m[13] + mm.m[2] * mm.m[14] );
+  r.m[13] = -( mm.m[4] * mm.m[12] + mm.m[5] * mm.m[13] + mm.m[6] * mm.m[14] );
+  r.m[14] = -( mm.m[8] * mm.m[12] + mm.m[9] * mm.m[13] + mm.m[10] * mm.m[14] );
+  r.m[15] = 1.0f;
+  return r;
+}
+
+// bottom row 0,0,0,1. rows of the inverse 3x3 are b x c, c x a, a x b over
+// a . (b x c) where a, b, c are the columns
+static inline mat4 inverse_affine_mat4( mat4 mm ) {
+  vec3 a = ( vec3 ){.x = mm.m[0], .y = mm.m[1], .z = mm.m[2] };
+  vec3 b = ( vec3 ){.x = mm.m[4], .y = mm.m[5], .z = mm.m[6] };
+  vec3 c = ( vec3 ){.x = mm.m[8], .y = mm.m[9], .z = mm.m[10] };
+  vec3 bc = cross_vec3( b, c );
+  vec3 ca = cross_vec3( c, a );
+  vec3 ab = cross_vec3( a, b );
+  float det = dot_vec3( a, bc );
+  if ( 0.0f == det ) {
+    fprintf( stderr, "WARNING. matrix has no determinant. can not invert\n" );
+    return mm;
+  }
+  float inv_det = 1.0f / det;
+  bc = mult_vec3_f( bc, inv_det );
+  ca = mult_vec3_f( ca, inv_det );
+  ab = mult_vec3_f( ab, inv_det );
+  vec3 t = ( vec3 ){.x = mm.m[12], .y = mm.m[13], .z = mm.m[14] };
+  mat4 r;
+  r.m[0] = bc.x;
+  r.m[1] = ca.x;
+  r.m[2] = ab.x;
+  r.m[4] = bc.y;
+  r.m[5] = ca.y;
+  r.m[6] = ab.y;
+  r.m[8] = bc.z;
+  r.m[9] = ca.z;
+  r.m[10] = ab.z;
+  r.m[3] = r.m[7] = r.m[11] = 0.0f;
+  r.m[12] = -dot_vec3( bc, t );
+  r.m[13] = -dot_vec3( ca, t );
+  r.m[14] = -dot_vec3( ab, t );
+  r.m[15] = 1.0f;
+  return r;
+}
+
 static inline mat4 transpose_mat4( mat4 mm ) {
   mat4 r;
   r.m[0] = mm.m[0];
@@ -422,13 +495,19 @@ static inline versor normalise_quat( versor q ) {
   return div_quat_f( q, mag );
 }
 
-static inline versor mult_quat_quat( versor a, versor b ) {
+static inline void mult_quat_quat_p( const versor *a, const versor *b, versor *r ) {
   versor result;
-  result.w = b.w * a.w - b.x * a.x - b.y * a.y - b.z * a.z;
-  result.x = b.w * a.x + b.x * a.w - b.y * a.z + b.z * a.y;
-  result.y = b.w * a.y + b.x * a.z + b.y * a.w - b.z * a.x;
-  result.z = b.w * a.z - b.x * a.y + b.y * a.x + b.z * a.w;
-  return normalise_quat( result );
+  result.w = b->w * a->w - b->x * a->x - b->y * a->y - b->z * a->z;
+  result.x = b->w * a->x + b->x * a->w - b->y * a->z + b->z * a->y;
+  result.y = b->w * a->y + b->x * a->z + b->y * a->w - b->z * a->x;
+  result.z = b->w * a->z - b->x * a->y + b->y * a->x + b->z * a->w;
+  *r = normalise_quat( result );
+}
+
+static inline versor mult_quat_quat( versor a, versor b ) {
+  versor r;
+  mult_quat_quat_p( &a, &b, &r );
+  return r;
 }
 
 static inline versor add_quat_quat( versor a, versor b ) {
@@ -453,25 +532,45 @@ static inline versor quat_from_axis_deg( float degrees, vec3 axis ) {
   return quat_from_axis_rad( ONE_DEG_IN_RAD * degrees, axis );
 }
 
+static inline void quat_to_mat4_p( const versor *q, mat4 *r ) {
+  float w = q->w;
+  float x = q->x;
+  float y = q->y;
+  float z = q->z;
+  r->m[0] = 1.0f - 2.0f * y * y - 2.0f * z * z;
+  r->m[1] = 2.0f * x * y + 2.0f * w * z;
+  r->m[2] = 2.0f * x * z - 2.0f * w * y;
+  r->m[3] = 0.0f;
+  r->m[4] = 2.0f * x * y - 2.0f * w * z;
+  r->m[5] = 1.0f - 2.0f * x * x - 2.0f * z * z;
+  r->m[6] = 2.0f * y * z + 2.0f * w * x;
+  r->m[7] = 0.0f;
+  r->m[8] = 2.0f * x * z + 2.0f * w * y;
+  r->m[9] = 2.0f * y * z - 2.0f * w * x;
+  r->m[10] = 1.0f - 2.0f * x * x - 2.0f * y * y;
+  r->m[11] = r->m[12] = r->m[13] = r->m[14] = 0.0f;
+  r->m[15] = 1.0f;
+}
+
 static inline mat4 quat_to_mat4( versor q ) {
-  float w = q.w;
-  float x = q.x;
-  float y = q.y;
-  float z = q.z;
   mat4 r;
-  r.m[0] = 1.0f - 2.0f * y * y - 2.0f * z * z;
-  r.m[1] = 2.0f * x * y + 2.0f * w * z;
-  r.m[2] = 2.0f * x * z - 2.0f * w * y;
-  r.m[3] = 0.0f;
-  r.m[4] = 2.0f * x * y - 2.0f * w * z;
-  r.m[5] = 1.0f - 2.0f * x * x - 2.0f * z * z;
-  r.m[6] = 2.0f * y * z + 2.0f * w * x;
-  r.m[7] = 0.0f;
-  r.m[8] = 2.0f * x * z + 2.0f * w * y;
-  r.m[9] = 2.0f * y * z - 2.0f * w * x;
-  r.m[10] = 1.0f - 2.0f * x * x - 2.0f * y * y;
-  r.m[11] = r.m[12] = r.m[13] = r.m[14] = 0.0f;
-  r.m[15] = 1.0f;
+  quat_to_mat4_p( &q, &r );
+  return r;
+}
+
+// same as inverse_mat4( mult_mat4_mat4( translate_mat4( pos ), quat_to_mat4( q ) ) )
+// the conjugate of a versor is its inverse rotation
+static inline void view_from_quat_pos_p( const versor *q, const vec3 *pos, mat4 *r ) {
+  versor conj = ( versor ){.w = q->w, .x = -q->x, .y = -q->y, .z = -q->z };
+  quat_to_mat4_p( &conj, r );
+  r->m[12] = -( r->m[0] * pos->x + r->m[4] * pos->y + r->m[8] * pos->z );
+  r->m[13] = -( r->m[1] * pos->x + r->m[5] * pos->y + r->m[9] * pos->z );
+  r->m[14] = -( r->m[2] * pos->x + r->m[6] * pos->y + r->m[10] * pos->z );
+}
+
+static inline mat4 view_from_quat_pos( versor q, vec3 pos ) {
+  mat4 r;
+  view_from_quat_pos_p( &q, &pos, &r );
   return r;
 }
 
@@ -441,12 +441,13 @@ glPolygonMode( GL_FRONT_AND_BACK, GL_LINE );
           versor q_yaw = quat_from_axis_deg( cam_yaw, v3_v4( up ) );
           mat4 Ry = rot_y_deg_mat4( cam_heading );
 
-          quaternion = mult_quat_quat( q_yaw, quaternion );
-          mat4 R = quat_to_mat4( quaternion );
+          mult_quat_quat_p( &q_yaw, &quaternion, &quaternion );
+          mat4 R;
+          quat_to_mat4_p( &quaternion, &R );
 
-          fwd = mult_mat4_vec4( Ry, ( vec4 ){ 0.0, 0.0, -1.0, 0.0 } );
+          mult_mat4_vec4_p( &Ry, &( vec4 ){ 0.0, 0.0, -1.0, 0.0 }, &fwd );
           // print_vec4( fwd );
-          rgt = mult_mat4_vec4( R, ( vec4 ){ 1.0, 0.0, 0.0, 0.0 } );
+          mult_mat4_vec4_p( &R, &( vec4 ){ 1.0, 0.0, 0.0, 0.0 }, &rgt );
           // up = mult_mat4_vec4( R, ( vec4 ){ 0.0, 1.0, 0.0, 0.0 } );
         }
         if ( glfwGetKey( g_window, GLFW_KEY_RIGHT ) ) {
@@ -455,44 +456,43 @@ glPolygonMode( GL_FRONT_AND_BACK, GL_LINE );
           cam_moved = true;
           versor q_yaw = quat_from_axis_deg( cam_yaw, v3_v4( up ) );
           mat4 Ry = rot_y_deg_mat4( cam_heading );
-          quaternion = mult_quat_quat( q_yaw, quaternion );
-          mat4 R = quat_to_mat4( quaternion );
-          fwd = mult_mat4_vec4( Ry, ( vec4 ){ 0.0, 0.0, -1.0, 0.0 } );
+          mult_quat_quat_p( &q_yaw, &quaternion, &quaternion );
+          mat4 R;
+          quat_to_mat4_p( &quaternion, &R );
+          mult_mat4_vec4_p( &Ry, &( vec4 ){ 0.0, 0.0, -1.0, 0.0 }, &fwd );
 
-          rgt = mult_mat4_vec4( R, ( vec4 ){ 1.0, 0.0, 0.0, 0.0 } );
+          mult_mat4_vec4_p( &R, &( vec4 ){ 1.0, 0.0, 0.0, 0.0 }, &rgt );
           // up = mult_mat4_vec4( R, ( vec4 ){ 0.0, 1.0, 0.0, 0.0 } );
         }
         if ( glfwGetKey( g_window, GLFW_KEY_UP ) ) {
           cam_pitch += cam_heading_speed * elapsed_seconds;
           cam_moved = true;
           versor q_pitch = quat_from_axis_deg( cam_pitch, v3_v4( rgt ) );
-          quaternion = mult_quat_quat( q_pitch, quaternion );
-          mat4 R = quat_to_mat4( quaternion );
+          mult_quat_quat_p( &q_pitch, &quaternion, &quaternion );
+          mat4 R;
+          quat_to_mat4_p( &quaternion, &R );
           // fwd = mult_mat4_vec4( R, ( vec4 ){ 0.0, 0.0, -1.0, 0.0 } );
-          rgt = mult_mat4_vec4( R, ( vec4 ){ 1.0, 0.0, 0.0, 0.0 } );
+          mult_mat4_vec4_p( &R, &( vec4 ){ 1.0, 0.0, 0.0, 0.0 }, &rgt );
           // up = mult_mat4_vec4( R, ( vec4 ){ 0.0, 1.0, 0.0, 0.0 } );
         }
         if ( glfwGetKey( g_window, GLFW_KEY_DOWN ) ) {
           cam_pitch -= cam_heading_speed * elapsed_seconds;
           cam_moved = true;
           versor q_pitch = quat_from_axis_deg( cam_pitch, v3_v4( rgt ) );
-          quaternion = mult_quat_quat( q_pitch, quaternion );
+          mult_quat_quat_p( &q_pitch, &quaternion, &quaternion );
           // recalc axes to suit new orientation
-          mat4 R = quat_to_mat4( quaternion );
+          mat4 R;
+          quat_to_mat4_p( &quaternion, &R );
           // fwd = mult_mat4_vec4( R, ( vec4 ){ 0.0, 0.0, -1.0, 0.0 } );
-          rgt = mult_mat4_vec4( R, ( vec4 ){ 1.0, 0.0, 0.0, 0.0 } );
+          mult_mat4_vec4_p( &R, &( vec4 ){ 1.0, 0.0, 0.0, 0.0 }, &rgt );
           // up = mult_mat4_vec4( R, ( vec4 ){ 0.0, 1.0, 0.0, 0.0 } );
         }
         if ( cam_moved ) {
-          mat4 R = quat_to_mat4( quaternion );
           cam_pos = add_vec3_vec3( cam_pos, mult_vec3_f( v3_v4( fwd ), -move.z ) );
           cam_pos = add_vec3_vec3( cam_pos, mult_vec3_f( v3_v4( up ), move.y ) );
           cam_pos = add_vec3_vec3( cam_pos, mult_vec3_f( v3_v4( rgt ), move.x ) );
           // print_vec3( cam_pos );
-          mat4 T = translate_mat4( cam_pos );
-
-          mat4 inverse_R = inverse_mat4( R );
-          V = mult_mat4_mat4( inverse_R, inverse_mat4( T ) );
+          view_from_quat_pos_p( &quaternion, &cam_pos, &V );
         }
         float aspect = (float)g_gl_width / (float)g_gl_height;
         P = perspective( 67, aspect, 0.1, 1000.0 );
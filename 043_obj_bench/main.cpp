@@ -0,0 +1,465 @@
+//
+// GPU-free throughput benchmark for every copy of the .obj loader
+// anton gerdelan <gerdela@scss.tcd.ie>
+// trinity college dublin
+//
+// generates grid meshes from 10K to 50M triangles (cached in the mesh dir
+// between runs), then loads each with every loader variant. each load runs in
+// a forked child so peak RSS is per-load and a loader that runs out of memory
+// on a big mesh only loses its own row. output is CSV on stdout:
+// variant,triangles,file_mb,seconds,mb_per_s,peak_rss_kb,allocs,alloc_mb,checksum
+//
+// seconds is the best of -r runs. peak_rss_kb includes the bench itself
+// (a few hundred KB). allocs counts malloc/calloc/realloc calls made by the
+// loader objects (linked with --wrap) - not stdio buffers or mmaps inside libc.
+// checksum sums every vertex attribute the loader returned, so variants that
+// parse the same file differently show up. 025_c_cached maps the .bin lazily,
+// so its time is just open + validate; the pages fault in during the checksum
+//
+// usage: ./obj_bench [-m max_triangles] [-r runs] [-d mesh_dir] [-v variant]
+//   [-t threads,threads,...]
+//   -m 1000000 skips the 10M and 50M meshes, which need several GB of disk
+//      and RAM
+//   -v only runs variants whose name contains this string
+//   -t also runs 025_c once per thread count listed, e.g. -t 1,2,4,8,16, as
+//      rows named 025_c_t1, 025_c_t2... for a scaling curve. the number of
+//      cores is printed to stderr - more threads than cores shows only the
+//      overhead of splitting
+//
+extern "C" {
+#include "../025_depth_antioverdraw/obj_parser.h"
+}
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// the same function built from each copy of obj_parser, renamed by the Makefile
+bool load_obj_file_orig_cpp (const char* file_name, float*& points,
+	float*& tex_coords, float*& normals, int& point_count);
+bool load_obj_file_003_cpp (const char* file_name, float*& points,
+	float*& tex_coords, float*& normals, int& point_count);
+bool load_obj_file_009_cpp (const char* file_name, float*& points,
+	float*& tex_coords, float*& normals, int& point_count);
+extern "C" {
+bool load_obj_file_016_c (const char* file_name, float** points,
+	float** tex_coords, float** normals, int* point_count);
+bool load_obj_file_021_c (const char* file_name, float** points,
+	float** tex_coords, float** normals, int* point_count);
+bool load_obj_file_027_c (const char* file_name, float** points,
+	float** tex_coords, float** normals, int* point_count);
+// 025 keeps its own name - it is the only copy with the extra entry points
+}
+
+// ---------------------------------------------------------------- allocations
+// counted in the child, only around the load itself
+static long g_allocs = 0;
+static double g_alloc_bytes = 0.0;
+
+extern "C" {
+void* __real_malloc (size_t sz);
+void* __real_calloc (size_t n, size_t sz);
+void* __real_realloc (void* ptr, size_t sz);
+
+void* __wrap_malloc (size_t sz) {
+	g_allocs++;
+	g_alloc_bytes += (double)sz;
+	return __real_malloc (sz);
+}
+
+void* __wrap_calloc (size_t n, size_t sz) {
+	g_allocs++;
+	g_alloc_bytes += (double)n * (double)sz;
+	return __real_calloc (n, sz);
+}
+
+void* __wrap_realloc (void* ptr, size_t sz) {
+	g_allocs++;
+	g_alloc_bytes += (double)sz;
+	return __real_realloc (ptr, sz);
+}
+}
+
+// ------------------------------------------------------------------- variants
+struct Load_Result {
+	float* points, *tex_coords, *normals;
+	int point_count;
+	Obj_Indexed_Mesh indexed; // only for the indexed variant
+	bool is_indexed;
+};
+
+static bool run_orig_cpp (const char* f, Load_Result& r) {
+	return load_obj_file_orig_cpp (f, r.points, r.tex_coords, r.normals,
+		r.point_count);
+}
+
+static bool run_003_cpp (const char* f, Load_Result& r) {
+	return load_obj_file_003_cpp (f, r.points, r.tex_coords, r.normals,
+		r.point_count);
+}
+
+static bool run_009_cpp (const char* f, Load_Result& r) {
+	return load_obj_file_009_cpp (f, r.points, r.tex_coords, r.normals,
+		r.point_count);
+}
+
+static bool run_016_c (const char* f, Load_Result& r) {
+	return load_obj_file_016_c (f, &r.points, &r.tex_coords, &r.normals,
+		&r.point_count);
+}
+
+static bool run_021_c (const char* f, Load_Result& r) {
+	return load_obj_file_021_c (f, &r.points, &r.tex_coords, &r.normals,
+		&r.point_count);
+}
+
+static bool run_027_c (const char* f, Load_Result& r) {
+	return load_obj_file_027_c (f, &r.points, &r.tex_coords, &r.normals,
+		&r.point_count);
+}
+
+static bool run_025_c (const char* f, Load_Result& r) {
+	set_obj_parser_cache (false);
+	set_obj_parser_threads (1);
+	return load_obj_file (f, &r.points, &r.tex_coords, &r.normals,
+		&r.point_count);
+}
+
+static bool run_025_c_mt (const char* f, Load_Result& r) {
+	set_obj_parser_cache (false);
+	set_obj_parser_threads (0);
+	return load_obj_file (f, &r.points, &r.tex_coords, &r.normals,
+		&r.point_count);
+}
+
+static bool run_025_c_indexed (const char* f, Load_Result& r) {
+	set_obj_parser_cache (false);
+	set_obj_parser_threads (0);
+	r.is_indexed = true;
+	return load_obj_file_indexed (f, &r.indexed);
+}
+
+// thread count for the -t sweep. set in the parent before each fork
+static int g_sweep_threads = 1;
+
+static bool run_025_c_sweep (const char* f, Load_Result& r) {
+	set_obj_parser_cache (false);
+	set_obj_parser_threads (g_sweep_threads);
+	return load_obj_file (f, &r.points, &r.tex_coords, &r.normals,
+		&r.point_count);
+}
+
+// .bin written by an untimed warm-up load first, so this times the cache hit
+static bool run_025_c_cached (const char* f, Load_Result& r) {
+	set_obj_parser_cache (true);
+	set_obj_parser_threads (0);
+	r.is_indexed = true;
+	return load_obj_file_indexed (f, &r.indexed);
+}
+
+struct Variant {
+	const char* name;
+	bool (*run) (const char* file_name, Load_Result& r);
+	bool warm_up; // load once untimed first
+};
+
+/* one row per distinct copy. 028 is byte-identical to the copies in 002 004
+   005 007 014 018 019 029 and xx_texture_shadows_cube; 021 to 036 */
+static const Variant g_variants[] = {
+	{ "orig_cpp", run_orig_cpp, false },
+	{ "003_cpp", run_003_cpp, false },
+	{ "009_cpp", run_009_cpp, false },
+	{ "016_c", run_016_c, false },
+	{ "021_c", run_021_c, false },
+	{ "027_c", run_027_c, false },
+	{ "025_c", run_025_c, false },
+	{ "025_c_mt", run_025_c_mt, false },
+	{ "025_c_indexed", run_025_c_indexed, false },
+	{ "025_c_cached", run_025_c_cached, true }
+};
+static const int g_n_variants = sizeof (g_variants) / sizeof (Variant);
+
+// -------------------------------------------------------------------- meshes
+static const int g_mesh_sizes[] = {
+	10000, 100000, 1000000, 10000000, 50000000
+};
+static const int g_n_mesh_sizes = sizeof (g_mesh_sizes) / sizeof (int);
+
+static double time_s () {
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static long long file_size (const char* file_name) {
+	struct stat st;
+	if (stat (file_name, &st) != 0) {
+		return -1;
+	}
+	return (long long)st.st_size;
+}
+
+/* n x n quads of gently rolling terrain, two triangles each, with a unique
+   vt and vn per vertex like a typical exported mesh */
+static bool write_grid_obj (const char* file_name, int n) {
+	FILE* fp = fopen (file_name, "w");
+	if (!fp) {
+		fprintf (stderr, "ERROR: could not write %s\n", file_name);
+		return false;
+	}
+	setvbuf (fp, NULL, _IOFBF, 1 << 20);
+	fprintf (fp, "# obj_bench grid %ix%i\n", n, n);
+	int side = n + 1;
+	for (int j = 0; j < side; j++) {
+		for (int i = 0; i < side; i++) {
+			float x = (float)i / (float)n * 2.0f - 1.0f;
+			float z = (float)j / (float)n * 2.0f - 1.0f;
+			fprintf (fp, "v %f %f %f\n", x, 0.1f * sinf (x * 7.0f) * cosf (z * 5.0f), z);
+		}
+	}
+	for (int j = 0; j < side; j++) {
+		for (int i = 0; i < side; i++) {
+			fprintf (fp, "vt %f %f\n", (float)i / (float)n, (float)j / (float)n);
+		}
+	}
+	for (int j = 0; j < side; j++) {
+		for (int i = 0; i < side; i++) {
+			float x = (float)i / (float)n * 2.0f - 1.0f;
+			float z = (float)j / (float)n * 2.0f - 1.0f;
+			float dx = 0.7f * cosf (x * 7.0f) * cosf (z * 5.0f);
+			float dz = -0.5f * sinf (x * 7.0f) * sinf (z * 5.0f);
+			float len = sqrtf (dx * dx + 1.0f + dz * dz);
+			fprintf (fp, "vn %f %f %f\n", -dx / len, 1.0f / len, -dz / len);
+		}
+	}
+	for (int j = 0; j < n; j++) {
+		for (int i = 0; i < n; i++) {
+			int a = j * side + i + 1, b = a + 1, c = a + side, d = c + 1;
+			fprintf (fp, "f %i/%i/%i %i/%i/%i %i/%i/%i\n", a, a, a, c, c, c, b, b, b);
+			fprintf (fp, "f %i/%i/%i %i/%i/%i %i/%i/%i\n", b, b, b, c, c, c, d, d, d);
+		}
+	}
+	bool ok = 0 == ferror (fp);
+	fclose (fp);
+	if (!ok) {
+		fprintf (stderr, "ERROR: writing %s failed - out of disk space?\n",
+			file_name);
+		remove (file_name);
+	}
+	return ok;
+}
+
+// ---------------------------------------------------------------- child runs
+struct Run_Stats {
+	bool ok;
+	int point_count;
+	double seconds, alloc_bytes, checksum;
+	long allocs, peak_rss_kb;
+};
+
+static double checksum_arrays (const float* p, const float* t, const float* n,
+	int count) {
+	double sum = 0.0;
+	for (int i = 0; i < count; i++) {
+		sum += (double)p[i * 3] + (double)p[i * 3 + 1] + (double)p[i * 3 + 2];
+		sum += (double)t[i * 2] + (double)t[i * 2 + 1];
+		sum += (double)n[i * 3] + (double)n[i * 3 + 1] + (double)n[i * 3 + 2];
+	}
+	return sum;
+}
+
+// walks the index buffer so indexed and unrolled loads checksum the same
+static double checksum_indexed (const Obj_Indexed_Mesh* m) {
+	double sum = 0.0;
+	for (int i = 0; i < m->index_count; i++) {
+		unsigned int v = 2 == m->index_size ? ((const unsigned short*)m->indices)[i] :
+			((const unsigned int*)m->indices)[i];
+		sum += checksum_arrays (&m->points[v * 3], &m->tex_coords[v * 2],
+			&m->normals[v * 3], 1);
+	}
+	return sum;
+}
+
+// child side. loader chatter goes to /dev/null so stdout stays clean CSV
+static void child_load (const Variant* v, const char* file_name, int fd) {
+	Run_Stats stats;
+	memset (&stats, 0, sizeof (Run_Stats));
+	int null_fd = open ("/dev/null", O_WRONLY);
+	if (null_fd >= 0) {
+		fflush (stdout);
+		dup2 (null_fd, STDOUT_FILENO);
+		close (null_fd);
+	}
+	Load_Result r;
+	memset (&r, 0, sizeof (Load_Result));
+	g_allocs = 0;
+	g_alloc_bytes = 0.0;
+	double start_s = time_s ();
+	stats.ok = v->run (file_name, r);
+	stats.seconds = time_s () - start_s;
+	stats.allocs = g_allocs;
+	stats.alloc_bytes = g_alloc_bytes;
+	if (stats.ok) {
+		if (r.is_indexed) {
+			stats.point_count = r.indexed.index_count;
+			stats.checksum = checksum_indexed (&r.indexed);
+			free_obj_indexed_mesh (&r.indexed);
+		} else {
+			stats.point_count = r.point_count;
+			stats.checksum = checksum_arrays (r.points, r.tex_coords, r.normals,
+				r.point_count);
+			free (r.points);
+			free (r.tex_coords);
+			free (r.normals);
+		}
+	}
+	ssize_t written = write (fd, &stats, sizeof (Run_Stats));
+	close (fd);
+	_exit (written == (ssize_t)sizeof (Run_Stats) ? 0 : 1);
+}
+
+// parent side. a child that dies (e.g. out of memory) comes back with ok false
+static Run_Stats run_in_child (const Variant* v, const char* file_name) {
+	Run_Stats stats;
+	memset (&stats, 0, sizeof (Run_Stats));
+	int fds[2];
+	if (pipe (fds) != 0) {
+		fprintf (stderr, "ERROR: pipe failed\n");
+		return stats;
+	}
+	fflush (stdout);
+	fflush (stderr);
+	pid_t pid = fork ();
+	if (0 == pid) {
+		close (fds[0]);
+		child_load (v, file_name, fds[1]);
+	}
+	close (fds[1]);
+	if (pid < 0) {
+		fprintf (stderr, "ERROR: fork failed\n");
+		close (fds[0]);
+		return stats;
+	}
+	ssize_t got = read (fds[0], &stats, sizeof (Run_Stats));
+	close (fds[0]);
+	int status = 0;
+	struct rusage ru;
+	memset (&ru, 0, sizeof (ru));
+	wait4 (pid, &status, 0, &ru);
+	if (got != (ssize_t)sizeof (Run_Stats) || !WIFEXITED (status) ||
+		WEXITSTATUS (status) != 0) {
+		memset (&stats, 0, sizeof (Run_Stats));
+	}
+	stats.peak_rss_kb = ru.ru_maxrss; // kilobytes on linux
+	return stats;
+}
+
+// best of runs, as one CSV row
+static void run_variant (const Variant* v, const char* name,
+	const char* file_name, int triangles, double file_mb, int runs) {
+	fprintf (stderr, "%s %i triangles...\n", name, triangles);
+	if (v->warm_up) {
+		run_in_child (v, file_name);
+	}
+	Run_Stats best;
+	memset (&best, 0, sizeof (Run_Stats));
+	for (int r = 0; r < runs; r++) {
+		Run_Stats stats = run_in_child (v, file_name);
+		if (!stats.ok) {
+			best = stats;
+			break;
+		}
+		if (0 == r || stats.seconds < best.seconds) {
+			best = stats;
+		}
+	}
+	if (best.ok && best.point_count != triangles * 3) {
+		fprintf (stderr, "ERROR: %s returned %i points, expected %i\n",
+			name, best.point_count, triangles * 3);
+		best.ok = false;
+	}
+	if (!best.ok) {
+		printf ("%s,%i,%.2f,,,%li,,,FAILED\n", name, triangles, file_mb,
+			best.peak_rss_kb);
+	} else {
+		printf ("%s,%i,%.2f,%.4f,%.1f,%li,%li,%.2f,%.6e\n", name, triangles,
+			file_mb, best.seconds,
+			best.seconds > 0.0 ? file_mb / best.seconds : 0.0, best.peak_rss_kb,
+			best.allocs, best.alloc_bytes / (1024.0 * 1024.0), best.checksum);
+	}
+	fflush (stdout);
+}
+
+int main (int argc, char** argv) {
+	int max_triangles = g_mesh_sizes[g_n_mesh_sizes - 1];
+	int runs = 3;
+	const char* mesh_dir = "/tmp";
+	const char* only = NULL;
+	const char* sweep = NULL;
+	for (int i = 1; i < argc; i++) {
+		if (0 == strcmp (argv[i], "-m") && i + 1 < argc) {
+			max_triangles = atoi (argv[++i]);
+		} else if (0 == strcmp (argv[i], "-r") && i + 1 < argc) {
+			runs = atoi (argv[++i]);
+			runs = runs < 1 ? 1 : runs;
+		} else if (0 == strcmp (argv[i], "-d") && i + 1 < argc) {
+			mesh_dir = argv[++i];
+		} else if (0 == strcmp (argv[i], "-v") && i + 1 < argc) {
+			only = argv[++i];
+		} else if (0 == strcmp (argv[i], "-t") && i + 1 < argc) {
+			sweep = argv[++i];
+		} else {
+			fprintf (stderr, "usage: %s [-m max_triangles] [-r runs] [-d mesh_dir] "
+				"[-v variant] [-t threads,threads,...]\n", argv[0]);
+			return 1;
+		}
+	}
+	fprintf (stderr, "%li cores\n", sysconf (_SC_NPROCESSORS_ONLN));
+
+	printf ("variant,triangles,file_mb,seconds,mb_per_s,peak_rss_kb,allocs,"
+		"alloc_mb,checksum\n");
+	for (int s = 0; s < g_n_mesh_sizes && g_mesh_sizes[s] <= max_triangles; s++) {
+		int n = (int)(sqrt ((double)g_mesh_sizes[s] * 0.5) + 0.5);
+		int triangles = n * n * 2;
+		char file_name[1024];
+		snprintf (file_name, sizeof (file_name), "%s/obj_bench_%i.obj", mesh_dir,
+			triangles);
+		if (file_size (file_name) <= 0) {
+			fprintf (stderr, "generating %s...\n", file_name);
+			if (!write_grid_obj (file_name, n)) {
+				return 1;
+			}
+		}
+		double file_mb = (double)file_size (file_name) / (1024.0 * 1024.0);
+
+		for (int vi = 0; vi < g_n_variants; vi++) {
+			const Variant* v = &g_variants[vi];
+			if (only && !strstr (v->name, only)) {
+				continue;
+			}
+			run_variant (v, v->name, file_name, triangles, file_mb, runs);
+		}
+		for (const char* t = sweep; t && *t; t = strchr (t, ',') ?
+			strchr (t, ',') + 1 : NULL) {
+			static const Variant sweep_variant = { "025_c_t", run_025_c_sweep,
+				false };
+			g_sweep_threads = atoi (t);
+			char name[32];
+			snprintf (name, sizeof (name), "025_c_t%i", g_sweep_threads);
+			run_variant (&sweep_variant, name, file_name, triangles, file_mb, runs);
+		}
+		// the cached variant leaves this behind
+		char bin_name[1100];
+		snprintf (bin_name, sizeof (bin_name), "%s.bin", file_name);
+		remove (bin_name);
+	}
+	return 0;
+}
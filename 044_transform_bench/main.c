@@ -0,0 +1,96 @@
+//
+// GPU-free throughput benchmark for the batch point transforms in apg_maths.h
+// anton gerdelan <gerdela@scss.tcd.ie>
+// trinity college dublin
+//
+// transforms N structure-of-arrays points with each SIMD level the cpu has,
+// both to clip space (transform_points_soa) and all the way to the viewport
+// (project_points_soa), against the one-vec4-per-call loop it replaces.
+// N goes from L1-sized to well past L3 so the memory-bound end shows up.
+// output is CSV on stdout:
+// op,level,points,seconds,mpoints_per_s
+//
+// seconds is the best of -r runs of one pass over all N points.
+//
+// usage: ./transform_bench [-r runs] [-m max_points]
+//
+#include "apg_maths.h"
+#include "apg_bench.h"
+
+int main (int argc, char** argv) {
+	int runs = apg_bench_arg_int (argc, argv, "-r", 5);
+	int max_points = apg_bench_arg_int (argc, argv, "-m", 16 * 1024 * 1024);
+	int max_level = set_maths_simd_level (APG_SIMD_AVX_FMA);
+	fprintf (stderr, "cpu supports up to %s\n",
+		apg_simd_level_name (max_level));
+
+	float* xs = apg_bench_alloc_floats (max_points);
+	float* ys = apg_bench_alloc_floats (max_points);
+	float* zs = apg_bench_alloc_floats (max_points);
+	float* rxs = apg_bench_alloc_floats (max_points);
+	float* rys = apg_bench_alloc_floats (max_points);
+	float* rzs = apg_bench_alloc_floats (max_points);
+	float* rws = apg_bench_alloc_floats (max_points);
+	srand (1);
+	for (int i = 0; i < max_points; i++) {
+		xs[i] = (float)rand () / (float)RAND_MAX * 20.0f - 10.0f;
+		ys[i] = (float)rand () / (float)RAND_MAX * 20.0f - 10.0f;
+		zs[i] = (float)rand () / (float)RAND_MAX * 20.0f - 10.0f;
+	}
+	// a typical camera, so the perspective divide sees realistic w values
+	mat4 P = perspective (67.0f, 16.0f / 9.0f, 0.1f, 100.0f);
+	mat4 V = look_at (vec3_from_3f (0.0f, 0.0f, 30.0f),
+		vec3_from_3f (0.0f, 0.0f, 0.0f), vec3_from_3f (0.0f, 1.0f, 0.0f));
+	mat4 PV = mult_mat4_mat4 (P, V);
+	vec4 viewport = vec4_from_4f (0.0f, 1080.0f, 1920.0f, -1080.0f);
+
+	printf ("op,level,points,seconds,mpoints_per_s\n");
+	for (int n = 1024; n <= max_points; n *= 16) {
+		for (int op = 0; op < 3; op++) {
+			for (int level = 0; level <= max_level; level++) {
+				set_maths_simd_level ((apg_simd_level)level);
+				double best = 1e9;
+				for (int r = 0; r < runs; r++) {
+					// small sizes repeat so each timing is well above clock resolution
+					int reps = 1 + (1024 * 1024) / n;
+					double t0 = apg_time_s ();
+					for (int k = 0; k < reps; k++) {
+						if (0 == op) {
+							for (int i = 0; i < n; i++) {
+								vec4 v = mult_mat4_vec4 (PV,
+									vec4_from_4f (xs[i], ys[i], zs[i], 1.0f));
+								rxs[i] = v.v[0];
+								rys[i] = v.v[1];
+								rzs[i] = v.v[2];
+								rws[i] = v.v[3];
+							}
+						} else if (1 == op) {
+							transform_points_soa (PV, xs, ys, zs, n, rxs, rys, rzs, rws);
+						} else {
+							project_points_soa (PV, xs, ys, zs, n, viewport, rxs, rys, rzs,
+								rws);
+						}
+					}
+					double t = (apg_time_s () - t0) / (double)reps;
+					if (t < best) {
+						best = t;
+					}
+				}
+				static const char* op_names[] = {
+					"mult_mat4_vec4_loop", "transform_points_soa", "project_points_soa"
+				};
+				printf ("%s,%s,%i,%.9f,%.1f\n", op_names[op],
+					apg_simd_level_name (level), n, best, (double)n / best * 1e-6);
+				fflush (stdout);
+			}
+		}
+	}
+	free (xs);
+	free (ys);
+	free (zs);
+	free (rxs);
+	free (rys);
+	free (rzs);
+	free (rws);
+	return 0;
+}
@@ -0,0 +1,34 @@
+// ops timed by main.c. each lib_*.c(pp) wraps one maths library behind the
+// same run_op signature so only plain floats cross between them
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+	OP_MULT_MAT4_MAT4 = 0, OP_MULT_MAT4_VEC4, OP_NORMALISE_VEC3,
+	OP_SLERP_QUAT, OP_INVERSE_MAT4, OP_TRANSPOSE_MAT4, OP_CROSS_VEC3,
+	OP_MULT_QUAT_QUAT, OP_LOOK_AT, OP_PROJECT_POINTS_SOA, OP_COUNT
+};
+
+// data is n items of 16 floats. each item is read as a mat4, as a vec3/vec4
+// from its first floats, or as a quaternion from floats 4..7.
+// runs op over all items reps times and returns a checksum of the results,
+// so the work can't be optimised away and the libraries can be compared.
+// returns NAN if the library wasn't built in (see lib_clang.c) or doesn't
+// have the op - only apg_maths.h and apg_maths_vec.h run the ops after
+// OP_INVERSE_MAT4
+typedef double (*run_op_func) (int op, const float* data, int n, int reps);
+
+double run_op_apg (int op, const float* data, int n, int reps);
+double run_op_apg_vec (int op, const float* data, int n, int reps);
+double run_op_linmath (int op, const float* data, int n, int reps);
+double run_op_clang (int op, const float* data, int n, int reps);
+double run_op_maths_funcs (int op, const float* data, int n, int reps);
+// apg_maths.h picks its mat4 kernels at run time. returns the level used
+int set_level_apg (int level);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,113 @@
+// apg_maths.h, or apg_maths_vec.h when built with -DBENCH_VEC - the two have
+// the same API
+#ifdef BENCH_VEC
+#include "apg_maths_vec.h"
+#define RUN_OP run_op_apg_vec
+#else
+#include "apg_maths.h"
+#define RUN_OP run_op_apg
+#endif
+#include "bench.h"
+
+#ifndef BENCH_VEC
+int set_level_apg (int level) {
+	return (int)set_maths_simd_level ((apg_simd_level)level);
+}
+#endif
+
+static mat4 mat4_at (const float* data, int i) {
+	mat4 m;
+	memcpy (m.m, data + i * 16, sizeof (m.m));
+	return m;
+}
+
+static vec3 vec3_at (const float* data, int i) {
+	const float* f = data + i * 16;
+	return vec3_from_3f (f[0], f[1], f[2]);
+}
+
+static versor quat_at (const float* data, int i) {
+	const float* f = data + i * 16 + 4;
+	return normalise_quat (versor_from_4f (f[0], f[1], f[2], f[3]));
+}
+
+double RUN_OP (int op, const float* data, int n, int reps) {
+	double sum = 0.0;
+	// SoA scratch for the batch op: xs, ys, zs then 4 outputs
+	static float soa[7][1024];
+	for (int r = 0; r < reps; r++) {
+		float acc = 0.0f;
+		switch (op) {
+			case OP_MULT_MAT4_MAT4: {
+				for (int i = 1; i < n; i++) {
+					mat4 m = mult_mat4_mat4 (mat4_at (data, i - 1), mat4_at (data, i));
+					acc += m.m[0] + m.m[15];
+				}
+			} break;
+			case OP_MULT_MAT4_VEC4: {
+				mat4 m = mat4_at (data, 0);
+				for (int i = 0; i < n; i++) {
+					const float* f = data + i * 16;
+					vec4 v = mult_mat4_vec4 (m, vec4_from_4f (f[0], f[1], f[2], 1.0f));
+					acc += v.v[0] + v.v[3];
+				}
+			} break;
+			case OP_NORMALISE_VEC3: {
+				for (int i = 0; i < n; i++) {
+					const float* f = data + i * 16;
+					acc += normalise_vec3 (vec3_from_3f (f[0], f[1], f[2])).v[1];
+				}
+			} break;
+			case OP_SLERP_QUAT: {
+				for (int i = 1; i < n; i++) {
+					float t = data[i * 16 + 8] * 0.5f + 0.5f;
+					acc += slerp_quat (quat_at (data, i - 1), quat_at (data, i), t).q[3];
+				}
+			} break;
+			case OP_INVERSE_MAT4: {
+				for (int i = 0; i < n; i++) {
+					acc += inverse_mat4 (mat4_at (data, i)).m[5];
+				}
+			} break;
+			case OP_TRANSPOSE_MAT4: {
+				for (int i = 0; i < n; i++) {
+					acc += transpose_mat4 (mat4_at (data, i)).m[7];
+				}
+			} break;
+			case OP_CROSS_VEC3: {
+				for (int i = 1; i < n; i++) {
+					acc += cross_vec3 (vec3_at (data, i - 1), vec3_at (data, i)).v[2];
+				}
+			} break;
+			case OP_MULT_QUAT_QUAT: {
+				versor q = quat_at (data, 0);
+				for (int i = 1; i < n; i++) {
+					q = mult_quat_quat (q, quat_at (data, i));
+				}
+				acc += q.q[0];
+			} break;
+			case OP_LOOK_AT: {
+				vec3 up = vec3_from_3f (0.0f, 1.0f, 0.0f);
+				for (int i = 1; i < n; i++) {
+					acc += look_at (vec3_at (data, i - 1), vec3_at (data, i), up).m[14];
+				}
+			} break;
+			case OP_PROJECT_POINTS_SOA: {
+				int np = n < 1024 ? n : 1024;
+				for (int i = 0; i < np; i++) {
+					soa[0][i] = data[i * 16];
+					soa[1][i] = data[i * 16 + 1];
+					soa[2][i] = data[i * 16 + 2] - 5.0f;
+				}
+				mat4 P = perspective (67.0f, 1.5f, 0.1f, 100.0f);
+				project_points_soa (P, soa[0], soa[1], soa[2], np,
+					vec4_from_4f (0.0f, 0.0f, 800.0f, 600.0f), soa[3], soa[4], soa[5],
+					soa[6]);
+				acc += soa[3][np / 2] + soa[6][np - 1];
+			} break;
+			default: return NAN;
+		}
+		sum += acc;
+	}
+	return sum;
+}
@@ -0,0 +1,73 @@
+// 030_clang_vectors' apg_maths_clang.h. it uses clang's ext_vector_type, so
+// with any other compiler this builds to a stub and the library is skipped.
+// the header's inline functions have external definitions with the same
+// names as apg_maths.h's, so the Makefile hides everything in this object but
+// run_op_clang
+#include "bench.h"
+#include <math.h>
+
+#ifdef __clang__
+#include "apg_maths_clang.h"
+
+static mat4 mat4_at (const float* data, int i) {
+	mat4 m;
+	memcpy (&m, data + i * 16, 16 * sizeof (float));
+	return m;
+}
+
+static versor quat_at (const float* data, int i) {
+	const float* f = data + i * 16 + 4;
+	return normalise_quat ((versor){ f[0], f[1], f[2], f[3] });
+}
+
+double run_op_clang (int op, const float* data, int n, int reps) {
+	double sum = 0.0;
+	for (int r = 0; r < reps; r++) {
+		float acc = 0.0f;
+		switch (op) {
+			case OP_MULT_MAT4_MAT4: {
+				for (int i = 1; i < n; i++) {
+					mat4 m = mat4_mul_mat4 (mat4_at (data, i - 1), mat4_at (data, i));
+					acc += m[0] + m[15];
+				}
+			} break;
+			case OP_MULT_MAT4_VEC4: {
+				mat4 m = mat4_at (data, 0);
+				for (int i = 0; i < n; i++) {
+					const float* f = data + i * 16;
+					vec4 v = mat4_mul_vec4 (m, (vec4){ f[0], f[1], f[2], 1.0f });
+					acc += v.x + v.w;
+				}
+			} break;
+			case OP_NORMALISE_VEC3: {
+				for (int i = 0; i < n; i++) {
+					const float* f = data + i * 16;
+					acc += normalise_vec3 ((vec3){ f[0], f[1], f[2] }).y;
+				}
+			} break;
+			case OP_SLERP_QUAT: {
+				for (int i = 1; i < n; i++) {
+					float t = data[i * 16 + 8] * 0.5f + 0.5f;
+					acc += slerp_quat (quat_at (data, i - 1), quat_at (data, i), t)[3];
+				}
+			} break;
+			case OP_INVERSE_MAT4: {
+				for (int i = 0; i < n; i++) {
+					acc += inverse_mat4 (mat4_at (data, i))[5];
+				}
+			} break;
+			default: return NAN; // op not in this library
+		}
+		sum += acc;
+	}
+	return sum;
+}
+#else
+double run_op_clang (int op, const float* data, int n, int reps) {
+	(void)op;
+	(void)data;
+	(void)n;
+	(void)reps;
+	return NAN;
+}
+#endif
@@ -0,0 +1,59 @@
+// 041_node_terrain's linmath.h - the .x .y .z struct C99 branch, also used by
+// 035 036 037 and 039
+#include <stdbool.h>
+#include "linmath.h"
+#include "bench.h"
+
+static mat4 mat4_at (const float* data, int i) {
+	mat4 m;
+	memcpy (m.m, data + i * 16, sizeof (m.m));
+	return m;
+}
+
+static versor quat_at (const float* data, int i) {
+	const float* f = data + i * 16 + 4;
+	return normalise_quat ((versor){ .w = f[0], .x = f[1], .y = f[2], .z = f[3] });
+}
+
+double run_op_linmath (int op, const float* data, int n, int reps) {
+	double sum = 0.0;
+	for (int r = 0; r < reps; r++) {
+		float acc = 0.0f;
+		switch (op) {
+			case OP_MULT_MAT4_MAT4: {
+				for (int i = 1; i < n; i++) {
+					mat4 m = mult_mat4_mat4 (mat4_at (data, i - 1), mat4_at (data, i));
+					acc += m.m[0] + m.m[15];
+				}
+			} break;
+			case OP_MULT_MAT4_VEC4: {
+				mat4 m = mat4_at (data, 0);
+				for (int i = 0; i < n; i++) {
+					const float* f = data + i * 16;
+					vec4 v = mult_mat4_vec4 (m, (vec4){ f[0], f[1], f[2], 1.0f });
+					acc += v.x + v.w;
+				}
+			} break;
+			case OP_NORMALISE_VEC3: {
+				for (int i = 0; i < n; i++) {
+					const float* f = data + i * 16;
+					acc += normalise_vec3 ((vec3){ f[0], f[1], f[2] }).y;
+				}
+			} break;
+			case OP_SLERP_QUAT: {
+				for (int i = 1; i < n; i++) {
+					float t = data[i * 16 + 8] * 0.5f + 0.5f;
+					acc += slerp_quat (quat_at (data, i - 1), quat_at (data, i), t).z;
+				}
+			} break;
+			case OP_INVERSE_MAT4: {
+				for (int i = 0; i < n; i++) {
+					acc += inverse_mat4 (mat4_at (data, i)).m[5];
+				}
+			} break;
+			default: return NAN; // op not in this library
+		}
+		sum += acc;
+	}
+	return sum;
+}
@@ -0,0 +1,66 @@
+// 028_more_cube's maths_funcs.cpp - the C++ operator-overloading version
+// shared by most of the older demos
+#include "maths_funcs.h"
+#include "bench.h"
+#include <math.h>
+#include <string.h>
+
+static mat4 mat4_at (const float* data, int i) {
+	mat4 m;
+	memcpy (m.m, data + i * 16, sizeof (m.m));
+	return m;
+}
+
+static versor quat_at (const float* data, int i) {
+	const float* f = data + i * 16 + 4;
+	versor q;
+	q.q[0] = f[0];
+	q.q[1] = f[1];
+	q.q[2] = f[2];
+	q.q[3] = f[3];
+	return normalise (q);
+}
+
+double run_op_maths_funcs (int op, const float* data, int n, int reps) {
+	double sum = 0.0;
+	for (int r = 0; r < reps; r++) {
+		float acc = 0.0f;
+		switch (op) {
+			case OP_MULT_MAT4_MAT4: {
+				for (int i = 1; i < n; i++) {
+					mat4 m = mat4_at (data, i - 1) * mat4_at (data, i);
+					acc += m.m[0] + m.m[15];
+				}
+			} break;
+			case OP_MULT_MAT4_VEC4: {
+				mat4 m = mat4_at (data, 0);
+				for (int i = 0; i < n; i++) {
+					const float* f = data + i * 16;
+					vec4 v = m * vec4 (f[0], f[1], f[2], 1.0f);
+					acc += v.v[0] + v.v[3];
+				}
+			} break;
+			case OP_NORMALISE_VEC3: {
+				for (int i = 0; i < n; i++) {
+					const float* f = data + i * 16;
+					acc += normalise (vec3 (f[0], f[1], f[2])).v[1];
+				}
+			} break;
+			case OP_SLERP_QUAT: {
+				for (int i = 1; i < n; i++) {
+					float t = data[i * 16 + 8] * 0.5f + 0.5f;
+					versor q = quat_at (data, i - 1), p = quat_at (data, i);
+					acc += slerp (q, p, t).q[3];
+				}
+			} break;
+			case OP_INVERSE_MAT4: {
+				for (int i = 0; i < n; i++) {
+					acc += inverse (mat4_at (data, i)).m[5];
+				}
+			} break;
+			default: return NAN; // op not in this library
+		}
+		sum += acc;
+	}
+	return sum;
+}
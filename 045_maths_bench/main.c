@@ -0,0 +1,173 @@
+//
+// GPU-free microbenchmark of the maths libraries used across these demos
+// anton gerdelan <gerdela@scss.tcd.ie>
+// trinity college dublin
+//
+// times mat4 x mat4, mat4 x vec4, normalise, quaternion slerp and mat4 inverse
+// on 1024 random inputs with each library below. transpose, cross, quaternion
+// multiply, look_at and project_points_soa are only timed for the first two:
+//   apg_maths      common/include/apg_maths.h, at each SIMD level the cpu has
+//   apg_maths_vec  common/include/apg_maths_vec.h (gcc/clang vector types)
+//   linmath        041_node_terrain/linmath.h
+//   clang_vectors  030_clang_vectors/apg_maths_clang.h (clang builds only)
+//   maths_funcs    028_more_cube/maths_funcs.cpp
+//
+// each op is run once to warm up, then -r times. ns_per_op is from the
+// fastest run. ipc is instructions per cycle over that run, from
+// perf_event_open() - it is left empty if the counters can't be opened, e.g.
+// not linux, or /proc/sys/kernel/perf_event_paranoid is too high.
+// checksums are sums of results and should agree to a few digits.
+//
+// usage: ./maths_bench [-r runs] [-json]
+// output is CSV on stdout: op,library,ns_per_op,ipc,checksum
+// or with -json an array of objects with the same fields
+//
+#ifdef __linux__
+#define _GNU_SOURCE // syscall()
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include "bench.h"
+#include "apg_bench.h"
+#include <math.h>
+#include <stdint.h>
+
+#define N_ITEMS 1024
+#define REPS 200
+
+static const char* op_names[OP_COUNT] = {
+	"mult_mat4_mat4", "mult_mat4_vec4", "normalise_vec3", "slerp_quat",
+	"inverse_mat4", "transpose_mat4", "cross_vec3", "mult_quat_quat", "look_at",
+	"project_points_soa"
+};
+
+/*-------------------------------PERF COUNTERS-------------------------------*/
+// cycles and instructions as one group so they count over the same interval
+static int g_perf_fd = -1;
+
+static void open_perf_counters () {
+#ifdef __linux__
+	struct perf_event_attr pe;
+	memset (&pe, 0, sizeof (pe));
+	pe.size = sizeof (pe);
+	pe.type = PERF_TYPE_HARDWARE;
+	pe.config = PERF_COUNT_HW_CPU_CYCLES;
+	pe.disabled = 1;
+	pe.exclude_kernel = 1;
+	pe.exclude_hv = 1;
+	pe.read_format = PERF_FORMAT_GROUP;
+	int leader = (int)syscall (__NR_perf_event_open, &pe, 0, -1, -1, 0);
+	if (leader < 0) {
+		fprintf (stderr, "WARNING: no perf counters. ipc will be empty\n");
+		return;
+	}
+	pe.config = PERF_COUNT_HW_INSTRUCTIONS;
+	pe.disabled = 0;
+	int fd = (int)syscall (__NR_perf_event_open, &pe, 0, -1, leader, 0);
+	if (fd < 0) {
+		fprintf (stderr, "WARNING: no instructions counter. ipc will be empty\n");
+		close (leader);
+		return;
+	}
+	g_perf_fd = leader;
+#endif
+}
+
+static void start_perf_counters () {
+#ifdef __linux__
+	if (g_perf_fd >= 0) {
+		ioctl (g_perf_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+		ioctl (g_perf_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	}
+#endif
+}
+
+// returns instructions per cycle since start_perf_counters() or -1
+static double stop_perf_counters () {
+#ifdef __linux__
+	if (g_perf_fd >= 0) {
+		ioctl (g_perf_fd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+		uint64_t buf[3]; // nr, cycles, instructions
+		if (read (g_perf_fd, buf, sizeof (buf)) == (ssize_t)sizeof (buf) &&
+			buf[1] > 0) {
+			return (double)buf[2] / (double)buf[1];
+		}
+	}
+#endif
+	return -1.0;
+}
+
+/*----------------------------------OUTPUT-----------------------------------*/
+static int g_json = 0, g_nrows = 0;
+
+static void print_row (const char* op, const char* lib, double ns, double ipc,
+	double checksum) {
+	char ipc_str[32] = "";
+	if (ipc >= 0.0) {
+		snprintf (ipc_str, sizeof (ipc_str), "%.2f", ipc);
+	}
+	if (g_json) {
+		printf ("%s\n  {\"op\": \"%s\", \"library\": \"%s\", \"ns_per_op\": %.2f, "
+			"\"ipc\": %s, \"checksum\": %.6g}", g_nrows > 0 ? "," : "[", op, lib, ns,
+			ipc >= 0.0 ? ipc_str : "null", checksum);
+	} else {
+		printf ("%s,%s,%.2f,%s,%.6g\n", op, lib, ns, ipc_str, checksum);
+	}
+	g_nrows++;
+	fflush (stdout);
+}
+
+static void time_op (int op, const char* lib, run_op_func run,
+	const float* data, int runs) {
+	if (isnan (run (op, data, N_ITEMS, 1))) { // also warms up
+		return; // not built in, or no such op
+	}
+	double best = 1e9, best_ipc = -1.0, checksum = 0.0;
+	for (int r = 0; r < runs; r++) {
+		start_perf_counters ();
+		double t0 = apg_time_s ();
+		checksum = run (op, data, N_ITEMS, REPS);
+		double t = apg_time_s () - t0;
+		double ipc = stop_perf_counters ();
+		if (t < best) {
+			best = t;
+			best_ipc = ipc;
+		}
+	}
+	print_row (op_names[op], lib, best * 1e9 / ((double)N_ITEMS * REPS),
+		best_ipc, checksum);
+}
+
+int main (int argc, char** argv) {
+	int runs = apg_bench_arg_int (argc, argv, "-r", 5);
+	g_json = apg_bench_arg_flag (argc, argv, "-json");
+	float* data = apg_bench_alloc_floats (N_ITEMS * 16);
+	srand (1);
+	for (int i = 0; i < N_ITEMS * 16; i++) {
+		data[i] = (float)rand () / (float)RAND_MAX * 2.0f - 1.0f;
+	}
+	open_perf_counters ();
+	int max_level = set_level_apg (2);
+	if (!g_json) {
+		printf ("op,library,ns_per_op,ipc,checksum\n");
+	}
+	for (int op = 0; op < OP_COUNT; op++) {
+		for (int level = 0; level <= max_level; level++) {
+			char lib[32];
+			snprintf (lib, sizeof (lib), "apg_maths_%s", apg_simd_level_name (level));
+			set_level_apg (level);
+			time_op (op, lib, run_op_apg, data, runs);
+		}
+		time_op (op, "apg_maths_vec", run_op_apg_vec, data, runs);
+		time_op (op, "linmath", run_op_linmath, data, runs);
+		time_op (op, "clang_vectors", run_op_clang, data, runs);
+		time_op (op, "maths_funcs", run_op_maths_funcs, data, runs);
+	}
+	if (g_json) {
+		printf ("%s]\n", g_nrows > 0 ? "\n" : "[");
+	}
+	free (data);
+	return 0;
+}
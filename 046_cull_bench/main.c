@@ -0,0 +1,99 @@
+//
+// GPU-free throughput benchmark for the frustum culling in apg_maths.h
+// anton gerdelan <gerdela@scss.tcd.ie>
+// trinity college dublin
+//
+// culls N random spheres and N random boxes (1M by default) against a
+// typical camera's frustum with each SIMD level the cpu has.
+// output is CSV on stdout:
+// op,level,objects,visible,seconds,mobjects_per_s
+//
+// seconds is the best of -r runs of one pass over all N objects. visible is
+// the number of bits set and should agree between levels, give or take a
+// few objects that touch a plane when FMA rounds differently.
+//
+// usage: ./cull_bench [-r runs] [-n objects]
+//
+#include "apg_maths.h"
+#include "apg_bench.h"
+
+static float rand_range (float min, float max) {
+	return (float)rand () / (float)RAND_MAX * (max - min) + min;
+}
+
+static int count_bits (const uint32_t* words, int n) {
+	int count = 0;
+	for (int i = 0; i < (n + 31) / 32; i++) {
+		for (uint32_t w = words[i]; w; w &= w - 1) {
+			count++;
+		}
+	}
+	return count;
+}
+
+int main (int argc, char** argv) {
+	int runs = apg_bench_arg_int (argc, argv, "-r", 5);
+	int n = apg_bench_arg_int (argc, argv, "-n", 1024 * 1024);
+	int max_level = set_maths_simd_level (APG_SIMD_AVX_FMA);
+	fprintf (stderr, "cpu supports up to %s\n",
+		apg_simd_level_name (max_level));
+
+	// spheres use xs,ys,zs and rs. boxes use the same centres and es as all 3
+	// half-sizes - the kernel reads 3 arrays either way
+	float* xs = apg_bench_alloc_floats (n);
+	float* ys = apg_bench_alloc_floats (n);
+	float* zs = apg_bench_alloc_floats (n);
+	float* rs = apg_bench_alloc_floats (n);
+	float* es = apg_bench_alloc_floats (n);
+	uint32_t* visible = (uint32_t*)malloc ((size_t)((n + 31) / 32) * 4);
+	if (!visible) {
+		fprintf (stderr, "ERROR: out of memory for %i objects\n", n);
+		return 1;
+	}
+	srand (1);
+	for (int i = 0; i < n; i++) {
+		xs[i] = rand_range (-100.0f, 100.0f);
+		ys[i] = rand_range (-100.0f, 100.0f);
+		zs[i] = rand_range (-100.0f, 100.0f);
+		rs[i] = rand_range (0.5f, 4.0f);
+		es[i] = rand_range (0.5f, 4.0f);
+	}
+	// a camera in the middle of the objects, so roughly 1/8 are visible and
+	// plenty are near a plane
+	mat4 P = perspective (67.0f, 16.0f / 9.0f, 0.1f, 100.0f);
+	mat4 V = look_at (vec3_from_3f (0.0f, 0.0f, 0.0f),
+		vec3_from_3f (0.3f, 0.2f, -1.0f), vec3_from_3f (0.0f, 1.0f, 0.0f));
+	frustum f = frustum_from_mat4 (mult_mat4_mat4 (P, V));
+
+	printf ("op,level,objects,visible,seconds,mobjects_per_s\n");
+	for (int op = 0; op < 2; op++) {
+		for (int level = 0; level <= max_level; level++) {
+			set_maths_simd_level ((apg_simd_level)level);
+			double best = 1e9;
+			for (int r = 0; r < runs; r++) {
+				double t0 = apg_time_s ();
+				if (0 == op) {
+					cull_spheres_soa (&f, xs, ys, zs, rs, n, visible);
+				} else {
+					cull_aabbs_soa (&f, xs, ys, zs, es, es, es, n, visible);
+				}
+				double t = apg_time_s () - t0;
+				if (t < best) {
+					best = t;
+				}
+			}
+			static const char* op_names[] = { "cull_spheres_soa", "cull_aabbs_soa" };
+			printf ("%s,%s,%i,%i,%.9f,%.1f\n", op_names[op],
+				apg_simd_level_name (level), n, count_bits (visible, n), best,
+				(double)n / best * 1e-6);
+			fflush (stdout);
+		}
+	}
+	free (xs);
+	free (ys);
+	free (zs);
+	free (rs);
+	free (es);
+	free (visible);
+	return 0;
+}
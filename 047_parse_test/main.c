@@ -0,0 +1,190 @@
+//
+// checks apg_parse_float() in apg_parse.h against strtof, bit for bit
+// anton gerdelan <gerdela@scss.tcd.ie>
+// trinity college dublin
+//
+// every string is parsed both ways and must give the same float bits and stop
+// at the same character. each is also parsed with end cut short at every
+// length, as happens at the end of a memory-mapped file with no terminator.
+// strings come from:
+// * a fixed list of edge cases - half-way ties, more than 19 digits,
+//   |exp10| > 22, denormals, overflow, inf/nan, hex, leading +/-/. and
+//   leading whitespace other than newlines
+// * random decimal strings, and floats printed at different precisions or
+//   exactly half-way between two neighbouring floats (+/- a little)
+// prints failures and a summary, and exits non-zero if anything differed.
+//
+// usage: ./parse_test [-n random_strings] [-s seed]
+//
+#include "apg_parse.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* edge_cases[] = {
+	// plain, and leading sign/point
+	"0", "-0", "+0", "0.0e0", "1", "+1", "-1", ".5", "-.5", "+.5", "5.", "-5.",
+	"+", "-", ".", "+.", "-.", "e5", ".e1", "1e", "1e+", "1.5e-", "-1.5E+3x",
+	"0001.2500", "1/2/3", "1.5 2.5",
+	// half-way between two floats, and either side of it
+	"16777217", "16777219", "16777216.999999999",
+	"1.000000059604644775390625", "1.0000000596046447753906251",
+	"1.0000000596046447753906249", "0.10000000894069671630859375",
+	"3.4028235677973366e38", "3.4028235677973365e38",
+	// just off half-way, but near enough that the nearest double is exactly
+	// half-way, so rounding via a double would tie the wrong way
+	"8.000001430511474", "8.000001430511475", "1.0000000596046448",
+	"16777217.000000001",
+	// more than 19 digits
+	"12345678901234567890123", "1234567890123456789.5",
+	"0.000000000000000000000000000012345678901234567890",
+	"00000000000000000000000000000001.5", "99999999999999999999999999999999",
+	"1.00000000000000000000000000000000000000000000000000000000000000000001",
+	// |exp10| > 22
+	"1e22", "1e23", "1e-22", "1e-23", "123e-30", "4.5e38", "1e-38",
+	"1e100000", "1e-100000",
+	// denormals and underflow
+	"1.17549435e-38", "1.1754942e-38", "1e-40", "1.4e-45", "1.401298464e-45",
+	"7.006492321624085e-46", "7.006492321624086e-46", "1e-46", "-1e-46",
+	// overflow
+	"3.4028235e38", "3.4028236e38", "3.5e38", "1e39", "-1e39",
+	// inf and nan
+	"inf", "-inf", "+inf", "INF", "infinity", "-Infinity", "infx", "nan",
+	"-nan", "NaN", "nan(123)", "in", "na",
+	// hex, which goes to strtof
+	"0x1A", "-0x1A", "+0X1p3", "0x.8p1", "0x1.fffffep127", "0x1p-149", "0x",
+	"0xg", "-0x", "0x1A/2",
+	// leading whitespace other than spaces and tabs. not '\n', which
+	// apg_parse_float deliberately stops at
+	"\v1.5", "\f-2.5", "\r3", " \t\v\f\r4e2", "\v\f", "\vinf", "\f0x10",
+};
+
+static int n_checked, n_failed;
+
+static void check_range (const char* str, size_t len) {
+	char copy[256];
+	if (len >= sizeof (copy)) {
+		return;
+	}
+	memcpy (copy, str, len);
+	copy[len] = '\0';
+	char* ref_end = copy;
+	float ref = strtof (copy, &ref_end);
+	size_t ref_used = (size_t)(ref_end - copy);
+
+	// parse the original, not the copy, so nothing past end can be read
+	float got = 12345.0f;
+	const char* got_end = apg_parse_float (str, str + len, &got);
+	size_t got_used = (size_t)(got_end - str);
+	uint32_t ref_bits, got_bits;
+	memcpy (&ref_bits, &ref, sizeof (ref_bits));
+	memcpy (&got_bits, &got, sizeof (got_bits));
+	n_checked++;
+	bool ok = got_used == ref_used && (0 == ref_used || got_bits == ref_bits);
+	if (!ok) {
+		if (n_failed < 20) {
+			fprintf (stderr, "FAIL \"%s\": strtof %.9g (0x%08x) used %i, "
+				"apg_parse_float %.9g (0x%08x) used %i\n", copy, ref,
+				(unsigned)ref_bits, (int)ref_used, got, (unsigned)got_bits,
+				(int)got_used);
+		}
+		n_failed++;
+	}
+}
+
+// the whole string, then every shorter end
+static void check (const char* str) {
+	size_t len = strlen (str);
+	for (size_t i = 0; i <= len; i++) {
+		check_range (str, len - i);
+	}
+}
+
+static int rand_n (int n) {
+	return rand () % n;
+}
+
+static void random_decimal (char* s) {
+	static const char* signs[] = { "", "", "-", "+" };
+	s += sprintf (s, "%s", signs[rand_n (4)]);
+	int n_int = rand_n (4) ? rand_n (10) : rand_n (26);
+	int n_frac = rand_n (4) ? rand_n (10) : rand_n (26);
+	for (int i = 0; i < n_int; i++) {
+		*s++ = (char)('0' + rand_n (10));
+	}
+	if (rand_n (4)) {
+		*s++ = '.';
+		for (int i = 0; i < n_frac; i++) {
+			*s++ = (char)('0' + rand_n (10));
+		}
+	}
+	if (rand_n (2)) {
+		*s++ = rand_n (2) ? 'e' : 'E';
+		s += sprintf (s, "%s", signs[rand_n (4)]);
+		s += sprintf (s, "%i", rand_n (3) ? rand_n (50) : rand_n (400));
+	}
+	*s = '\0';
+}
+
+// any finite float, spread over every exponent
+static float random_float () {
+	uint32_t bits = (uint32_t)rand () << 16 ^ (uint32_t)rand ();
+	float f;
+	memcpy (&f, &bits, sizeof (f));
+	return isfinite (f) ? f : 1.0f;
+}
+
+static void random_printed (char* s) {
+	float f = random_float ();
+	switch (rand_n (5)) {
+		case 0: sprintf (s, "%.9g", f); break;
+		case 1: sprintf (s, "%.6g", f); break;
+		case 2: sprintf (s, "%.17e", (double)f); break;
+		default: {
+			// half-way to the next float up is exact in a double, and so is its
+			// decimal expansion. nudge it by a last digit sometimes. at 16 digits
+			// the string is a little off half-way but its nearest double isn't
+			double next = (double)nextafterf (f, INFINITY);
+			double mid = ((double)f + next) * 0.5;
+			sprintf (s, rand_n (2) ? "%.60e" : "%.15e", mid);
+			char* e = strchr (s, 'e');
+			if (e && rand_n (2)) {
+				e[-1] = (char)(e[-1] == '0' ? '1' : e[-1] - 1);
+			}
+		} break;
+	}
+}
+
+int main (int argc, char** argv) {
+	int n_random = 1000000;
+	unsigned seed = 1;
+	for (int i = 1; i < argc - 1; i++) {
+		if (0 == strcmp (argv[i], "-n")) {
+			n_random = atoi (argv[++i]);
+		} else if (0 == strcmp (argv[i], "-s")) {
+			seed = (unsigned)atoi (argv[++i]);
+		}
+	}
+	int n_edge = (int)(sizeof (edge_cases) / sizeof (edge_cases[0]));
+	for (int i = 0; i < n_edge; i++) {
+		check (edge_cases[i]);
+	}
+	printf ("edge cases: %i strings, %i failed\n", n_edge, n_failed);
+
+	srand (seed);
+	char s[256];
+	for (int i = 0; i < n_random; i++) {
+		if (rand_n (2)) {
+			random_decimal (s);
+		} else {
+			random_printed (s);
+		}
+		// the whole string only, as the prefixes of a long one are mostly
+		// the same number again
+		check_range (s, strlen (s));
+	}
+	printf ("random: %i strings, %i checks in total, %i failed\n", n_random,
+		n_checked, n_failed);
+	return n_failed ? 1 : 0;
+}
@@ -0,0 +1,556 @@
+//
+// checks the SIMD kernels in apg_maths.h against the scalar ones
+// anton gerdelan <gerdela@scss.tcd.ie>
+// trinity college dublin
+//
+// each kernel is run at every SIMD level the cpu has, on the same inputs, and
+// compared with the scalar level:
+// * SSE2 adds the products in the scalar order, so it must be bit-exact
+// * AVX_FMA skips the rounding of each product, so it may differ by up to
+//   4 ULP of the sum of the absolute products, |a0*b0| + |a1*b1| + ...
+// covered are:
+// * mult_mat4_mat4 and mult_mat4_vec4, also through the in-place (r == a)
+//   pointer versions, which must match the out-of-place ones exactly. inputs
+//   are random matrices with exponents spread over 2^-20 - 2^20, and a few
+//   edge cases - identity, zeros, large-magnitude cancellation
+// * transform_points_soa and project_points_soa, at sizes around the 4 and 8
+//   wide blocks, and in place. for projection the AVX_FMA allowance grows with
+//   the divide by w
+// * cull_spheres_soa and cull_aabbs_soa bitmasks, with a quarter of the
+//   objects touching a plane. AVX_FMA may only flip those
+// * inverse_rigid_mat4, inverse_affine_mat4 and view_from_quat_pos, which
+//   have no SIMD paths, against inverse_mat4 to ~1e-5
+// before any of that, 8 threads make their first maths call at the same
+// time, to exercise the one-time kernel selection; build with
+// -fsanitize=thread to check it. exits non-zero if anything differed.
+//
+// usage: ./maths_test [-n random_cases] [-s seed]
+//
+#define _POSIX_C_SOURCE 200112L // pthread_barrier_t
+#include "apg_maths.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#define N_THREADS 8
+
+static int n_checked, n_failed;
+static const char* level_names[] = { "scalar", "sse2", "avx_fma" };
+
+static pthread_barrier_t start_barrier;
+static apg_simd_level thread_levels[N_THREADS];
+static mat4 thread_results[N_THREADS];
+
+static void* first_use_thread (void* arg) {
+	int i = (int)(size_t)arg;
+	mat4 a = rot_y_deg_mat4 (30.0f + (float)i);
+	pthread_barrier_wait (&start_barrier);
+	thread_results[i] = mult_mat4_mat4 (a, translate_mat4 (vec3_from_3f (1.0f,
+		2.0f, 3.0f)));
+	thread_levels[i] = get_maths_simd_level ();
+	return NULL;
+}
+
+// every thread must pick the same, best, level and use working kernels
+static void check_first_use () {
+	pthread_t threads[N_THREADS];
+	pthread_barrier_init (&start_barrier, NULL, N_THREADS);
+	for (int i = 0; i < N_THREADS; i++) {
+		pthread_create (&threads[i], NULL, first_use_thread, (void*)(size_t)i);
+	}
+	for (int i = 0; i < N_THREADS; i++) {
+		pthread_join (threads[i], NULL);
+	}
+	pthread_barrier_destroy (&start_barrier);
+	apg_simd_level best = set_maths_simd_level (APG_SIMD_AVX_FMA);
+	for (int i = 0; i < N_THREADS; i++) {
+		mat4 expected = mult_mat4_mat4 (rot_y_deg_mat4 (30.0f + (float)i),
+			translate_mat4 (vec3_from_3f (1.0f, 2.0f, 3.0f)));
+		n_checked++;
+		if (thread_levels[i] != best ||
+			0 != memcmp (&expected, &thread_results[i], sizeof (mat4))) {
+			fprintf (stderr, "FAIL first use: thread %i got level %s, expected %s\n",
+				i, level_names[thread_levels[i]], level_names[best]);
+			n_failed++;
+		}
+	}
+	printf ("first use from %i threads: level %s, %i failed\n", N_THREADS,
+		level_names[best], n_failed);
+}
+
+static float ulp (float x) {
+	x = fabsf (x);
+	return nextafterf (x, INFINITY) - x;
+}
+
+// 4 ULP of the sum of the absolute terms - what fma may change a sum by
+static double fma_error (double abs_sum) {
+	return 4.0 * (double)ulp ((float)abs_sum);
+}
+
+/* got vs the scalar result ref for one value. AVX_FMA may be off by up to
+   avx_error, anything else must match exactly */
+static void check_value (const char* what, apg_simd_level level, int element,
+	float ref, float got, double avx_error) {
+	n_checked++;
+	bool ok;
+	if (APG_SIMD_AVX_FMA == level) {
+		ok = fabs ((double)got - (double)ref) <= avx_error;
+	} else {
+		ok = 0 == memcmp (&ref, &got, sizeof (float));
+	}
+	if (!ok) {
+		if (n_failed < 20) {
+			fprintf (stderr, "FAIL %s %s [%i]: scalar %.9g, got %.9g, "
+				"allowed error %.3g\n", what, level_names[level], element, ref, got,
+				avx_error);
+		}
+		n_failed++;
+	}
+}
+
+/* as check_value, where abs_sum is the sum of the absolute products that went
+   into the element */
+static void check_element (const char* what, apg_simd_level level, int element,
+	float ref, float got, double abs_sum) {
+	check_value (what, level, element, ref, got, fma_error (abs_sum));
+}
+
+// runs a * b and m * v at every level and checks each against scalar
+static void check_case (const mat4* a, const mat4* b, const vec4* v) {
+	set_maths_simd_level (APG_SIMD_SCALAR);
+	mat4 ref_mm = mult_mat4_mat4 (*a, *b);
+	vec4 ref_mv = mult_mat4_vec4 (*a, *v);
+	double abs_mm[16], abs_mv[4];
+	for (int col = 0; col < 4; col++) {
+		for (int row = 0; row < 4; row++) {
+			abs_mm[col * 4 + row] = 0.0;
+			for (int i = 0; i < 4; i++) {
+				abs_mm[col * 4 + row] += fabs ((double)a->m[row + i * 4] *
+					(double)b->m[i + col * 4]);
+			}
+		}
+	}
+	for (int row = 0; row < 4; row++) {
+		abs_mv[row] = 0.0;
+		for (int i = 0; i < 4; i++) {
+			abs_mv[row] += fabs ((double)a->m[row + i * 4] * (double)v->v[i]);
+		}
+	}
+	for (int l = APG_SIMD_SCALAR; l <= APG_SIMD_AVX_FMA; l++) {
+		apg_simd_level level = set_maths_simd_level ((apg_simd_level)l);
+		if (level != (apg_simd_level)l) {
+			break; // cpu doesn't have it
+		}
+		mat4 mm = mult_mat4_mat4 (*a, *b);
+		vec4 mv = mult_mat4_vec4 (*a, *v);
+		for (int i = 0; i < 16; i++) {
+			check_element ("mult_mat4_mat4", level, i, ref_mm.m[i], mm.m[i],
+				abs_mm[i]);
+		}
+		for (int i = 0; i < 4; i++) {
+			check_element ("mult_mat4_vec4", level, i, ref_mv.v[i], mv.v[i],
+				abs_mv[i]);
+		}
+		// in place must give what out of place did at the same level
+		mat4 in_place = *a;
+		mult_mat4_mat4_p (&in_place, b, &in_place);
+		vec4 in_place_v = *v;
+		mult_mat4_vec4_p (a, &in_place_v, &in_place_v);
+		n_checked++;
+		if (0 != memcmp (&in_place, &mm, sizeof (mat4)) ||
+			0 != memcmp (&in_place_v, &mv, sizeof (vec4))) {
+			fprintf (stderr, "FAIL in-place %s\n", level_names[level]);
+			n_failed++;
+		}
+	}
+}
+
+static int rand_n (int n) {
+	return rand () % n;
+}
+
+// random sign and mantissa, exponent anywhere in 2^-20 - 2^20
+static float random_float () {
+	float mantissa = (float)rand () / (float)RAND_MAX;
+	float f = ldexpf (mantissa, rand_n (41) - 20);
+	return rand_n (2) ? -f : f;
+}
+
+static void check_edge_cases () {
+	mat4 zero, big, id = identity_mat4 ();
+	vec4 v = vec4_from_4f (1.0f, -2.0f, 3.0f, 1.0f);
+	memset (&zero, 0, sizeof (mat4));
+	check_case (&id, &id, &v);
+	check_case (&zero, &id, &v);
+	// +1e20 and -1e20 products around small ones - the small terms are lost
+	// in scalar but fma keeps more of them
+	for (int i = 0; i < 16; i++) {
+		big.m[i] = (i & 1 ? -1e10f : 1e10f) * (1.0f + (float)i * 0.1f);
+	}
+	vec4 bv = vec4_from_4f (1e10f, 1e10f, 1e-10f, 3.0f);
+	check_case (&big, &big, &bv);
+	mat4 rot = mult_mat4_mat4 (rot_x_deg_mat4 (33.0f), rot_z_deg_mat4 (-71.0f));
+	mat4 P = perspective (67.0f, 1.6f, 0.1f, 1000.0f);
+	check_case (&P, &rot, &v);
+}
+
+/*------------------------------BATCH TRANSFORMS------------------------------*/
+// tails of 1-7 points and whole blocks of 4 and 8, around the kernel widths
+static const int soa_sizes[] = { 0, 1, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 33,
+	1000, 1003 };
+#define N_SOA_SIZES (int)(sizeof (soa_sizes) / sizeof (soa_sizes[0]))
+#define MAX_SOA 1003
+
+static float soa_in[3][MAX_SOA], soa_ref[4][MAX_SOA], soa_got[4][MAX_SOA];
+
+static void run_points_soa (bool project, const mat4* m, vec4 viewport, int n,
+	float out[4][MAX_SOA]) {
+	if (project) {
+		project_points_soa (*m, soa_in[0], soa_in[1], soa_in[2], n, viewport,
+			out[0], out[1], out[2], out[3]);
+	} else {
+		transform_points_soa (*m, soa_in[0], soa_in[1], soa_in[2], n, out[0],
+			out[1], out[2], out[3]);
+	}
+}
+
+/* what AVX_FMA may change element c of point i by. clip-space values are
+   sums of products. projected values divide those by w, which scales both
+   their error and w's, before a viewport multiply-add */
+static double points_soa_error (bool project, const mat4* m, vec4 viewport,
+	int i, int c, float ref) {
+	double p[3] = { soa_in[0][i], soa_in[1][i], soa_in[2][i] };
+	double clip[4], abs_sum[4];
+	for (int row = 0; row < 4; row++) {
+		clip[row] = m->m[12 + row];
+		abs_sum[row] = fabs ((double)m->m[12 + row]);
+		for (int k = 0; k < 3; k++) {
+			clip[row] += (double)m->m[row + k * 4] * p[k];
+			abs_sum[row] += fabs ((double)m->m[row + k * 4] * p[k]);
+		}
+	}
+	if (!project) {
+		return fma_error (abs_sum[c]);
+	}
+	double w = fabs (clip[3]), w_error = fma_error (abs_sum[3]);
+	if (3 == c) {
+		return w_error / (w * w) + fma_error (fabs (ref));
+	}
+	double ndc = clip[c] / w;
+	double ndc_error = (fma_error (abs_sum[c]) + fabs (ndc) * w_error) / w;
+	double scale = 0 == c ? viewport.v[2] * 0.5 : 1 == c ? viewport.v[3] * 0.5 :
+		0.5;
+	return fabs (scale) * (ndc_error + fma_error (fabs (ndc) + 1.0)) +
+		fma_error (fabs (ref));
+}
+
+/* transform_points_soa and project_points_soa at every level against scalar,
+   and in place (outputs over the inputs) against out of place */
+static void check_points_soa (bool project, const mat4* m, vec4 viewport) {
+	const char* what = project ? "project_points_soa" : "transform_points_soa";
+	for (int s = 0; s < N_SOA_SIZES; s++) {
+		int n = soa_sizes[s];
+		set_maths_simd_level (APG_SIMD_SCALAR);
+		run_points_soa (project, m, viewport, n, soa_ref);
+		for (int l = APG_SIMD_SCALAR; l <= APG_SIMD_AVX_FMA; l++) {
+			apg_simd_level level = set_maths_simd_level ((apg_simd_level)l);
+			if (level != (apg_simd_level)l) {
+				break;
+			}
+			run_points_soa (project, m, viewport, n, soa_got);
+			for (int i = 0; i < n; i++) {
+				for (int c = 0; c < 4; c++) {
+					check_value (what, level, i * 4 + c, soa_ref[c][i], soa_got[c][i],
+						points_soa_error (project, m, viewport, i, c, soa_ref[c][i]));
+				}
+			}
+			float in_place[4][MAX_SOA];
+			for (int c = 0; c < 3; c++) {
+				memcpy (in_place[c], soa_in[c], (size_t)n * sizeof (float));
+			}
+			if (project) {
+				project_points_soa (*m, in_place[0], in_place[1], in_place[2], n,
+					viewport, in_place[0], in_place[1], in_place[2], in_place[3]);
+			} else {
+				transform_points_soa (*m, in_place[0], in_place[1], in_place[2], n,
+					in_place[0], in_place[1], in_place[2], in_place[3]);
+			}
+			n_checked++;
+			for (int c = 0; c < 4; c++) {
+				if (0 != memcmp (in_place[c], soa_got[c], (size_t)n * sizeof (float))) {
+					fprintf (stderr, "FAIL in-place %s %s n=%i\n", what,
+						level_names[level], n);
+					n_failed++;
+					break;
+				}
+			}
+		}
+	}
+}
+
+// a random matrix with random points, then a camera with points in front of it
+static void check_batch_transforms () {
+	mat4 m;
+	for (int i = 0; i < 16; i++) {
+		m.m[i] = random_float ();
+	}
+	for (int i = 0; i < MAX_SOA; i++) {
+		for (int c = 0; c < 3; c++) {
+			soa_in[c][i] = random_float ();
+		}
+	}
+	vec4 viewport = vec4_from_4f (0.0f, 1080.0f, 1920.0f, -1080.0f);
+	check_points_soa (false, &m, viewport);
+
+	mat4 P = perspective (67.0f, 16.0f / 9.0f, 0.1f, 100.0f);
+	mat4 V = look_at (vec3_from_3f (3.0f, 2.0f, 10.0f),
+		vec3_from_3f (0.0f, 0.0f, 0.0f), vec3_from_3f (0.0f, 1.0f, 0.0f));
+	mat4 PV = mult_mat4_mat4 (P, V);
+	// within 8 of the origin, so at least 2.5 in front of the camera
+	for (int i = 0; i < MAX_SOA; i++) {
+		for (int c = 0; c < 3; c++) {
+			soa_in[c][i] = (float)rand () / (float)RAND_MAX * 9.2f - 4.6f;
+		}
+	}
+	check_points_soa (false, &PV, viewport);
+	check_points_soa (true, &PV, viewport);
+}
+
+/*----------------------------------CULLING-----------------------------------*/
+#define N_CULL 20000
+
+static float cull_in[7][N_CULL]; // x, y, z, r, ex, ey, ez
+static int n_cull_flips; // AVX_FMA differences on objects touching a plane
+static uint32_t cull_ref[N_CULL / 32 + 1], cull_got[N_CULL / 32 + 1];
+
+static void run_cull (bool boxes, const frustum* f, int n, uint32_t* visible) {
+	if (boxes) {
+		cull_aabbs_soa (f, cull_in[0], cull_in[1], cull_in[2], cull_in[4],
+			cull_in[5], cull_in[6], n, visible);
+	} else {
+		cull_spheres_soa (f, cull_in[0], cull_in[1], cull_in[2], cull_in[3], n,
+			visible);
+	}
+}
+
+// how far object i reaches back across plane p, and the sum of its abs terms
+static double cull_reach (bool boxes, const float* p, int i, double* abs_sum) {
+	if (!boxes) {
+		*abs_sum = cull_in[3][i];
+		return cull_in[3][i];
+	}
+	double reach = 0.0;
+	for (int k = 0; k < 3; k++) {
+		reach += fabs ((double)p[k]) * (double)cull_in[4 + k][i];
+	}
+	*abs_sum = reach;
+	return reach;
+}
+
+/* fma may only flip an object that touches a plane, i.e. one whose distance
+   to it is within rounding of its reach */
+static bool touches_a_plane (bool boxes, const frustum* f, int i) {
+	for (int j = 0; j < 6; j++) {
+		const float* p = f->planes[j].v;
+		double reach_sum, reach = cull_reach (boxes, p, i, &reach_sum);
+		double d = p[3], d_sum = fabs ((double)p[3]);
+		for (int k = 0; k < 3; k++) {
+			d += (double)p[k] * (double)cull_in[k][i];
+			d_sum += fabs ((double)p[k] * (double)cull_in[k][i]);
+		}
+		if (fabs (d + reach) <= fma_error (d_sum) + fma_error (reach_sum)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/* the visibility bits at every level against scalar. SSE2 must match
+   exactly. AVX_FMA may only differ on objects touching a plane. bits past n
+   must be clear either way */
+static void check_cull (bool boxes, const frustum* f, int n) {
+	const char* what = boxes ? "cull_aabbs_soa" : "cull_spheres_soa";
+	int n_words = (n + 31) / 32;
+	set_maths_simd_level (APG_SIMD_SCALAR);
+	run_cull (boxes, f, n, cull_ref);
+	for (int l = APG_SIMD_SCALAR; l <= APG_SIMD_AVX_FMA; l++) {
+		apg_simd_level level = set_maths_simd_level ((apg_simd_level)l);
+		if (level != (apg_simd_level)l) {
+			break;
+		}
+		memset (cull_got, 0xFF, sizeof (cull_got)); // must be overwritten
+		run_cull (boxes, f, n, cull_got);
+		for (int i = 0; i < n; i++) {
+			bool ref = cull_ref[i >> 5] & (1u << (i & 31));
+			bool got = cull_got[i >> 5] & (1u << (i & 31));
+			n_checked++;
+			if (ref != got && APG_SIMD_AVX_FMA == level &&
+				touches_a_plane (boxes, f, i)) {
+				n_cull_flips++;
+			} else if (ref != got) {
+				if (n_failed < 20) {
+					fprintf (stderr, "FAIL %s %s object %i: scalar %i, got %i\n", what,
+						level_names[level], i, ref, got);
+				}
+				n_failed++;
+			}
+		}
+		n_checked++;
+		if (n % 32 && cull_got[n_words - 1] >> (n % 32)) {
+			fprintf (stderr, "FAIL %s %s n=%i: bits set past n\n", what,
+				level_names[level], n);
+			n_failed++;
+		}
+	}
+}
+
+/* random spheres and boxes around a camera, a quarter of them moved to touch
+   a random plane exactly, where the SIMD and scalar tests are most likely to
+   disagree */
+static void check_culling () {
+	mat4 P = perspective (67.0f, 16.0f / 9.0f, 0.1f, 100.0f);
+	mat4 V = look_at (vec3_from_3f (0.0f, 0.0f, 0.0f),
+		vec3_from_3f (0.3f, 0.2f, -1.0f), vec3_from_3f (0.0f, 1.0f, 0.0f));
+	frustum f = frustum_from_mat4 (mult_mat4_mat4 (P, V));
+	for (int boxes = 0; boxes < 2; boxes++) {
+		for (int i = 0; i < N_CULL; i++) {
+			for (int c = 0; c < 3; c++) {
+				cull_in[c][i] = (float)rand () / (float)RAND_MAX * 60.0f - 30.0f;
+			}
+			for (int c = 3; c < 7; c++) {
+				cull_in[c][i] = (float)rand () / (float)RAND_MAX * 4.0f;
+			}
+			if (rand_n (4)) {
+				continue;
+			}
+			// d + reach = 0 in float for plane j
+			const float* p = f.planes[rand_n (6)].v;
+			double reach_sum, reach = cull_reach (boxes, p, i, &reach_sum);
+			float d = p[0] * cull_in[0][i] + p[1] * cull_in[1][i] +
+				p[2] * cull_in[2][i] + p[3];
+			for (int c = 0; c < 3; c++) {
+				cull_in[c][i] -= (float)((d + reach) * p[c]);
+			}
+		}
+		for (int s = 0; s < N_SOA_SIZES; s++) {
+			check_cull (boxes, &f, soa_sizes[s]);
+		}
+		check_cull (boxes, &f, N_CULL);
+	}
+}
+
+/*------------------------------CHEAPER INVERSES------------------------------*/
+// |a - b| within tolerance of the largest element of b, for every element
+static void check_close (const char* what, const mat4* ref, const mat4* got,
+	float tolerance) {
+	float biggest = 1.0f;
+	for (int i = 0; i < 16; i++) {
+		biggest = fmaxf (biggest, fabsf (ref->m[i]));
+	}
+	n_checked++;
+	for (int i = 0; i < 16; i++) {
+		if (fabsf (got->m[i] - ref->m[i]) > tolerance * biggest) {
+			if (n_failed < 20) {
+				fprintf (stderr, "FAIL %s [%i]: inverse_mat4 %.9g, got %.9g\n", what,
+					i, ref->m[i], got->m[i]);
+			}
+			n_failed++;
+			return;
+		}
+	}
+}
+
+static vec3 random_vec3 (float range) {
+	return vec3_from_3f (((float)rand () / (float)RAND_MAX * 2.0f - 1.0f) * range,
+		((float)rand () / (float)RAND_MAX * 2.0f - 1.0f) * range,
+		((float)rand () / (float)RAND_MAX * 2.0f - 1.0f) * range);
+}
+
+static versor random_versor () {
+	vec3 axis = normalise_vec3 (random_vec3 (1.0f));
+	return quat_from_axis_deg ((float)rand () / (float)RAND_MAX * 360.0f,
+		axis.v[0], axis.v[1], axis.v[2]);
+}
+
+/* inverse_rigid_mat4, inverse_affine_mat4 and view_from_quat_pos against the
+   general inverse_mat4. the scale in the affine ones is kept to 0.25 - 4 so
+   the matrices are well enough conditioned for both to agree to ~1e-5 */
+static void check_inverses (int n_cases) {
+	for (int c = 0; c < n_cases; c++) {
+		versor q = random_versor ();
+		vec3 pos = random_vec3 (100.0f);
+		mat4 R = quat_to_mat4 (q);
+		mat4 T = translate_mat4 (pos);
+		mat4 rigid = mult_mat4_mat4 (T, R);
+		mat4 ref = inverse_mat4 (rigid);
+		mat4 got = inverse_rigid_mat4 (rigid);
+		check_close ("inverse_rigid_mat4", &ref, &got, 1e-5f);
+		got = view_from_quat_pos (q, pos);
+		check_close ("view_from_quat_pos", &ref, &got, 1e-5f);
+
+		vec3 sv = random_vec3 (1.0f);
+		for (int i = 0; i < 3; i++) {
+			sv.v[i] = exp2f (sv.v[i] * 2.0f); // 0.25 - 4
+		}
+		mat4 affine = mult_mat4_mat4 (T, mult_mat4_mat4 (R,
+			mult_mat4_mat4 (scale_mat4 (sv), quat_to_mat4 (random_versor ()))));
+		ref = inverse_mat4 (affine);
+		got = inverse_affine_mat4 (affine);
+		check_close ("inverse_affine_mat4", &ref, &got, 1e-5f);
+
+		// in place must give what out of place did
+		mat4 in_place = rigid;
+		inverse_rigid_mat4_p (&in_place, &in_place);
+		mat4 in_place_affine = affine;
+		inverse_affine_mat4_p (&in_place_affine, &in_place_affine);
+		mat4 out_of_place = inverse_rigid_mat4 (rigid);
+		n_checked++;
+		if (0 != memcmp (&in_place, &out_of_place, sizeof (mat4)) ||
+			0 != memcmp (&in_place_affine, &got, sizeof (mat4))) {
+			fprintf (stderr, "FAIL in-place inverse_rigid/affine_mat4\n");
+			n_failed++;
+		}
+	}
+}
+
+int main (int argc, char** argv) {
+	int n_random = 100000;
+	unsigned seed = 1;
+	for (int i = 1; i < argc - 1; i++) {
+		if (0 == strcmp (argv[i], "-n")) {
+			n_random = atoi (argv[++i]);
+		} else if (0 == strcmp (argv[i], "-s")) {
+			seed = (unsigned)atoi (argv[++i]);
+		}
+	}
+	check_first_use ();
+	check_edge_cases ();
+	printf ("edge cases: %i checks, %i failed\n", n_checked, n_failed);
+
+	srand (seed);
+	for (int c = 0; c < n_random; c++) {
+		mat4 a, b;
+		vec4 v;
+		for (int i = 0; i < 16; i++) {
+			a.m[i] = random_float ();
+			b.m[i] = random_float ();
+		}
+		for (int i = 0; i < 4; i++) {
+			v.v[i] = random_float ();
+		}
+		check_case (&a, &b, &v);
+	}
+	printf ("random: %i cases, %i checks in total, %i failed\n", n_random,
+		n_checked, n_failed);
+
+	check_batch_transforms ();
+	printf ("batch transforms: %i checks in total, %i failed\n", n_checked,
+		n_failed);
+	check_culling ();
+	printf ("culling: %i checks in total, %i failed, %i allowed fma flips\n",
+		n_checked, n_failed, n_cull_flips);
+	check_inverses (n_random / 10);
+	printf ("inverses: %i checks in total, %i failed\n", n_checked, n_failed);
+	return n_failed ? 1 : 0;
+}
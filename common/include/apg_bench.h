@@ -0,0 +1,64 @@
+/*****************************************************************************\
+| Anton's micro-benchmark helpers. C99 and C++                                |
+| Email: anton at antongerdelan dot net                                       |
+| Copyright Dr Anton Gerdelan                                                 |
+|*****************************************************************************|
+| Header-only bits shared by the GPU-free benchmarks (044, 045, 046):         |
+| a monotonic clock, allocation that gives up loudly, names for the           |
+| apg_maths.h SIMD levels, and "-flag value" command-line parsing.            |
+| Each benchmark keeps its own timing loop, as what goes inside it differs.   |
+| Build with _POSIX_C_SOURCE >= 199309L on linux for clock_gettime().         |
+\*****************************************************************************/
+#pragma once
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// seconds from an arbitrary start. only differences mean anything
+static inline double apg_time_s () {
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// n floats, or exits with an error. a benchmark can't do anything useful
+// without its data. malloc (0) may return NULL, which isn't an error here
+static inline float* apg_bench_alloc_floats (int n) {
+	float* f = (float*)malloc ((size_t)n * sizeof (float));
+	if (!f && n > 0) {
+		fprintf (stderr, "ERROR: out of memory for %i floats\n", n);
+		exit (1);
+	}
+	return f;
+}
+
+// names for apg_maths.h's apg_simd_level values, for output columns
+static inline const char* apg_simd_level_name (int level) {
+	static const char* names[] = { "scalar", "sse2", "avx_fma" };
+	return level >= 0 && level < 3 ? names[level] : "unknown";
+}
+
+// the integer after "flag" on the command line, or default_value if absent
+static inline int apg_bench_arg_int (int argc, char** argv, const char* flag,
+	int default_value) {
+	for (int i = 1; i < argc - 1; i++) {
+		if (0 == strcmp (argv[i], flag)) {
+			return atoi (argv[i + 1]);
+		}
+	}
+	return default_value;
+}
+
+// true if "flag" appears on its own anywhere on the command line
+static inline bool apg_bench_arg_flag (int argc, char** argv,
+	const char* flag) {
+	for (int i = 1; i < argc; i++) {
+		if (0 == strcmp (argv[i], flag)) {
+			return true;
+		}
+	}
+	return false;
+}
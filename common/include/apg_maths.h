@@ -18,6 +18,24 @@
 #define _USE_MATH_DEFINES
 #include <math.h>
 #include <string.h> // memset, memcpy
+#include <stdint.h> // uint32_t
+
+// SIMD kernels for the mat4 multiplies. SSE2 is part of x86-64 so it is always
+// compiled in there; AVX+FMA is compiled in too but only called if CPUID says
+// the cpu and OS support it. define APG_MATHS_NO_SIMD to get the plain C loops
+#if !defined(APG_MATHS_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || \
+	(defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define APG_MATHS_SSE2
+#include <emmintrin.h>
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define APG_TARGET_AVX_FMA
+#else
+#include <cpuid.h>
+#define APG_TARGET_AVX_FMA __attribute__ ((target ("avx,fma")))
+#endif
+#endif
 
 // C99 removed M_PI
 #ifndef M_PI
@@ -34,6 +52,7 @@ typedef struct vec3 vec3;
 typedef struct vec4 vec4;
 typedef struct mat4 mat4;
 typedef struct versor versor;
+typedef struct frustum frustum;
 
 // xy
 struct vec2 {
@@ -64,6 +83,13 @@ struct versor {
 	float q[4];
 };
 
+// the 6 clip planes of a camera, as (a,b,c,d) with a*x + b*y + c*z + d >= 0
+// on the inside. order is left, right, bottom, top, near, far. a,b,c is unit
+// length so d is a distance, which the sphere test relies on
+struct frustum {
+	vec4 planes[6];
+};
+
 // print functions
 void print_vec2 (vec2 v);
 void print_vec3 (vec3 v);
@@ -134,9 +160,16 @@ mat4 mat4_from_mat4 (mat4 mm);
 
 // matrix functions -- linear algebra
 mat4 mult_mat4_mat4 (mat4 a, mat4 b);
+// transform a vector e.g. a point with w=1 or a direction with w=0
+vec4 mult_mat4_vec4 (mat4 m, vec4 v);
 // determinant
 float det_mat4 (mat4 mm);
 mat4 inverse_mat4 (mat4 mm);
+// cheaper inverses when the matrix is known to be rotation + translation only
+// (rigid), or rotation/scale/shear + translation with a 0,0,0,1 bottom row
+// (affine). no check is done that the matrix really is of that kind
+mat4 inverse_rigid_mat4 (mat4 mm);
+mat4 inverse_affine_mat4 (mat4 mm);
 mat4 transpose_mat4 (mat4 mm);
 
 // matrix functions -- affine functions
@@ -151,6 +184,68 @@ mat4 scale_mat4 (vec3 v);
 // matrix functions -- camera functions
 mat4 look_at (vec3 cam_pos, vec3 targ_pos, vec3 up);
 mat4 perspective (float fovy, float aspect, float near, float far);
+// view matrix of a camera with orientation q at pos, i.e. the same as
+// inverse (translate (pos) * quat_to_mat4 (q)) but without the inverses
+mat4 view_from_quat_pos (versor q, vec3 pos);
+
+// matrix functions -- pointer versions
+// these read their inputs through const pointers and write to r instead of
+// copying 64-byte matrices on and off the stack; the value functions are
+// wrappers around them. r may point at an input, so they also work in place,
+// e.g. mult_mat4_mat4_p (&M, &T, &M) or inverse_mat4_p (&V, &V)
+void mult_mat4_mat4_p (const mat4* a, const mat4* b, mat4* r);
+void mult_mat4_vec4_p (const mat4* m, const vec4* v, vec4* r);
+float det_mat4_p (const mat4* mm);
+void inverse_mat4_p (const mat4* mm, mat4* r);
+void inverse_rigid_mat4_p (const mat4* mm, mat4* r);
+void inverse_affine_mat4_p (const mat4* mm, mat4* r);
+void transpose_mat4_p (const mat4* mm, mat4* r);
+void view_from_quat_pos_p (const versor* q, const vec3* pos, mat4* r);
+
+// batch transforms -- structure-of-arrays points, i.e. separate x, y and z
+// arrays, with w taken as 1. these run 4 or 8 points per instruction.
+// an output array may be the same as an input array but not partly overlap it
+// writes clip-space x,y,z,w
+void transform_points_soa (mat4 m, const float* xs, const float* ys,
+	const float* zs, int n, float* rxs, float* rys, float* rzs, float* rws);
+// also divides by w and maps to viewport (x, y, width, height) like
+// glViewport. depth goes to 0..1 and rws gets 1/w for perspective-correct
+// interpolation. a negative height flips y, for top-left origin images.
+// points with w <= 0 (behind the camera) come out as garbage - clip first
+void project_points_soa (mat4 m, const float* xs, const float* ys,
+	const float* zs, int n, vec4 viewport, float* rxs, float* rys, float* rzs,
+	float* rws);
+
+// frustum culling -- planes from a P*V matrix, after Gribb and Hartmann. from
+// P*V*M they come out in that model's local space instead of world space
+frustum frustum_from_mat4 (mat4 pv);
+void frustum_from_mat4_p (const mat4* pv, frustum* r);
+// batch tests, structure-of-arrays like the transforms, 4 or 8 objects per
+// instruction. bit (i & 31) of visible[i / 32] is set if object i is at least
+// partly inside. visible must have (n + 31) / 32 words and is overwritten.
+// the tests are conservative: a big object just off a corner of the frustum
+// can still count as visible
+// spheres with centres xs,ys,zs and radii rs
+void cull_spheres_soa (const frustum* f, const float* xs, const float* ys,
+	const float* zs, const float* rs, int n, uint32_t* visible);
+// axis-aligned boxes with centres cxs,cys,czs and half-sizes exs,eys,ezs
+void cull_aabbs_soa (const frustum* f, const float* cxs, const float* cys,
+	const float* czs, const float* exs, const float* eys, const float* ezs,
+	int n, uint32_t* visible);
+
+// SIMD kernel selection -- picked from CPUID on first use. the SSE2 kernels
+// give bit-identical results to the scalar ones. FMA skips the rounding of
+// each product, so AVX_FMA results can differ from scalar by up to 4 ULP of
+// the sum of the absolute products (e.g. |a0*b0| + |a1*b1| + ...)
+typedef enum apg_simd_level {
+	APG_SIMD_SCALAR = 0, APG_SIMD_SSE2, APG_SIMD_AVX_FMA
+} apg_simd_level;
+apg_simd_level get_maths_simd_level ();
+// asks for a level, e.g. to compare or time the kernels. returns the level
+// actually used, which is capped at what the cpu supports. first use is
+// thread-safe, but switching levels is not - call this before starting any
+// threads that use the maths functions. the choice applies program-wide
+apg_simd_level set_maths_simd_level (apg_simd_level level);
 
 // quaternion functions -- construction and assignment
 versor versor_from_4f (float x, float y, float z, float w);
@@ -171,6 +266,10 @@ mat4 quat_to_mat4 (versor q);
 float dot_quat (versor q, versor r);
 versor normalise_quat (versor q);
 
+// quaternion functions -- pointer versions, as for the matrix ones above
+void mult_quat_quat_p (const versor* a, const versor* b, versor* r);
+void quat_to_mat4_p (const versor* q, mat4* r);
+
 // quaternion functions -- interpolation
 versor slerp (versor q, versor r);
 versor slerp_quat (versor q, versor r, float t);
@@ -423,170 +522,814 @@ inline mat4 mat4_from_mat4 (mat4 mm) {
 	return r;
 }
 
-//
-inline mat4 mult_mat4_mat4 (mat4 a, mat4 b) {
-	mat4 r = zero_mat4 ();
+/*---------------------------SIMD MATRIX KERNELS-----------------------------*/
+// every kernel adds the products in the same order as the scalar loops, i.e.
+// r[row] = ((0 + a[row]*b0) + a[row+4]*b1) + ..., so SSE2 matches exactly.
+// r must not alias a or b
+static inline void apg_mult_mat4_mat4_scalar (const float* a, const float* b,
+	float* r) {
 	int r_index = 0;
 	for (int col = 0; col < 4; col++) {
 		for (int row = 0; row < 4; row++) {
 			float sum = 0.0f;
 			for (int i = 0; i < 4; i++) {
-				sum += b.m[i + col * 4] * a.m[row + i * 4];
+				sum += b[i + col * 4] * a[row + i * 4];
 			}
-			r.m[r_index] = sum;
+			r[r_index] = sum;
 			r_index++;
 		}
 	}
+}
+
+static inline void apg_mult_mat4_vec4_scalar (const float* m, const float* v,
+	float* r) {
+	for (int row = 0; row < 4; row++) {
+		float sum = 0.0f;
+		for (int i = 0; i < 4; i++) {
+			sum += v[i] * m[row + i * 4];
+		}
+		r[row] = sum;
+	}
+}
+
+typedef struct apg_points_soa_args {
+	const float* m;
+	const float *xs, *ys, *zs;
+	float *rxs, *rys, *rzs, *rws;
+	int n;
+	int project;
+	float vp_x, vp_y, vp_half_w, vp_half_h;
+} apg_points_soa_args;
+
+// does points first..n-1. the SIMD kernels use this for their leftovers
+static inline void apg_points_soa_scalar (const apg_points_soa_args* a,
+	int first) {
+	const float* m = a->m;
+	for (int i = first; i < a->n; i++) {
+		float x = a->xs[i], y = a->ys[i], z = a->zs[i];
+		float cx = m[0] * x + m[4] * y + m[8] * z + m[12];
+		float cy = m[1] * x + m[5] * y + m[9] * z + m[13];
+		float cz = m[2] * x + m[6] * y + m[10] * z + m[14];
+		float cw = m[3] * x + m[7] * y + m[11] * z + m[15];
+		if (a->project) {
+			float iw = 1.0f / cw;
+			cx = (cx * iw + 1.0f) * a->vp_half_w + a->vp_x;
+			cy = (cy * iw + 1.0f) * a->vp_half_h + a->vp_y;
+			cz = cz * iw * 0.5f + 0.5f;
+			cw = iw;
+		}
+		a->rxs[i] = cx;
+		a->rys[i] = cy;
+		a->rzs[i] = cz;
+		a->rws[i] = cw;
+	}
+}
+
+typedef struct apg_cull_soa_args {
+	const float* planes; // 6 x a,b,c,d
+	const float *xs, *ys, *zs;
+	const float* rs; // spheres, or NULL for boxes
+	const float *exs, *eys, *ezs;
+	int n;
+	uint32_t* visible; // zeroed by the caller. the kernels only set bits
+} apg_cull_soa_args;
+
+// does objects first..n-1. an object is out if it is entirely behind any plane
+static inline void apg_cull_soa_scalar (const apg_cull_soa_args* a,
+	int first) {
+	for (int i = first; i < a->n; i++) {
+		float x = a->xs[i], y = a->ys[i], z = a->zs[i];
+		int inside = 1;
+		for (int j = 0; j < 6 && inside; j++) {
+			const float* p = a->planes + j * 4;
+			// how far the object reaches back across the plane. for a box that is
+			// its half-sizes projected onto the plane normal
+			float reach = a->rs ? a->rs[i] : fabsf (p[0]) * a->exs[i] +
+				fabsf (p[1]) * a->eys[i] + fabsf (p[2]) * a->ezs[i];
+			float d = p[0] * x + p[1] * y + p[2] * z + p[3];
+			inside = d >= -reach;
+		}
+		if (inside) {
+			a->visible[i >> 5] |= 1u << (i & 31);
+		}
+	}
+}
+
+#ifdef APG_MATHS_SSE2
+// result column = sum of a's columns weighted by the elements of b's column
+static inline void apg_mult_mat4_mat4_sse2 (const float* a, const float* b,
+	float* r) {
+	__m128 a0 = _mm_loadu_ps (a);
+	__m128 a1 = _mm_loadu_ps (a + 4);
+	__m128 a2 = _mm_loadu_ps (a + 8);
+	__m128 a3 = _mm_loadu_ps (a + 12);
+	for (int col = 0; col < 4; col++) {
+		__m128 bc = _mm_loadu_ps (b + col * 4);
+		__m128 sum = _mm_setzero_ps ();
+		sum = _mm_add_ps (sum, _mm_mul_ps (_mm_shuffle_ps (bc, bc, 0x00), a0));
+		sum = _mm_add_ps (sum, _mm_mul_ps (_mm_shuffle_ps (bc, bc, 0x55), a1));
+		sum = _mm_add_ps (sum, _mm_mul_ps (_mm_shuffle_ps (bc, bc, 0xAA), a2));
+		sum = _mm_add_ps (sum, _mm_mul_ps (_mm_shuffle_ps (bc, bc, 0xFF), a3));
+		_mm_storeu_ps (r + col * 4, sum);
+	}
+}
+
+static inline void apg_mult_mat4_vec4_sse2 (const float* m, const float* v,
+	float* r) {
+	__m128 vv = _mm_loadu_ps (v);
+	__m128 sum = _mm_setzero_ps ();
+	sum = _mm_add_ps (sum, _mm_mul_ps (_mm_shuffle_ps (vv, vv, 0x00),
+		_mm_loadu_ps (m)));
+	sum = _mm_add_ps (sum, _mm_mul_ps (_mm_shuffle_ps (vv, vv, 0x55),
+		_mm_loadu_ps (m + 4)));
+	sum = _mm_add_ps (sum, _mm_mul_ps (_mm_shuffle_ps (vv, vv, 0xAA),
+		_mm_loadu_ps (m + 8)));
+	sum = _mm_add_ps (sum, _mm_mul_ps (_mm_shuffle_ps (vv, vv, 0xFF),
+		_mm_loadu_ps (m + 12)));
+	_mm_storeu_ps (r, sum);
+}
+
+// two result columns per 256-bit register. each 128-bit half splats its own
+// column of b, and a's columns are repeated in both halves
+APG_TARGET_AVX_FMA static inline void apg_mult_mat4_mat4_avx_fma (
+	const float* a, const float* b, float* r) {
+	__m256 a0 = _mm256_broadcast_ps ((const __m128*)a);
+	__m256 a1 = _mm256_broadcast_ps ((const __m128*)(a + 4));
+	__m256 a2 = _mm256_broadcast_ps ((const __m128*)(a + 8));
+	__m256 a3 = _mm256_broadcast_ps ((const __m128*)(a + 12));
+	for (int col = 0; col < 4; col += 2) {
+		// two 128-bit loads, not one 256-bit one - b was usually just copied onto
+		// the stack 16 bytes at a time and a wide load would stall on that
+		__m256 bc = _mm256_insertf128_ps (
+			_mm256_castps128_ps256 (_mm_loadu_ps (b + col * 4)),
+			_mm_loadu_ps (b + col * 4 + 4), 1);
+		__m256 sum = _mm256_mul_ps (_mm256_permute_ps (bc, 0x00), a0);
+		sum = _mm256_fmadd_ps (_mm256_permute_ps (bc, 0x55), a1, sum);
+		sum = _mm256_fmadd_ps (_mm256_permute_ps (bc, 0xAA), a2, sum);
+		sum = _mm256_fmadd_ps (_mm256_permute_ps (bc, 0xFF), a3, sum);
+		_mm256_storeu_ps (r + col * 4, sum);
+	}
+	// the compiler doesn't always add this for target() functions, and without
+	// it every later non-VEX SSE instruction pays a ~10x false dependency
+	_mm256_zeroupper ();
+}
+
+APG_TARGET_AVX_FMA static inline void apg_mult_mat4_vec4_avx_fma (
+	const float* m, const float* v, float* r) {
+	__m128 vv = _mm_loadu_ps (v);
+	__m128 sum = _mm_mul_ps (_mm_permute_ps (vv, 0x00), _mm_loadu_ps (m));
+	sum = _mm_fmadd_ps (_mm_permute_ps (vv, 0x55), _mm_loadu_ps (m + 4), sum);
+	sum = _mm_fmadd_ps (_mm_permute_ps (vv, 0xAA), _mm_loadu_ps (m + 8), sum);
+	sum = _mm_fmadd_ps (_mm_permute_ps (vv, 0xFF), _mm_loadu_ps (m + 12), sum);
+	_mm_storeu_ps (r, sum);
+}
+
+// one matrix row against 4 points, in the same order as the scalar loop
+#define APG_SOA_ROW_SSE2(r0, r1, r2, r3, x, y, z) _mm_add_ps (_mm_add_ps ( \
+	_mm_add_ps (_mm_mul_ps (r0, x), _mm_mul_ps (r1, y)), _mm_mul_ps (r2, z)), r3)
+
+static inline void apg_points_soa_sse2 (const apg_points_soa_args* a,
+	int first) {
+	const float* m = a->m;
+	__m128 mm[16];
+	for (int i = 0; i < 16; i++) {
+		mm[i] = _mm_set1_ps (m[i]);
+	}
+	__m128 one = _mm_set1_ps (1.0f), half = _mm_set1_ps (0.5f);
+	__m128 vp_x = _mm_set1_ps (a->vp_x), vp_y = _mm_set1_ps (a->vp_y);
+	__m128 vp_hw = _mm_set1_ps (a->vp_half_w);
+	__m128 vp_hh = _mm_set1_ps (a->vp_half_h);
+	int i = first;
+	for (; i + 4 <= a->n; i += 4) {
+		__m128 x = _mm_loadu_ps (a->xs + i);
+		__m128 y = _mm_loadu_ps (a->ys + i);
+		__m128 z = _mm_loadu_ps (a->zs + i);
+		__m128 cx = APG_SOA_ROW_SSE2 (mm[0], mm[4], mm[8], mm[12], x, y, z);
+		__m128 cy = APG_SOA_ROW_SSE2 (mm[1], mm[5], mm[9], mm[13], x, y, z);
+		__m128 cz = APG_SOA_ROW_SSE2 (mm[2], mm[6], mm[10], mm[14], x, y, z);
+		__m128 cw = APG_SOA_ROW_SSE2 (mm[3], mm[7], mm[11], mm[15], x, y, z);
+		if (a->project) {
+			__m128 iw = _mm_div_ps (one, cw); // not rcp - keeps it exact
+			cx = _mm_add_ps (_mm_mul_ps (_mm_add_ps (_mm_mul_ps (cx, iw), one),
+				vp_hw), vp_x);
+			cy = _mm_add_ps (_mm_mul_ps (_mm_add_ps (_mm_mul_ps (cy, iw), one),
+				vp_hh), vp_y);
+			cz = _mm_add_ps (_mm_mul_ps (_mm_mul_ps (cz, iw), half), half);
+			cw = iw;
+		}
+		_mm_storeu_ps (a->rxs + i, cx);
+		_mm_storeu_ps (a->rys + i, cy);
+		_mm_storeu_ps (a->rzs + i, cz);
+		_mm_storeu_ps (a->rws + i, cw);
+	}
+	apg_points_soa_scalar (a, i);
+}
+
+// all 6 planes against 4 objects, with no early out. i is a multiple of 4 so
+// the 4 result bits always land in the same word
+static inline void apg_cull_soa_sse2 (const apg_cull_soa_args* a, int first) {
+	__m128 p[24], ap[18];
+	for (int j = 0; j < 24; j++) {
+		p[j] = _mm_set1_ps (a->planes[j]);
+	}
+	for (int j = 0; j < 6; j++) {
+		for (int k = 0; k < 3; k++) {
+			ap[j * 3 + k] = _mm_set1_ps (fabsf (a->planes[j * 4 + k]));
+		}
+	}
+	__m128 zero = _mm_setzero_ps ();
+	int i = first;
+	for (; i + 4 <= a->n; i += 4) {
+		__m128 x = _mm_loadu_ps (a->xs + i);
+		__m128 y = _mm_loadu_ps (a->ys + i);
+		__m128 z = _mm_loadu_ps (a->zs + i);
+		__m128 r = zero, ex = zero, ey = zero, ez = zero;
+		if (a->rs) {
+			r = _mm_loadu_ps (a->rs + i);
+		} else {
+			ex = _mm_loadu_ps (a->exs + i);
+			ey = _mm_loadu_ps (a->eys + i);
+			ez = _mm_loadu_ps (a->ezs + i);
+		}
+		__m128 in = _mm_cmpeq_ps (zero, zero); // all ones
+		for (int j = 0; j < 6; j++) {
+			__m128 reach = r;
+			if (!a->rs) {
+				reach = _mm_add_ps (_mm_add_ps (_mm_mul_ps (ap[j * 3], ex),
+					_mm_mul_ps (ap[j * 3 + 1], ey)), _mm_mul_ps (ap[j * 3 + 2], ez));
+			}
+			__m128 d = APG_SOA_ROW_SSE2 (p[j * 4], p[j * 4 + 1], p[j * 4 + 2],
+				p[j * 4 + 3], x, y, z);
+			in = _mm_and_ps (in, _mm_cmpge_ps (d, _mm_sub_ps (zero, reach)));
+		}
+		a->visible[i >> 5] |= (uint32_t)_mm_movemask_ps (in) << (i & 31);
+	}
+	apg_cull_soa_scalar (a, i);
+}
+
+#define APG_SOA_ROW_AVX(r0, r1, r2, r3, x, y, z) \
+	_mm256_fmadd_ps (r2, z, _mm256_fmadd_ps (r1, y, _mm256_fmadd_ps (r0, x, r3)))
+
+APG_TARGET_AVX_FMA static inline void apg_points_soa_avx_fma (
+	const apg_points_soa_args* a, int first) {
+	const float* m = a->m;
+	__m256 mm[16];
+	for (int i = 0; i < 16; i++) {
+		mm[i] = _mm256_set1_ps (m[i]);
+	}
+	__m256 one = _mm256_set1_ps (1.0f), half = _mm256_set1_ps (0.5f);
+	__m256 vp_x = _mm256_set1_ps (a->vp_x), vp_y = _mm256_set1_ps (a->vp_y);
+	__m256 vp_hw = _mm256_set1_ps (a->vp_half_w);
+	__m256 vp_hh = _mm256_set1_ps (a->vp_half_h);
+	int i = first;
+	for (; i + 8 <= a->n; i += 8) {
+		__m256 x = _mm256_loadu_ps (a->xs + i);
+		__m256 y = _mm256_loadu_ps (a->ys + i);
+		__m256 z = _mm256_loadu_ps (a->zs + i);
+		__m256 cx = APG_SOA_ROW_AVX (mm[0], mm[4], mm[8], mm[12], x, y, z);
+		__m256 cy = APG_SOA_ROW_AVX (mm[1], mm[5], mm[9], mm[13], x, y, z);
+		__m256 cz = APG_SOA_ROW_AVX (mm[2], mm[6], mm[10], mm[14], x, y, z);
+		__m256 cw = APG_SOA_ROW_AVX (mm[3], mm[7], mm[11], mm[15], x, y, z);
+		if (a->project) {
+			__m256 iw = _mm256_div_ps (one, cw);
+			cx = _mm256_fmadd_ps (_mm256_fmadd_ps (cx, iw, one), vp_hw, vp_x);
+			cy = _mm256_fmadd_ps (_mm256_fmadd_ps (cy, iw, one), vp_hh, vp_y);
+			cz = _mm256_fmadd_ps (_mm256_mul_ps (cz, iw), half, half);
+			cw = iw;
+		}
+		_mm256_storeu_ps (a->rxs + i, cx);
+		_mm256_storeu_ps (a->rys + i, cy);
+		_mm256_storeu_ps (a->rzs + i, cz);
+		_mm256_storeu_ps (a->rws + i, cw);
+	}
+	_mm256_zeroupper (); // see apg_mult_mat4_mat4_avx_fma
+	apg_points_soa_scalar (a, i);
+}
+
+// as the SSE2 one, 8 objects at a time
+APG_TARGET_AVX_FMA static inline void apg_cull_soa_avx_fma (
+	const apg_cull_soa_args* a, int first) {
+	__m256 p[24], ap[18];
+	for (int j = 0; j < 24; j++) {
+		p[j] = _mm256_set1_ps (a->planes[j]);
+	}
+	for (int j = 0; j < 6; j++) {
+		for (int k = 0; k < 3; k++) {
+			ap[j * 3 + k] = _mm256_set1_ps (fabsf (a->planes[j * 4 + k]));
+		}
+	}
+	__m256 zero = _mm256_setzero_ps ();
+	int i = first;
+	for (; i + 8 <= a->n; i += 8) {
+		__m256 x = _mm256_loadu_ps (a->xs + i);
+		__m256 y = _mm256_loadu_ps (a->ys + i);
+		__m256 z = _mm256_loadu_ps (a->zs + i);
+		__m256 r = zero, ex = zero, ey = zero, ez = zero;
+		if (a->rs) {
+			r = _mm256_loadu_ps (a->rs + i);
+		} else {
+			ex = _mm256_loadu_ps (a->exs + i);
+			ey = _mm256_loadu_ps (a->eys + i);
+			ez = _mm256_loadu_ps (a->ezs + i);
+		}
+		__m256 in = _mm256_cmp_ps (zero, zero, _CMP_EQ_OQ);
+		for (int j = 0; j < 6; j++) {
+			__m256 reach = r;
+			if (!a->rs) {
+				reach = _mm256_fmadd_ps (ap[j * 3 + 2], ez, _mm256_fmadd_ps (
+					ap[j * 3 + 1], ey, _mm256_mul_ps (ap[j * 3], ex)));
+			}
+			__m256 d = APG_SOA_ROW_AVX (p[j * 4], p[j * 4 + 1], p[j * 4 + 2],
+				p[j * 4 + 3], x, y, z);
+			in = _mm256_and_ps (in,
+				_mm256_cmp_ps (d, _mm256_sub_ps (zero, reach), _CMP_GE_OQ));
+		}
+		a->visible[i >> 5] |= (uint32_t)_mm256_movemask_ps (in) << (i & 31);
+	}
+	_mm256_zeroupper (); // see apg_mult_mat4_mat4_avx_fma
+	apg_cull_soa_scalar (a, i);
+}
+
+// AVX needs the cpu flags and the OS saving the YMM registers (XCR0 bits 1,2)
+static inline apg_simd_level apg_detect_simd_level () {
+	unsigned int ecx = 0;
+	unsigned long long xcr0 = 0;
+#if defined(_MSC_VER) && !defined(__clang__)
+	int regs[4];
+	__cpuid (regs, 1);
+	ecx = (unsigned int)regs[2];
+	if (ecx & (1u << 27)) {
+		xcr0 = _xgetbv (0);
+	}
+#else
+	unsigned int eax, ebx, edx;
+	if (!__get_cpuid (1, &eax, &ebx, &ecx, &edx)) {
+		return APG_SIMD_SSE2;
+	}
+	if (ecx & (1u << 27)) { // OSXSAVE
+		unsigned int lo, hi;
+		__asm__ ("xgetbv" : "=a" (lo), "=d" (hi) : "c" (0));
+		xcr0 = ((unsigned long long)hi << 32) | lo;
+	}
+#endif
+	int avx = (ecx & (1u << 28)) && (xcr0 & 6) == 6;
+	int fma = (ecx & (1u << 12)) != 0;
+	return avx && fma ? APG_SIMD_AVX_FMA : APG_SIMD_SSE2;
+}
+#endif
+
+// atomics for the one-time kernel selection below. acquire/release is enough
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define APG_ATOMIC_LOAD(p) _InterlockedOr ((p), 0)
+#define APG_ATOMIC_STORE(p, v) _InterlockedExchange ((p), (v))
+#define APG_ATOMIC_CAS(p, old, v) \
+	((old) == _InterlockedCompareExchange ((p), (v), (old)))
+#else
+#define APG_ATOMIC_LOAD(p) __atomic_load_n ((p), __ATOMIC_ACQUIRE)
+#define APG_ATOMIC_STORE(p, v) __atomic_store_n ((p), (v), __ATOMIC_RELEASE)
+#define APG_ATOMIC_CAS(p, old, v) apg_atomic_cas ((p), (old), (v))
+static inline int apg_atomic_cas (long* p, long old, long v) {
+	return __atomic_compare_exchange_n (p, &old, v, 0, __ATOMIC_ACQ_REL,
+		__ATOMIC_ACQUIRE);
+}
+#endif
+
+/* kernel dispatch state. like every function in this file it has its one
+   external definition in the .c file that includes apg_maths.h (a second .c
+   file including it fails to link), so it is shared by the whole program and
+   set_maths_simd_level() affects every caller */
+typedef void (*apg_mat4_kernel) (const float*, const float*, float*);
+long apg_simd_state; // 0 - not picked yet, 1 - a thread is picking, 2 - ready
+apg_simd_level apg_simd_level_max, apg_simd_level_curr;
+apg_mat4_kernel apg_mult_mat4_mat4_fn = apg_mult_mat4_mat4_scalar;
+apg_mat4_kernel apg_mult_mat4_vec4_fn = apg_mult_mat4_vec4_scalar;
+typedef void (*apg_points_soa_kernel) (const apg_points_soa_args*, int);
+apg_points_soa_kernel apg_points_soa_fn = apg_points_soa_scalar;
+typedef void (*apg_cull_soa_kernel) (const apg_cull_soa_args*, int);
+apg_cull_soa_kernel apg_cull_soa_fn = apg_cull_soa_scalar;
+
+static inline void apg_use_simd_level (apg_simd_level level) {
+	apg_mult_mat4_mat4_fn = apg_mult_mat4_mat4_scalar;
+	apg_mult_mat4_vec4_fn = apg_mult_mat4_vec4_scalar;
+	apg_points_soa_fn = apg_points_soa_scalar;
+	apg_cull_soa_fn = apg_cull_soa_scalar;
+#ifdef APG_MATHS_SSE2
+	if (APG_SIMD_SSE2 == level) {
+		apg_mult_mat4_mat4_fn = apg_mult_mat4_mat4_sse2;
+		apg_mult_mat4_vec4_fn = apg_mult_mat4_vec4_sse2;
+		apg_points_soa_fn = apg_points_soa_sse2;
+		apg_cull_soa_fn = apg_cull_soa_sse2;
+	} else if (APG_SIMD_AVX_FMA == level) {
+		apg_mult_mat4_mat4_fn = apg_mult_mat4_mat4_avx_fma;
+		apg_mult_mat4_vec4_fn = apg_mult_mat4_vec4_avx_fma;
+		apg_points_soa_fn = apg_points_soa_avx_fma;
+		apg_cull_soa_fn = apg_cull_soa_avx_fma;
+	}
+#endif
+	apg_simd_level_curr = level;
+}
+
+/* picks the best kernels the cpu has, once, whichever thread gets here first.
+   the others wait the fraction of a microsecond CPUID takes */
+static inline void apg_maths_init () {
+	if (2 == APG_ATOMIC_LOAD (&apg_simd_state)) {
+		return;
+	}
+	if (APG_ATOMIC_CAS (&apg_simd_state, 0, 1)) {
+#ifdef APG_MATHS_SSE2
+		apg_simd_level_max = apg_detect_simd_level ();
+#else
+		apg_simd_level_max = APG_SIMD_SCALAR;
+#endif
+		apg_use_simd_level (apg_simd_level_max);
+		APG_ATOMIC_STORE (&apg_simd_state, 2);
+	}
+	while (2 != APG_ATOMIC_LOAD (&apg_simd_state));
+}
+
+inline apg_simd_level set_maths_simd_level (apg_simd_level level) {
+	apg_maths_init ();
+	if (level > apg_simd_level_max) {
+		level = apg_simd_level_max;
+	}
+	apg_use_simd_level (level);
+	return level;
+}
+
+inline apg_simd_level get_maths_simd_level () {
+	apg_maths_init ();
+	return apg_simd_level_curr;
+}
+
+//
+inline void mult_mat4_mat4_p (const mat4* a, const mat4* b, mat4* r) {
+	apg_maths_init ();
+	// the kernels can't write over their inputs
+	if (r == a || r == b) {
+		mat4 t;
+		apg_mult_mat4_mat4_fn (a->m, b->m, t.m);
+		*r = t;
+	} else {
+		apg_mult_mat4_mat4_fn (a->m, b->m, r->m);
+	}
+}
+
+inline mat4 mult_mat4_mat4 (mat4 a, mat4 b) {
+	mat4 r;
+	mult_mat4_mat4_p (&a, &b, &r);
 	return r;
 }
 
+//
+inline void mult_mat4_vec4_p (const mat4* m, const vec4* v, vec4* r) {
+	apg_maths_init ();
+	if (r == v) {
+		vec4 t;
+		apg_mult_mat4_vec4_fn (m->m, v->v, t.v);
+		*r = t;
+	} else {
+		apg_mult_mat4_vec4_fn (m->m, v->v, r->v);
+	}
+}
+
+inline vec4 mult_mat4_vec4 (mat4 m, vec4 v) {
+	vec4 r;
+	mult_mat4_vec4_p (&m, &v, &r);
+	return r;
+}
+
+//
+inline void transform_points_soa (mat4 m, const float* xs, const float* ys,
+	const float* zs, int n, float* rxs, float* rys, float* rzs, float* rws) {
+	apg_points_soa_args a;
+	memset (&a, 0, sizeof (apg_points_soa_args));
+	a.m = m.m;
+	a.xs = xs, a.ys = ys, a.zs = zs;
+	a.rxs = rxs, a.rys = rys, a.rzs = rzs, a.rws = rws;
+	a.n = n;
+	apg_maths_init ();
+	apg_points_soa_fn (&a, 0);
+}
+
+//
+inline void project_points_soa (mat4 m, const float* xs, const float* ys,
+	const float* zs, int n, vec4 viewport, float* rxs, float* rys, float* rzs,
+	float* rws) {
+	apg_points_soa_args a;
+	a.m = m.m;
+	a.xs = xs, a.ys = ys, a.zs = zs;
+	a.rxs = rxs, a.rys = rys, a.rzs = rzs, a.rws = rws;
+	a.n = n;
+	a.project = 1;
+	a.vp_x = viewport.v[0];
+	a.vp_y = viewport.v[1];
+	a.vp_half_w = viewport.v[2] * 0.5f;
+	a.vp_half_h = viewport.v[3] * 0.5f;
+	apg_maths_init ();
+	apg_points_soa_fn (&a, 0);
+}
+
+// row 3 of the matrix plus (left, bottom, near) or minus (right, top, far) row
+// 0, 1 or 2, i.e. the planes where clip-space -w <= x <= w etc.
+inline void frustum_from_mat4_p (const mat4* pv, frustum* r) {
+	const float* m = pv->m;
+	for (int i = 0; i < 6; i++) {
+		int row = i / 2;
+		float sign = (i & 1) ? -1.0f : 1.0f;
+		float* p = r->planes[i].v;
+		for (int j = 0; j < 4; j++) {
+			p[j] = m[3 + j * 4] + sign * m[row + j * 4];
+		}
+		float l = sqrt (p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+		if (l > 0.0f) {
+			for (int j = 0; j < 4; j++) {
+				p[j] /= l;
+			}
+		}
+	}
+}
+
+inline frustum frustum_from_mat4 (mat4 pv) {
+	frustum f;
+	frustum_from_mat4_p (&pv, &f);
+	return f;
+}
+
+//
+inline void cull_spheres_soa (const frustum* f, const float* xs,
+	const float* ys, const float* zs, const float* rs, int n,
+	uint32_t* visible) {
+	apg_cull_soa_args a;
+	memset (&a, 0, sizeof (apg_cull_soa_args));
+	a.planes = f->planes[0].v;
+	a.xs = xs, a.ys = ys, a.zs = zs;
+	a.rs = rs;
+	a.n = n;
+	a.visible = visible;
+	memset (visible, 0, (size_t)((n + 31) / 32) * sizeof (uint32_t));
+	apg_maths_init ();
+	apg_cull_soa_fn (&a, 0);
+}
+
+//
+inline void cull_aabbs_soa (const frustum* f, const float* cxs,
+	const float* cys, const float* czs, const float* exs, const float* eys,
+	const float* ezs, int n, uint32_t* visible) {
+	apg_cull_soa_args a;
+	memset (&a, 0, sizeof (apg_cull_soa_args));
+	a.planes = f->planes[0].v;
+	a.xs = cxs, a.ys = cys, a.zs = czs;
+	a.exs = exs, a.eys = eys, a.ezs = ezs;
+	a.n = n;
+	a.visible = visible;
+	memset (visible, 0, (size_t)((n + 31) / 32) * sizeof (uint32_t));
+	apg_maths_init ();
+	apg_cull_soa_fn (&a, 0);
+}
+
 // returns a scalar value with the determinant for a 4x4 matrix
 // see http://www.euclideanspace.com/maths/algebra/matrix/functions/determinant/fourD/index.htm
-inline float det_mat4 (mat4 mm) {
+inline float det_mat4_p (const mat4* mm) {
 	return
-		mm.m[12] * mm.m[9] * mm.m[6] * mm.m[3] -
-		mm.m[8] * mm.m[13] * mm.m[6] * mm.m[3] -
-		mm.m[12] * mm.m[5] * mm.m[10] * mm.m[3] +
-		mm.m[4] * mm.m[13] * mm.m[10] * mm.m[3] +
-		mm.m[8] * mm.m[5] * mm.m[14] * mm.m[3] -
-		mm.m[4] * mm.m[9] * mm.m[14] * mm.m[3] -
-		mm.m[12] * mm.m[9] * mm.m[2] * mm.m[7] +
-		mm.m[8] * mm.m[13] * mm.m[2] * mm.m[7] +
-		mm.m[12] * mm.m[1] * mm.m[10] * mm.m[7] -
-		mm.m[0] * mm.m[13] * mm.m[10] * mm.m[7] -
-		mm.m[8] * mm.m[1] * mm.m[14] * mm.m[7] +
-		mm.m[0] * mm.m[9] * mm.m[14] * mm.m[7] +
-		mm.m[12] * mm.m[5] * mm.m[2] * mm.m[11] -
-		mm.m[4] * mm.m[13] * mm.m[2] * mm.m[11] -
-		mm.m[12] * mm.m[1] * mm.m[6] * mm.m[11] +
-		mm.m[0] * mm.m[13] * mm.m[6] * mm.m[11] +
-		mm.m[4] * mm.m[1] * mm.m[14] * mm.m[11] -
-		mm.m[0] * mm.m[5] * mm.m[14] * mm.m[11] -
-		mm.m[8] * mm.m[5] * mm.m[2] * mm.m[15] +
-		mm.m[4] * mm.m[9] * mm.m[2] * mm.m[15] +
-		mm.m[8] * mm.m[1] * mm.m[6] * mm.m[15] -
-		mm.m[0] * mm.m[9] * mm.m[6] * mm.m[15] -
-		mm.m[4] * mm.m[1] * mm.m[10] * mm.m[15] +
-		mm.m[0] * mm.m[5] * mm.m[10] * mm.m[15];
+		mm->m[12] * mm->m[9] * mm->m[6] * mm->m[3] -
+		mm->m[8] * mm->m[13] * mm->m[6] * mm->m[3] -
+		mm->m[12] * mm->m[5] * mm->m[10] * mm->m[3] +
+		mm->m[4] * mm->m[13] * mm->m[10] * mm->m[3] +
+		mm->m[8] * mm->m[5] * mm->m[14] * mm->m[3] -
+		mm->m[4] * mm->m[9] * mm->m[14] * mm->m[3] -
+		mm->m[12] * mm->m[9] * mm->m[2] * mm->m[7] +
+		mm->m[8] * mm->m[13] * mm->m[2] * mm->m[7] +
+		mm->m[12] * mm->m[1] * mm->m[10] * mm->m[7] -
+		mm->m[0] * mm->m[13] * mm->m[10] * mm->m[7] -
+		mm->m[8] * mm->m[1] * mm->m[14] * mm->m[7] +
+		mm->m[0] * mm->m[9] * mm->m[14] * mm->m[7] +
+		mm->m[12] * mm->m[5] * mm->m[2] * mm->m[11] -
+		mm->m[4] * mm->m[13] * mm->m[2] * mm->m[11] -
+		mm->m[12] * mm->m[1] * mm->m[6] * mm->m[11] +
+		mm->m[0] * mm->m[13] * mm->m[6] * mm->m[11] +
+		mm->m[4] * mm->m[1] * mm->m[14] * mm->m[11] -
+		mm->m[0] * mm->m[5] * mm->m[14] * mm->m[11] -
+		mm->m[8] * mm->m[5] * mm->m[2] * mm->m[15] +
+		mm->m[4] * mm->m[9] * mm->m[2] * mm->m[15] +
+		mm->m[8] * mm->m[1] * mm->m[6] * mm->m[15] -
+		mm->m[0] * mm->m[9] * mm->m[6] * mm->m[15] -
+		mm->m[4] * mm->m[1] * mm->m[10] * mm->m[15] +
+		mm->m[0] * mm->m[5] * mm->m[10] * mm->m[15];
+}
+
+inline float det_mat4 (mat4 mm) {
+	return det_mat4_p (&mm);
 }
 
 // TODO(anton) pretty sure there's a nicer method in Lengyel's book
 // returns a 16-element array that is the inverse of a 16-element array (4x4
 // matrix).
 // see http://www.euclideanspace.com/maths/algebra/matrix/functions/inverse/fourD/index.htm
-inline mat4 inverse_mat4 (mat4 mm) {
-	float det = det_mat4 (mm);
+inline void inverse_mat4_p (const mat4* mm, mat4* r) {
+	float det = det_mat4_p (mm);
 	/* there is no inverse if determinant is zero (not likely unless scale is
 	broken) */
 	if (0.0f == det) {
 		fprintf (stderr, "WARNING. matrix has no determinant. can not invert\n");
-		return mm;
+		*r = *mm;
+		return;
 	}
 	float inv_det = 1.0f / det;
 	
-	mat4 r;
-	r.m[0] = inv_det * (
-		mm.m[9] * mm.m[14] * mm.m[7] - mm.m[13] * mm.m[10] * mm.m[7] +
-		mm.m[13] * mm.m[6] * mm.m[11] - mm.m[5] * mm.m[14] * mm.m[11] -
-		mm.m[9] * mm.m[6] * mm.m[15] + mm.m[5] * mm.m[10] * mm.m[15]
+	mat4 result; // r may be mm
+	result.m[0] = inv_det * (
+		mm->m[9] * mm->m[14] * mm->m[7] - mm->m[13] * mm->m[10] * mm->m[7] +
+		mm->m[13] * mm->m[6] * mm->m[11] - mm->m[5] * mm->m[14] * mm->m[11] -
+		mm->m[9] * mm->m[6] * mm->m[15] + mm->m[5] * mm->m[10] * mm->m[15]
 	);
-	r.m[1] = inv_det * (
-		mm.m[13] * mm.m[10] * mm.m[3] - mm.m[9] * mm.m[14] * mm.m[3] -
-		mm.m[13] * mm.m[2] * mm.m[11] + mm.m[1] * mm.m[14] * mm.m[11] +
-		mm.m[9] * mm.m[2] * mm.m[15] - mm.m[1] * mm.m[10] * mm.m[15]
+	result.m[1] = inv_det * (
+		mm->m[13] * mm->m[10] * mm->m[3] - mm->m[9] * mm->m[14] * mm->m[3] -
+		mm->m[13] * mm->m[2] * mm->m[11] + mm->m[1] * mm->m[14] * mm->m[11] +
+		mm->m[9] * mm->m[2] * mm->m[15] - mm->m[1] * mm->m[10] * mm->m[15]
 	);
-	r.m[2] = inv_det * (
-		mm.m[5] * mm.m[14] * mm.m[3] - mm.m[13] * mm.m[6] * mm.m[3] +
-		mm.m[13] * mm.m[2] * mm.m[7] - mm.m[1] * mm.m[14] * mm.m[7] -
-		mm.m[5] * mm.m[2] * mm.m[15] + mm.m[1] * mm.m[6] * mm.m[15]
+	result.m[2] = inv_det * (
+		mm->m[5] * mm->m[14] * mm->m[3] - mm->m[13] * mm->m[6] * mm->m[3] +
+		mm->m[13] * mm->m[2] * mm->m[7] - mm->m[1] * mm->m[14] * mm->m[7] -
+		mm->m[5] * mm->m[2] * mm->m[15] + mm->m[1] * mm->m[6] * mm->m[15]
 	);
-	r.m[3] = inv_det * (
-		mm.m[9] * mm.m[6] * mm.m[3] - mm.m[5] * mm.m[10] * mm.m[3] -
-		mm.m[9] * mm.m[2] * mm.m[7] + mm.m[1] * mm.m[10] * mm.m[7] +
-		mm.m[5] * mm.m[2] * mm.m[11] - mm.m[1] * mm.m[6] * mm.m[11]
+	result.m[3] = inv_det * (
+		mm->m[9] * mm->m[6] * mm->m[3] - mm->m[5] * mm->m[10] * mm->m[3] -
+		mm->m[9] * mm->m[2] * mm->m[7] + mm->m[1] * mm->m[10] * mm->m[7] +
+		mm->m[5] * mm->m[2] * mm->m[11] - mm->m[1] * mm->m[6] * mm->m[11]
 	);
-	r.m[4] = inv_det * (
-		mm.m[12] * mm.m[10] * mm.m[7] - mm.m[8] * mm.m[14] * mm.m[7] -
-		mm.m[12] * mm.m[6] * mm.m[11] + mm.m[4] * mm.m[14] * mm.m[11] +
-		mm.m[8] * mm.m[6] * mm.m[15] - mm.m[4] * mm.m[10] * mm.m[15]
+	result.m[4] = inv_det * (
+		mm->m[12] * mm->m[10] * mm->m[7] - mm->m[8] * mm->m[14] * mm->m[7] -
+		mm->m[12] * mm->m[6] * mm->m[11] + mm->m[4] * mm->m[14] * mm->m[11] +
+		mm->m[8] * mm->m[6] * mm->m[15] - mm->m[4] * mm->m[10] * mm->m[15]
 	);
-	r.m[5] = inv_det * (
-		mm.m[8] * mm.m[14] * mm.m[3] - mm.m[12] * mm.m[10] * mm.m[3] +
-		mm.m[12] * mm.m[2] * mm.m[11] - mm.m[0] * mm.m[14] * mm.m[11] -
-		mm.m[8] * mm.m[2] * mm.m[15] + mm.m[0] * mm.m[10] * mm.m[15]
+	result.m[5] = inv_det * (
+		mm->m[8] * mm->m[14] * mm->m[3] - mm->m[12] * mm->m[10] * mm->m[3] +
+		mm->m[12] * mm->m[2] * mm->m[11] - mm->m[0] * mm->m[14] * mm->m[11] -
+		mm->m[8] * mm->m[2] * mm->m[15] + mm->m[0] * mm->m[10] * mm->m[15]
 	);
-	r.m[6] = inv_det * (
-		mm.m[12] * mm.m[6] * mm.m[3] - mm.m[4] * mm.m[14] * mm.m[3] -
-		mm.m[12] * mm.m[2] * mm.m[7] + mm.m[0] * mm.m[14] * mm.m[7] +
-		mm.m[4] * mm.m[2] * mm.m[15] - mm.m[0] * mm.m[6] * mm.m[15]
+	result.m[6] = inv_det * (
+		mm->m[12] * mm->m[6] * mm->m[3] - mm->m[4] * mm->m[14] * mm->m[3] -
+		mm->m[12] * mm->m[2] * mm->m[7] + mm->m[0] * mm->m[14] * mm->m[7] +
+		mm->m[4] * mm->m[2] * mm->m[15] - mm->m[0] * mm->m[6] * mm->m[15]
 	);
-	r.m[7] = inv_det * (
-		mm.m[4] * mm.m[10] * mm.m[3] - mm.m[8] * mm.m[6] * mm.m[3] +
-		mm.m[8] * mm.m[2] * mm.m[7] - mm.m[0] * mm.m[10] * mm.m[7] -
-		mm.m[4] * mm.m[2] * mm.m[11] + mm.m[0] * mm.m[6] * mm.m[11]
+	result.m[7] = inv_det * (
+		mm->m[4] * mm->m[10] * mm->m[3] - mm->m[8] * mm->m[6] * mm->m[3] +
+		mm->m[8] * mm->m[2] * mm->m[7] - mm->m[0] * mm->m[10] * mm->m[7] -
+		mm->m[4] * mm->m[2] * mm->m[11] + mm->m[0] * mm->m[6] * mm->m[11]
 	);
-	r.m[8] = inv_det * (
-		mm.m[8] * mm.m[13] * mm.m[7] - mm.m[12] * mm.m[9] * mm.m[7] +
-		mm.m[12] * mm.m[5] * mm.m[11] - mm.m[4] * mm.m[13] * mm.m[11] -
-		mm.m[8] * mm.m[5] * mm.m[15] + mm.m[4] * mm.m[9] * mm.m[15]
+	result.m[8] = inv_det * (
+		mm->m[8] * mm->m[13] * mm->m[7] - mm->m[12] * mm->m[9] * mm->m[7] +
+		mm->m[12] * mm->m[5] * mm->m[11] - mm->m[4] * mm->m[13] * mm->m[11] -
+		mm->m[8] * mm->m[5] * mm->m[15] + mm->m[4] * mm->m[9] * mm->m[15]
 	);
-	r.m[9] = inv_det * (
-		mm.m[12] * mm.m[9] * mm.m[3] - mm.m[8] * mm.m[13] * mm.m[3] -
-		mm.m[12] * mm.m[1] * mm.m[11] + mm.m[0] * mm.m[13] * mm.m[11] +
-		mm.m[8] * mm.m[1] * mm.m[15] - mm.m[0] * mm.m[9] * mm.m[15]
+	result.m[9] = inv_det * (
+		mm->m[12] * mm->m[9] * mm->m[3] - mm->m[8] * mm->m[13] * mm->m[3] -
+		mm->m[12] * mm->m[1] * mm->m[11] + mm->m[0] * mm->m[13] * mm->m[11] +
+		mm->m[8] * mm->m[1] * mm->m[15] - mm->m[0] * mm->m[9] * mm->m[15]
 	);
-	r.m[10] = inv_det * (
-		mm.m[4] * mm.m[13] * mm.m[3] - mm.m[12] * mm.m[5] * mm.m[3] +
-		mm.m[12] * mm.m[1] * mm.m[7] - mm.m[0] * mm.m[13] * mm.m[7] -
-		mm.m[4] * mm.m[1] * mm.m[15] + mm.m[0] * mm.m[5] * mm.m[15]
+	result.m[10] = inv_det * (
+		mm->m[4] * mm->m[13] * mm->m[3] - mm->m[12] * mm->m[5] * mm->m[3] +
+		mm->m[12] * mm->m[1] * mm->m[7] - mm->m[0] * mm->m[13] * mm->m[7] -
+		mm->m[4] * mm->m[1] * mm->m[15] + mm->m[0] * mm->m[5] * mm->m[15]
 	);
-	r.m[11] = inv_det * (
-		mm.m[8] * mm.m[5] * mm.m[3] - mm.m[4] * mm.m[9] * mm.m[3] -
-		mm.m[8] * mm.m[1] * mm.m[7] + mm.m[0] * mm.m[9] * mm.m[7] +
-		mm.m[4] * mm.m[1] * mm.m[11] - mm.m[0] * mm.m[5] * mm.m[11]
+	result.m[11] = inv_det * (
+		mm->m[8] * mm->m[5] * mm->m[3] - mm->m[4] * mm->m[9] * mm->m[3] -
+		mm->m[8] * mm->m[1] * mm->m[7] + mm->m[0] * mm->m[9] * mm->m[7] +
+		mm->m[4] * mm->m[1] * mm->m[11] - mm->m[0] * mm->m[5] * mm->m[11]
 	);
-	r.m[12] = inv_det * (
-		mm.m[12] * mm.m[9] * mm.m[6] - mm.m[8] * mm.m[13] * mm.m[6] -
-		mm.m[12] * mm.m[5] * mm.m[10] + mm.m[4] * mm.m[13] * mm.m[10] +
-		mm.m[8] * mm.m[5] * mm.m[14] - mm.m[4] * mm.m[9] * mm.m[14]
+	result.m[12] = inv_det * (
+		mm->m[12] * mm->m[9] * mm->m[6] - mm->m[8] * mm->m[13] * mm->m[6] -
+		mm->m[12] * mm->m[5] * mm->m[10] + mm->m[4] * mm->m[13] * mm->m[10] +
+		mm->m[8] * mm->m[5] * mm->m[14] - mm->m[4] * mm->m[9] * mm->m[14]
 	);
-	r.m[13] = inv_det * (
-		mm.m[8] * mm.m[13] * mm.m[2] - mm.m[12] * mm.m[9] * mm.m[2] +
-		mm.m[12] * mm.m[1] * mm.m[10] - mm.m[0] * mm.m[13] * mm.m[10] -
-		mm.m[8] * mm.m[1] * mm.m[14] + mm.m[0] * mm.m[9] * mm.m[14]
+	result.m[13] = inv_det * (
+		mm->m[8] * mm->m[13] * mm->m[2] - mm->m[12] * mm->m[9] * mm->m[2] +
+		mm->m[12] * mm->m[1] * mm->m[10] - mm->m[0] * mm->m[13] * mm->m[10] -
+		mm->m[8] * mm->m[1] * mm->m[14] + mm->m[0] * mm->m[9] * mm->m[14]
 	);
-	r.m[14] = inv_det * (
-		mm.m[12] * mm.m[5] * mm.m[2] - mm.m[4] * mm.m[13] * mm.m[2] -
-		mm.m[12] * mm.m[1] * mm.m[6] + mm.m[0] * mm.m[13] * mm.m[6] +
-		mm.m[4] * mm.m[1] * mm.m[14] - mm.m[0] * mm.m[5] * mm.m[14]
+	result.m[14] = inv_det * (
+		mm->m[12] * mm->m[5] * mm->m[2] - mm->m[4] * mm->m[13] * mm->m[2] -
+		mm->m[12] * mm->m[1] * mm->m[6] + mm->m[0] * mm->m[13] * mm->m[6] +
+		mm->m[4] * mm->m[1] * mm->m[14] - mm->m[0] * mm->m[5] * mm->m[14]
 	);
-	r.m[15] = inv_det * (
-		mm.m[4] * mm.m[9] * mm.m[2] - mm.m[8] * mm.m[5] * mm.m[2] +
-		mm.m[8] * mm.m[1] * mm.m[6] - mm.m[0] * mm.m[9] * mm.m[6] -
-		mm.m[4] * mm.m[1] * mm.m[10] + mm.m[0] * mm.m[5] * mm.m[10]
+	result.m[15] = inv_det * (
+		mm->m[4] * mm->m[9] * mm->m[2] - mm->m[8] * mm->m[5] * mm->m[2] +
+		mm->m[8] * mm->m[1] * mm->m[6] - mm->m[0] * mm->m[9] * mm->m[6] -
+		mm->m[4] * mm->m[1] * mm->m[10] + mm->m[0] * mm->m[5] * mm->m[10]
 	);
+	*r = result;
+}
+
+inline mat4 inverse_mat4 (mat4 mm) {
+	mat4 r;
+	inverse_mat4_p (&mm, &r);
 	return r;
 }
 
 // returns a 16-element array flipped on the main diagonal
+inline void transpose_mat4_p (const mat4* mm, mat4* r) {
+	mat4 result; // r may be mm
+	result.m[0] = mm->m[0];
+	result.m[1] = mm->m[4];
+	result.m[2] = mm->m[8];
+	result.m[3] = mm->m[12];
+	result.m[4] = mm->m[1];
+	result.m[5] = mm->m[5];
+	result.m[6] = mm->m[9];
+	result.m[7] = mm->m[13];
+	result.m[8] = mm->m[2];
+	result.m[9] = mm->m[6];
+	result.m[10] = mm->m[10];
+	result.m[11] = mm->m[14];
+	result.m[12] = mm->m[3];
+	result.m[13] = mm->m[7];
+	result.m[14] = mm->m[11];
+	result.m[15] = mm->m[15];
+	*r = result;
+}
+
 inline mat4 transpose_mat4 (mat4 mm) {
 	mat4 r;
-	r.m[0] = mm.m[0];
-	r.m[1] = mm.m[4];
-	r.m[2] = mm.m[8];
-	r.m[3] = mm.m[12];
-	r.m[4] = mm.m[1];
-	r.m[5] = mm.m[5];
-	r.m[6] = mm.m[9];
-	r.m[7] = mm.m[13];
-	r.m[8] = mm.m[2];
-	r.m[9] = mm.m[6];
-	r.m[10] = mm.m[10];
-	r.m[11] = mm.m[14];
-	r.m[12] = mm.m[3];
-	r.m[13] = mm.m[7];
-	r.m[14] = mm.m[11];
-	r.m[15] = mm.m[15];
+	transpose_mat4_p (&mm, &r);
+	return r;
+}
+
+// rotation part is orthonormal so its inverse is its transpose, and the
+// translation t becomes -R^T * t
+inline void inverse_rigid_mat4_p (const mat4* mm, mat4* r) {
+	mat4 result; // r may be mm
+	result.m[0] = mm->m[0];
+	result.m[1] = mm->m[4];
+	result.m[2] = mm->m[8];
+	result.m[3] = 0.0f;
+	result.m[4] = mm->m[1];
+	result.m[5] = mm->m[5];
+	result.m[6] = mm->m[9];
+	result.m[7] = 0.0f;
+	result.m[8] = mm->m[2];
+	result.m[9] = mm->m[6];
+	result.m[10] = mm->m[10];
+	result.m[11] = 0.0f;
+	result.m[12] = -(mm->m[0] * mm->m[12] + mm->m[1] * mm->m[13] +
+		mm->m[2] * mm->m[14]);
+	result.m[13] = -(mm->m[4] * mm->m[12] + mm->m[5] * mm->m[13] +
+		mm->m[6] * mm->m[14]);
+	result.m[14] = -(mm->m[8] * mm->m[12] + mm->m[9] * mm->m[13] +
+		mm->m[10] * mm->m[14]);
+	result.m[15] = 1.0f;
+	*r = result;
+}
+
+inline mat4 inverse_rigid_mat4 (mat4 mm) {
+	mat4 r;
+	inverse_rigid_mat4_p (&mm, &r);
+	return r;
+}
+
+// inverts the upper 3x3 with cross products of its columns a, b, c - the rows
+// of the inverse are b x c, c x a, a x b over the determinant a . (b x c)
+inline void inverse_affine_mat4_p (const mat4* mm, mat4* r) {
+	vec3 a = vec3_from_3f (mm->m[0], mm->m[1], mm->m[2]);
+	vec3 b = vec3_from_3f (mm->m[4], mm->m[5], mm->m[6]);
+	vec3 c = vec3_from_3f (mm->m[8], mm->m[9], mm->m[10]);
+	vec3 bc = cross_vec3 (b, c);
+	vec3 ca = cross_vec3 (c, a);
+	vec3 ab = cross_vec3 (a, b);
+	float det = dot_vec3 (a, bc);
+	if (0.0f == det) {
+		fprintf (stderr, "WARNING. matrix has no determinant. can not invert\n");
+		*r = *mm;
+		return;
+	}
+	float inv_det = 1.0f / det;
+	bc = mult_vec3_f (bc, inv_det);
+	ca = mult_vec3_f (ca, inv_det);
+	ab = mult_vec3_f (ab, inv_det);
+	vec3 tr = vec3_from_3f (mm->m[12], mm->m[13], mm->m[14]);
+	mat4 result; // r may be mm
+	result.m[0] = bc.v[0];
+	result.m[1] = ca.v[0];
+	result.m[2] = ab.v[0];
+	result.m[3] = 0.0f;
+	result.m[4] = bc.v[1];
+	result.m[5] = ca.v[1];
+	result.m[6] = ab.v[1];
+	result.m[7] = 0.0f;
+	result.m[8] = bc.v[2];
+	result.m[9] = ca.v[2];
+	result.m[10] = ab.v[2];
+	result.m[11] = 0.0f;
+	result.m[12] = -dot_vec3 (bc, tr);
+	result.m[13] = -dot_vec3 (ca, tr);
+	result.m[14] = -dot_vec3 (ab, tr);
+	result.m[15] = 1.0f;
+	*r = result;
+}
+
+inline mat4 inverse_affine_mat4 (mat4 mm) {
+	mat4 r;
+	inverse_affine_mat4_p (&mm, &r);
 	return r;
 }
 
@@ -691,6 +1434,29 @@ inline mat4 perspective (float fovy, float aspect, float near, float far) {
 	return m;
 }
 
+// the conjugate of a versor is its inverse rotation, so the rotation part of
+// the view matrix is just that of the conjugate. the translation is then
+// -R^T * pos
+inline void view_from_quat_pos_p (const versor* q, const vec3* pos,
+	mat4* r) {
+	versor conj;
+	conj.q[0] = q->q[0];
+	conj.q[1] = -q->q[1];
+	conj.q[2] = -q->q[2];
+	conj.q[3] = -q->q[3];
+	quat_to_mat4_p (&conj, r);
+	float x = pos->v[0], y = pos->v[1], z = pos->v[2];
+	r->m[12] = -(r->m[0] * x + r->m[4] * y + r->m[8] * z);
+	r->m[13] = -(r->m[1] * x + r->m[5] * y + r->m[9] * z);
+	r->m[14] = -(r->m[2] * x + r->m[6] * y + r->m[10] * z);
+}
+
+inline mat4 view_from_quat_pos (versor q, vec3 pos) {
+	mat4 r;
+	view_from_quat_pos_p (&q, &pos, &r);
+	return r;
+}
+
 /*----------------------------HAMILTON IN DA HOUSE!--------------------------*/
 // manual cons
 inline versor versor_from_4f (float x, float y, float z, float w) {
@@ -730,18 +1496,25 @@ inline versor mult_quat_f (versor qq, float s) {
 }
 
 // component-wise mult versor by a versor
-inline versor mult_quat_quat (versor a, versor b) {
+inline void mult_quat_quat_p (const versor* a, const versor* b,
+	versor* r) {
 	versor result;
-	result.q[0] = b.q[0] * a.q[0] - b.q[1] * a.q[1] -
-		b.q[2] * a.q[2] - b.q[3] * a.q[3];
-	result.q[1] = b.q[0] * a.q[1] + b.q[1] * a.q[0] -
-		b.q[2] * a.q[3] + b.q[3] * a.q[2];
-	result.q[2] = b.q[0] * a.q[2] + b.q[1] * a.q[3] +
-		b.q[2] * a.q[0] - b.q[3] * a.q[1];
-	result.q[3] = b.q[0] * a.q[3] - b.q[1] * a.q[2] +
-		b.q[2] * a.q[1] + b.q[3] * a.q[0];
+	result.q[0] = b->q[0] * a->q[0] - b->q[1] * a->q[1] -
+		b->q[2] * a->q[2] - b->q[3] * a->q[3];
+	result.q[1] = b->q[0] * a->q[1] + b->q[1] * a->q[0] -
+		b->q[2] * a->q[3] + b->q[3] * a->q[2];
+	result.q[2] = b->q[0] * a->q[2] + b->q[1] * a->q[3] +
+		b->q[2] * a->q[0] - b->q[3] * a->q[1];
+	result.q[3] = b->q[0] * a->q[3] - b->q[1] * a->q[2] +
+		b->q[2] * a->q[1] + b->q[3] * a->q[0];
 	// re-normalise in case of mangling
-	return normalise_quat (result);
+	*r = normalise_quat (result);
+}
+
+inline versor mult_quat_quat (versor a, versor b) {
+	versor r;
+	mult_quat_quat_p (&a, &b, &r);
+	return r;
 }
 
 // add versor to a versor
@@ -771,28 +1544,32 @@ inline versor quat_from_axis_deg (float degrees, float x, float y, float z) {
 }
 
 // convert versor to rotation matrix
+inline void quat_to_mat4_p (const versor* q, mat4* r) {
+	float w = q->q[0];
+	float x = q->q[1];
+	float y = q->q[2];
+	float z = q->q[3];
+	r->m[0] = 1.0f - 2.0f * y * y - 2.0f * z * z;
+	r->m[1] = 2.0f * x * y + 2.0f * w * z;
+	r->m[2] = 2.0f * x * z - 2.0f * w * y;
+	r->m[3] = 0.0f;
+	r->m[4] = 2.0f * x * y - 2.0f * w * z;
+	r->m[5] = 1.0f - 2.0f * x * x - 2.0f * z * z;
+	r->m[6] = 2.0f * y * z + 2.0f * w * x;
+	r->m[7] = 0.0f;
+	r->m[8] = 2.0f * x * z + 2.0f * w * y;
+	r->m[9] = 2.0f * y * z - 2.0f * w * x;
+	r->m[10] = 1.0f - 2.0f * x * x - 2.0f * y * y;
+	r->m[11] = 0.0f;
+	r->m[12] = 0.0f;
+	r->m[13] = 0.0f;
+	r->m[14] = 0.0f;
+	r->m[15] = 1.0f;
+}
+
 inline mat4 quat_to_mat4 (versor q) {
-	float w = q.q[0];
-	float x = q.q[1];
-	float y = q.q[2];
-	float z = q.q[3];
 	mat4 r;
-	r.m[0] = 1.0f - 2.0f * y * y - 2.0f * z * z;
-	r.m[1] = 2.0f * x * y + 2.0f * w * z;
-	r.m[2] = 2.0f * x * z - 2.0f * w * y;
-	r.m[3] = 0.0f;
-	r.m[4] = 2.0f * x * y - 2.0f * w * z;
-	r.m[5] = 1.0f - 2.0f * x * x - 2.0f * z * z;
-	r.m[6] = 2.0f * y * z + 2.0f * w * x;
-	r.m[7] = 0.0f;
-	r.m[8] = 2.0f * x * z + 2.0f * w * y;
-	r.m[9] = 2.0f * y * z - 2.0f * w * x;
-	r.m[10] = 1.0f - 2.0f * x * x - 2.0f * y * y;
-	r.m[11] = 0.0f;
-	r.m[12] = 0.0f;
-	r.m[13] = 0.0f;
-	r.m[14] = 0.0f;
-	r.m[15] = 1.0f;
+	quat_to_mat4_p (&q, &r);
 	return r;
 }
 
@@ -0,0 +1,968 @@
+/*****************************************************************************\
+| Anton's Maths Library -- GCC/Clang vector extensions version                |
+| Email: anton at antongerdelan dot net                                       |
+| Finished from the 030_clang_vectors and 031_gcc_vectors experiments         |
+| Copyright Dr Anton Gerdelan                                                 |
+|*****************************************************************************|
+| Drop-in replacement for apg_maths.h: the same structs, with the same "v",   |
+| "m", "q" float arrays, and the same functions, so switching is just a       |
+| change of #include. Inside, the maths is done on 4-wide vector_size types,  |
+| which both GCC and Clang support, and the compiler picks the instructions   |
+| for whatever -m flags it was given (SSE2 on any x86-64, NEON on ARM, ...).  |
+| Everything is static inline so it can sit next to apg_maths.h in a program  |
+| as long as no one file includes both.                                       |
+| Results match apg_maths.h to within rounding. Sums are done in the same     |
+| order but the compiler may fuse multiply-adds when FMA is enabled.          |
+\*****************************************************************************/
+#pragma once
+
+#if !defined(__GNUC__) && !defined(__clang__)
+#error "apg_maths_vec.h needs GCC or Clang vector extensions. use apg_maths.h"
+#endif
+
+#include <stdio.h>
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <string.h> // memset, memcpy
+#include <stdint.h> // uint32_t
+
+// C99 removed M_PI
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+// const used to convert degrees into radians
+#define TAU 2.0 * M_PI
+#define ONE_DEG_IN_RAD (2.0 * M_PI) / 360.0 // 0.017444444
+#define ONE_RAD_IN_DEG 360.0 / (2.0 * M_PI) //57.2957795
+
+// the working register type. vec3 is loaded with a 0 (or 1) in the w lane
+typedef float apg_f4 __attribute__ ((vector_size (16)));
+typedef int apg_i4 __attribute__ ((vector_size (16)));
+
+// lane shuffles. GCC only got __builtin_shufflevector in version 12
+#if defined(__clang__) || __GNUC__ >= 12
+#define APG_SHUF(a, x, y, z, w) __builtin_shufflevector (a, a, x, y, z, w)
+#define APG_SHUF2(a, b, x, y, z, w) __builtin_shufflevector (a, b, x, y, z, w)
+#else
+#define APG_SHUF(a, x, y, z, w) __builtin_shuffle (a, (apg_i4){ x, y, z, w })
+#define APG_SHUF2(a, b, x, y, z, w) \
+	__builtin_shuffle (a, b, (apg_i4){ x, y, z, w })
+#endif
+
+// data structures -- identical to apg_maths.h
+typedef struct vec2 vec2;
+typedef struct vec3 vec3;
+typedef struct vec4 vec4;
+typedef struct mat4 mat4;
+typedef struct versor versor;
+typedef struct frustum frustum;
+
+// xy
+struct vec2 {
+	float v[2];
+};
+
+// xyz
+struct vec3 {
+	float v[3];
+};
+
+// xyzw
+struct vec4 {
+	float v[4];
+};
+
+// stored like this:
+// 00 04 08 12
+// 01 05 09 13
+// 02 06 10 14
+// 03 07 11 15
+struct mat4 {
+	float m[16];
+};
+
+// a unit quaternion used for rotation (xyzw)
+struct versor {
+	float q[4];
+};
+
+// left, right, bottom, top, near, far planes as (a,b,c,d), inside >= 0
+struct frustum {
+	vec4 planes[6];
+};
+
+// same levels as apg_maths.h. here they only report what the compiler was
+// told to target - there is nothing to switch at run time
+typedef enum apg_simd_level {
+	APG_SIMD_SCALAR = 0, APG_SIMD_SSE2, APG_SIMD_AVX_FMA
+} apg_simd_level;
+
+/*---------------------------------REGISTERS---------------------------------*/
+// memcpy keeps these legal for any alignment. compilers turn it into a movups
+static inline apg_f4 apg_load4 (const float* p) {
+	apg_f4 r;
+	memcpy (&r, p, sizeof (apg_f4));
+	return r;
+}
+
+static inline void apg_store4 (float* p, apg_f4 a) {
+	memcpy (p, &a, sizeof (apg_f4));
+}
+
+static inline apg_f4 apg_load3 (const float* p, float w) {
+	apg_f4 r = { p[0], p[1], p[2], w };
+	return r;
+}
+
+static inline void apg_store3 (float* p, apg_f4 a) {
+	p[0] = a[0];
+	p[1] = a[1];
+	p[2] = a[2];
+}
+
+static inline apg_f4 apg_splat (float f) {
+	apg_f4 r = { f, f, f, f };
+	return r;
+}
+
+static inline float apg_sum3 (apg_f4 a) {
+	return a[0] + a[1] + a[2];
+}
+
+static inline float apg_sum4 (apg_f4 a) {
+	return a[0] + a[1] + a[2] + a[3];
+}
+
+/*-----------------------------PRINT FUNCTIONS-------------------------------*/
+static inline void print_vec2 (vec2 v) {
+	printf ("[%.2f, %.2f]\n", v.v[0], v.v[1]);
+}
+
+static inline void print_vec3 (vec3 v) {
+	printf ("[%.2f, %.2f, %.2f]\n", v.v[0], v.v[1], v.v[2]);
+}
+
+static inline void print_vec4 (vec4 v) {
+	printf ("[%.2f, %.2f, %.2f, %.2f]\n", v.v[0], v.v[1], v.v[2], v.v[3]);
+}
+
+static inline void print_mat4 (mat4 m) {
+	printf("\n");
+	printf ("[%.2f][%.2f][%.2f][%.2f]\n", m.m[0], m.m[4], m.m[8], m.m[12]);
+	printf ("[%.2f][%.2f][%.2f][%.2f]\n", m.m[1], m.m[5], m.m[9], m.m[13]);
+	printf ("[%.2f][%.2f][%.2f][%.2f]\n", m.m[2], m.m[6], m.m[10], m.m[14]);
+	printf ("[%.2f][%.2f][%.2f][%.2f]\n", m.m[3], m.m[7], m.m[11], m.m[15]);
+}
+
+static inline void print_quat (versor q) {
+	printf ("[%.2f ,%.2f, %.2f, %.2f]\n", q.q[0], q.q[1], q.q[2], q.q[3]);
+}
+
+/*------------------------------VECTOR FUNCTIONS-----------------------------*/
+static inline vec2 vec2_from_2f (float x, float y) {
+	vec2 r = { { x, y } };
+	return r;
+}
+
+static inline vec2 vec2_from_vec2 (vec2 vv) {
+	return vv;
+}
+
+static inline vec3 vec3_from_3f (float x, float y, float z) {
+	vec3 r = { { x, y, z } };
+	return r;
+}
+
+static inline vec3 vec3_from_vec2_f (vec2 vv, float z) {
+	vec3 r = { { vv.v[0], vv.v[1], z } };
+	return r;
+}
+
+static inline vec3 vec3_from_vec3 (vec3 vv) {
+	return vv;
+}
+
+// create vec3 by truncating vec4
+static inline vec3 vec3_from_vec4 (vec4 vv) {
+	vec3 r = { { vv.v[0], vv.v[1], vv.v[2] } };
+	return r;
+}
+
+static inline vec4 vec4_from_4f (float x, float y, float z, float w) {
+	vec4 r = { { x, y, z, w } };
+	return r;
+}
+
+static inline vec4 vec4_from_vec3_f (vec3 vv, float w) {
+	vec4 r = { { vv.v[0], vv.v[1], vv.v[2], w } };
+	return r;
+}
+
+static inline vec4 vec4_from_vec4 (vec4 vv) {
+	return vv;
+}
+
+static inline vec3 add_vec3_vec3 (vec3 a, vec3 b) {
+	vec3 r;
+	apg_store3 (r.v, apg_load3 (a.v, 0.0f) + apg_load3 (b.v, 0.0f));
+	return r;
+}
+
+static inline vec3 sub_vec3_vec3 (vec3 a, vec3 b) {
+	vec3 r;
+	apg_store3 (r.v, apg_load3 (a.v, 0.0f) - apg_load3 (b.v, 0.0f));
+	return r;
+}
+
+static inline vec3 add_vec3_f (vec3 a, float b) {
+	vec3 r;
+	apg_store3 (r.v, apg_load3 (a.v, 0.0f) + apg_splat (b));
+	return r;
+}
+
+static inline vec3 sub_vec3_f (vec3 a, float b) {
+	vec3 r;
+	apg_store3 (r.v, apg_load3 (a.v, 0.0f) - apg_splat (b));
+	return r;
+}
+
+static inline vec3 mult_vec3_f (vec3 a, float b) {
+	vec3 r;
+	apg_store3 (r.v, apg_load3 (a.v, 0.0f) * apg_splat (b));
+	return r;
+}
+
+static inline vec3 div_vec3_f (vec3 a, float b) {
+	vec3 r;
+	apg_store3 (r.v, apg_load3 (a.v, 0.0f) / apg_splat (b));
+	return r;
+}
+
+static inline vec3 mult_vec3_vec3 (vec3 a, vec3 b) {
+	vec3 r;
+	apg_store3 (r.v, apg_load3 (a.v, 0.0f) * apg_load3 (b.v, 0.0f));
+	return r;
+}
+
+// w lane of the divisor is 1 so the unused lane doesn't do 0/0
+static inline vec3 div_vec3_vec3 (vec3 a, vec3 b) {
+	vec3 r;
+	apg_store3 (r.v, apg_load3 (a.v, 0.0f) / apg_load3 (b.v, 1.0f));
+	return r;
+}
+
+static inline float length2_vec3 (vec3 v) {
+	apg_f4 a = apg_load3 (v.v, 0.0f);
+	return apg_sum3 (a * a);
+}
+
+static inline float length_vec3 (vec3 v) {
+	return sqrt (length2_vec3 (v));
+}
+
+// note: proper spelling (hehe)
+static inline vec3 normalise_vec3 (vec3 v) {
+	float l = length_vec3 (v);
+	if (0.0f == l) {
+		return vec3_from_3f (0.0f, 0.0f, 0.0f);
+	}
+	return div_vec3_f (v, l);
+}
+
+static inline float dot_vec3 (vec3 a, vec3 b) {
+	return apg_sum3 (apg_load3 (a.v, 0.0f) * apg_load3 (b.v, 0.0f));
+}
+
+// a.yzx * b.zxy - a.zxy * b.yzx
+static inline vec3 cross_vec3 (vec3 a, vec3 b) {
+	apg_f4 va = apg_load3 (a.v, 0.0f), vb = apg_load3 (b.v, 0.0f);
+	apg_f4 r = APG_SHUF (va, 1, 2, 0, 3) * APG_SHUF (vb, 2, 0, 1, 3) -
+		APG_SHUF (va, 2, 0, 1, 3) * APG_SHUF (vb, 1, 2, 0, 3);
+	vec3 rv;
+	apg_store3 (rv.v, r);
+	return rv;
+}
+
+// converts an un-normalised direction vector's X,Z components into a heading
+// in degrees
+// NB i suspect that the z is backwards here but i've used in in
+// several places like this. d'oh!
+static inline float vec3_to_heading (vec3 d) {
+	return atan2 (-d.v[0], -d.v[2]) * ONE_RAD_IN_DEG;
+}
+
+// very informal function to convert a heading (e.g. y-axis orientation) into
+// a 3d vector with components in x and z axes
+static inline vec3 heading_to_vec3 (float degrees) {
+	float rad = degrees * ONE_DEG_IN_RAD;
+	return vec3_from_3f (-sinf (rad), 0.0f, -cosf (rad));
+}
+
+/*-----------------------------MATRIX FUNCTIONS------------------------------*/
+static inline mat4 zero_mat4 () {
+	mat4 r;
+	memset (r.m, 0, 16 * sizeof (float));
+	return r;
+}
+
+static inline mat4 identity_mat4 () {
+	mat4 r = zero_mat4 ();
+	r.m[0] = 1.0f;
+	r.m[5] = 1.0f;
+	r.m[10] = 1.0f;
+	r.m[15] = 1.0f;
+	return r;
+}
+
+static inline mat4 mat4_from_mat4 (mat4 mm) {
+	return mm;
+}
+
+// result column = a's columns weighted by the elements of b's column
+static inline mat4 mult_mat4_mat4 (mat4 a, mat4 b) {
+	apg_f4 a0 = apg_load4 (a.m), a1 = apg_load4 (a.m + 4);
+	apg_f4 a2 = apg_load4 (a.m + 8), a3 = apg_load4 (a.m + 12);
+	mat4 r;
+	for (int col = 0; col < 4; col++) {
+		apg_f4 bc = apg_load4 (b.m + col * 4);
+		apg_f4 sum = APG_SHUF (bc, 0, 0, 0, 0) * a0;
+		sum += APG_SHUF (bc, 1, 1, 1, 1) * a1;
+		sum += APG_SHUF (bc, 2, 2, 2, 2) * a2;
+		sum += APG_SHUF (bc, 3, 3, 3, 3) * a3;
+		apg_store4 (r.m + col * 4, sum);
+	}
+	return r;
+}
+
+static inline vec4 mult_mat4_vec4 (mat4 m, vec4 v) {
+	apg_f4 vv = apg_load4 (v.v);
+	apg_f4 sum = APG_SHUF (vv, 0, 0, 0, 0) * apg_load4 (m.m);
+	sum += APG_SHUF (vv, 1, 1, 1, 1) * apg_load4 (m.m + 4);
+	sum += APG_SHUF (vv, 2, 2, 2, 2) * apg_load4 (m.m + 8);
+	sum += APG_SHUF (vv, 3, 3, 3, 3) * apg_load4 (m.m + 12);
+	vec4 r;
+	apg_store4 (r.v, sum);
+	return r;
+}
+
+// all twelve 2x2 determinants of the inverse come out of six column pairs:
+// lane 0 of apg_det2 (ci, cj) is rows 0,1 of columns i,j and lane 2 is rows 2,3
+static inline apg_f4 apg_det2 (apg_f4 ci, apg_f4 cj) {
+	apg_f4 p = ci * APG_SHUF (cj, 1, 0, 3, 2);
+	return p - APG_SHUF (p, 1, 0, 3, 2);
+}
+
+static inline void apg_transpose4 (apg_f4* r0, apg_f4* r1, apg_f4* r2,
+	apg_f4* r3) {
+	apg_f4 t0 = APG_SHUF2 (*r0, *r1, 0, 4, 1, 5);
+	apg_f4 t1 = APG_SHUF2 (*r2, *r3, 0, 4, 1, 5);
+	apg_f4 t2 = APG_SHUF2 (*r0, *r1, 2, 6, 3, 7);
+	apg_f4 t3 = APG_SHUF2 (*r2, *r3, 2, 6, 3, 7);
+	*r0 = APG_SHUF2 (t0, t1, 0, 1, 4, 5);
+	*r1 = APG_SHUF2 (t0, t1, 2, 3, 6, 7);
+	*r2 = APG_SHUF2 (t2, t3, 0, 1, 4, 5);
+	*r3 = APG_SHUF2 (t2, t3, 2, 3, 6, 7);
+}
+
+// determinant by expanding the 2x2 minors of the top and bottom row pairs
+static inline float det_mat4 (mat4 mm) {
+	apg_f4 c0 = apg_load4 (mm.m), c1 = apg_load4 (mm.m + 4);
+	apg_f4 c2 = apg_load4 (mm.m + 8), c3 = apg_load4 (mm.m + 12);
+	apg_f4 d01 = apg_det2 (c0, c1), d02 = apg_det2 (c0, c2);
+	apg_f4 d03 = apg_det2 (c0, c3), d12 = apg_det2 (c1, c2);
+	apg_f4 d13 = apg_det2 (c1, c3), d23 = apg_det2 (c2, c3);
+	return d01[0] * d23[2] - d02[0] * d13[2] + d03[0] * d12[2] +
+		d12[0] * d03[2] - d13[0] * d02[2] + d23[0] * d01[2];
+}
+
+// inverse from the 2x2 minors (Laplace expansion) rather than the 3x3
+// cofactor-per-element method of apg_maths.h - about a third of the multiplies
+// and all 4-wide. each row of the inverse is three minors weighted by shuffled
+// columns, then a transpose gives the column-major result
+static inline mat4 inverse_mat4 (mat4 mm) {
+	apg_f4 c0 = apg_load4 (mm.m), c1 = apg_load4 (mm.m + 4);
+	apg_f4 c2 = apg_load4 (mm.m + 8), c3 = apg_load4 (mm.m + 12);
+	apg_f4 d01 = apg_det2 (c0, c1), d02 = apg_det2 (c0, c2);
+	apg_f4 d03 = apg_det2 (c0, c3), d12 = apg_det2 (c1, c2);
+	apg_f4 d13 = apg_det2 (c1, c3), d23 = apg_det2 (c2, c3);
+	float det = d01[0] * d23[2] - d02[0] * d13[2] + d03[0] * d12[2] +
+		d12[0] * d03[2] - d13[0] * d02[2] + d23[0] * d01[2];
+	/* there is no inverse if determinant is zero (not likely unless scale is
+	broken) */
+	if (0.0f == det) {
+		fprintf (stderr, "WARNING. matrix has no determinant. can not invert\n");
+		return mm;
+	}
+	// bottom-pair minor twice then top-pair minor twice
+	apg_f4 k01 = APG_SHUF (d01, 2, 2, 0, 0), k02 = APG_SHUF (d02, 2, 2, 0, 0);
+	apg_f4 k03 = APG_SHUF (d03, 2, 2, 0, 0), k12 = APG_SHUF (d12, 2, 2, 0, 0);
+	apg_f4 k13 = APG_SHUF (d13, 2, 2, 0, 0), k23 = APG_SHUF (d23, 2, 2, 0, 0);
+	apg_f4 sgn = { 1.0f, -1.0f, 1.0f, -1.0f };
+	apg_f4 y0 = sgn * APG_SHUF (c0, 1, 0, 3, 2);
+	apg_f4 y1 = sgn * APG_SHUF (c1, 1, 0, 3, 2);
+	apg_f4 y2 = sgn * APG_SHUF (c2, 1, 0, 3, 2);
+	apg_f4 y3 = sgn * APG_SHUF (c3, 1, 0, 3, 2);
+	apg_f4 inv_det = apg_splat (1.0f / det);
+	apg_f4 r0 = (y1 * k23 - y2 * k13 + y3 * k12) * inv_det;
+	apg_f4 r1 = (y2 * k03 - y0 * k23 - y3 * k02) * inv_det;
+	apg_f4 r2 = (y0 * k13 - y1 * k03 + y3 * k01) * inv_det;
+	apg_f4 r3 = (y1 * k02 - y0 * k12 - y2 * k01) * inv_det;
+	apg_transpose4 (&r0, &r1, &r2, &r3);
+	mat4 r;
+	apg_store4 (r.m, r0);
+	apg_store4 (r.m + 4, r1);
+	apg_store4 (r.m + 8, r2);
+	apg_store4 (r.m + 12, r3);
+	return r;
+}
+
+// returns a 16-element array flipped on the main diagonal
+static inline mat4 transpose_mat4 (mat4 mm) {
+	apg_f4 c0 = apg_load4 (mm.m), c1 = apg_load4 (mm.m + 4);
+	apg_f4 c2 = apg_load4 (mm.m + 8), c3 = apg_load4 (mm.m + 12);
+	apg_transpose4 (&c0, &c1, &c2, &c3);
+	mat4 r;
+	apg_store4 (r.m, c0);
+	apg_store4 (r.m + 4, c1);
+	apg_store4 (r.m + 8, c2);
+	apg_store4 (r.m + 12, c3);
+	return r;
+}
+
+// rotation part is orthonormal so its inverse is its transpose, and the
+// translation t becomes -R^T * t
+static inline mat4 inverse_rigid_mat4 (mat4 mm) {
+	mat4 r;
+	r.m[0] = mm.m[0];
+	r.m[1] = mm.m[4];
+	r.m[2] = mm.m[8];
+	r.m[3] = 0.0f;
+	r.m[4] = mm.m[1];
+	r.m[5] = mm.m[5];
+	r.m[6] = mm.m[9];
+	r.m[7] = 0.0f;
+	r.m[8] = mm.m[2];
+	r.m[9] = mm.m[6];
+	r.m[10] = mm.m[10];
+	r.m[11] = 0.0f;
+	r.m[12] = -(mm.m[0] * mm.m[12] + mm.m[1] * mm.m[13] + mm.m[2] * mm.m[14]);
+	r.m[13] = -(mm.m[4] * mm.m[12] + mm.m[5] * mm.m[13] + mm.m[6] * mm.m[14]);
+	r.m[14] = -(mm.m[8] * mm.m[12] + mm.m[9] * mm.m[13] + mm.m[10] * mm.m[14]);
+	r.m[15] = 1.0f;
+	return r;
+}
+
+// inverts the upper 3x3 with cross products of its columns a, b, c - the rows
+// of the inverse are b x c, c x a, a x b over the determinant a . (b x c)
+static inline mat4 inverse_affine_mat4 (mat4 mm) {
+	vec3 a = vec3_from_3f (mm.m[0], mm.m[1], mm.m[2]);
+	vec3 b = vec3_from_3f (mm.m[4], mm.m[5], mm.m[6]);
+	vec3 c = vec3_from_3f (mm.m[8], mm.m[9], mm.m[10]);
+	vec3 bc = cross_vec3 (b, c);
+	vec3 ca = cross_vec3 (c, a);
+	vec3 ab = cross_vec3 (a, b);
+	float det = dot_vec3 (a, bc);
+	if (0.0f == det) {
+		fprintf (stderr, "WARNING. matrix has no determinant. can not invert\n");
+		return mm;
+	}
+	float inv_det = 1.0f / det;
+	bc = mult_vec3_f (bc, inv_det);
+	ca = mult_vec3_f (ca, inv_det);
+	ab = mult_vec3_f (ab, inv_det);
+	vec3 t = vec3_from_3f (mm.m[12], mm.m[13], mm.m[14]);
+	mat4 r;
+	r.m[0] = bc.v[0];
+	r.m[1] = ca.v[0];
+	r.m[2] = ab.v[0];
+	r.m[3] = 0.0f;
+	r.m[4] = bc.v[1];
+	r.m[5] = ca.v[1];
+	r.m[6] = ab.v[1];
+	r.m[7] = 0.0f;
+	r.m[8] = bc.v[2];
+	r.m[9] = ca.v[2];
+	r.m[10] = ab.v[2];
+	r.m[11] = 0.0f;
+	r.m[12] = -dot_vec3 (bc, t);
+	r.m[13] = -dot_vec3 (ca, t);
+	r.m[14] = -dot_vec3 (ab, t);
+	r.m[15] = 1.0f;
+	return r;
+}
+
+/*--------------------------AFFINE MATRIX FUNCTIONS--------------------------*/
+// translate a 4d matrix with xyz array
+static inline mat4 translate_mat4 (vec3 vv) {
+	mat4 r = identity_mat4 ();
+	r.m[12] = vv.v[0];
+	r.m[13] = vv.v[1];
+	r.m[14] = vv.v[2];
+	return r;
+}
+
+// rotate around x axis by an angle in degrees
+static inline mat4 rot_x_deg_mat4 (float deg) {
+	// convert to radians
+	float rad = deg * ONE_DEG_IN_RAD;
+	mat4 r = identity_mat4 ();
+	r.m[5] = cos (rad);
+	r.m[9] = -sin (rad);
+	r.m[6] = sin (rad);
+	r.m[10] = cos (rad);
+	return r;
+}
+
+// rotate around y axis by an angle in degrees
+static inline mat4 rot_y_deg_mat4 (float deg) {
+	// convert to radians
+	float rad = deg * ONE_DEG_IN_RAD;
+	mat4 r = identity_mat4 ();
+	r.m[0] = cos (rad);
+	r.m[8] = sin (rad);
+	r.m[2] = -sin (rad);
+	r.m[10] = cos (rad);
+	return r;
+}
+
+// rotate around z axis by an angle in degrees
+static inline mat4 rot_z_deg_mat4 (float deg) {
+	// convert to radians
+	float rad = deg * ONE_DEG_IN_RAD;
+	mat4 r = identity_mat4 ();
+	r.m[0] = cos (rad);
+	r.m[4] = -sin (rad);
+	r.m[1] = sin (rad);
+	r.m[5] = cos (rad);
+	return r;
+}
+
+// scale a matrix by [x, y, z]
+static inline mat4 scale_mat4 (vec3 v) {
+	mat4 r = identity_mat4 ();
+	r.m[0] = v.v[0];
+	r.m[5] = v.v[1];
+	r.m[10] = v.v[2];
+	return r;
+}
+
+/*-----------------------VIRTUAL CAMERA MATRIX FUNCTIONS---------------------*/
+// returns a view matrix using the GLU lookAt style.
+static inline mat4 look_at (vec3 cam_pos, vec3 targ_pos, vec3 up) {
+	// inverse translation
+	mat4 p = translate_mat4 (vec3_from_3f (-cam_pos.v[0], -cam_pos.v[1],
+		-cam_pos.v[2]));
+	// distance vector
+	vec3 d = sub_vec3_vec3 (targ_pos, cam_pos);
+	// forward vector
+	vec3 f = normalise_vec3 (d);
+	// right vector
+	vec3 r = normalise_vec3 (cross_vec3 (f, up));
+	// real up vector
+	vec3 u = normalise_vec3 (cross_vec3 (r, f));
+	mat4 ori = identity_mat4 ();
+	ori.m[0] = r.v[0];
+	ori.m[4] = r.v[1];
+	ori.m[8] = r.v[2];
+	ori.m[1] = u.v[0];
+	ori.m[5] = u.v[1];
+	ori.m[9] = u.v[2];
+	ori.m[2] = -f.v[0];
+	ori.m[6] = -f.v[1];
+	ori.m[10] = -f.v[2];
+	return mult_mat4_mat4 (ori, p);
+}
+
+// returns a perspective matrix mimicking the opengl projection style
+// remeber if calculating aspect to do floating point division, not integer
+static inline mat4 perspective (float fovy, float aspect, float near,
+	float far) {
+	float fov_rad = fovy * ONE_DEG_IN_RAD;
+	float range = tan (fov_rad / 2.0f) * near;
+	float sx = (2.0f * near) / (range * aspect + range * aspect);
+	float sy = near / range;
+	float sz = -(far + near) / (far - near);
+	float pz = -(2.0f * far * near) / (far - near);
+	mat4 m = zero_mat4 (); // make sure bottom-right corner is zero
+	m.m[0] = sx;
+	m.m[5] = sy;
+	m.m[10] = sz;
+	m.m[14] = pz;
+	m.m[11] = -1.0f;
+	return m;
+}
+
+/*-----------------------------BATCH TRANSFORMS------------------------------*/
+// as apg_maths.h. 4 points at a time here; the scalar loop does the leftovers
+static inline void apg_points_soa_vec (mat4 m, const float* xs,
+	const float* ys, const float* zs, int n, int project, vec4 viewport,
+	float* rxs, float* rys, float* rzs, float* rws) {
+	apg_f4 mm[16];
+	for (int i = 0; i < 16; i++) {
+		mm[i] = apg_splat (m.m[i]);
+	}
+	float hw = viewport.v[2] * 0.5f, hh = viewport.v[3] * 0.5f;
+	apg_f4 one = apg_splat (1.0f), half = apg_splat (0.5f);
+	int i = 0;
+	for (; i + 4 <= n; i += 4) {
+		apg_f4 x = apg_load4 (xs + i), y = apg_load4 (ys + i);
+		apg_f4 z = apg_load4 (zs + i);
+		apg_f4 cx = mm[0] * x + mm[4] * y + mm[8] * z + mm[12];
+		apg_f4 cy = mm[1] * x + mm[5] * y + mm[9] * z + mm[13];
+		apg_f4 cz = mm[2] * x + mm[6] * y + mm[10] * z + mm[14];
+		apg_f4 cw = mm[3] * x + mm[7] * y + mm[11] * z + mm[15];
+		if (project) {
+			apg_f4 iw = one / cw;
+			cx = (cx * iw + one) * apg_splat (hw) + apg_splat (viewport.v[0]);
+			cy = (cy * iw + one) * apg_splat (hh) + apg_splat (viewport.v[1]);
+			cz = cz * iw * half + half;
+			cw = iw;
+		}
+		apg_store4 (rxs + i, cx);
+		apg_store4 (rys + i, cy);
+		apg_store4 (rzs + i, cz);
+		apg_store4 (rws + i, cw);
+	}
+	for (; i < n; i++) {
+		float x = xs[i], y = ys[i], z = zs[i];
+		float cx = m.m[0] * x + m.m[4] * y + m.m[8] * z + m.m[12];
+		float cy = m.m[1] * x + m.m[5] * y + m.m[9] * z + m.m[13];
+		float cz = m.m[2] * x + m.m[6] * y + m.m[10] * z + m.m[14];
+		float cw = m.m[3] * x + m.m[7] * y + m.m[11] * z + m.m[15];
+		if (project) {
+			float iw = 1.0f / cw;
+			cx = (cx * iw + 1.0f) * hw + viewport.v[0];
+			cy = (cy * iw + 1.0f) * hh + viewport.v[1];
+			cz = cz * iw * 0.5f + 0.5f;
+			cw = iw;
+		}
+		rxs[i] = cx;
+		rys[i] = cy;
+		rzs[i] = cz;
+		rws[i] = cw;
+	}
+}
+
+static inline void transform_points_soa (mat4 m, const float* xs,
+	const float* ys, const float* zs, int n, float* rxs, float* rys,
+	float* rzs, float* rws) {
+	apg_points_soa_vec (m, xs, ys, zs, n, 0, vec4_from_4f (0, 0, 0, 0), rxs,
+		rys, rzs, rws);
+}
+
+static inline void project_points_soa (mat4 m, const float* xs,
+	const float* ys, const float* zs, int n, vec4 viewport, float* rxs,
+	float* rys, float* rzs, float* rws) {
+	apg_points_soa_vec (m, xs, ys, zs, n, 1, viewport, rxs, rys, rzs, rws);
+}
+
+/*----------------------------FRUSTUM CULLING--------------------------------*/
+// as apg_maths.h
+static inline void frustum_from_mat4_p (const mat4* pv, frustum* r) {
+	const float* m = pv->m;
+	for (int i = 0; i < 6; i++) {
+		int row = i / 2;
+		float sign = (i & 1) ? -1.0f : 1.0f;
+		float* p = r->planes[i].v;
+		for (int j = 0; j < 4; j++) {
+			p[j] = m[3 + j * 4] + sign * m[row + j * 4];
+		}
+		float l = sqrt (p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+		if (l > 0.0f) {
+			for (int j = 0; j < 4; j++) {
+				p[j] /= l;
+			}
+		}
+	}
+}
+
+static inline frustum frustum_from_mat4 (mat4 pv) {
+	frustum f;
+	frustum_from_mat4_p (&pv, &f);
+	return f;
+}
+
+// 4 objects at a time. rs is NULL for boxes. comparisons give -1 in the lanes
+// that pass, which are packed into 4 bits of visible
+static inline void apg_cull_soa_vec (const frustum* f, const float* xs,
+	const float* ys, const float* zs, const float* rs, const float* exs,
+	const float* eys, const float* ezs, int n, uint32_t* visible) {
+	apg_f4 p[24], ap[18];
+	for (int j = 0; j < 6; j++) {
+		for (int k = 0; k < 4; k++) {
+			p[j * 4 + k] = apg_splat (f->planes[j].v[k]);
+		}
+		for (int k = 0; k < 3; k++) {
+			ap[j * 3 + k] = apg_splat (fabsf (f->planes[j].v[k]));
+		}
+	}
+	memset (visible, 0, (size_t)((n + 31) / 32) * sizeof (uint32_t));
+	int i = 0;
+	for (; i + 4 <= n; i += 4) {
+		apg_f4 x = apg_load4 (xs + i), y = apg_load4 (ys + i);
+		apg_f4 z = apg_load4 (zs + i);
+		apg_i4 in = { -1, -1, -1, -1 };
+		for (int j = 0; j < 6; j++) {
+			apg_f4 reach;
+			if (rs) {
+				reach = apg_load4 (rs + i);
+			} else {
+				reach = ap[j * 3] * apg_load4 (exs + i) +
+					ap[j * 3 + 1] * apg_load4 (eys + i) +
+					ap[j * 3 + 2] * apg_load4 (ezs + i);
+			}
+			apg_f4 d = p[j * 4] * x + p[j * 4 + 1] * y + p[j * 4 + 2] * z +
+				p[j * 4 + 3];
+			in &= d >= -reach;
+		}
+		uint32_t bits = (in[0] & 1) | (in[1] & 2) | (in[2] & 4) | (in[3] & 8);
+		visible[i >> 5] |= bits << (i & 31);
+	}
+	for (; i < n; i++) {
+		int inside = 1;
+		for (int j = 0; j < 6 && inside; j++) {
+			const float* pl = f->planes[j].v;
+			float reach = rs ? rs[i] : fabsf (pl[0]) * exs[i] +
+				fabsf (pl[1]) * eys[i] + fabsf (pl[2]) * ezs[i];
+			float d = pl[0] * xs[i] + pl[1] * ys[i] + pl[2] * zs[i] + pl[3];
+			inside = d >= -reach;
+		}
+		if (inside) {
+			visible[i >> 5] |= 1u << (i & 31);
+		}
+	}
+}
+
+static inline void cull_spheres_soa (const frustum* f, const float* xs,
+	const float* ys, const float* zs, const float* rs, int n,
+	uint32_t* visible) {
+	apg_cull_soa_vec (f, xs, ys, zs, rs, NULL, NULL, NULL, n, visible);
+}
+
+static inline void cull_aabbs_soa (const frustum* f, const float* cxs,
+	const float* cys, const float* czs, const float* exs, const float* eys,
+	const float* ezs, int n, uint32_t* visible) {
+	apg_cull_soa_vec (f, cxs, cys, czs, NULL, exs, eys, ezs, n, visible);
+}
+
+static inline apg_simd_level get_maths_simd_level () {
+#if defined(__AVX__) && defined(__FMA__)
+	return APG_SIMD_AVX_FMA;
+#elif defined(__SSE2__)
+	return APG_SIMD_SSE2;
+#else
+	return APG_SIMD_SCALAR;
+#endif
+}
+
+static inline apg_simd_level set_maths_simd_level (apg_simd_level level) {
+	(void)level;
+	return get_maths_simd_level ();
+}
+
+/*----------------------------HAMILTON IN DA HOUSE!--------------------------*/
+// manual cons
+static inline versor versor_from_4f (float x, float y, float z, float w) {
+	versor r = { { x, y, z, w } };
+	return r;
+}
+
+// assignment
+static inline versor versor_from_versor (versor qq) {
+	return qq;
+}
+
+// divide versor by a scalar
+static inline versor div_quat_f (versor qq, float s) {
+	versor r;
+	apg_store4 (r.q, apg_load4 (qq.q) / apg_splat (s));
+	return r;
+}
+
+// mult versor by a scalar
+static inline versor mult_quat_f (versor qq, float s) {
+	versor r;
+	apg_store4 (r.q, apg_load4 (qq.q) * apg_splat (s));
+	return r;
+}
+
+static inline float dot_quat (versor q, versor r) {
+	return apg_sum4 (apg_load4 (q.q) * apg_load4 (r.q));
+}
+
+// normalise a quaternion into a unit quaternion (versor) for use in rotation
+static inline versor normalise_quat (versor q) {
+	// only compute sqrt if interior sum != 1.0
+	float sum = dot_quat (q, q);
+	// NB: floats have min 6 digits of precision
+	const float thresh = 0.0001f;
+	if (fabs (1.0f - sum) < thresh) {
+		return q;
+	}
+	float mag = sqrt (sum);
+	return div_quat_f (q, mag);
+}
+
+// Hamilton product as four 4-wide multiply-adds of b's lanes with sign-flipped
+// shuffles of a
+static inline versor mult_quat_quat (versor a, versor b) {
+	apg_f4 va = apg_load4 (a.q), vb = apg_load4 (b.q);
+	apg_f4 s1 = { -1.0f, 1.0f, 1.0f, -1.0f };
+	apg_f4 s2 = { -1.0f, -1.0f, 1.0f, 1.0f };
+	apg_f4 s3 = { -1.0f, 1.0f, -1.0f, 1.0f };
+	apg_f4 r = APG_SHUF (vb, 0, 0, 0, 0) * va;
+	r += APG_SHUF (vb, 1, 1, 1, 1) * (APG_SHUF (va, 1, 0, 3, 2) * s1);
+	r += APG_SHUF (vb, 2, 2, 2, 2) * (APG_SHUF (va, 2, 3, 0, 1) * s2);
+	r += APG_SHUF (vb, 3, 3, 3, 3) * (APG_SHUF (va, 3, 2, 1, 0) * s3);
+	versor result;
+	apg_store4 (result.q, r);
+	// re-normalise in case of mangling
+	return normalise_quat (result);
+}
+
+// add versor to a versor
+static inline versor add_quat_quat (versor a, versor b) {
+	versor result;
+	apg_store4 (result.q, apg_load4 (b.q) + apg_load4 (a.q));
+	// re-normalise in case of mangling
+	return normalise_quat (result);
+}
+
+// create quaternion from normalised axis and angle in radians around axis
+static inline versor quat_from_axis_rad (float radians, float x, float y,
+	float z) {
+	versor result;
+	result.q[0] = cos (radians / 2.0);
+	result.q[1] = sin (radians / 2.0) * x;
+	result.q[2] = sin (radians / 2.0) * y;
+	result.q[3] = sin (radians / 2.0) * z;
+	return result;
+}
+
+// create quaternion from normalised axis and angle in degrees around axis
+static inline versor quat_from_axis_deg (float degrees, float x, float y,
+	float z) {
+	return quat_from_axis_rad (ONE_DEG_IN_RAD * degrees, x, y, z);
+}
+
+// convert versor to rotation matrix
+static inline mat4 quat_to_mat4 (versor q) {
+	float w = q.q[0];
+	float x = q.q[1];
+	float y = q.q[2];
+	float z = q.q[3];
+	mat4 r;
+	r.m[0] = 1.0f - 2.0f * y * y - 2.0f * z * z;
+	r.m[1] = 2.0f * x * y + 2.0f * w * z;
+	r.m[2] = 2.0f * x * z - 2.0f * w * y;
+	r.m[3] = 0.0f;
+	r.m[4] = 2.0f * x * y - 2.0f * w * z;
+	r.m[5] = 1.0f - 2.0f * x * x - 2.0f * z * z;
+	r.m[6] = 2.0f * y * z + 2.0f * w * x;
+	r.m[7] = 0.0f;
+	r.m[8] = 2.0f * x * z + 2.0f * w * y;
+	r.m[9] = 2.0f * y * z - 2.0f * w * x;
+	r.m[10] = 1.0f - 2.0f * x * x - 2.0f * y * y;
+	r.m[11] = 0.0f;
+	r.m[12] = 0.0f;
+	r.m[13] = 0.0f;
+	r.m[14] = 0.0f;
+	r.m[15] = 1.0f;
+	return r;
+}
+
+// the conjugate of a versor is its inverse rotation, so the rotation part of
+// the view matrix is just that of the conjugate. the translation is then
+// -R^T * pos
+static inline mat4 view_from_quat_pos (versor q, vec3 pos) {
+	versor conj;
+	conj.q[0] = q.q[0];
+	conj.q[1] = -q.q[1];
+	conj.q[2] = -q.q[2];
+	conj.q[3] = -q.q[3];
+	mat4 r = quat_to_mat4 (conj);
+	float x = pos.v[0], y = pos.v[1], z = pos.v[2];
+	r.m[12] = -(r.m[0] * x + r.m[4] * y + r.m[8] * z);
+	r.m[13] = -(r.m[1] * x + r.m[5] * y + r.m[9] * z);
+	r.m[14] = -(r.m[2] * x + r.m[6] * y + r.m[10] * z);
+	return r;
+}
+
+// spherical linear interpolation between two quaternions
+// factor t between 0.0 and 1.0
+// returns interpolated versor
+static inline versor slerp_quat (versor q, versor r, float t) {
+	apg_f4 vq = apg_load4 (q.q), vr = apg_load4 (r.q);
+	// angle between q0-q1
+	float cos_half_theta = apg_sum4 (vq * vr);
+	// if dot product is negative then one quaternion should be negated, to make
+	// it take the short way around, rather than the long way
+	if (cos_half_theta < 0.0f) {
+		vq = -vq;
+		cos_half_theta = -cos_half_theta;
+	}
+	versor result;
+	// if qa=qb or qa=-qb then theta = 0 and we can return qa
+	if (fabs (cos_half_theta) >= 1.0f) {
+		apg_store4 (result.q, vq);
+		return result;
+	}
+	// Calculate temporary values
+	float sin_half_theta = sqrt (1.0f - cos_half_theta * cos_half_theta);
+	// if theta = 180 degrees then result is not fully defined
+	// we could rotate around any axis normal to qa or qb
+	if (fabs (sin_half_theta) < 0.001f) {
+		apg_store4 (result.q, apg_splat (1.0f - t) * vq + apg_splat (t) * vr);
+		return result;
+	}
+	float half_theta = acos (cos_half_theta);
+	float a = sin ((1.0f - t) * half_theta) / sin_half_theta;
+	float b = sin (t * half_theta) / sin_half_theta;
+	apg_store4 (result.q, vq * apg_splat (a) + vr * apg_splat (b));
+	return result;
+}
+
+/*-----------------------------POINTER VERSIONS------------------------------*/
+// same signatures as apg_maths.h's. here everything inlines, so these just
+// forward to the value functions. r may point at an input
+static inline void mult_mat4_mat4_p (const mat4* a, const mat4* b, mat4* r) {
+	*r = mult_mat4_mat4 (*a, *b);
+}
+
+static inline void mult_mat4_vec4_p (const mat4* m, const vec4* v, vec4* r) {
+	*r = mult_mat4_vec4 (*m, *v);
+}
+
+static inline float det_mat4_p (const mat4* mm) {
+	return det_mat4 (*mm);
+}
+
+static inline void inverse_mat4_p (const mat4* mm, mat4* r) {
+	*r = inverse_mat4 (*mm);
+}
+
+static inline void inverse_rigid_mat4_p (const mat4* mm, mat4* r) {
+	*r = inverse_rigid_mat4 (*mm);
+}
+
+static inline void inverse_affine_mat4_p (const mat4* mm, mat4* r) {
+	*r = inverse_affine_mat4 (*mm);
+}
+
+static inline void transpose_mat4_p (const mat4* mm, mat4* r) {
+	*r = transpose_mat4 (*mm);
+}
+
+static inline void view_from_quat_pos_p (const versor* q, const vec3* pos,
+	mat4* r) {
+	*r = view_from_quat_pos (*q, *pos);
+}
+
+static inline void mult_quat_quat_p (const versor* a, const versor* b,
+	versor* r) {
+	*r = mult_quat_quat (*a, *b);
+}
+
+static inline void quat_to_mat4_p (const versor* q, mat4* r) {
+	*r = quat_to_mat4 (*q);
+}
@@ -0,0 +1,250 @@
+/*****************************************************************************\
+| Anton's number tokeniser for text file formats. C99 and C++                 |
+| Email: anton at antongerdelan dot net                                       |
+| Copyright Dr Anton Gerdelan                                                 |
+|*****************************************************************************|
+| Header-only replacement for sscanf("%f")/sscanf("%i") when parsing big text |
+| files like Wavefront .obj.                                                  |
+| Every function takes a [str, end) range so it can run straight off a        |
+| memory-mapped file with no null terminator, and returns the pointer just    |
+| past what it consumed. If nothing could be parsed it returns str unchanged. |
+| Digits are scanned 8 at a time with SWAR (64-bit register) arithmetic.      |
+| Floats are built exactly in a double and rounded once to float. Anything    |
+| that can't be done exactly that way (more than 19 digits, big exponents,    |
+| denormals, a double landing exactly on a float half-way point, hex, inf,    |
+| nan) falls back to strtof, so results are identical to strtof - except      |
+| that apg_parse_float never skips a newline to find a number, where strtof   |
+| skips any isspace() character.                                              |
+\*****************************************************************************/
+#pragma once
+
+#include <float.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h> // strtof, strtol
+#include <string.h> // memcpy
+
+#if defined(_WIN32) || (defined(__BYTE_ORDER__) && \
+	__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define APG_PARSE_SWAR
+#endif
+
+static inline bool apg_is_digit (char c) {
+	return (unsigned char)(c - '0') < 10;
+}
+
+// skips spaces and tabs but never goes past the end of a line
+static inline const char* apg_skip_spaces (const char* str, const char* end) {
+	while (str < end && (*str == ' ' || *str == '\t')) {
+		str++;
+	}
+	return str;
+}
+
+#ifdef APG_PARSE_SWAR
+// true if all 8 bytes of a little-endian load are ascii '0'-'9'
+static inline bool apg_is_8_digits (uint64_t v) {
+	return ((v & 0xF0F0F0F0F0F0F0F0ULL) |
+		(((v + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) ==
+		0x3333333333333333ULL;
+}
+
+// converts 8 ascii digits to their value with 3 multiplies instead of 8
+static inline uint32_t apg_parse_8_digits (uint64_t v) {
+	const uint64_t mask = 0x000000FF000000FFULL;
+	const uint64_t mul1 = 0x000F424000000064ULL; // 100 + (1000000 << 32)
+	const uint64_t mul2 = 0x0000271000000001ULL; // 1 + (10000 << 32)
+	v -= 0x3030303030303030ULL;
+	v = (v * 10) + (v >> 8); // pairs of digits
+	v = (((v & mask) * mul1) + (((v >> 16) & mask) * mul2)) >> 32;
+	return (uint32_t)v;
+}
+#endif
+
+/* accumulates a run of digits into mantissa. n_digits counts digits once the
+   mantissa is non-zero, so leading zeros don't use up precision */
+static inline const char* apg_scan_digits (const char* str, const char* end,
+	uint64_t* mantissa, int* n_digits, int* n_scanned) {
+	const char* start = str;
+#ifdef APG_PARSE_SWAR
+	while (end - str >= 8 && *n_digits <= 11) {
+		uint64_t v;
+		memcpy (&v, str, 8);
+		if (!apg_is_8_digits (v)) {
+			break;
+		}
+		*mantissa = *mantissa * 100000000ULL + apg_parse_8_digits (v);
+		if (*mantissa) {
+			*n_digits += 8; // may over-count leading zeros, which is harmless
+		}
+		str += 8;
+	}
+#endif
+	while (str < end && apg_is_digit (*str)) {
+		if (*n_digits < 19) {
+			*mantissa = *mantissa * 10 + (uint64_t)(*str - '0');
+			if (*mantissa) {
+				(*n_digits)++;
+			}
+		} else {
+			*n_digits = 20; // too many for a uint64 - flags the strtof fallback
+		}
+		str++;
+	}
+	*n_scanned = (int)(str - start);
+	return str;
+}
+
+// strtof on a copy of the token, for the cases the fast path can't do exactly
+static inline const char* apg_parse_float_slow (const char* str,
+	const char* end, float* out) {
+	char tmp[128];
+	char* copy = tmp;
+	const char* tok_end = str;
+	while (tok_end < end && *tok_end != ' ' && *tok_end != '\t' &&
+		*tok_end != '\r' && *tok_end != '\n' && *tok_end != '/') {
+		tok_end++;
+	}
+	size_t len = (size_t)(tok_end - str);
+	if (len >= sizeof (tmp)) {
+		copy = (char*)malloc (len + 1);
+		if (!copy) {
+			return str;
+		}
+	}
+	memcpy (copy, str, len);
+	copy[len] = '\0';
+	char* stop = copy;
+	float f = strtof (copy, &stop);
+	size_t used = (size_t)(stop - copy);
+	if (copy != tmp) {
+		free (copy);
+	}
+	if (0 == used) {
+		return str;
+	}
+	*out = f;
+	return str + used;
+}
+
+/* parses a float like strtof would, after skipping whitespace other than
+   '\n', so a missing number isn't taken from the next line. out is left
+   untouched if there is no number */
+static inline const char* apg_parse_float (const char* str, const char* end,
+	float* out) {
+	// exact powers of ten in double precision
+	static const double pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8,
+		1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20,
+		1e21, 1e22 };
+	const char* start = str;
+	while (start < end && (*start == ' ' || *start == '\t' || *start == '\v' ||
+		*start == '\f' || *start == '\r')) {
+		start++;
+	}
+	const char* p = start;
+	bool neg = false;
+	if (p < end && (*p == '-' || *p == '+')) {
+		neg = *p == '-';
+		p++;
+	}
+	if (end - p >= 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+		return apg_parse_float_slow (start, end, out);
+	}
+	uint64_t mantissa = 0;
+	int n_digits = 0, n_int = 0, n_frac = 0, exp10 = 0;
+	p = apg_scan_digits (p, end, &mantissa, &n_digits, &n_int);
+	if (p < end && *p == '.') {
+		p++;
+		p = apg_scan_digits (p, end, &mantissa, &n_digits, &n_frac);
+		exp10 = -n_frac;
+	}
+	if (0 == n_int + n_frac) {
+		// no digits at all: could be inf or nan, or just not a number
+		p = apg_parse_float_slow (start, end, out);
+		return p == start ? str : p;
+	}
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		const char* q = p + 1;
+		bool exp_neg = false;
+		if (q < end && (*q == '-' || *q == '+')) {
+			exp_neg = *q == '-';
+			q++;
+		}
+		if (q < end && apg_is_digit (*q)) {
+			int e = 0;
+			while (q < end && apg_is_digit (*q)) {
+				if (e < 10000) {
+					e = e * 10 + (*q - '0');
+				}
+				q++;
+			}
+			exp10 += exp_neg ? -e : e;
+			p = q;
+		}
+	}
+	if (0 == mantissa) {
+		*out = neg ? -0.0f : 0.0f;
+		return p;
+	}
+	if (n_digits > 19 || mantissa > (1ULL << 53) || exp10 < -22 || exp10 > 22) {
+		return apg_parse_float_slow (start, end, out);
+	}
+	// one correctly-rounded double operation on exact operands
+	double d = (double)mantissa;
+	if (exp10 < 0) {
+		d /= pow10[-exp10];
+	} else {
+		d *= pow10[exp10];
+	}
+	if (d < FLT_MIN || d > FLT_MAX) {
+		return apg_parse_float_slow (start, end, out);
+	}
+	/* rounding to double then to float only goes wrong if the double sits
+	   exactly half-way between two floats - 29 discarded bits of 100..0 */
+	uint64_t bits;
+	memcpy (&bits, &d, sizeof (bits));
+	if ((bits & 0x1FFFFFFFULL) == 0x10000000ULL) {
+		return apg_parse_float_slow (start, end, out);
+	}
+	float f = (float)d;
+	*out = neg ? -f : f;
+	return p;
+}
+
+/* parses a decimal int after skipping spaces/tabs. out is left untouched if
+   there is no number. values beyond int range are clamped */
+static inline const char* apg_parse_int (const char* str, const char* end,
+	int* out) {
+	const char* p = apg_skip_spaces (str, end);
+	bool neg = false;
+	if (p < end && (*p == '-' || *p == '+')) {
+		neg = *p == '-';
+		p++;
+	}
+	if (p >= end || !apg_is_digit (*p)) {
+		return str;
+	}
+	int64_t v = 0;
+	while (p < end && apg_is_digit (*p)) {
+		if (v <= 2147483648LL) {
+			v = v * 10 + (*p - '0');
+		}
+		p++;
+	}
+	if (neg) {
+		v = -v;
+	}
+	if (v > 2147483647LL) {
+		v = 2147483647LL;
+	} else if (v < -2147483647LL - 1) {
+		v = -2147483647LL - 1;
+	}
+	*out = (int)v;
+	return p;
+}
+
+// returns the start of the next line, or end
+static inline const char* apg_next_line (const char* str, const char* end) {
+	const char* eol = (const char*)memchr (str, '\n', (size_t)(end - str));
+	return eol ? eol + 1 : end;
+}